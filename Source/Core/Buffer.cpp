@@ -1,7 +1,6 @@
 #include "Buffer.h"
+#include "Native.h"
 
-#include <Windows.h>
-#include <malloc.h>
 #include <memory.h>
 
 namespace Graphics
@@ -13,23 +12,42 @@ namespace Graphics
 		, m_elementSize(0)
 		, m_sizeInBytes(0)
 		, m_rowSizeInBytes(0)
+		, m_layout(BufferLayout::LINEAR)
+		, m_tilesPerRow(0)
 		, m_data(nullptr)
 	{
 	}
-	Buffer::Buffer(Integer width, Integer height, Integer elementSize, Integer alignment, Integer rowPadding)
+	Buffer::Buffer(Integer width, Integer height, Integer elementSize, Integer alignment, Integer rowPadding, BufferPolicy policy, BufferLayout layout)
 		: m_width(width)
 		, m_height(height)
 		, m_alignment(alignment)
 		, m_elementSize(elementSize)
 		, m_sizeInBytes(0)
 		, m_rowSizeInBytes(0)
+		, m_layout(layout)
+		, m_tilesPerRow(0)
 		, m_data(nullptr)
 	{
-		m_data = ( Byte * ) _aligned_malloc(height * (width * elementSize + rowPadding), alignment);
+		Integer sizeInBytes;
+
+		if ( layout == BufferLayout::TILED )
+		{
+			// row padding is meaningless, whole tiles are allocated
+			m_tilesPerRow	= BufferTiledCount(( u32 ) width);
+			sizeInBytes	= m_tilesPerRow * BufferTiledCount(( u32 ) height) * BUFFER_TILE_SIZE * BUFFER_TILE_SIZE * elementSize;
+		}
+		else
+		{
+			sizeInBytes	= height * (width * elementSize + rowPadding);
+		}
+
+		m_data = ( Byte * ) AlignedMallocEx(sizeInBytes,
+						    alignment,
+						    policy == BufferPolicy::HUGE_PAGE ? NATIVE_ALLOC_HUGE_PAGE : NATIVE_ALLOC_DEFAULT);
 		if ( m_data )
 		{
-			m_rowSizeInBytes = width * elementSize + rowPadding;
-			m_sizeInBytes = height * m_rowSizeInBytes;
+			m_rowSizeInBytes = layout == BufferLayout::TILED ? 0 : width * elementSize + rowPadding;
+			m_sizeInBytes = sizeInBytes;
 			memset(m_data, 0, m_sizeInBytes);
 		}
 	}
@@ -40,6 +58,8 @@ namespace Graphics
 		, m_elementSize(other.m_elementSize)
 		, m_sizeInBytes(other.m_sizeInBytes)
 		, m_rowSizeInBytes(other.m_rowSizeInBytes)
+		, m_layout(other.m_layout)
+		, m_tilesPerRow(other.m_tilesPerRow)
 		, m_data(other.m_data)
 	{
 		new ( &other ) Buffer();
@@ -48,7 +68,7 @@ namespace Graphics
 	{
 		if ( m_data )
 		{
-			_aligned_free(m_data);
+			AlignedFree(m_data);
 			m_data = nullptr;
 		}
 	}
@@ -76,7 +96,9 @@ namespace Graphics
 	{
 		if ( m_data )
 		{
-			memset(m_data, value, m_sizeInBytes);
+			// padding included, one row over the whole allocation
+			BufferRect rect = { m_data, 1, ( u32 ) m_sizeInBytes, ( u32 ) m_sizeInBytes, 1 };
+			Buffer2DFill(&rect, &value);
 		}
 	}
 	Integer		Buffer::Width() const
@@ -115,4 +137,32 @@ namespace Graphics
 	{
 		return m_data;
 	}
+	BufferLayout	Buffer::Layout() const
+	{
+		return m_layout;
+	}
+	BufferRect	Buffer::GetBufferRect()
+	{
+		ASSERT(m_layout == BufferLayout::LINEAR);
+
+		BufferRect rect;
+		rect.pData	= m_data;
+		rect.nRCount	= ( u32 ) m_height;
+		rect.nCCount	= ( u32 ) m_width;
+		rect.nRStride	= ( u32 ) m_rowSizeInBytes;
+		rect.nCStride	= ( u32 ) m_elementSize;
+		return rect;
+	}
+	BufferTiled	Buffer::GetBufferTiled()
+	{
+		ASSERT(m_layout == BufferLayout::TILED);
+
+		BufferTiled tiled;
+		tiled.pData		= m_data;
+		tiled.nRCount		= ( u32 ) m_height;
+		tiled.nCCount		= ( u32 ) m_width;
+		tiled.nTilesPerRow	= m_tilesPerRow;
+		tiled.nCStride		= ( u32 ) m_elementSize;
+		return tiled;
+	}
 }
\ No newline at end of file
@@ -3,15 +3,28 @@
 #include "Common.h"
 #include "Event.h"
 #include "Unknown.h"
+#include "BufferKernels.h"
 
 namespace Graphics
 {
+	enum class BufferPolicy
+	{
+		DEFAULT,
+		HUGE_PAGE,	// large buffers walked every frame: render targets, depth, textures
+	};
+
+	enum class BufferLayout
+	{
+		LINEAR,
+		TILED,		// see BufferTiledIndex, rows/cols padded to whole tiles
+	};
+
 	class Buffer : public IUnknown
 	{
 		_INTERFACE_DEFINE_IID(1611390238);
 	public:
 		Buffer();
-		Buffer(Integer width, Integer height, Integer elementSize, Integer alignment = 1, Integer rowPadding = 0);
+		Buffer(Integer width, Integer height, Integer elementSize, Integer alignment = 1, Integer rowPadding = 0, BufferPolicy policy = BufferPolicy::DEFAULT, BufferLayout layout = BufferLayout::LINEAR);
 
 		Buffer(const Buffer &) = delete;
 		Buffer(Buffer && other);
@@ -29,16 +42,16 @@ namespace Graphics
 		void		SetAllAs(T value)
 		{
 			ASSERT(sizeof(T) == m_elementSize);
-			Byte * pRow = m_data;
-			T * pData;
-			for (Integer r = 0; r < m_height; ++r)
+			if ( m_layout == BufferLayout::TILED )
 			{
-				pData = reinterpret_cast<T *>(pRow);
-				for (Integer c = 0; c < m_width; ++c)
-				{
-					*pData++ = value;
-				}
-				pRow += m_rowSizeInBytes;
+				// padding included, one row over the whole allocation
+				BufferRect rect = { m_data, 1, ( u32 ) ( m_sizeInBytes / m_elementSize ), ( u32 ) m_sizeInBytes, ( u32 ) m_elementSize };
+				Buffer2DFill(&rect, &value);
+			}
+			else
+			{
+				BufferRect rect = GetBufferRect();
+				Buffer2DFill(&rect, &value);
 			}
 		}
 		// TODO: resize (keep properties)
@@ -49,19 +62,30 @@ namespace Graphics
 		Integer		Height() const;
 		Integer		Alignment() const;
 		Integer		SizeInBytes() const;
-		Integer		RowSizeInBytes() const;
+		Integer		RowSizeInBytes() const;	// 0 if tiled
 		Integer		ElementCount() const;
 		Integer		ElementSize() const;
 		const void *	Data() const;
 		void *		Data();
+		BufferLayout	Layout() const;
+		BufferRect	GetBufferRect();	// linear only
+		BufferTiled	GetBufferTiled();	// tiled only
 		const void *	At(Integer row, Integer col) const
 		{
 			ASSERT(m_data);
+			if ( m_layout == BufferLayout::TILED )
+			{
+				return m_data + BufferTiledIndex(m_tilesPerRow, ( u32 ) row, ( u32 ) col) * m_elementSize;
+			}
 			return m_data + row * m_rowSizeInBytes + col * m_elementSize;
 		}
 		void *		At(Integer row, Integer col)
 		{
 			ASSERT(m_data);
+			if ( m_layout == BufferLayout::TILED )
+			{
+				return m_data + BufferTiledIndex(m_tilesPerRow, ( u32 ) row, ( u32 ) col) * m_elementSize;
+			}
 			return m_data + row * m_rowSizeInBytes + col * m_elementSize;
 		}
 
@@ -73,6 +97,8 @@ namespace Graphics
 		Integer		m_elementSize;
 		Integer		m_sizeInBytes;
 		Integer		m_rowSizeInBytes;
+		BufferLayout	m_layout;
+		u32		m_tilesPerRow;
 		Byte *		m_data;
 	};
 }
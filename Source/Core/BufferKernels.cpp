@@ -0,0 +1,643 @@
+#include "BufferKernels_Impl.h"
+#include "Common.h"
+
+#include <cstring>
+#include <memory>
+
+#if defined(BUFFER_KERNEL_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// Scalar rows
+	// ---------------------------------------------------------------
+
+	static void		_FillRowScalar(u8 * pDst, const u8 * pPattern, u32 nBytes, u32 nFlags)
+	{
+		const u32 P = BUFFER_KERNEL_PATTERN_PERIOD;
+		u32 i = 0;
+		for ( ; i + P <= nBytes; i += P )
+		{
+			memcpy(pDst + i, pPattern, P);
+		}
+		memcpy(pDst + i, pPattern, nBytes - i);
+	}
+	static void		_CopyRowScalar(u8 * pDst, const u8 * pSrc, u32 nBytes, u32 nFlags)
+	{
+		memcpy(pDst, pSrc, nBytes);
+	}
+	static void		_CopyRowU8Scalar(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		if ( nFlags & KERNEL_ROW_FLIP_H )
+		{
+			for ( u32 i = 0; i < nCount; ++i )
+			{
+				pDst[ nCount - 1 - i ] = pSrc[ i ];
+			}
+		}
+		else
+		{
+			memcpy(pDst, pSrc, nCount);
+		}
+	}
+	template <u32 (*Convert)(const u8 *), u32 SIZE>
+	static void		_ConvertRowToBGRAScalar(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		u32 * pOut = ( u32 * ) pDst;
+		if ( nFlags & KERNEL_ROW_FLIP_H )
+		{
+			for ( u32 i = 0; i < nCount; ++i )
+			{
+				pOut[ nCount - 1 - i ] = Convert(pSrc + i * SIZE);
+			}
+		}
+		else
+		{
+			for ( u32 i = 0; i < nCount; ++i )
+			{
+				pOut[ i ] = Convert(pSrc + i * SIZE);
+			}
+		}
+	}
+	static void		_ConvertRowU8FromF32Scalar(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		if ( nFlags & KERNEL_ROW_FLIP_H )
+		{
+			for ( u32 i = 0; i < nCount; ++i )
+			{
+				pDst[ nCount - 1 - i ] = KernelGreyFromF32(pSrc + i * 4);
+			}
+		}
+		else
+		{
+			for ( u32 i = 0; i < nCount; ++i )
+			{
+				pDst[ i ] = KernelGreyFromF32(pSrc + i * 4);
+			}
+		}
+	}
+
+	static void		_CompositeRowScalar(u8 * pDstColor, u8 * pDstDepth, const u8 * pSrcColor, const u8 * pSrcDepth, u32 nCount, u32 nColorSize)
+	{
+		for ( u32 i = 0; i < nCount; ++i )
+		{
+			KernelCompositePixel(pDstColor + i * nColorSize, pDstDepth + i * 4, pSrcColor + i * nColorSize, pSrcDepth + i * 4, nColorSize);
+		}
+	}
+
+	static void		_LerpRowScalar(u8 * pDst, const u8 * pA, const u8 * pB, u32 nBytes, u32 nWeight)
+	{
+		for ( u32 i = 0; i < nBytes; ++i )
+		{
+			pDst[ i ] = KernelLerpByte(pA[ i ], pB[ i ], nWeight);
+		}
+	}
+	static void		_SharpenRowScalar(u8 * pDst, const u8 * pUp, const u8 * pMid, const u8 * pDown, u32 nBytes, u32 nSize, u32 nSharpen)
+	{
+		for ( u32 i = 0; i < nBytes; ++i )
+		{
+			u32 l = i >= nSize ? i - nSize : i;
+			u32 r = i + nSize < nBytes ? i + nSize : i;
+			pDst[ i ] = KernelSharpenByte(pUp[ i ], pMid[ i ], pDown[ i ], pMid[ l ], pMid[ r ], nSharpen);
+		}
+	}
+
+	template <u32 SIZE>
+	static void		_YUVRowScalar(u8 * pY0, u8 * pY1, u8 * pU, u8 * pV, const u8 * pSrc0, const u8 * pSrc1, u32 nPairs)
+	{
+		for ( u32 i = 0; i < nPairs; ++i )
+		{
+			KernelYUVPair(pY0 + i * 2, pY1 + i * 2, pU + i, pV + i, pSrc0 + i * 2 * SIZE, pSrc1 + i * 2 * SIZE, SIZE);
+		}
+	}
+
+	const BufferKernelTable	gBufferKernelsScalar =
+	{
+		_FillRowScalar,
+		{
+			_CopyRowScalar,
+			_CopyRowU8Scalar,
+			_ConvertRowToBGRAScalar<KernelBGRAFromBGRA, 4>,
+			_ConvertRowToBGRAScalar<KernelBGRAFromBGR, 3>,
+			_ConvertRowToBGRAScalar<KernelBGRAFromU8, 1>,
+			_ConvertRowToBGRAScalar<KernelBGRAFromF32, 4>,
+			_ConvertRowU8FromF32Scalar,
+		},
+		_CompositeRowScalar,
+		_LerpRowScalar,
+		_SharpenRowScalar,
+		{
+			_YUVRowScalar<3>,
+			_YUVRowScalar<4>,
+		},
+	};
+
+	// ---------------------------------------------------------------
+	// Dispatch
+	// ---------------------------------------------------------------
+
+#if defined(BUFFER_KERNEL_X86)
+	static void		_CpuId(int leaf, int subleaf, int regs[ 4 ])
+	{
+#if defined(_MSC_VER)
+		__cpuidex(regs, leaf, subleaf);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		regs[ 0 ] = ( int ) a; regs[ 1 ] = ( int ) b; regs[ 2 ] = ( int ) c; regs[ 3 ] = ( int ) d;
+#endif
+	}
+	static u64		_XGetBV()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__ __volatile__("xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ));
+		return ( ( u64 ) hi << 32 ) | lo;
+#endif
+	}
+#endif
+
+	static BufferKernelISA	_DetectISA()
+	{
+		BufferKernelISA isa = BUFFER_KERNEL_SCALAR;
+#if defined(BUFFER_KERNEL_X86)
+		int regs[ 4 ];
+
+		_CpuId(0, 0, regs);
+		const int nMaxLeaf = regs[ 0 ];
+
+		_CpuId(1, 0, regs);
+		const bool bSSSE3	= ( regs[ 2 ] & ( 1 << 9 ) ) != 0;
+		const bool bSSE41	= ( regs[ 2 ] & ( 1 << 19 ) ) != 0;
+		const bool bOSXSAVE	= ( regs[ 2 ] & ( 1 << 27 ) ) != 0;
+		const bool bAVX		= ( regs[ 2 ] & ( 1 << 28 ) ) != 0;
+
+		if ( bSSSE3 && bSSE41 )
+		{
+			isa = BUFFER_KERNEL_SSE;
+		}
+		if ( bOSXSAVE && bAVX && nMaxLeaf >= 7 && ( _XGetBV() & 6 ) == 6 )
+		{
+			_CpuId(7, 0, regs);
+			if ( regs[ 1 ] & ( 1 << 5 ) )
+			{
+				isa = BUFFER_KERNEL_AVX2;
+			}
+		}
+#endif
+		return isa;
+	}
+	static BufferKernelISA	_SupportedISA()
+	{
+		static const BufferKernelISA isa = _DetectISA();
+		return isa;
+	}
+	static const BufferKernelTable *	_TableOf(BufferKernelISA isa)
+	{
+		switch ( isa )
+		{
+#if defined(BUFFER_KERNEL_X86)
+			case BUFFER_KERNEL_AVX2:	return &gBufferKernelsAVX2;
+			case BUFFER_KERNEL_SSE:		return &gBufferKernelsSSE;
+#endif
+			default:			return &gBufferKernelsScalar;
+		}
+	}
+
+	static BufferKernelISA		gISA = BUFFER_KERNEL_SCALAR;
+	static const BufferKernelTable *	gpKernels = nullptr;
+
+	static inline const BufferKernelTable *	_Kernels()
+	{
+		// once, whichever device's thread comes first
+		static const bool bInitialized = gpKernels || ( BufferKernelSetISA(_SupportedISA()), true );
+		( void ) bInitialized;
+		return gpKernels;
+	}
+
+	BufferKernelISA		BufferKernelGetISA()
+	{
+		_Kernels();
+		return gISA;
+	}
+	BufferKernelISA		BufferKernelSetISA(BufferKernelISA isa)
+	{
+		gISA		= isa < _SupportedISA() ? isa : _SupportedISA();
+		gpKernels	= _TableOf(gISA);
+		return gISA;
+	}
+
+	// ---------------------------------------------------------------
+	// Kernels
+	// ---------------------------------------------------------------
+
+	static inline u32	_StreamFlag(const BufferRect * pDst)
+	{
+		return ( u64 ) pDst->nRCount * pDst->nRStride >= BUFFER_KERNEL_STREAM_BYTES ? KERNEL_ROW_STREAM : 0;
+	}
+	static inline u8 *	_RowOf(const BufferRect * pRect, u32 r, bool bFlipV)
+	{
+		return pRect->pData + ( u64 ) pRect->nRStride * ( bFlipV ? pRect->nRCount - 1 - r : r );
+	}
+
+	u32			BufferFormatSize(BufferFormat format)
+	{
+		switch ( format )
+		{
+			case BUFFER_FORMAT_U8:		return 1;
+			case BUFFER_FORMAT_BGR:		return 3;
+			case BUFFER_FORMAT_BGRA:	return 4;
+			case BUFFER_FORMAT_F32:		return 4;
+			default:			return 0;
+		}
+	}
+
+	void			Buffer2DFill(const BufferRect * pRect, const void * pValue)
+	{
+		const u32 nSize		= pRect->nCStride;
+		const u32 nRowBytes	= pRect->nCCount * nSize;
+		const u8 * pValueBytes	= ( const u8 * ) pValue;
+
+		ASSERT(nSize > 0 && nRowBytes <= pRect->nRStride);
+
+		if ( BUFFER_KERNEL_PATTERN_PERIOD % nSize != 0 )
+		{
+			for ( u32 r = 0; r < pRect->nRCount; ++r )
+			{
+				u8 * pRow = _RowOf(pRect, r, false);
+				for ( u32 c = 0; c < nRowBytes; c += nSize )
+				{
+					memcpy(pRow + c, pValueBytes, nSize);
+				}
+			}
+			return;
+		}
+
+		u8 pattern[ BUFFER_KERNEL_PATTERN_BYTES ];
+		for ( u32 i = 0; i < BUFFER_KERNEL_PATTERN_BYTES; ++i )
+		{
+			pattern[ i ] = pValueBytes[ i % nSize ];
+		}
+
+		const u32 nFlags = _StreamFlag(pRect);
+		if ( nRowBytes == pRect->nRStride )
+		{
+			_Kernels()->pFillRow(pRect->pData, pattern, nRowBytes * pRect->nRCount, nFlags);
+		}
+		else
+		{
+			for ( u32 r = 0; r < pRect->nRCount; ++r )
+			{
+				_Kernels()->pFillRow(_RowOf(pRect, r, false), pattern, nRowBytes, nFlags);
+			}
+		}
+	}
+
+	void			Buffer2DCopy(const BufferRect * pDst, const BufferRect * pSrc, int flip)
+	{
+		const u32 nSize		= pDst->nCStride;
+		const u32 nRowBytes	= pDst->nCCount * nSize;
+		const bool bFlipH	= ( flip & BUFFER_FLIP_H ) != 0;
+		const bool bFlipV	= ( flip & BUFFER_FLIP_V ) != 0;
+
+		ASSERT(pDst->nRCount == pSrc->nRCount && pDst->nCCount == pSrc->nCCount);
+		ASSERT(pDst->nCStride == pSrc->nCStride);
+
+		if ( !bFlipH )
+		{
+			const u32 nFlags = _StreamFlag(pDst);
+			if ( !bFlipV && pDst->nRStride == nRowBytes && pSrc->nRStride == nRowBytes )
+			{
+				_Kernels()->pConvertRow[ KERNEL_COPY_BYTES ](pDst->pData, pSrc->pData, nRowBytes * pDst->nRCount, nFlags);
+			}
+			else
+			{
+				for ( u32 r = 0; r < pDst->nRCount; ++r )
+				{
+					_Kernels()->pConvertRow[ KERNEL_COPY_BYTES ](_RowOf(pDst, r, bFlipV), _RowOf(pSrc, r, false), nRowBytes, nFlags);
+				}
+			}
+		}
+		else if ( nSize == 1 || nSize == 4 )
+		{
+			KernelConvertRow pRow = _Kernels()->pConvertRow[ nSize == 1 ? KERNEL_COPY_U8 : KERNEL_COPY_U32 ];
+			for ( u32 r = 0; r < pDst->nRCount; ++r )
+			{
+				pRow(_RowOf(pDst, r, bFlipV), _RowOf(pSrc, r, false), pDst->nCCount, KERNEL_ROW_FLIP_H);
+			}
+		}
+		else
+		{
+			for ( u32 r = 0; r < pDst->nRCount; ++r )
+			{
+				u8 * pDstRow = _RowOf(pDst, r, bFlipV);
+				const u8 * pSrcRow = _RowOf(pSrc, r, false);
+				for ( u32 c = 0; c < pDst->nCCount; ++c )
+				{
+					memcpy(pDstRow + ( pDst->nCCount - 1 - c ) * nSize, pSrcRow + c * nSize, nSize);
+				}
+			}
+		}
+	}
+
+	static bool		_FindConversion(BufferFormat dstFormat, BufferFormat srcFormat, KernelConversion * pConv)
+	{
+		if ( dstFormat == BUFFER_FORMAT_BGRA && srcFormat == BUFFER_FORMAT_BGR )	*pConv = KERNEL_BGRA_FROM_BGR;
+		else if ( dstFormat == BUFFER_FORMAT_BGRA && srcFormat == BUFFER_FORMAT_U8 )	*pConv = KERNEL_BGRA_FROM_U8;
+		else if ( dstFormat == BUFFER_FORMAT_BGRA && srcFormat == BUFFER_FORMAT_F32 )	*pConv = KERNEL_BGRA_FROM_F32;
+		else if ( dstFormat == BUFFER_FORMAT_U8 && srcFormat == BUFFER_FORMAT_F32 )	*pConv = KERNEL_U8_FROM_F32;
+		else										return false;
+		return true;
+	}
+
+	bool			Buffer2DConvert(const BufferRect * pDst, BufferFormat dstFormat, const BufferRect * pSrc, BufferFormat srcFormat, int flip)
+	{
+		KernelConversion conv;
+
+		if ( dstFormat == srcFormat )
+		{
+			Buffer2DCopy(pDst, pSrc, flip);
+			return true;
+		}
+
+		if ( !_FindConversion(dstFormat, srcFormat, &conv) )
+		{
+			return false;
+		}
+
+		ASSERT(pDst->nRCount == pSrc->nRCount && pDst->nCCount == pSrc->nCCount);
+		ASSERT(pDst->nCStride == BufferFormatSize(dstFormat) && pSrc->nCStride == BufferFormatSize(srcFormat));
+
+		const bool bFlipV	= ( flip & BUFFER_FLIP_V ) != 0;
+		const u32 nFlags	= ( flip & BUFFER_FLIP_H ) ? KERNEL_ROW_FLIP_H : _StreamFlag(pDst);
+		KernelConvertRow pRow	= _Kernels()->pConvertRow[ conv ];
+
+		for ( u32 r = 0; r < pDst->nRCount; ++r )
+		{
+			pRow(_RowOf(pDst, r, bFlipV), _RowOf(pSrc, r, false), pDst->nCCount, nFlags);
+		}
+		return true;
+	}
+
+	void			Buffer2DDepthComposite(const BufferRect * pDstColor, const BufferRect * pDstDepth, const BufferRect * pSrcColor, const BufferRect * pSrcDepth)
+	{
+		const u32 nColorSize	= pDstColor->nCStride;
+		KernelCompositeRow pRow	= _Kernels()->pCompositeRow;
+
+		ASSERT(pDstColor->nRCount == pSrcColor->nRCount && pDstColor->nCCount == pSrcColor->nCCount);
+		ASSERT(pDstDepth->nRCount == pDstColor->nRCount && pDstDepth->nCCount == pDstColor->nCCount);
+		ASSERT(pSrcDepth->nRCount == pDstColor->nRCount && pSrcDepth->nCCount == pDstColor->nCCount);
+		ASSERT(pSrcColor->nCStride == nColorSize && pDstDepth->nCStride == 4 && pSrcDepth->nCStride == 4);
+
+		for ( u32 r = 0; r < pDstColor->nRCount; ++r )
+		{
+			pRow(_RowOf(pDstColor, r, false), _RowOf(pDstDepth, r, false), _RowOf(pSrcColor, r, false), _RowOf(pSrcDepth, r, false), pDstColor->nCCount, nColorSize);
+		}
+	}
+
+	// source position of a destination pixel center, as index and
+	// weight of the next index in [0, 256]
+	static inline void	_UpscaleTap(u32 nDst, u32 nDstCount, u32 nSrcCount, u32 * pIndex, u32 * pWeight)
+	{
+		f32 f = ( nDst + 0.5f ) * nSrcCount / nDstCount - 0.5f;
+		f = f < 0.0f ? 0.0f : ( f > nSrcCount - 1 ? ( f32 ) ( nSrcCount - 1 ) : f );
+
+		u32 i		= ( u32 ) f;
+		*pIndex		= i;
+		*pWeight	= i + 1 < nSrcCount ? ( u32 ) ( ( f - i ) * 256.0f + 0.5f ) : 0;
+	}
+
+	void			Buffer2DUpscale(const BufferRect * pDst, const BufferRect * pSrc, u32 nSharpen)
+	{
+		const u32 nSize		= pDst->nCStride;
+		const u32 nSrcBytes	= pSrc->nCCount * nSize;
+		const u32 nDstBytes	= pDst->nCCount * nSize;
+		const BufferKernelTable * pKernels = _Kernels();
+
+		ASSERT(pSrc->nCStride == nSize && nSize <= 4);
+		ASSERT(pSrc->nRCount > 0 && pSrc->nCCount > 0);
+		ASSERT(nSharpen <= BUFFER_SHARPEN_MAX);
+
+		// horizontal taps are the same for every row
+		std::unique_ptr<u32[]> taps(new u32[ pDst->nCCount * 2 ]);
+		for ( u32 c = 0; c < pDst->nCCount; ++c )
+		{
+			_UpscaleTap(c, pDst->nCCount, pSrc->nCCount, &taps[ c * 2 ], &taps[ c * 2 + 1 ]);
+		}
+
+		// vertical blend with the row kernel, horizontal per element
+		std::unique_ptr<u8[]> blend(new u8[ nSrcBytes + nSize ]);
+		for ( u32 r = 0; r < pDst->nRCount; ++r )
+		{
+			u32 nRow, nWeight;
+			_UpscaleTap(r, pDst->nRCount, pSrc->nRCount, &nRow, &nWeight);
+
+			const u8 * pA = _RowOf(pSrc, nRow, false);
+			if ( nWeight > 0 )
+			{
+				pKernels->pLerpRow(blend.get(), pA, _RowOf(pSrc, nRow + 1, false), nSrcBytes, nWeight);
+			}
+			else
+			{
+				memcpy(blend.get(), pA, nSrcBytes);
+			}
+			memcpy(blend.get() + nSrcBytes, blend.get() + nSrcBytes - nSize, nSize);	// right edge tap
+
+			u8 * pOut = _RowOf(pDst, r, false);
+			for ( u32 c = 0; c < pDst->nCCount; ++c )
+			{
+				const u8 * p	= blend.get() + taps[ c * 2 ] * nSize;
+				const u32 w	= taps[ c * 2 + 1 ];
+				for ( u32 k = 0; k < nSize; ++k )
+				{
+					pOut[ c * nSize + k ] = KernelLerpByte(p[ k ], p[ k + nSize ], w);
+				}
+			}
+		}
+
+		if ( nSharpen == 0 )
+		{
+			return;
+		}
+
+		// in place, keeping the unsharpened row above and the current one
+		std::unique_ptr<u8[]> rows(new u8[ nDstBytes * 2 ]);
+		u8 * pUp	= rows.get();
+		u8 * pMid	= rows.get() + nDstBytes;
+		memcpy(pUp, _RowOf(pDst, 0, false), nDstBytes);
+		for ( u32 r = 0; r < pDst->nRCount; ++r )
+		{
+			u8 * pOut = _RowOf(pDst, r, false);
+			memcpy(pMid, pOut, nDstBytes);
+
+			const u8 * pDown = r + 1 < pDst->nRCount ? _RowOf(pDst, r + 1, false) : pMid;
+			pKernels->pSharpenRow(pOut, pUp, pMid, pDown, nDstBytes, nSize, nSharpen);
+
+			u8 * pSwap = pUp;
+			pUp = pMid;
+			pMid = pSwap;
+		}
+	}
+
+	void			Buffer2DToYUV420(u8 * pY, u8 * pU, u8 * pV, const BufferRect * pSrc, BufferFormat srcFormat)
+	{
+		const u32 nWidth	= pSrc->nCCount;
+		const u32 nHeight	= pSrc->nRCount;
+		const u32 nChroma	= ( nWidth + 1 ) / 2;
+		const u32 nSize		= pSrc->nCStride;
+		KernelYUVRow pRow	= _Kernels()->pYUVRow[ srcFormat == BUFFER_FORMAT_BGRA ? 1 : 0 ];
+
+		ASSERT(( srcFormat == BUFFER_FORMAT_BGR || srcFormat == BUFFER_FORMAT_BGRA ) && nSize == BufferFormatSize(srcFormat));
+
+		for ( u32 r = 0; r < nHeight; r += 2 )
+		{
+			// an odd last row pairs with itself
+			const u32 r1		= r + 1 < nHeight ? r + 1 : r;
+			const u8 * pSrc0	= _RowOf(pSrc, r, false);
+			const u8 * pSrc1	= _RowOf(pSrc, r1, false);
+			u8 * pY0		= pY + ( u64 ) r * nWidth;
+			u8 * pY1		= pY + ( u64 ) r1 * nWidth;
+			u8 * pURow		= pU + ( u64 ) ( r / 2 ) * nChroma;
+			u8 * pVRow		= pV + ( u64 ) ( r / 2 ) * nChroma;
+
+			pRow(pY0, pY1, pURow, pVRow, pSrc0, pSrc1, nWidth / 2);
+
+			// and so does an odd last column
+			if ( nWidth & 1 )
+			{
+				const u8 * p0	= pSrc0 + ( nWidth - 1 ) * nSize;
+				const u8 * p1	= pSrc1 + ( nWidth - 1 ) * nSize;
+				pY0[ nWidth - 1 ] = KernelLuma(p0);
+				pY1[ nWidth - 1 ] = KernelLuma(p1);
+				KernelChroma(2 * ( p0[ 0 ] + p1[ 0 ] ), 2 * ( p0[ 1 ] + p1[ 1 ] ), 2 * ( p0[ 2 ] + p1[ 2 ] ), pURow + nChroma - 1, pVRow + nChroma - 1);
+			}
+		}
+	}
+
+	// ---------------------------------------------------------------
+	// Tiled
+	// ---------------------------------------------------------------
+
+	typedef void		( *DetileBand )( u8 * const * ppRows, u32 nRows, const BufferTiled * pSrc, u32 nTop );
+
+	// nTop is micro tile aligned, every micro tile is read whole and
+	// spread over up to 4 output rows
+	template <u32 SIZE>
+	static void		_DetileBand(u8 * const * ppRows, u32 nRows, const BufferTiled * pSrc, u32 nTop)
+	{
+		const u32 RUN		= BUFFER_MICRO_TILE_SIZE * SIZE;
+		const u32 nFull		= pSrc->nCCount & ~( BUFFER_MICRO_TILE_SIZE - 1 );
+
+		u32 c = 0;
+		for ( ; c < nFull; c += BUFFER_MICRO_TILE_SIZE )
+		{
+			const u8 * pMicro = pSrc->pData + ( u64 ) BufferTiledIndex(pSrc->nTilesPerRow, nTop, c) * SIZE;
+			for ( u32 y = 0; y < nRows; ++y )
+			{
+				memcpy(ppRows[ y ] + c * SIZE, pMicro + y * RUN, RUN);
+			}
+		}
+		if ( c < pSrc->nCCount )
+		{
+			const u8 * pMicro = pSrc->pData + ( u64 ) BufferTiledIndex(pSrc->nTilesPerRow, nTop, c) * SIZE;
+			for ( u32 y = 0; y < nRows; ++y )
+			{
+				memcpy(ppRows[ y ] + c * SIZE, pMicro + y * RUN, ( pSrc->nCCount - c ) * SIZE);
+			}
+		}
+	}
+
+	void			Buffer2DFillTiled(const BufferTiled * pTiled, u32 nTop, u32 nLeft, u32 nBottom, u32 nRight, const void * pValue)
+	{
+		const u32 nSize = pTiled->nCStride;
+		u8 run[ BUFFER_MICRO_TILE_SIZE * 16 ];
+
+		ASSERT(nSize > 0 && nSize <= 16);
+		ASSERT(nTop <= nBottom && nBottom <= pTiled->nRCount && nLeft <= nRight && nRight <= pTiled->nCCount);
+
+		for ( u32 i = 0; i < BUFFER_MICRO_TILE_SIZE; ++i )
+		{
+			memcpy(run + i * nSize, pValue, nSize);
+		}
+
+		// contiguous runs end at micro tile columns
+		for ( u32 r = nTop; r < nBottom; ++r )
+		{
+			for ( u32 c = nLeft; c < nRight; )
+			{
+				u32 nRun = BUFFER_MICRO_TILE_SIZE - ( c & ( BUFFER_MICRO_TILE_SIZE - 1 ) );
+				nRun = nRun < nRight - c ? nRun : nRight - c;
+
+				memcpy(pTiled->pData + ( u64 ) BufferTiledIndex(pTiled->nTilesPerRow, r, c) * nSize, run, nRun * nSize);
+				c += nRun;
+			}
+		}
+	}
+
+	bool			Buffer2DLinearize(const BufferRect * pDst, BufferFormat dstFormat, const BufferTiled * pSrc, BufferFormat srcFormat, int flip)
+	{
+		const u32 nSrcSize	= BufferFormatSize(srcFormat);
+		const bool bFlipV	= ( flip & BUFFER_FLIP_V ) != 0;
+		// same format and no mirroring: detile straight into the target
+		const bool bDirect	= dstFormat == srcFormat && !( flip & BUFFER_FLIP_H );
+		KernelConversion conv;
+		DetileBand pDetile;
+
+		switch ( nSrcSize )
+		{
+			case 1:		pDetile = _DetileBand<1>; break;
+			case 3:		pDetile = _DetileBand<3>; break;
+			case 4:		pDetile = _DetileBand<4>; break;
+			default:	return false;
+		}
+		if ( dstFormat != srcFormat && !_FindConversion(dstFormat, srcFormat, &conv) )
+		{
+			return false;
+		}
+
+		ASSERT(pDst->nRCount == pSrc->nRCount && pDst->nCCount == pSrc->nCCount);
+		ASSERT(pSrc->nCStride == nSrcSize);
+
+		std::unique_ptr<u8[]> stage;
+		BufferRect brStage = {};
+		if ( !bDirect )
+		{
+			brStage.nCCount		= pSrc->nCCount;
+			brStage.nRStride	= pSrc->nCCount * nSrcSize;
+			brStage.nCStride	= nSrcSize;
+			stage.reset(new u8[ BUFFER_MICRO_TILE_SIZE * brStage.nRStride ]);
+			brStage.pData		= stage.get();
+		}
+
+		for ( u32 r = 0; r < pSrc->nRCount; r += BUFFER_MICRO_TILE_SIZE )
+		{
+			const u32 nRows = pSrc->nRCount - r < BUFFER_MICRO_TILE_SIZE ? pSrc->nRCount - r : BUFFER_MICRO_TILE_SIZE;
+			u8 * pRows[ BUFFER_MICRO_TILE_SIZE ];
+
+			for ( u32 y = 0; y < nRows; ++y )
+			{
+				pRows[ y ] = bDirect ? _RowOf(pDst, r + y, bFlipV) : brStage.pData + y * brStage.nRStride;
+			}
+			pDetile(pRows, nRows, pSrc, r);
+
+			if ( !bDirect )
+			{
+				BufferRect brBand	= brStage;
+				BufferRect brDst	= *pDst;
+				brBand.nRCount		= nRows;
+				brDst.nRCount		= nRows;
+				brDst.pData		= pDst->pData + ( u64 ) pDst->nRStride * ( bFlipV ? pDst->nRCount - r - nRows : r );
+				Buffer2DConvert(&brDst, dstFormat, &brBand, srcFormat, flip);
+			}
+		}
+		return true;
+	}
+}
\ No newline at end of file
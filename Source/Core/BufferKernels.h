@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Graphics.h"
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// Bulk kernels over BufferRect
+	//
+	// Fill, copy and pixel format conversion with optional flips, one
+	// implementation per instruction set, picked once at first use.
+	// Targets larger than BUFFER_KERNEL_STREAM_BYTES are written with
+	// non-temporal stores so they don't evict the working set.
+	// ---------------------------------------------------------------
+
+	enum BufferFormat
+	{
+		BUFFER_FORMAT_UNKNOWN	= 0,
+		BUFFER_FORMAT_U8	= 1,	// grey
+		BUFFER_FORMAT_BGR	= 2,
+		BUFFER_FORMAT_BGRA	= 3,
+		BUFFER_FORMAT_F32	= 4,	// grey, [0, 1]
+	};
+
+	enum BufferFlip
+	{
+		BUFFER_FLIP_NONE	= 0,
+		BUFFER_FLIP_H		= 1,
+		BUFFER_FLIP_V		= 2,
+		BUFFER_FLIP_HV		= BUFFER_FLIP_H | BUFFER_FLIP_V,
+	};
+
+	enum BufferKernelISA
+	{
+		BUFFER_KERNEL_SCALAR	= 0,
+		BUFFER_KERNEL_SSE	= 1,	// SSE4.1
+		BUFFER_KERNEL_AVX2	= 2,
+	};
+
+	#define BUFFER_KERNEL_STREAM_BYTES	(4u << 20)
+
+	u32			BufferFormatSize(BufferFormat format);
+
+	// element size is pRect->nCStride, pValue points to one element
+	void			Buffer2DFill(const BufferRect * pRect, const void * pValue);
+	// same element size, same extent
+	void			Buffer2DCopy(const BufferRect * pDst, const BufferRect * pSrc, int flip);
+	// BGR/U8/F32 -> BGRA, F32 -> U8, or a copy if formats are equal
+	bool			Buffer2DConvert(const BufferRect * pDst, BufferFormat dstFormat, const BufferRect * pSrc, BufferFormat srcFormat, int flip);
+
+	// ---------------------------------------------------------------
+	// Depth compositing
+	//
+	// Sort-last merge: where the source depth (F32) is less than the
+	// destination's, source color and depth replace the destination's.
+	// All four rects share the extent, colors share the element size.
+	// ---------------------------------------------------------------
+
+	void			Buffer2DDepthComposite(const BufferRect * pDstColor, const BufferRect * pDstDepth, const BufferRect * pSrcColor, const BufferRect * pSrcDepth);
+
+	// ---------------------------------------------------------------
+	// Upscaling
+	//
+	// Bilinear stretch of pSrc over pDst (pixel centers aligned, same
+	// element size of at most 4 bytes), then an unsharp pass of strength
+	// nSharpen / 16 to win back some of the detail lost to filtering.
+	// ---------------------------------------------------------------
+
+	#define BUFFER_SHARPEN_MAX	(16)
+
+	void			Buffer2DUpscale(const BufferRect * pDst, const BufferRect * pSrc, u32 nSharpen);
+
+	// ---------------------------------------------------------------
+	// YUV 4:2:0
+	//
+	// BGR or BGRA to planar full range YCbCr (JPEG, BT.601 weights),
+	// chroma averaged over 2x2 blocks, odd edges paired with themselves.
+	// Planes are packed: Y is nCCount x nRCount, U and V are
+	// ( nCCount + 1 ) / 2 x ( nRCount + 1 ) / 2.
+	// ---------------------------------------------------------------
+
+	void			Buffer2DToYUV420(u8 * pY, u8 * pU, u8 * pV, const BufferRect * pSrc, BufferFormat srcFormat);
+
+	// ---------------------------------------------------------------
+	// Tiled layout
+	//
+	// 64x64 element tiles, row major. Inside a tile 4x4 micro tiles in
+	// Morton order, each micro tile row major. A 4x4 block of 32-bit
+	// elements is one cache line and a tile spans a few pages, so the
+	// neighbourhood of a triangle stays close in memory.
+	// ---------------------------------------------------------------
+
+	#define BUFFER_TILE_SHIFT	(6)
+	#define BUFFER_TILE_SIZE	(1u << BUFFER_TILE_SHIFT)
+	#define BUFFER_MICRO_TILE_SHIFT	(2)
+	#define BUFFER_MICRO_TILE_SIZE	(1u << BUFFER_MICRO_TILE_SHIFT)
+
+	struct BufferTiled
+	{
+		u8 *	pData;
+		u32	nRCount;	// const
+		u32	nCCount;	// const
+		u32	nTilesPerRow;	// const
+		u32	nCStride;	// const
+	};
+
+	inline u32		BufferTiledCount(u32 n)
+	{
+		return ( n + BUFFER_TILE_SIZE - 1 ) >> BUFFER_TILE_SHIFT;
+	}
+	// element index of (row, col)
+	inline u32		BufferTiledIndex(u32 nTilesPerRow, u32 row, u32 col)
+	{
+		// spread micro tile x to even bits, y to odd bits
+		u32 x = ( col >> BUFFER_MICRO_TILE_SHIFT ) & 0xf;
+		u32 y = ( row >> BUFFER_MICRO_TILE_SHIFT ) & 0xf;
+		x = ( x | ( x << 2 ) ) & 0x33;
+		x = ( x | ( x << 1 ) ) & 0x55;
+		y = ( y | ( y << 2 ) ) & 0x33;
+		y = ( y | ( y << 1 ) ) & 0x55;
+
+		return ( ( ( row >> BUFFER_TILE_SHIFT ) * nTilesPerRow + ( col >> BUFFER_TILE_SHIFT ) ) << ( 2 * BUFFER_TILE_SHIFT ) ) |
+		       ( ( x | ( y << 1 ) ) << ( 2 * BUFFER_MICRO_TILE_SHIFT ) ) |
+		       ( ( row & ( BUFFER_MICRO_TILE_SIZE - 1 ) ) << BUFFER_MICRO_TILE_SHIFT ) |
+		       ( col & ( BUFFER_MICRO_TILE_SIZE - 1 ) );
+	}
+
+	// fill rows [nTop, nBottom), cols [nLeft, nRight)
+	void			Buffer2DFillTiled(const BufferTiled * pTiled, u32 nTop, u32 nLeft, u32 nBottom, u32 nRight, const void * pValue);
+	// detile into a linear rect of the same extent, then as Buffer2DConvert
+	bool			Buffer2DLinearize(const BufferRect * pDst, BufferFormat dstFormat, const BufferTiled * pSrc, BufferFormat srcFormat, int flip);
+
+	BufferKernelISA		BufferKernelGetISA();
+	BufferKernelISA		BufferKernelSetISA(BufferKernelISA isa);	// clamped to what the cpu supports
+}
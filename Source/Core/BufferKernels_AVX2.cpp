@@ -0,0 +1,144 @@
+#include "BufferKernels.h"
+
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+
+// Everything below is built for AVX2 and only reached after a cpuid check.
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#pragma GCC target("avx2")
+#endif
+
+#include "BufferKernels_Impl.h"
+
+#if defined(BUFFER_KERNEL_X86)
+
+namespace Graphics
+{
+	struct KernelAVX2
+	{
+		typedef __m256i		Reg;
+		enum { BYTES = 32, PIXELS = 8 };
+
+		static inline Reg	LoadU(const void * p)		{ return _mm256_loadu_si256(( const __m256i * ) p); }
+		static inline void	StoreU(void * p, Reg v)		{ _mm256_storeu_si256(( __m256i * ) p, v); }
+		static inline void	Stream(void * p, Reg v)		{ _mm256_stream_si256(( __m256i * ) p, v); }
+		static inline void	Fence()				{ _mm_sfence(); }
+
+		static inline u32	LessMask(const u8 * a, const u8 * b)
+		{
+			return ( u32 ) _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(( const float * ) a), _mm256_loadu_ps(( const float * ) b), _CMP_LT_OQ));
+		}
+
+		static inline Reg	Set16(u32 n)			{ return _mm256_set1_epi16(( short ) n); }
+		// (a (256 - w) + b w + 128) >> 8 per byte, 16-bit lanes stay unsigned.
+		// unpack and pack both work per 128-bit lane, so byte order holds.
+		static inline Reg	Lerp(Reg a, Reg b, Reg w)
+		{
+			const Reg z	= _mm256_setzero_si256();
+			const Reg wa	= _mm256_sub_epi16(_mm256_set1_epi16(256), w);
+			const Reg round	= _mm256_set1_epi16(128);
+			Reg lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, z), wa), _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, z), w)), round);
+			Reg hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, z), wa), _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, z), w)), round);
+			return _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+		}
+		static inline Reg	SharpenHalf(Reg up, Reg mid, Reg down, Reg left, Reg right, Reg s)
+		{
+			Reg e = _mm256_sub_epi16(_mm256_slli_epi16(mid, 2), _mm256_add_epi16(_mm256_add_epi16(up, down), _mm256_add_epi16(left, right)));
+			return _mm256_add_epi16(mid, _mm256_srai_epi16(_mm256_mullo_epi16(e, s), 4));
+		}
+		static inline Reg	Sharpen(Reg up, Reg mid, Reg down, Reg left, Reg right, Reg s)
+		{
+			const Reg z = _mm256_setzero_si256();
+			Reg lo = SharpenHalf(_mm256_unpacklo_epi8(up, z), _mm256_unpacklo_epi8(mid, z), _mm256_unpacklo_epi8(down, z),
+					     _mm256_unpacklo_epi8(left, z), _mm256_unpacklo_epi8(right, z), s);
+			Reg hi = SharpenHalf(_mm256_unpackhi_epi8(up, z), _mm256_unpackhi_epi8(mid, z), _mm256_unpackhi_epi8(down, z),
+					     _mm256_unpackhi_epi8(left, z), _mm256_unpackhi_epi8(right, z), s);
+			return _mm256_packus_epi16(lo, hi);
+		}
+
+		static inline Reg	Reverse32(Reg v)
+		{
+			return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+		}
+		static inline Reg	Reverse8(Reg v)
+		{
+			const Reg mask = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+							  15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+			v = _mm256_shuffle_epi8(v, mask);
+			return _mm256_permute2x128_si256(v, v, 0x01);
+		}
+
+		static inline Reg	FromBGR(const u8 * p)
+		{
+			const Reg mask = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+							  0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			Reg v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(( const __m128i * ) p)),
+							_mm_loadu_si128(( const __m128i * ) ( p + 12 )),
+							1);
+			return _mm256_or_si256(_mm256_shuffle_epi8(v, mask), _mm256_set1_epi32(( int ) 0xff000000));
+		}
+		static inline Reg	FromU8(const u8 * p)
+		{
+			return Grey(_mm256_cvtepu8_epi32(_mm_loadl_epi64(( const __m128i * ) p)));
+		}
+		static inline Reg	GreyFromF32(const u8 * p)
+		{
+			__m256 f = _mm256_mul_ps(_mm256_loadu_ps(( const float * ) p), _mm256_set1_ps(255.0f));
+			f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+			return _mm256_cvttps_epi32(f);
+		}
+		static inline Reg	Grey(Reg grey)
+		{
+			return _mm256_or_si256(_mm256_mullo_epi32(grey, _mm256_set1_epi32(0x010101)), _mm256_set1_epi32(( int ) 0xff000000));
+		}
+		static inline Reg	PackGrey(Reg a, Reg b, Reg c, Reg d)
+		{
+			// packs work per 128-bit lane, put the dwords back in order afterwards
+			Reg v = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+			return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		}
+
+		// As the SSE ones, per 128-bit lane, each lane's first dword holds
+		// its result bytes
+		static inline void	Luma(u8 * pY, Reg bgra)
+		{
+			const Reg z = _mm256_setzero_si256();
+			const Reg w = _mm256_setr_epi16(KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0, KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0,
+							KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0, KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0);
+			Reg lo	= _mm256_madd_epi16(_mm256_unpacklo_epi8(bgra, z), w);
+			Reg hi	= _mm256_madd_epi16(_mm256_unpackhi_epi8(bgra, z), w);
+			Reg y	= _mm256_srli_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), _mm256_set1_epi32(1 << 14)), 15);
+			y	= _mm256_packus_epi16(_mm256_packus_epi32(y, z), z);
+			y	= _mm256_permutevar8x32_epi32(y, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+			_mm_storel_epi64(( __m128i * ) pY, _mm256_castsi256_si128(y));
+		}
+		static inline void	Chroma(u8 * pU, u8 * pV, Reg a, Reg b)
+		{
+			const Reg z = _mm256_setzero_si256();
+			const Reg wu = _mm256_setr_epi16(KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0, KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0,
+							 KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0, KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0);
+			const Reg wv = _mm256_setr_epi16(KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0, KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0,
+							 KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0, KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0);
+			Reg lo	= _mm256_add_epi16(_mm256_unpacklo_epi8(a, z), _mm256_unpacklo_epi8(b, z));
+			Reg hi	= _mm256_add_epi16(_mm256_unpackhi_epi8(a, z), _mm256_unpackhi_epi8(b, z));
+			lo	= _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+			hi	= _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+			Reg s	= _mm256_unpacklo_epi64(lo, hi);
+			Reg uv	= _mm256_hadd_epi32(_mm256_madd_epi16(s, wu), _mm256_madd_epi16(s, wv));
+			uv	= _mm256_srai_epi32(_mm256_add_epi32(uv, _mm256_set1_epi32(KERNEL_UV_BIAS)), 15);
+			uv	= _mm256_packus_epi16(_mm256_packus_epi32(uv, z), z);
+			uv	= _mm256_permutevar8x32_epi32(uv, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+			// u0 u1 v0 v1 u2 u3 v2 v3 -> u0 u1 u2 u3 v0 v1 v2 v3
+			__m128i uv8 = _mm_shuffle_epi8(_mm256_castsi256_si128(uv), _mm_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+			int u4	= _mm_cvtsi128_si32(uv8);
+			int v4	= _mm_cvtsi128_si32(_mm_srli_si128(uv8, 4));
+			memcpy(pU, &u4, 4);
+			memcpy(pV, &v4, 4);
+		}
+	};
+
+	const BufferKernelTable	gBufferKernelsAVX2 = BUFFER_KERNEL_TABLE(KernelAVX2);
+}
+
+#endif
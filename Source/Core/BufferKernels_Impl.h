@@ -0,0 +1,519 @@
+#pragma once
+
+// Internal to BufferKernels*.cpp: row kernels and the per-isa tables.
+// Isa files include this after their target pragma, so everything here
+// must stay static or templated to keep other isas out of the scalar path.
+
+#include "BufferKernels.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BUFFER_KERNEL_X86
+#endif
+
+#define BUFFER_KERNEL_PATTERN_PERIOD	(96)	// lcm of 32 and every element size we fill with
+#define BUFFER_KERNEL_PATTERN_BYTES	(BUFFER_KERNEL_PATTERN_PERIOD + 32)
+
+namespace Graphics
+{
+	enum
+	{
+		KERNEL_ROW_FLIP_H	= 1,
+		KERNEL_ROW_STREAM	= 2,
+	};
+
+	enum KernelConversion
+	{
+		KERNEL_COPY_BYTES,	// nCount bytes, no flip
+		KERNEL_COPY_U8,		// 1-byte elements
+		KERNEL_COPY_U32,	// 4-byte elements
+		KERNEL_BGRA_FROM_BGR,
+		KERNEL_BGRA_FROM_U8,
+		KERNEL_BGRA_FROM_F32,
+		KERNEL_U8_FROM_F32,
+		KERNEL_CONVERSION_COUNT,
+	};
+
+	typedef void (*KernelFillRow)(u8 * pDst, const u8 * pPattern, u32 nBytes, u32 nFlags);
+	typedef void (*KernelConvertRow)(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags);
+	typedef void (*KernelCompositeRow)(u8 * pDstColor, u8 * pDstDepth, const u8 * pSrcColor, const u8 * pSrcDepth, u32 nCount, u32 nColorSize);
+	typedef void (*KernelLerpRow)(u8 * pDst, const u8 * pA, const u8 * pB, u32 nBytes, u32 nWeight);
+	typedef void (*KernelSharpenRow)(u8 * pDst, const u8 * pUp, const u8 * pMid, const u8 * pDown, u32 nBytes, u32 nSize, u32 nSharpen);
+	// two source rows of nPairs * 2 pixels to two luma rows and a chroma row
+	typedef void (*KernelYUVRow)(u8 * pY0, u8 * pY1, u8 * pU, u8 * pV, const u8 * pSrc0, const u8 * pSrc1, u32 nPairs);
+
+	struct BufferKernelTable
+	{
+		KernelFillRow		pFillRow;
+		KernelConvertRow	pConvertRow[ KERNEL_CONVERSION_COUNT ];
+		KernelCompositeRow	pCompositeRow;
+		KernelLerpRow		pLerpRow;
+		KernelSharpenRow	pSharpenRow;
+		KernelYUVRow		pYUVRow[ 2 ];	// from BGR, BGRA
+	};
+
+	extern const BufferKernelTable	gBufferKernelsScalar;
+	extern const BufferKernelTable	gBufferKernelsSSE;
+	extern const BufferKernelTable	gBufferKernelsAVX2;
+
+	// ---------------------------------------------------------------
+	// Scalar pixel conversions, also used for row heads and tails
+	// ---------------------------------------------------------------
+
+	static inline u8	KernelGreyFromF32(const u8 * p)
+	{
+		f32 f = *( const f32 * ) p * 255.0f;
+		f = f < 0.0f ? 0.0f : ( f > 255.0f ? 255.0f : f );
+		return ( u8 ) f;
+	}
+	static inline u32	KernelBGRAFromGrey(u32 grey)
+	{
+		return 0xff000000 | ( grey << 16 ) | ( grey << 8 ) | grey;
+	}
+	static inline u32	KernelBGRAFromBGRA(const u8 * p)
+	{
+		return *( const u32 * ) p;
+	}
+	static inline u32	KernelBGRAFromBGR(const u8 * p)
+	{
+		return 0xff000000 | ( p[ 2 ] << 16 ) | ( p[ 1 ] << 8 ) | p[ 0 ];
+	}
+	static inline u32	KernelBGRAFromU8(const u8 * p)
+	{
+		return KernelBGRAFromGrey(*p);
+	}
+	static inline u32	KernelBGRAFromF32(const u8 * p)
+	{
+		return KernelBGRAFromGrey(KernelGreyFromF32(p));
+	}
+	static inline void	KernelCompositePixel(u8 * pDstColor, u8 * pDstDepth, const u8 * pSrcColor, const u8 * pSrcDepth, u32 nColorSize)
+	{
+		if ( *( const f32 * ) pSrcDepth < *( const f32 * ) pDstDepth )
+		{
+			memcpy(pDstColor, pSrcColor, nColorSize);
+			memcpy(pDstDepth, pSrcDepth, 4);
+		}
+	}
+
+	// nWeight of b in [0, 256]
+	static inline u8	KernelLerpByte(u32 a, u32 b, u32 nWeight)
+	{
+		return ( u8 ) ( ( a * ( 256 - nWeight ) + b * nWeight + 128 ) >> 8 );
+	}
+	// mid + (4 mid - neighbours) * nSharpen / 16, clamped
+	static inline u8	KernelSharpenByte(int up, int mid, int down, int left, int right, int nSharpen)
+	{
+		int v = mid + ( ( ( 4 * mid - up - down - left - right ) * nSharpen ) >> 4 );
+		return ( u8 ) ( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+	}
+
+	// Full range BT.601 (JPEG) in 15-bit fixed point, small enough for
+	// 16-bit multiplies. Luma of a pixel, chroma of the channel sums of a
+	// 2x2 block (hence a quarter of the weights).
+	#define KERNEL_Y_B	(3735)
+	#define KERNEL_Y_G	(19235)
+	#define KERNEL_Y_R	(9798)
+	#define KERNEL_U_B	(4096)
+	#define KERNEL_U_G	(-2714)
+	#define KERNEL_U_R	(-1382)
+	#define KERNEL_V_B	(-666)
+	#define KERNEL_V_G	(-3430)
+	#define KERNEL_V_R	(4096)
+	#define KERNEL_UV_BIAS	(( 128 << 15 ) + ( 1 << 14 ))
+
+	static inline u8	KernelLuma(const u8 * p)
+	{
+		return ( u8 ) ( ( KERNEL_Y_B * p[ 0 ] + KERNEL_Y_G * p[ 1 ] + KERNEL_Y_R * p[ 2 ] + ( 1 << 14 ) ) >> 15 );
+	}
+	static inline void	KernelChroma(int b, int g, int r, u8 * pU, u8 * pV)
+	{
+		int u = ( KERNEL_U_B * b + KERNEL_U_G * g + KERNEL_U_R * r + KERNEL_UV_BIAS ) >> 15;
+		int v = ( KERNEL_V_B * b + KERNEL_V_G * g + KERNEL_V_R * r + KERNEL_UV_BIAS ) >> 15;
+		*pU = ( u8 ) ( u > 255 ? 255 : u );
+		*pV = ( u8 ) ( v > 255 ? 255 : v );
+	}
+	static inline void	KernelYUVPair(u8 * pY0, u8 * pY1, u8 * pU, u8 * pV, const u8 * p0, const u8 * p1, u32 nSize)
+	{
+		pY0[ 0 ] = KernelLuma(p0);
+		pY0[ 1 ] = KernelLuma(p0 + nSize);
+		pY1[ 0 ] = KernelLuma(p1);
+		pY1[ 1 ] = KernelLuma(p1 + nSize);
+		KernelChroma(p0[ 0 ] + p0[ nSize ] + p1[ 0 ] + p1[ nSize ],
+			     p0[ 1 ] + p0[ nSize + 1 ] + p1[ 1 ] + p1[ nSize + 1 ],
+			     p0[ 2 ] + p0[ nSize + 2 ] + p1[ 2 ] + p1[ nSize + 2 ],
+			     pU, pV);
+	}
+
+	// ---------------------------------------------------------------
+	// Row templates, instantiated by each isa with its register traits
+	//
+	// V::Reg, V::BYTES, V::PIXELS (32-bit pixels per register),
+	// V::LoadU, V::StoreU, V::Stream, V::Fence, V::Reverse32, V::Reverse8,
+	// V::FromBGR, V::FromU8, V::GreyFromF32, V::Grey, V::PackGrey,
+	// V::LessMask, V::Set16, V::Lerp, V::Sharpen, V::Luma, V::Chroma
+	// ---------------------------------------------------------------
+
+	template <typename V>
+	inline u32		KernelStreamHead(const u8 * pDst, u32 nLimit)
+	{
+		u32 nHead = ( u32 ) ( ( V::BYTES - ( ( uintptr_t ) pDst & ( V::BYTES - 1 ) ) ) & ( V::BYTES - 1 ) );
+		return nHead < nLimit ? nHead : nLimit;
+	}
+
+	template <typename V>
+	void			KernelFillRowT(u8 * pDst, const u8 * pPattern, u32 nBytes, u32 nFlags)
+	{
+		typedef typename V::Reg Reg;
+
+		const u32 P = BUFFER_KERNEL_PATTERN_PERIOD;
+		u32 i = 0;
+
+		if ( nFlags & KERNEL_ROW_STREAM )
+		{
+			for ( u32 nHead = KernelStreamHead<V>(pDst, nBytes); i < nHead; ++i )
+			{
+				pDst[ i ] = pPattern[ i ];
+			}
+		}
+
+		// pattern phase at i, one register per V::BYTES of the period
+		Reg v[ P / V::BYTES ];
+		for ( u32 k = 0; k < P / V::BYTES; ++k )
+		{
+			v[ k ] = V::LoadU(pPattern + ( i + k * V::BYTES ) % P);
+		}
+
+		if ( nFlags & KERNEL_ROW_STREAM )
+		{
+			for ( ; i + P <= nBytes; i += P )
+			{
+				for ( u32 k = 0; k < P / V::BYTES; ++k )
+				{
+					V::Stream(pDst + i + k * V::BYTES, v[ k ]);
+				}
+			}
+			for ( u32 k = 0; i + V::BYTES <= nBytes; i += V::BYTES, ++k )
+			{
+				V::Stream(pDst + i, v[ k ]);
+			}
+			V::Fence();
+		}
+		else
+		{
+			for ( ; i + P <= nBytes; i += P )
+			{
+				for ( u32 k = 0; k < P / V::BYTES; ++k )
+				{
+					V::StoreU(pDst + i + k * V::BYTES, v[ k ]);
+				}
+			}
+			for ( u32 k = 0; i + V::BYTES <= nBytes; i += V::BYTES, ++k )
+			{
+				V::StoreU(pDst + i, v[ k ]);
+			}
+		}
+
+		for ( ; i < nBytes; ++i )
+		{
+			pDst[ i ] = pPattern[ i % P ];
+		}
+	}
+
+	template <typename V>
+	void			KernelCopyRowT(u8 * pDst, const u8 * pSrc, u32 nBytes, u32 nFlags)
+	{
+		u32 i = 0;
+
+		if ( nFlags & KERNEL_ROW_STREAM )
+		{
+			for ( u32 nHead = KernelStreamHead<V>(pDst, nBytes); i < nHead; ++i )
+			{
+				pDst[ i ] = pSrc[ i ];
+			}
+			for ( ; i + 4 * V::BYTES <= nBytes; i += 4 * V::BYTES )
+			{
+				typename V::Reg v0 = V::LoadU(pSrc + i);
+				typename V::Reg v1 = V::LoadU(pSrc + i + V::BYTES);
+				typename V::Reg v2 = V::LoadU(pSrc + i + 2 * V::BYTES);
+				typename V::Reg v3 = V::LoadU(pSrc + i + 3 * V::BYTES);
+				V::Stream(pDst + i, v0);
+				V::Stream(pDst + i + V::BYTES, v1);
+				V::Stream(pDst + i + 2 * V::BYTES, v2);
+				V::Stream(pDst + i + 3 * V::BYTES, v3);
+			}
+			for ( ; i + V::BYTES <= nBytes; i += V::BYTES )
+			{
+				V::Stream(pDst + i, V::LoadU(pSrc + i));
+			}
+			V::Fence();
+		}
+		else
+		{
+			for ( ; i + V::BYTES <= nBytes; i += V::BYTES )
+			{
+				V::StoreU(pDst + i, V::LoadU(pSrc + i));
+			}
+		}
+
+		for ( ; i < nBytes; ++i )
+		{
+			pDst[ i ] = pSrc[ i ];
+		}
+	}
+
+	// L::Load reads V::PIXELS source pixels (plus L::PAD trailing pixels
+	// it may touch) and returns them as BGRA.
+	template <typename V, typename L>
+	void			KernelConvertRowToBGRAT(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		const u32 N = V::PIXELS;
+		u32 * pOut = ( u32 * ) pDst;
+		u32 i = 0;
+
+		if ( nFlags & KERNEL_ROW_FLIP_H )
+		{
+			for ( ; i + N + L::PAD <= nCount; i += N )
+			{
+				V::StoreU(pOut + nCount - i - N, V::Reverse32(L::Load(pSrc + i * L::SIZE)));
+			}
+			for ( ; i < nCount; ++i )
+			{
+				pOut[ nCount - 1 - i ] = L::Scalar(pSrc + i * L::SIZE);
+			}
+		}
+		else if ( ( nFlags & KERNEL_ROW_STREAM ) && ( ( uintptr_t ) pOut & 3 ) == 0 )
+		{
+			for ( u32 nHead = KernelStreamHead<V>(pDst, nCount * 4) / 4; i < nHead; ++i )
+			{
+				pOut[ i ] = L::Scalar(pSrc + i * L::SIZE);
+			}
+			for ( ; i + N + L::PAD <= nCount; i += N )
+			{
+				V::Stream(pOut + i, L::Load(pSrc + i * L::SIZE));
+			}
+			V::Fence();
+			for ( ; i < nCount; ++i )
+			{
+				pOut[ i ] = L::Scalar(pSrc + i * L::SIZE);
+			}
+		}
+		else
+		{
+			for ( ; i + N + L::PAD <= nCount; i += N )
+			{
+				V::StoreU(pOut + i, L::Load(pSrc + i * L::SIZE));
+			}
+			for ( ; i < nCount; ++i )
+			{
+				pOut[ i ] = L::Scalar(pSrc + i * L::SIZE);
+			}
+		}
+	}
+
+	template <typename V>
+	void			KernelCopyRowU8T(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		u32 i = 0;
+
+		if ( !( nFlags & KERNEL_ROW_FLIP_H ) )
+		{
+			KernelCopyRowT<V>(pDst, pSrc, nCount, nFlags);
+			return;
+		}
+
+		for ( ; i + V::BYTES <= nCount; i += V::BYTES )
+		{
+			V::StoreU(pDst + nCount - i - V::BYTES, V::Reverse8(V::LoadU(pSrc + i)));
+		}
+		for ( ; i < nCount; ++i )
+		{
+			pDst[ nCount - 1 - i ] = pSrc[ i ];
+		}
+	}
+
+	template <typename V>
+	void			KernelConvertRowU8FromF32T(u8 * pDst, const u8 * pSrc, u32 nCount, u32 nFlags)
+	{
+		const u32 N = V::BYTES;	// one register of grey bytes from four of floats
+		u32 i = 0;
+
+		for ( ; i + N <= nCount; i += N )
+		{
+			const u8 * p = pSrc + i * 4;
+			typename V::Reg v = V::PackGrey(V::GreyFromF32(p),
+							V::GreyFromF32(p + V::BYTES),
+							V::GreyFromF32(p + 2 * V::BYTES),
+							V::GreyFromF32(p + 3 * V::BYTES));
+			if ( nFlags & KERNEL_ROW_FLIP_H )
+			{
+				V::StoreU(pDst + nCount - i - N, V::Reverse8(v));
+			}
+			else
+			{
+				V::StoreU(pDst + i, v);
+			}
+		}
+		for ( ; i < nCount; ++i )
+		{
+			pDst[ ( nFlags & KERNEL_ROW_FLIP_H ) ? nCount - 1 - i : i ] = KernelGreyFromF32(pSrc + i * 4);
+		}
+	}
+
+	// Depth test a register of pixels at once, runs that are all nearer
+	// or all farther (the common case away from silhouettes) skip the
+	// per pixel work.
+	template <typename V>
+	void			KernelCompositeRowT(u8 * pDstColor, u8 * pDstDepth, const u8 * pSrcColor, const u8 * pSrcDepth, u32 nCount, u32 nColorSize)
+	{
+		const u32 N	= V::PIXELS;
+		const u32 ALL	= ( 1u << N ) - 1;
+		u32 i = 0;
+
+		for ( ; i + N <= nCount; i += N )
+		{
+			const u32 nMask = V::LessMask(pSrcDepth + i * 4, pDstDepth + i * 4);
+			if ( nMask == 0 )
+			{
+				continue;
+			}
+			if ( nMask == ALL )
+			{
+				memcpy(pDstColor + i * nColorSize, pSrcColor + i * nColorSize, N * nColorSize);
+				V::StoreU(pDstDepth + i * 4, V::LoadU(pSrcDepth + i * 4));
+				continue;
+			}
+			for ( u32 k = 0; k < N; ++k )
+			{
+				if ( nMask & ( 1u << k ) )
+				{
+					memcpy(pDstColor + ( i + k ) * nColorSize, pSrcColor + ( i + k ) * nColorSize, nColorSize);
+					memcpy(pDstDepth + ( i + k ) * 4, pSrcDepth + ( i + k ) * 4, 4);
+				}
+			}
+		}
+		for ( ; i < nCount; ++i )
+		{
+			KernelCompositePixel(pDstColor + i * nColorSize, pDstDepth + i * 4, pSrcColor + i * nColorSize, pSrcDepth + i * 4, nColorSize);
+		}
+	}
+
+	// Vertical half of the bilinear upscale, two source rows blended into one
+	template <typename V>
+	void			KernelLerpRowT(u8 * pDst, const u8 * pA, const u8 * pB, u32 nBytes, u32 nWeight)
+	{
+		const typename V::Reg w = V::Set16(nWeight);
+		u32 i = 0;
+
+		for ( ; i + V::BYTES <= nBytes; i += V::BYTES )
+		{
+			V::StoreU(pDst + i, V::Lerp(V::LoadU(pA + i), V::LoadU(pB + i), w));
+		}
+		for ( ; i < nBytes; ++i )
+		{
+			pDst[ i ] = KernelLerpByte(pA[ i ], pB[ i ], nWeight);
+		}
+	}
+
+	// Neighbours are nSize bytes (one element) away, edge elements reuse
+	// themselves for the missing side
+	template <typename V>
+	void			KernelSharpenRowT(u8 * pDst, const u8 * pUp, const u8 * pMid, const u8 * pDown, u32 nBytes, u32 nSize, u32 nSharpen)
+	{
+		const typename V::Reg s = V::Set16(nSharpen);
+		u32 i = 0;
+
+		for ( ; i < nSize && i < nBytes; ++i )
+		{
+			u32 r = i + nSize < nBytes ? i + nSize : i;
+			pDst[ i ] = KernelSharpenByte(pUp[ i ], pMid[ i ], pDown[ i ], pMid[ i ], pMid[ r ], nSharpen);
+		}
+		for ( ; i + V::BYTES + nSize <= nBytes; i += V::BYTES )
+		{
+			V::StoreU(pDst + i, V::Sharpen(V::LoadU(pUp + i), V::LoadU(pMid + i), V::LoadU(pDown + i),
+						       V::LoadU(pMid + i - nSize), V::LoadU(pMid + i + nSize), s));
+		}
+		for ( ; i < nBytes; ++i )
+		{
+			u32 r = i + nSize < nBytes ? i + nSize : i;
+			pDst[ i ] = KernelSharpenByte(pUp[ i ], pMid[ i ], pDown[ i ], pMid[ i - nSize ], pMid[ r ], nSharpen);
+		}
+	}
+
+	// L as for KernelConvertRowToBGRAT. V::Luma stores the luma of a
+	// register of BGRA pixels, V::Chroma the chroma of the 2x2 blocks
+	// of two such registers, one row above the other.
+	template <typename V, typename L>
+	void			KernelYUVRowT(u8 * pY0, u8 * pY1, u8 * pU, u8 * pV, const u8 * pSrc0, const u8 * pSrc1, u32 nPairs)
+	{
+		const u32 N = V::PIXELS;
+		const u32 nCount = nPairs * 2;
+		u32 i = 0;
+
+		for ( ; i + N + L::PAD <= nCount; i += N )
+		{
+			typename V::Reg a = L::Load(pSrc0 + i * L::SIZE);
+			typename V::Reg b = L::Load(pSrc1 + i * L::SIZE);
+			V::Luma(pY0 + i, a);
+			V::Luma(pY1 + i, b);
+			V::Chroma(pU + i / 2, pV + i / 2, a, b);
+		}
+		for ( ; i < nCount; i += 2 )
+		{
+			KernelYUVPair(pY0 + i, pY1 + i, pU + i / 2, pV + i / 2, pSrc0 + i * L::SIZE, pSrc1 + i * L::SIZE, L::SIZE);
+		}
+	}
+
+	// Source pixel loaders for KernelConvertRowToBGRAT, shared by every isa
+	// that provides V::FromBGR, V::FromU8 and V::FromF32.
+	template <typename V>
+	struct KernelLoadBGRA
+	{
+		enum { SIZE = 4, PAD = 0 };
+		static inline typename V::Reg	Load(const u8 * p)	{ return V::LoadU(p); }
+		static inline u32		Scalar(const u8 * p)	{ return KernelBGRAFromBGRA(p); }
+	};
+	template <typename V>
+	struct KernelLoadBGR
+	{
+		enum { SIZE = 3, PAD = 2 };	// reads 4 bytes past the last pixel
+		static inline typename V::Reg	Load(const u8 * p)	{ return V::FromBGR(p); }
+		static inline u32		Scalar(const u8 * p)	{ return KernelBGRAFromBGR(p); }
+	};
+	template <typename V>
+	struct KernelLoadU8
+	{
+		enum { SIZE = 1, PAD = 0 };
+		static inline typename V::Reg	Load(const u8 * p)	{ return V::FromU8(p); }
+		static inline u32		Scalar(const u8 * p)	{ return KernelBGRAFromU8(p); }
+	};
+	template <typename V>
+	struct KernelLoadF32
+	{
+		enum { SIZE = 4, PAD = 0 };
+		static inline typename V::Reg	Load(const u8 * p)	{ return V::Grey(V::GreyFromF32(p)); }
+		static inline u32		Scalar(const u8 * p)	{ return KernelBGRAFromF32(p); }
+	};
+
+	#define BUFFER_KERNEL_TABLE(V) \
+		{ \
+			KernelFillRowT<V>, \
+			{ \
+				KernelCopyRowT<V>, \
+				KernelCopyRowU8T<V>, \
+				KernelConvertRowToBGRAT<V, KernelLoadBGRA<V>>, \
+				KernelConvertRowToBGRAT<V, KernelLoadBGR<V>>, \
+				KernelConvertRowToBGRAT<V, KernelLoadU8<V>>, \
+				KernelConvertRowToBGRAT<V, KernelLoadF32<V>>, \
+				KernelConvertRowU8FromF32T<V>, \
+			}, \
+			KernelCompositeRowT<V>, \
+			KernelLerpRowT<V>, \
+			KernelSharpenRowT<V>, \
+			{ \
+				KernelYUVRowT<V, KernelLoadBGR<V>>, \
+				KernelYUVRowT<V, KernelLoadBGRA<V>>, \
+			}, \
+		}
+}
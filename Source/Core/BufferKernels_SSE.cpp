@@ -0,0 +1,129 @@
+#include "BufferKernels.h"
+
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+
+// Everything below is built for SSE4.1 and only reached after a cpuid check.
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#pragma GCC target("ssse3,sse4.1")
+#endif
+
+#include "BufferKernels_Impl.h"
+
+#if defined(BUFFER_KERNEL_X86)
+
+namespace Graphics
+{
+	struct KernelSSE
+	{
+		typedef __m128i		Reg;
+		enum { BYTES = 16, PIXELS = 4 };
+
+		static inline Reg	LoadU(const void * p)		{ return _mm_loadu_si128(( const __m128i * ) p); }
+		static inline void	StoreU(void * p, Reg v)		{ _mm_storeu_si128(( __m128i * ) p, v); }
+		static inline void	Stream(void * p, Reg v)		{ _mm_stream_si128(( __m128i * ) p, v); }
+		static inline void	Fence()				{ _mm_sfence(); }
+
+		static inline u32	LessMask(const u8 * a, const u8 * b)
+		{
+			return ( u32 ) _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(( const float * ) a), _mm_loadu_ps(( const float * ) b)));
+		}
+
+		static inline Reg	Set16(u32 n)			{ return _mm_set1_epi16(( short ) n); }
+		// (a (256 - w) + b w + 128) >> 8 per byte, 16-bit lanes stay unsigned
+		static inline Reg	Lerp(Reg a, Reg b, Reg w)
+		{
+			const Reg z	= _mm_setzero_si128();
+			const Reg wa	= _mm_sub_epi16(_mm_set1_epi16(256), w);
+			const Reg round	= _mm_set1_epi16(128);
+			Reg lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, z), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(b, z), w)), round);
+			Reg hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, z), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(b, z), w)), round);
+			return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+		}
+		static inline Reg	SharpenHalf(Reg up, Reg mid, Reg down, Reg left, Reg right, Reg s)
+		{
+			Reg e = _mm_sub_epi16(_mm_slli_epi16(mid, 2), _mm_add_epi16(_mm_add_epi16(up, down), _mm_add_epi16(left, right)));
+			return _mm_add_epi16(mid, _mm_srai_epi16(_mm_mullo_epi16(e, s), 4));
+		}
+		static inline Reg	Sharpen(Reg up, Reg mid, Reg down, Reg left, Reg right, Reg s)
+		{
+			const Reg z = _mm_setzero_si128();
+			Reg lo = SharpenHalf(_mm_unpacklo_epi8(up, z), _mm_unpacklo_epi8(mid, z), _mm_unpacklo_epi8(down, z),
+					     _mm_unpacklo_epi8(left, z), _mm_unpacklo_epi8(right, z), s);
+			Reg hi = SharpenHalf(_mm_unpackhi_epi8(up, z), _mm_unpackhi_epi8(mid, z), _mm_unpackhi_epi8(down, z),
+					     _mm_unpackhi_epi8(left, z), _mm_unpackhi_epi8(right, z), s);
+			return _mm_packus_epi16(lo, hi);
+		}
+
+		static inline Reg	Reverse32(Reg v)
+		{
+			return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+		}
+		static inline Reg	Reverse8(Reg v)
+		{
+			return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+		}
+
+		static inline Reg	FromBGR(const u8 * p)
+		{
+			const Reg mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			return _mm_or_si128(_mm_shuffle_epi8(LoadU(p), mask), _mm_set1_epi32(( int ) 0xff000000));
+		}
+		static inline Reg	FromU8(const u8 * p)
+		{
+			int grey4;
+			memcpy(&grey4, p, 4);
+			return Grey(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(grey4)));
+		}
+		static inline Reg	GreyFromF32(const u8 * p)
+		{
+			__m128 f = _mm_mul_ps(_mm_loadu_ps(( const float * ) p), _mm_set1_ps(255.0f));
+			f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+			return _mm_cvttps_epi32(f);
+		}
+		static inline Reg	Grey(Reg grey)
+		{
+			return _mm_or_si128(_mm_mullo_epi32(grey, _mm_set1_epi32(0x010101)), _mm_set1_epi32(( int ) 0xff000000));
+		}
+		static inline Reg	PackGrey(Reg a, Reg b, Reg c, Reg d)
+		{
+			return _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+		}
+
+		// madd gives (b wb + g wg, r wr) per pixel, hadd the rest
+		static inline void	Luma(u8 * pY, Reg bgra)
+		{
+			const Reg z = _mm_setzero_si128();
+			const Reg w = _mm_setr_epi16(KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0, KERNEL_Y_B, KERNEL_Y_G, KERNEL_Y_R, 0);
+			Reg lo	= _mm_madd_epi16(_mm_unpacklo_epi8(bgra, z), w);
+			Reg hi	= _mm_madd_epi16(_mm_unpackhi_epi8(bgra, z), w);
+			Reg y	= _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), _mm_set1_epi32(1 << 14)), 15);
+			int y4	= _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(y, z), z));
+			memcpy(pY, &y4, 4);
+		}
+		static inline void	Chroma(u8 * pU, u8 * pV, Reg a, Reg b)
+		{
+			const Reg z = _mm_setzero_si128();
+			const Reg wu = _mm_setr_epi16(KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0, KERNEL_U_B, KERNEL_U_G, KERNEL_U_R, 0);
+			const Reg wv = _mm_setr_epi16(KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0, KERNEL_V_B, KERNEL_V_G, KERNEL_V_R, 0);
+			// columns summed down, then across: the 2x2 blocks' channel sums
+			Reg lo	= _mm_add_epi16(_mm_unpacklo_epi8(a, z), _mm_unpacklo_epi8(b, z));
+			Reg hi	= _mm_add_epi16(_mm_unpackhi_epi8(a, z), _mm_unpackhi_epi8(b, z));
+			lo	= _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi	= _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			Reg s	= _mm_unpacklo_epi64(lo, hi);
+			Reg uv	= _mm_hadd_epi32(_mm_madd_epi16(s, wu), _mm_madd_epi16(s, wv));
+			uv	= _mm_srai_epi32(_mm_add_epi32(uv, _mm_set1_epi32(KERNEL_UV_BIAS)), 15);
+			u32 uv4	= ( u32 ) _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(uv, z), z));
+			pU[ 0 ] = ( u8 ) uv4;
+			pU[ 1 ] = ( u8 ) ( uv4 >> 8 );
+			pV[ 0 ] = ( u8 ) ( uv4 >> 16 );
+			pV[ 1 ] = ( u8 ) ( uv4 >> 24 );
+		}
+	};
+
+	const BufferKernelTable	gBufferKernelsSSE = BUFFER_KERNEL_TABLE(KernelSSE);
+}
+
+#endif
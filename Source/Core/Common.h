@@ -26,8 +26,15 @@ using Ref = std::shared_ptr<T>; // TODO: implement a non thread-safe one
 
 
 #define ____STR(x) #x
+#if defined(_WIN32)
 #define ____MSG(e, l) (TEXT(#e "\nat " __FILE__ ":" ____STR(l)))
-#define _ALERT_IF_FALSE(e) if (!(e)) { MessageBox(NULL, ____MSG(e, __LINE__), TEXT("Exception"), MB_OK); ExitProcess(0); }
+#define _ALERT_IF_FALSE(e) if (!(e)) { MessageBox(NULL, ____MSG(e, __LINE__), TEXT("Exception"), MB_OK); ExitProcess(1); }
+#else
+#include <cstdio>
+#include <cstdlib>
+#define ____MSG(e, l) (#e "\nat " __FILE__ ":" ____STR(l))
+#define _ALERT_IF_FALSE(e) if (!(e)) { fprintf(stderr, "Exception: %s\n", ____MSG(e, __LINE__)); abort(); }
+#endif
 
 #define ENSURE_NOT_NULL(e) _ALERT_IF_FALSE((e) != NULL)
 #define ENSURE_TRUE(e) _ALERT_IF_FALSE((e))
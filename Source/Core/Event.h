@@ -227,7 +227,14 @@ namespace Event
 // Event Definitions
 // --------------------------------------------------------------------------
 
+#if defined(_WIN32)
 #include <Windows.h>
+#else
+#include <cstdint>
+typedef void *		HDC;
+typedef unsigned long	DWORD;
+typedef uintptr_t	WPARAM;
+#endif
 #include "_Math.h"
 
 namespace win32
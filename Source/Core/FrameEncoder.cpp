@@ -0,0 +1,538 @@
+#include "FrameEncoder.h"
+
+#include <cstring>
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// QOI
+	// ---------------------------------------------------------------
+
+	static inline void			_PutU32BE(std::vector<u8> * pOut, u32 value)
+	{
+		pOut->push_back(static_cast< u8 >( value >> 24 ));
+		pOut->push_back(static_cast< u8 >( value >> 16 ));
+		pOut->push_back(static_cast< u8 >( value >> 8 ));
+		pOut->push_back(static_cast< u8 >( value ));
+	}
+
+	// RGB, sRGB, see qoiformat.org
+	static void				_EncodeQOI(std::vector<u8> * pOut, const BufferRect * pSrc)
+	{
+		u32 index[ 64 ] = {};
+		u32 prev	= 0xff000000u;
+		u32 run		= 0;
+
+		pOut->clear();
+		pOut->insert(pOut->end(), { 'q', 'o', 'i', 'f' });
+		_PutU32BE(pOut, pSrc->nCCount);
+		_PutU32BE(pOut, pSrc->nRCount);
+		pOut->push_back(3);
+		pOut->push_back(0);
+
+		const u64 nPixels = static_cast< u64 >( pSrc->nRCount ) * pSrc->nCCount;
+		u64 iPixel = 0;
+		for ( u32 r = 0; r < pSrc->nRCount; ++r )
+		{
+			const u8 * pPixel = pSrc->pData + static_cast< u64 >( r ) * pSrc->nRStride;
+			for ( u32 c = 0; c < pSrc->nCCount; ++c, ++iPixel, pPixel += pSrc->nCStride )
+			{
+				u32 px = 0xff000000u | ( pPixel[ 2 ] << 16 ) | ( pPixel[ 1 ] << 8 ) | pPixel[ 0 ];
+				if ( px == prev )
+				{
+					if ( ++run == 62 || iPixel + 1 == nPixels )
+					{
+						pOut->push_back(static_cast< u8 >( 0xc0 | ( run - 1 ) ));
+						run = 0;
+					}
+					continue;
+				}
+				if ( run > 0 )
+				{
+					pOut->push_back(static_cast< u8 >( 0xc0 | ( run - 1 ) ));
+					run = 0;
+				}
+
+				int pr = ( prev >> 16 ) & 0xff, pg = ( prev >> 8 ) & 0xff, pb = prev & 0xff;
+				int cr = ( px >> 16 ) & 0xff, cg = ( px >> 8 ) & 0xff, cb = px & 0xff;
+				u32 iHash = ( cr * 3 + cg * 5 + cb * 7 + 255 * 11 ) & 63;
+				if ( index[ iHash ] == px )
+				{
+					pOut->push_back(static_cast< u8 >( iHash ));
+				}
+				else
+				{
+					index[ iHash ] = px;
+
+					int dr	= static_cast< i8 >( cr - pr );
+					int dg	= static_cast< i8 >( cg - pg );
+					int db	= static_cast< i8 >( cb - pb );
+					int drg	= dr - dg;
+					int dbg	= db - dg;
+					if ( dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1 )
+					{
+						pOut->push_back(static_cast< u8 >( 0x40 | ( ( dr + 2 ) << 4 ) | ( ( dg + 2 ) << 2 ) | ( db + 2 ) ));
+					}
+					else if ( dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7 )
+					{
+						pOut->push_back(static_cast< u8 >( 0x80 | ( dg + 32 ) ));
+						pOut->push_back(static_cast< u8 >( ( ( drg + 8 ) << 4 ) | ( dbg + 8 ) ));
+					}
+					else
+					{
+						pOut->insert(pOut->end(), { 0xfe, static_cast< u8 >( cr ), static_cast< u8 >( cg ), static_cast< u8 >( cb ) });
+					}
+				}
+				prev = px;
+			}
+		}
+
+		pOut->insert(pOut->end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	}
+
+	// ---------------------------------------------------------------
+	// PNG
+	//
+	// No zlib: one fixed Huffman deflate block over a greedy LZ77 with
+	// a single candidate per hash. Rows use the Up filter, which costs
+	// nothing to pick and suits rendered frames.
+	// ---------------------------------------------------------------
+
+	#define DEFLATE_WINDOW		(32768)
+	#define DEFLATE_MIN_MATCH	(3)
+	#define DEFLATE_MAX_MATCH	(258)
+	#define DEFLATE_HASH_BITS	(15)
+
+	static const u32 c_lengthBase[ 29 ]	= { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const u8 c_lengthExtra[ 29 ]	= { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const u32 c_distBase[ 30 ]	= { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const u8 c_distExtra[ 30 ]	= { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	struct BitWriter
+	{
+		std::vector<u8> *	pOut;
+		u32			bits;
+		u32			nBits;
+
+		void			Put(u32 value, u32 n)	// LSB first
+		{
+			bits	|= value << nBits;
+			nBits	+= n;
+			while ( nBits >= 8 )
+			{
+				pOut->push_back(static_cast< u8 >( bits ));
+				bits	>>= 8;
+				nBits	-= 8;
+			}
+		}
+		void			PutCode(u32 code, u32 n)	// Huffman codes go MSB first
+		{
+			u32 rev = 0;
+			for ( u32 i = 0; i < n; ++i )
+			{
+				rev = ( rev << 1 ) | ( ( code >> i ) & 1 );
+			}
+			Put(rev, n);
+		}
+		void			Flush()
+		{
+			if ( nBits > 0 )
+			{
+				pOut->push_back(static_cast< u8 >( bits ));
+			}
+			bits	= 0;
+			nBits	= 0;
+		}
+	};
+
+	static inline void			_PutLiteral(BitWriter & bw, u32 v)
+	{
+		if ( v < 144 )		bw.PutCode(0x30 + v, 8);
+		else if ( v < 256 )	bw.PutCode(0x190 + v - 144, 9);
+		else if ( v < 280 )	bw.PutCode(v - 256, 7);
+		else			bw.PutCode(0xc0 + v - 280, 8);
+	}
+	static inline void			_PutMatch(BitWriter & bw, u32 nLength, u32 nDist)
+	{
+		u32 i = 28;
+		while ( c_lengthBase[ i ] > nLength ) --i;
+		_PutLiteral(bw, 257 + i);
+		bw.Put(nLength - c_lengthBase[ i ], c_lengthExtra[ i ]);
+
+		u32 j = 29;
+		while ( c_distBase[ j ] > nDist ) --j;
+		bw.PutCode(j, 5);
+		bw.Put(nDist - c_distBase[ j ], c_distExtra[ j ]);
+	}
+
+	static u32				_Adler32(const u8 * pData, u64 nSize)
+	{
+		u32 a = 1, b = 0;
+		while ( nSize > 0 )
+		{
+			u64 n = Min<u64>(nSize, 5552);	// no overflow before the modulo
+			nSize -= n;
+			while ( n-- > 0 )
+			{
+				a += *pData++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return ( b << 16 ) | a;
+	}
+	static u32				_Crc32(u32 crc, const u8 * pData, u64 nSize)
+	{
+		static u32 table[ 256 ];
+		static bool bTable = [ ]
+		{
+			for ( u32 n = 0; n < 256; ++n )
+			{
+				u32 c = n;
+				for ( int k = 0; k < 8; ++k )
+				{
+					c = ( c & 1 ) ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+				}
+				table[ n ] = c;
+			}
+			return true;
+		}();
+		( void ) bTable;
+
+		crc = ~crc;
+		while ( nSize-- > 0 )
+		{
+			crc = table[ ( crc ^ *pData++ ) & 0xff ] ^ ( crc >> 8 );
+		}
+		return ~crc;
+	}
+
+	// zlib stream of one fixed Huffman block
+	static void				_Deflate(std::vector<u8> * pOut, const u8 * pData, u64 nSize)
+	{
+		std::vector<i32> head(1 << DEFLATE_HASH_BITS, -1);
+		BitWriter bw = { pOut, 0, 0 };
+
+		pOut->push_back(0x78);
+		pOut->push_back(0x01);
+		bw.Put(1, 1);	// final
+		bw.Put(1, 2);	// fixed Huffman
+
+		u64 i = 0;
+		while ( i < nSize )
+		{
+			u32 nLength = 0;
+			u32 nDist = 0;
+			if ( i + DEFLATE_MIN_MATCH <= nSize )
+			{
+				u32 h = ( ( pData[ i ] << 16 ) | ( pData[ i + 1 ] << 8 ) | pData[ i + 2 ] ) * 2654435761u >> ( 32 - DEFLATE_HASH_BITS );
+				i64 iCandidate = head[ h ];
+				head[ h ] = static_cast< i32 >( i );
+
+				if ( iCandidate >= 0 && i - iCandidate <= DEFLATE_WINDOW )
+				{
+					u32 nMax = static_cast< u32 >( Min<u64>(nSize - i, DEFLATE_MAX_MATCH) );
+					const u8 * p = pData + i;
+					const u8 * q = pData + iCandidate;
+					while ( nLength < nMax && p[ nLength ] == q[ nLength ] ) ++nLength;
+					nDist = static_cast< u32 >( i - iCandidate );
+				}
+			}
+
+			if ( nLength >= DEFLATE_MIN_MATCH )
+			{
+				_PutMatch(bw, nLength, nDist);
+				i += nLength;
+			}
+			else
+			{
+				_PutLiteral(bw, pData[ i ]);
+				++i;
+			}
+		}
+		_PutLiteral(bw, 256);
+		bw.Flush();
+
+		_PutU32BE(pOut, _Adler32(pData, nSize));
+	}
+
+	static void				_PutChunk(std::vector<u8> * pOut, const char * pType, const u8 * pData, u64 nSize)
+	{
+		_PutU32BE(pOut, static_cast< u32 >( nSize ));
+		u64 iType = pOut->size();
+		pOut->insert(pOut->end(), pType, pType + 4);
+		pOut->insert(pOut->end(), pData, pData + nSize);
+		_PutU32BE(pOut, _Crc32(0, pOut->data() + iType, nSize + 4));
+	}
+
+	// 8 bit RGB
+	static void				_EncodePNG(std::vector<u8> * pOut, std::vector<u8> * pScratch, const BufferRect * pSrc)
+	{
+		const u32 nWidth	= pSrc->nCCount;
+		const u32 nHeight	= pSrc->nRCount;
+		const u64 nRowSize	= 1 + static_cast< u64 >( nWidth ) * 3;
+
+		// filtered rows in pScratch, then the zlib stream after them
+		pScratch->resize(nRowSize * nHeight);
+		for ( u32 r = 0; r < nHeight; ++r )
+		{
+			const u8 * pRow	= pSrc->pData + static_cast< u64 >( r ) * pSrc->nRStride;
+			const u8 * pUp	= r > 0 ? pRow - pSrc->nRStride : nullptr;
+			u8 * pDst	= pScratch->data() + r * nRowSize;
+
+			*pDst++ = 2;	// Up
+			for ( u32 c = 0; c < nWidth; ++c, pDst += 3 )
+			{
+				const u8 * p = pRow + c * pSrc->nCStride;
+				if ( pUp )
+				{
+					const u8 * u = pUp + c * pSrc->nCStride;
+					pDst[ 0 ] = static_cast< u8 >( p[ 2 ] - u[ 2 ] );
+					pDst[ 1 ] = static_cast< u8 >( p[ 1 ] - u[ 1 ] );
+					pDst[ 2 ] = static_cast< u8 >( p[ 0 ] - u[ 0 ] );
+				}
+				else
+				{
+					pDst[ 0 ] = p[ 2 ];
+					pDst[ 1 ] = p[ 1 ];
+					pDst[ 2 ] = p[ 0 ];
+				}
+			}
+		}
+
+		std::vector<u8> idat;
+		_Deflate(&idat, pScratch->data(), pScratch->size());
+
+		u8 ihdr[ 13 ] = { 0 };
+		ihdr[ 0 ] = static_cast< u8 >( nWidth >> 24 );
+		ihdr[ 1 ] = static_cast< u8 >( nWidth >> 16 );
+		ihdr[ 2 ] = static_cast< u8 >( nWidth >> 8 );
+		ihdr[ 3 ] = static_cast< u8 >( nWidth );
+		ihdr[ 4 ] = static_cast< u8 >( nHeight >> 24 );
+		ihdr[ 5 ] = static_cast< u8 >( nHeight >> 16 );
+		ihdr[ 6 ] = static_cast< u8 >( nHeight >> 8 );
+		ihdr[ 7 ] = static_cast< u8 >( nHeight );
+		ihdr[ 8 ] = 8;	// bit depth
+		ihdr[ 9 ] = 2;	// truecolor
+
+		pOut->clear();
+		pOut->insert(pOut->end(), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' });
+		_PutChunk(pOut, "IHDR", ihdr, sizeof(ihdr));
+		_PutChunk(pOut, "IDAT", idat.data(), idat.size());
+		_PutChunk(pOut, "IEND", nullptr, 0);
+	}
+
+	void			FrameEncodeStill(std::vector<u8> * pOut, std::vector<u8> * pScratch, FrameFileFormat format, const BufferRect * pSrc)
+	{
+		ASSERT(format == FrameFileFormat::QOI || format == FrameFileFormat::PNG);
+
+		if ( format == FrameFileFormat::QOI )
+		{
+			_EncodeQOI(pOut, pSrc);
+		}
+		else
+		{
+			_EncodePNG(pOut, pScratch, pSrc);
+		}
+	}
+
+	// ---------------------------------------------------------------
+	// FrameEncoder
+	// ---------------------------------------------------------------
+
+	FrameEncoder::FrameEncoder(const FrameOutputDesc & desc, Integer nWidth, Integer nHeight)
+		: m_desc(desc)
+		, m_nSubmitted(0)
+		, m_nWritten(0)
+		, m_nFinished(0)
+		, m_nFailed(0)
+		, m_bStop(false)
+		, m_pStream(nullptr)
+	{
+		ASSERT(desc.pPath && desc.nThreads > 0 && desc.nMaxQueued > 0);
+		ASSERT(nWidth > 0 && nHeight > 0);
+
+		if ( desc.format == FrameFileFormat::Y4M )
+		{
+			ASSERT(desc.nFrameRate > 0);
+
+			m_pStream = fopen(desc.pPath, "wb");
+			if ( !m_pStream || fprintf(m_pStream, "YUV4MPEG2 W%lld H%lld F%lld:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+				     static_cast< long long >( nWidth ), static_cast< long long >( nHeight ), static_cast< long long >( desc.nFrameRate )) < 0 )
+			{
+				++m_nFailed;
+			}
+		}
+
+		// the encoders' frames plus the queued ones
+		Integer nSlots = desc.nThreads + desc.nMaxQueued;
+		for ( Integer i = 0; i < nSlots; ++i )
+		{
+			m_slots.emplace_back(nWidth, nHeight, 4, 16);
+			m_rects.push_back(BufferRect {});
+			m_formats.push_back(BUFFER_FORMAT_UNKNOWN);
+			m_free.push_back(i);
+		}
+
+		for ( Integer i = 0; i < desc.nThreads; ++i )
+		{
+			m_threads.emplace_back([ this ] { Run(); });
+		}
+	}
+	FrameEncoder::~FrameEncoder()
+	{
+		Close();
+	}
+	bool			FrameEncoder::Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+		}
+		m_cvJob.notify_all();
+
+		for ( std::thread & thread : m_threads )
+		{
+			thread.join();
+		}
+		m_threads.clear();
+
+		if ( m_pStream )
+		{
+			if ( fclose(m_pStream) != 0 )
+			{
+				++m_nFailed;
+			}
+			m_pStream = nullptr;
+		}
+		return m_nFailed == 0;
+	}
+	Integer			FrameEncoder::GetFailedCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_nFailed;
+	}
+	Integer			FrameEncoder::Acquire(BufferFormat format, BufferRect * pRect)
+	{
+		ASSERT(format == BUFFER_FORMAT_BGR || format == BUFFER_FORMAT_BGRA);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvDone.wait(lock, [ this ] { return !m_free.empty(); });
+
+		Integer iSlot = m_free.back();
+		m_free.pop_back();
+
+		Buffer & slot		= m_slots[ iSlot ];
+		BufferRect & rect	= m_rects[ iSlot ];
+		rect.pData		= static_cast< u8 * >( slot.Data() );
+		rect.nRCount		= static_cast< u32 >( slot.Height() );
+		rect.nCCount		= static_cast< u32 >( slot.Width() );
+		rect.nCStride		= BufferFormatSize(format);
+		rect.nRStride		= rect.nCCount * rect.nCStride;
+		m_formats[ iSlot ]	= format;
+
+		*pRect = rect;
+		return iSlot;
+	}
+	void			FrameEncoder::Submit(Integer iSlot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(Job { iSlot, m_nSubmitted++ });
+		}
+		m_cvJob.notify_one();
+	}
+	bool			FrameEncoder::Flush()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvDone.wait(lock, [ this ] { return m_nFinished == m_nSubmitted; });
+		if ( m_pStream && fflush(m_pStream) != 0 )
+		{
+			++m_nFailed;
+		}
+		return m_nFailed == 0;
+	}
+	void			FrameEncoder::Run()
+	{
+		std::vector<u8> out;
+		std::vector<u8> scratch;
+
+		for ( ;; )
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvJob.wait(lock, [ this ] { return m_bStop || !m_jobs.empty(); });
+				if ( m_jobs.empty() )
+				{
+					return;
+				}
+				job = m_jobs.front();
+				m_jobs.pop_front();
+			}
+
+			bool bWritten = Write(job, &out, &scratch);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_nFinished;
+				m_nFailed += bWritten ? 0 : 1;
+			}
+			m_cvDone.notify_all();
+		}
+	}
+	void			FrameEncoder::Release(Integer iSlot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(iSlot);
+		}
+		m_cvDone.notify_all();
+	}
+	// Encodes a frame and writes it out, false if that failed. The slot
+	// goes back to the producer once encoded, before the file write.
+	bool			FrameEncoder::Write(const Job & job, std::vector<u8> * pOut, std::vector<u8> * pScratch)
+	{
+		const BufferRect & rect = m_rects[ job.iSlot ];
+
+		if ( m_desc.format == FrameFileFormat::Y4M )
+		{
+			u64 nY		= static_cast< u64 >( rect.nCCount ) * rect.nRCount;
+			u64 nUV		= static_cast< u64 >( ( rect.nCCount + 1 ) / 2 ) * ( ( rect.nRCount + 1 ) / 2 );
+			pOut->resize(nY + nUV * 2);
+			Buffer2DToYUV420(pOut->data(), pOut->data() + nY, pOut->data() + nY + nUV, &rect, m_formats[ job.iSlot ]);
+			Release(job.iSlot);
+
+			// frames go into the stream in order, one writer at a time
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvDone.wait(lock, [ this, &job ] { return m_nWritten == job.iFrame; });
+			}
+			// a failed frame still moves the stream on, the next one may fit
+			bool bWritten = m_pStream &&
+					fwrite("FRAME\n", 1, 6, m_pStream) == 6 &&
+					fwrite(pOut->data(), 1, pOut->size(), m_pStream) == pOut->size();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_nWritten;
+			}
+			m_cvDone.notify_all();
+			return bWritten;
+		}
+
+		FrameEncodeStill(pOut, pScratch, m_desc.format, &rect);
+		Release(job.iSlot);
+
+		char path[ 1024 ];
+		snprintf(path, sizeof(path), m_desc.pPath, static_cast< long long >( job.iFrame ));
+
+		FILE * pFile = fopen(path, "wb");
+		if ( !pFile )
+		{
+			return false;
+		}
+		bool bWritten = fwrite(pOut->data(), 1, pOut->size(), pFile) == pOut->size();
+		return fclose(pFile) == 0 && bWritten;
+	}
+}
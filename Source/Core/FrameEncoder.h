@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Graphics
+{
+	enum class FrameFileFormat
+	{
+		QOI,
+		PNG,
+		Y4M,		// one stream, YUV 4:2:0
+	};
+
+	struct FrameOutputDesc
+	{
+		FrameFileFormat	format;
+		const char *	pPath;		// stills: printf pattern of the frame number (%lld), Y4M: the stream
+		Integer		nThreads;	// encoder threads
+		Integer		nMaxQueued;	// frames waiting for an encoder, one more blocks the producer
+		Integer		nFrameRate;	// Y4M only, per second
+	};
+
+	// One QOI or PNG still of a BGR or BGRA rect into pOut, pScratch is
+	// reused between calls.
+	void		FrameEncodeStill(std::vector<u8> * pOut, std::vector<u8> * pScratch, FrameFileFormat format, const BufferRect * pSrc);
+
+	// Encodes BGR or BGRA frames on its own threads. A producer acquires a slot,
+	// fills it and submits it; with every slot taken Acquire waits, so a
+	// slow encoder holds the producer back instead of piling up frames.
+	// Stills are written as they finish, the Y4M stream in frame order.
+	// A frame that fails to write is counted and skipped, Flush and Close
+	// report it.
+	class FrameEncoder
+	{
+	public:
+		FrameEncoder(const FrameOutputDesc & desc, Integer nWidth, Integer nHeight);
+		~FrameEncoder();	// Close()
+
+		FrameEncoder(const FrameEncoder &) = delete;
+		FrameEncoder & operator = (const FrameEncoder &) = delete;
+
+		// One producer at a time. pRect is a packed frame of format,
+		// owned by the encoder until it is submitted.
+		Integer		Acquire(BufferFormat format, BufferRect * pRect);
+		void		Submit(Integer iSlot);
+		// Wait for everything submitted, false if a frame so far failed to write.
+		bool		Flush();
+		// Writes out everything submitted, stops the threads and closes the
+		// stream. False if a frame failed to write, or the stream to close.
+		bool		Close();
+		Integer		GetFailedCount();
+
+	private:
+		struct Job
+		{
+			Integer		iSlot;
+			Integer		iFrame;
+		};
+
+		void		Run();
+		bool		Write(const Job & job, std::vector<u8> * pOut, std::vector<u8> * pScratch);
+		void		Release(Integer iSlot);
+
+		FrameOutputDesc			m_desc;
+		std::vector<Buffer>		m_slots;		// 4 bytes per pixel, either format fits
+		std::vector<BufferRect>		m_rects;
+		std::vector<BufferFormat>	m_formats;
+		std::vector<Integer>		m_free;
+		std::deque<Job>			m_jobs;
+		std::vector<std::thread>	m_threads;
+
+		std::mutex			m_mutex;
+		std::condition_variable		m_cvJob;
+		std::condition_variable		m_cvDone;	// slot freed, frame written
+
+		Integer				m_nSubmitted;
+		Integer				m_nWritten;	// Y4M: frames before this one are in the stream
+		Integer				m_nFinished;
+		Integer				m_nFailed;
+		bool				m_bStop;
+
+		FILE *				m_pStream;	// Y4M only
+	};
+}
@@ -0,0 +1,207 @@
+#include "FrameRing.h"
+
+#include <chrono>
+#include <new>
+
+namespace Graphics
+{
+	i64			FrameRingClock()
+	{
+		return std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	// ---------------------------------------------------------------
+	// FrameRing
+	// ---------------------------------------------------------------
+
+	FrameRing::FrameRing(const char * pName, Integer nWidth, Integer nHeight, Integer nSlots)
+		: m_pMemory(nullptr)
+		, m_pHeader(nullptr)
+		, m_nFrames(0)
+	{
+		ASSERT(nWidth > 0 && nHeight > 0);
+		ASSERT(nSlots >= 2 && nSlots <= FRAME_RING_MAX_SLOTS);
+
+		// frames start on their own pages
+		const u64 nPage		= 4096;
+		const u64 nOffset	= ( sizeof(FrameRingHeader) + nPage - 1 ) & ~( nPage - 1 );
+		const u64 nRowStride	= static_cast< u64 >( nWidth ) * 4;
+		const u64 nStride	= ( nRowStride * nHeight + nPage - 1 ) & ~( nPage - 1 );
+
+		m_pMemory = NativeSharedMemoryCreate(pName, static_cast< size_t >( nOffset + nStride * nSlots ));
+		ENSURE_NOT_NULL(m_pMemory);
+
+		m_pHeader		= new ( NativeSharedMemoryGetData(m_pMemory) ) FrameRingHeader();
+		m_pHeader->version	= FRAME_RING_VERSION;
+		m_pHeader->nWidth	= static_cast< u32 >( nWidth );
+		m_pHeader->nHeight	= static_cast< u32 >( nHeight );
+		m_pHeader->nRowStride	= static_cast< u32 >( nRowStride );
+		m_pHeader->nSlots	= static_cast< u32 >( nSlots );
+		m_pHeader->nFrameOffset	= nOffset;
+		m_pHeader->nFrameStride	= nStride;
+		m_pHeader->bClosed	= 0;
+		m_pHeader->nPublished	= 0;
+		for ( FrameRingSlot & slot : m_pHeader->slots )
+		{
+			slot.seq		= 0;
+			slot.iSwapTick		= 0;
+			slot.iPublishTick	= 0;
+		}
+
+		std::atomic_thread_fence(std::memory_order_release);
+		m_pHeader->magic	= FRAME_RING_MAGIC;
+	}
+	FrameRing::~FrameRing()
+	{
+		m_pHeader->bClosed.store(1, std::memory_order_release);
+		NativeSharedMemoryClose(m_pMemory);
+	}
+	bool			FrameRing::QueryInterface(Integer guid, void ** ppInterface)
+	{
+		if ( _INTERFACE_IID(FrameRing) == guid )
+		{
+			*ppInterface = this;
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	Integer			FrameRing::Width() const
+	{
+		return m_pHeader->nWidth;
+	}
+	Integer			FrameRing::Height() const
+	{
+		return m_pHeader->nHeight;
+	}
+	u64			FrameRing::GetFrameCount() const
+	{
+		return m_pHeader->nPublished.load(std::memory_order_relaxed);
+	}
+	BufferRect		FrameRing::GetSlotRect(u64 iFrame)
+	{
+		BufferRect rect;
+		rect.pData	= static_cast< u8 * >( NativeSharedMemoryGetData(m_pMemory) ) + m_pHeader->nFrameOffset + ( iFrame % m_pHeader->nSlots ) * m_pHeader->nFrameStride;
+		rect.nRCount	= m_pHeader->nHeight;
+		rect.nCCount	= m_pHeader->nWidth;
+		rect.nRStride	= m_pHeader->nRowStride;
+		rect.nCStride	= 4;
+		return rect;
+	}
+	BufferRect		FrameRing::BeginFrame(i64 iSwapTick)
+	{
+		FrameRingSlot & slot = m_pHeader->slots[ m_nFrames % m_pHeader->nSlots ];
+
+		// odd before any pixel changes
+		slot.seq.store(2 * m_nFrames + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.iSwapTick = iSwapTick;
+
+		return GetSlotRect(m_nFrames);
+	}
+	void			FrameRing::EndFrame()
+	{
+		FrameRingSlot & slot = m_pHeader->slots[ m_nFrames % m_pHeader->nSlots ];
+
+		slot.iPublishTick = FrameRingClock();
+		slot.seq.store(2 * m_nFrames + 2, std::memory_order_release);
+		m_pHeader->nPublished.store(++m_nFrames, std::memory_order_release);
+	}
+	BufferRect		FrameRing::GetLastFrame()
+	{
+		ASSERT(m_nFrames > 0);
+		return GetSlotRect(m_nFrames - 1);
+	}
+
+	// ---------------------------------------------------------------
+	// FrameRingReader
+	// ---------------------------------------------------------------
+
+	FrameRingReader::FrameRingReader()
+		: m_pMemory(nullptr)
+		, m_pHeader(nullptr)
+		, m_nSeen(0)
+	{
+	}
+	FrameRingReader::~FrameRingReader()
+	{
+		if ( m_pMemory )
+		{
+			NativeSharedMemoryClose(m_pMemory);
+		}
+	}
+	bool			FrameRingReader::Open(const char * pName)
+	{
+		ASSERT(!m_pMemory);
+
+		NativeSharedMemory * pMemory = NativeSharedMemoryOpen(pName);
+		if ( !pMemory )
+		{
+			return false;
+		}
+
+		FrameRingHeader * pHeader = static_cast< FrameRingHeader * >( NativeSharedMemoryGetData(pMemory) );
+		if ( NativeSharedMemoryGetSize(pMemory) < sizeof(FrameRingHeader) ||
+		     pHeader->magic != FRAME_RING_MAGIC )
+		{
+			// not ready yet
+			NativeSharedMemoryClose(pMemory);
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		ENSURE_TRUE(pHeader->version == FRAME_RING_VERSION);
+
+		m_pMemory	= pMemory;
+		m_pHeader	= pHeader;
+		m_nSeen		= pHeader->nPublished.load(std::memory_order_acquire);
+		return true;
+	}
+	bool			FrameRingReader::IsClosed() const
+	{
+		return m_pHeader->bClosed.load(std::memory_order_acquire) != 0;
+	}
+	u64			FrameRingReader::GetFrameCount() const
+	{
+		return m_pHeader->nPublished.load(std::memory_order_acquire);
+	}
+	bool			FrameRingReader::Acquire(FrameRingView * pView)
+	{
+		for ( ;; )
+		{
+			u64 nPublished = m_pHeader->nPublished.load(std::memory_order_acquire);
+			if ( nPublished <= m_nSeen )
+			{
+				return false;
+			}
+
+			u64 iFrame		= nPublished - 1;
+			const FrameRingSlot & slot = m_pHeader->slots[ iFrame % m_pHeader->nSlots ];
+			if ( slot.seq.load(std::memory_order_acquire) != 2 * iFrame + 2 )
+			{
+				// lapped already, look again
+				continue;
+			}
+
+			pView->iFrame		= iFrame;
+			pView->rect.pData	= static_cast< u8 * >( NativeSharedMemoryGetData(m_pMemory) ) + m_pHeader->nFrameOffset + ( iFrame % m_pHeader->nSlots ) * m_pHeader->nFrameStride;
+			pView->rect.nRCount	= m_pHeader->nHeight;
+			pView->rect.nCCount	= m_pHeader->nWidth;
+			pView->rect.nRStride	= m_pHeader->nRowStride;
+			pView->rect.nCStride	= 4;
+			pView->iSwapTick	= slot.iSwapTick;
+			pView->iPublishTick	= slot.iPublishTick;
+
+			m_nSeen = nPublished;
+			return true;
+		}
+	}
+	bool			FrameRingReader::Release(const FrameRingView & view)
+	{
+		const FrameRingSlot & slot = m_pHeader->slots[ view.iFrame % m_pHeader->nSlots ];
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.seq.load(std::memory_order_relaxed) == 2 * view.iFrame + 2;
+	}
+}
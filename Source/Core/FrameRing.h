@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Native.h"
+
+#include <atomic>
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// Shared memory layout
+	//
+	// A header, then nSlots BGRA frames. Frame n (from 0) goes to slot
+	// n % nSlots, whose sequence is 2n + 1 while it is written and
+	// 2n + 2 once complete; nPublished is n + 1 after that. Readers use
+	// the pixels in place and check the sequence again when done: if it
+	// moved, the frame was overwritten meanwhile.
+	// ---------------------------------------------------------------
+
+	#define FRAME_RING_MAGIC	(0x474e4952)	// "RING"
+	#define FRAME_RING_VERSION	(1)
+	#define FRAME_RING_MAX_SLOTS	(16)
+
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(std::atomic<u64>) == sizeof(u64), "ring counters are shared between processes");
+
+	struct alignas(64) FrameRingSlot
+	{
+		std::atomic<u64>	seq;
+		i64			iSwapTick;	// FrameRingClock() at the Swap
+		i64			iPublishTick;	// and once the frame is complete
+	};
+
+	struct FrameRingHeader
+	{
+		u32			magic;		// written last
+		u32			version;
+		u32			nWidth;
+		u32			nHeight;
+		u32			nRowStride;	// bytes
+		u32			nSlots;
+		u64			nFrameOffset;	// first frame, from the header
+		u64			nFrameStride;
+		std::atomic<u32>	bClosed;	// no more frames
+
+		alignas(64) std::atomic<u64>	nPublished;
+		FrameRingSlot		slots[ FRAME_RING_MAX_SLOTS ];
+	};
+
+	// microseconds, on a clock all processes of the machine share
+	i64		FrameRingClock();
+
+	// ---------------------------------------------------------------
+	// FrameRing
+	// ---------------------------------------------------------------
+
+	// Swap chain target (see Device::CreateRenderTarget) in shared memory:
+	// a present converts straight into the oldest slot, nothing else is
+	// copied. Readers are never waited for, one falling nSlots - 1 frames
+	// behind loses frames.
+	class FrameRing : public IUnknown
+	{
+		_INTERFACE_DEFINE_IID(1629856113);
+	public:
+		FrameRing(const char * pName, Integer nWidth, Integer nHeight, Integer nSlots = 3);
+		virtual		~FrameRing();	// readers see bClosed, the name goes
+
+		FrameRing(const FrameRing &) = delete;
+		FrameRing & operator = (const FrameRing &) = delete;
+
+		virtual bool	QueryInterface(Integer guid, void ** ppInterface) override;
+
+		Integer		Width() const;
+		Integer		Height() const;
+		u64		GetFrameCount() const;	// published so far
+
+		// Present side, one thread at a time. BeginFrame hands out the
+		// next slot, BGRA, EndFrame publishes it.
+		BufferRect	BeginFrame(i64 iSwapTick);
+		void		EndFrame();
+		BufferRect	GetLastFrame();
+
+	private:
+		BufferRect	GetSlotRect(u64 iFrame);
+
+		NativeSharedMemory *	m_pMemory;
+		FrameRingHeader *	m_pHeader;
+		u64			m_nFrames;	// begun
+	};
+
+	// ---------------------------------------------------------------
+	// FrameRingReader
+	// ---------------------------------------------------------------
+
+	struct FrameRingView
+	{
+		u64			iFrame;
+		BufferRect		rect;		// BGRA, in the shared memory
+		i64			iSwapTick;
+		i64			iPublishTick;
+	};
+
+	// The consumer side, in any process.
+	class FrameRingReader
+	{
+	public:
+		FrameRingReader();
+		~FrameRingReader();
+
+		FrameRingReader(const FrameRingReader &) = delete;
+		FrameRingReader & operator = (const FrameRingReader &) = delete;
+
+		bool		Open(const char * pName);	// false until the producer made it
+		bool		IsClosed() const;
+		u64		GetFrameCount() const;		// published so far
+
+		// The newest complete frame not seen yet, in place. False if
+		// there is none.
+		bool		Acquire(FrameRingView * pView);
+		// False if the frame was overwritten while held: drop what was
+		// read from it.
+		bool		Release(const FrameRingView & view);
+
+	private:
+		NativeSharedMemory *	m_pMemory;
+		FrameRingHeader *	m_pHeader;
+		u64			m_nSeen;
+	};
+}
@@ -1,28 +1,11 @@
 #include "Graphics.h"
+#include "BufferKernels.h"
 #include "Native.h"
 #include "Common.h"
 
 #define MAX_TRIANGLES_CLIP_3D	(64) // 2^6
 #define BUFFER_ALIGN_BYTES	(64)
 
-#define BUFFER_2D_SET_IMPL(name, type) \
-	Buffer2DSet##name(const BufferRect * pRect, type value) \
-	{ \
-		type * pBegin; \
-		type * pEnd; \
-		BufferIt2D it; \
-		it.pData	= pRect->pData; \
-		it.nRCount	= pRect->nRCount; \
-		it.nCCount	= pRect->nCCount; \
-		it.nRStride	= pRect->nRStride; \
-		it.nCStride	= pRect->nCStride; \
-		ASSERT(pRect->nCStride == sizeof(value)); \
-		while ( BufferIt2DGetIncRaw(&it, ( void ** ) &pBegin, ( void ** ) &pEnd) ) \
-		{ \
-			std::uninitialized_fill(pBegin, pEnd, value); \
-		} \
-	}
-
 #define LERP_POS(dst, src1, src2, t)	F32Lerp((f32 *)&(dst), (const f32 *)&(src1), (const f32 *)&(src2), (t), sizeof(dst) / sizeof(f32))
 #define LERP_V(dst, src1, src2, t, n)	F32Lerp((f32 *)(dst), (const f32 *)(src1), (const f32 *)(src2), (t), (n))
 #define LERP(src1, src2, t)		V4Lerp((src1), (src2), (t))
@@ -58,9 +41,21 @@ namespace Graphics
 		}
 	}
 
-	void		BUFFER_2D_SET_IMPL(U8, u8);
-	void		BUFFER_2D_SET_IMPL(U32, u32);
-	void		BUFFER_2D_SET_IMPL(F32, f32);
+	void		Buffer2DSetU8(const BufferRect * pRect, u8 value)
+	{
+		ASSERT(pRect->nCStride == sizeof(value));
+		Buffer2DFill(pRect, &value);
+	}
+	void		Buffer2DSetU32(const BufferRect * pRect, u32 value)
+	{
+		ASSERT(pRect->nCStride == sizeof(value));
+		Buffer2DFill(pRect, &value);
+	}
+	void		Buffer2DSetF32(const BufferRect * pRect, f32 value)
+	{
+		ASSERT(pRect->nCStride == sizeof(value));
+		Buffer2DFill(pRect, &value);
+	}
 	void		Buffer2DSetAtU32(const BufferRect * pRect, u32 nX, u32 nY, u32 value)
 	{
 		ASSERT(nY < pRect->nRCount && nX < pRect->nCCount);
@@ -203,7 +198,7 @@ namespace Graphics
 		static Vector4 bufClipCoord[ 3 * 16 ]; // 16 triangles at maximum
 		static f32 bufVaryings[ 3 * 16 * 24 ]; // 24 f32 elements per varyings at maximum
 
-		ASSERT(vbytes < 24 * sizeof(f32));
+		ASSERT(vbytes < static_cast< int >( 24 * sizeof(f32) ));
 
 		Vector4 * pi = bufClipCoord;
 		Vector4 * po = pOutClipCoord;
@@ -233,7 +228,7 @@ namespace Graphics
 		static Vector4 bufClipCoord[ 3 * 64 ]; // 64 triangles at maximum
 		static f32 bufVaryings[ 3 * 64 * 24 ]; // 24 f32 elements per varyings at maximum
 
-		ASSERT(vbytes < 24 * sizeof(f32));
+		ASSERT(vbytes < static_cast< int >( 24 * sizeof(f32) ));
 
 		Vector4 * pi = bufClipCoord;
 		Vector4 * po = pOutClipCoord;
@@ -326,7 +321,7 @@ namespace Graphics
 				// attributes interpolation
 				Vector3 weight = { depth * baryCoord.x / scnDepth[0], depth * baryCoord.y / scnDepth[1], depth * baryCoord.z / scnDepth[2]};
 
-				for (int i = 0; i < (nVaryingsSize / sizeof(f32)); ++i)
+				for (int i = 0; i < static_cast< int >( nVaryingsSize / sizeof(f32) ); ++i)
 				{
 					*(f32 *)(pVaryings + 3 * nVaryingsSize + i * sizeof(f32)) =
 						weight.x * *(f32 *)(pVaryings + 0 * nVaryingsSize + i * sizeof(f32)) +
@@ -0,0 +1,344 @@
+#pragma once
+
+#include "_Math.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LANES_AVX
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define LANES_SSE
+#endif
+
+namespace Graphics
+{
+	// --------------------------------------------------------------------------
+	// Lanes
+	//
+	// 8-wide values for SPMD shading, one lane per pixel, ISPC style:
+	// arithmetic runs on all lanes, branches become masks and F8Select.
+	// One __m256 when the compiler targets AVX, two SSE halves on plain
+	// x86-64, arrays elsewhere.
+	// --------------------------------------------------------------------------
+
+	#define LANE_COUNT	(8)
+
+#if defined(LANES_AVX)
+	#define LANES_ALIGN	alignas(32)
+#else
+	#define LANES_ALIGN	alignas(16)
+#endif
+
+	struct LANES_ALIGN float8
+	{
+#if defined(LANES_AVX)
+		__m256	v;
+#elif defined(LANES_SSE)
+		__m128	lo, hi;
+#else
+		f32	f[ LANE_COUNT ];
+#endif
+	};
+
+	// all ones or all zeros per lane
+	struct LANES_ALIGN mask8
+	{
+#if defined(LANES_AVX)
+		__m256	v;
+#elif defined(LANES_SSE)
+		__m128	lo, hi;
+#else
+		u32	m[ LANE_COUNT ];
+#endif
+	};
+
+	struct vec2x8
+	{
+		float8	x, y;
+	};
+	struct vec3x8
+	{
+		float8	x, y, z;
+	};
+
+	// --------------------------------------------------------------------------
+	// float8
+	// --------------------------------------------------------------------------
+
+	inline float8		F8Set(f32 f)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_set1_ps(f);
+#elif defined(LANES_SSE)
+		r.lo = r.hi = _mm_set1_ps(f);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = f;
+#endif
+		return r;
+	}
+	inline float8		F8Load(const f32 * p)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_loadu_ps(p);
+#elif defined(LANES_SSE)
+		r.lo = _mm_loadu_ps(p);
+		r.hi = _mm_loadu_ps(p + 4);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = p[ i ];
+#endif
+		return r;
+	}
+	inline void		F8Store(f32 * p, float8 a)
+	{
+#if defined(LANES_AVX)
+		_mm256_storeu_ps(p, a.v);
+#elif defined(LANES_SSE)
+		_mm_storeu_ps(p, a.lo);
+		_mm_storeu_ps(p + 4, a.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) p[ i ] = a.f[ i ];
+#endif
+	}
+
+#if defined(LANES_AVX)
+	#define LANES_F8_BINARY(op, avx, sse, expr)			\
+	inline float8		operator op (float8 a, float8 b)	\
+	{								\
+		float8 r; r.v = avx(a.v, b.v); return r;		\
+	}
+#elif defined(LANES_SSE)
+	#define LANES_F8_BINARY(op, avx, sse, expr)			\
+	inline float8		operator op (float8 a, float8 b)	\
+	{								\
+		float8 r; r.lo = sse(a.lo, b.lo); r.hi = sse(a.hi, b.hi); return r;	\
+	}
+#else
+	#define LANES_F8_BINARY(op, avx, sse, expr)			\
+	inline float8		operator op (float8 a, float8 b)	\
+	{								\
+		float8 r;						\
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = a.f[ i ] expr b.f[ i ];	\
+		return r;						\
+	}
+#endif
+
+	LANES_F8_BINARY(+, _mm256_add_ps, _mm_add_ps, +)
+	LANES_F8_BINARY(-, _mm256_sub_ps, _mm_sub_ps, -)
+	LANES_F8_BINARY(*, _mm256_mul_ps, _mm_mul_ps, *)
+	LANES_F8_BINARY(/, _mm256_div_ps, _mm_div_ps, /)
+
+	#undef LANES_F8_BINARY
+
+	inline float8		operator - (float8 a)
+	{
+		return F8Set(0.0f) - a;
+	}
+	inline float8		operator * (float8 a, f32 b)
+	{
+		return a * F8Set(b);
+	}
+
+	inline float8		F8Min(float8 a, float8 b)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_min_ps(a.v, b.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_min_ps(a.lo, b.lo);
+		r.hi = _mm_min_ps(a.hi, b.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = a.f[ i ] < b.f[ i ] ? a.f[ i ] : b.f[ i ];
+#endif
+		return r;
+	}
+	inline float8		F8Max(float8 a, float8 b)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_max_ps(a.v, b.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_max_ps(a.lo, b.lo);
+		r.hi = _mm_max_ps(a.hi, b.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = a.f[ i ] > b.f[ i ] ? a.f[ i ] : b.f[ i ];
+#endif
+		return r;
+	}
+	inline float8		F8Bound(float8 min, float8 value, float8 max)
+	{
+		return F8Min(F8Max(value, min), max);
+	}
+	inline float8		F8Sqrt(float8 a)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_sqrt_ps(a.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_sqrt_ps(a.lo);
+		r.hi = _mm_sqrt_ps(a.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = sqrtf(a.f[ i ]);
+#endif
+		return r;
+	}
+
+	// --------------------------------------------------------------------------
+	// mask8
+	// --------------------------------------------------------------------------
+
+#if defined(LANES_AVX)
+	#define LANES_F8_COMPARE(op, avx, sse, expr)			\
+	inline mask8		operator op (float8 a, float8 b)	\
+	{								\
+		mask8 r; r.v = _mm256_cmp_ps(a.v, b.v, avx); return r;	\
+	}
+#elif defined(LANES_SSE)
+	#define LANES_F8_COMPARE(op, avx, sse, expr)			\
+	inline mask8		operator op (float8 a, float8 b)	\
+	{								\
+		mask8 r; r.lo = sse(a.lo, b.lo); r.hi = sse(a.hi, b.hi); return r;	\
+	}
+#else
+	#define LANES_F8_COMPARE(op, avx, sse, expr)			\
+	inline mask8		operator op (float8 a, float8 b)	\
+	{								\
+		mask8 r;						\
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.m[ i ] = a.f[ i ] expr b.f[ i ] ? 0xffffffff : 0;	\
+		return r;						\
+	}
+#endif
+
+	LANES_F8_COMPARE(<, _CMP_LT_OQ, _mm_cmplt_ps, <)
+	LANES_F8_COMPARE(<=, _CMP_LE_OQ, _mm_cmple_ps, <=)
+	LANES_F8_COMPARE(>, _CMP_GT_OQ, _mm_cmpgt_ps, >)
+	LANES_F8_COMPARE(>=, _CMP_GE_OQ, _mm_cmpge_ps, >=)
+
+	#undef LANES_F8_COMPARE
+
+	// lanes [0, n) set
+	inline mask8		M8FirstN(int n)
+	{
+		mask8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+#elif defined(LANES_SSE)
+		r.lo = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(n), _mm_setr_epi32(0, 1, 2, 3)));
+		r.hi = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(n), _mm_setr_epi32(4, 5, 6, 7)));
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.m[ i ] = i < n ? 0xffffffff : 0;
+#endif
+		return r;
+	}
+	inline mask8		operator & (mask8 a, mask8 b)
+	{
+		mask8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_and_ps(a.v, b.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_and_ps(a.lo, b.lo);
+		r.hi = _mm_and_ps(a.hi, b.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.m[ i ] = a.m[ i ] & b.m[ i ];
+#endif
+		return r;
+	}
+	inline mask8		operator | (mask8 a, mask8 b)
+	{
+		mask8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_or_ps(a.v, b.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_or_ps(a.lo, b.lo);
+		r.hi = _mm_or_ps(a.hi, b.hi);
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.m[ i ] = a.m[ i ] | b.m[ i ];
+#endif
+		return r;
+	}
+	// bit i set if lane i is
+	inline int		M8Bits(mask8 a)
+	{
+#if defined(LANES_AVX)
+		return _mm256_movemask_ps(a.v);
+#elif defined(LANES_SSE)
+		return _mm_movemask_ps(a.lo) | ( _mm_movemask_ps(a.hi) << 4 );
+#else
+		int bits = 0;
+		for ( int i = 0; i < LANE_COUNT; ++i ) bits |= ( a.m[ i ] ? 1 : 0 ) << i;
+		return bits;
+#endif
+	}
+	inline bool		M8Any(mask8 a)
+	{
+		return M8Bits(a) != 0;
+	}
+	inline bool		M8All(mask8 a)
+	{
+		return M8Bits(a) == 0xff;
+	}
+	// mask ? a : b per lane
+	inline float8		F8Select(mask8 mask, float8 a, float8 b)
+	{
+		float8 r;
+#if defined(LANES_AVX)
+		r.v = _mm256_blendv_ps(b.v, a.v, mask.v);
+#elif defined(LANES_SSE)
+		r.lo = _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo));
+		r.hi = _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi));
+#else
+		for ( int i = 0; i < LANE_COUNT; ++i ) r.f[ i ] = mask.m[ i ] ? a.f[ i ] : b.f[ i ];
+#endif
+		return r;
+	}
+
+	// --------------------------------------------------------------------------
+	// vec3x8
+	// --------------------------------------------------------------------------
+
+	inline vec3x8		V3x8Set(const Vector3 & v)
+	{
+		return { F8Set(v.x), F8Set(v.y), F8Set(v.z) };
+	}
+	inline vec3x8		operator + (const vec3x8 & a, const vec3x8 & b)
+	{
+		return { a.x + b.x, a.y + b.y, a.z + b.z };
+	}
+	inline vec3x8		operator - (const vec3x8 & a, const vec3x8 & b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+	inline vec3x8		operator - (const vec3x8 & a)
+	{
+		return { -a.x, -a.y, -a.z };
+	}
+	inline vec3x8		V3x8Scale(const vec3x8 & a, float8 s)
+	{
+		return { a.x * s, a.y * s, a.z * s };
+	}
+	inline vec3x8		V3x8Multiply(const vec3x8 & a, const vec3x8 & b)
+	{
+		return { a.x * b.x, a.y * b.y, a.z * b.z };
+	}
+	inline float8		V3x8Dot(const vec3x8 & a, const vec3x8 & b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	inline float8		V3x8Length(const vec3x8 & a)
+	{
+		return F8Sqrt(V3x8Dot(a, a));
+	}
+	inline vec3x8		V3x8Normalize(const vec3x8 & a)
+	{
+		return V3x8Scale(a, F8Set(1.0f) / V3x8Length(a));
+	}
+	inline vec3x8		V3x8Bound(float8 min, const vec3x8 & a, float8 max)
+	{
+		return { F8Bound(min, a.x, max), F8Bound(min, a.y, max), F8Bound(min, a.z, max) };
+	}
+	inline vec3x8		V3x8Select(mask8 mask, const vec3x8 & a, const vec3x8 & b)
+	{
+		return { F8Select(mask, a.x, b.x), F8Select(mask, a.y, b.y), F8Select(mask, a.z, b.z) };
+	}
+}
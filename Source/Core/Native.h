@@ -16,6 +16,24 @@ enum NativeBlitMode
 	NATIVE_BLIT_FLIP_HV	= NATIVE_BLIT_FLIP_H | NATIVE_BLIT_FLIP_V,
 };
 
+enum NativeAllocPolicy
+{
+	NATIVE_ALLOC_DEFAULT	= 0,
+	NATIVE_ALLOC_HUGE_PAGE	= 1,	// 2 MiB pages if the system grants them, default pages otherwise
+};
+
+#define NATIVE_HUGE_PAGE_BYTES	(2 << 20)
+
+struct NativeAllocStats
+{
+	int64_t	nHugeAllocs;		// reserved huge pages (hugetlb pool, Windows large pages)
+	int64_t	nHugeBytes;
+	int64_t	nAdvisedAllocs;		// transparent huge pages requested with madvise
+	int64_t	nAdvisedBytes;
+	int64_t	nFallbackAllocs;	// huge pages requested, default pages used
+	int64_t	nFallbackBytes;
+};
+
 struct NativeWindowCallbacks
 {
 	void	( *move )	( int x, int y );
@@ -40,7 +58,42 @@ struct NativeMouseCallbacks
 	void	( *middleup )	( int x, int y );
 };
 
+// Scripted input, delivered by NativeInputPoll as if it came from the
+// user: iFrame counts polls from the NativeScriptInput call, 1 is the
+// next. Keys carry the keycode in x. NATIVE_INPUT_CLOSE closes the
+// window as its close button would.
+enum NativeInputType
+{
+	NATIVE_INPUT_KEY_DOWN	= 0,
+	NATIVE_INPUT_KEY_UP	= 1,
+	NATIVE_INPUT_MOUSE_MOVE	= 2,
+	NATIVE_INPUT_LEFT_DOWN	= 3,
+	NATIVE_INPUT_LEFT_UP	= 4,
+	NATIVE_INPUT_RIGHT_DOWN	= 5,
+	NATIVE_INPUT_RIGHT_UP	= 6,
+	NATIVE_INPUT_MIDDLE_DOWN = 7,
+	NATIVE_INPUT_MIDDLE_UP	= 8,
+	NATIVE_INPUT_CLOSE	= 9,
+};
+
+struct NativeInputEvent
+{
+	int64_t	iFrame;
+	int	type;
+	int	x;
+	int	y;
+};
+
 struct NativeWindow;
+struct NativeSharedMemory;
+struct NativeProcess;
+struct NativeSocket;
+
+// Backends: Win32Native.cpp, and HeadlessNative.cpp everywhere else.
+// Headless windows are memory surfaces nobody sees and input is scripted
+// or sent only. NATIVE_HEADLESS_FRAMES=n in the environment scripts every new
+// window to close after n polls, and makes waits skip the clock ahead
+// instead of sleeping so scenes run at full speed (see NativeWaitUntil).
 
 // Native
 bool		NativeInitialize();
@@ -55,19 +108,77 @@ int		NativeGetWindowCount();
 int		NativeWindowGetWidth(NativeWindow * pWindow);
 int		NativeWindowGetHeight(NativeWindow * pWindow);
 bool		NativeWindowBilt(NativeWindow * pWindow, const void * pSrc, int mode);
+// pSrc is still the whole window, only [nLeft, nRight) x [nTop, nBottom) of it is shown
+bool		NativeWindowBiltRect(NativeWindow * pWindow, const void * pSrc, int mode, int nLeft, int nTop, int nRight, int nBottom);
+// What the blits convert into: BGRA, top-down rows of width * 4 bytes,
+// nullptr once destroyed. Write it in place and show it with
+// NativeWindowPresentRect, no conversion or copy on the way.
+void *		NativeWindowGetSurface(NativeWindow * pWindow);
+bool		NativeWindowPresentRect(NativeWindow * pWindow, int nLeft, int nTop, int nRight, int nBottom);
 
 // Input
 void		NativeRegisterWindowCallbacks(NativeWindow * pWindow, const NativeWindowCallbacks * pCallbacks);
 void		NativeRegisterKeyboardCallbacks(NativeWindow * pWindow, const NativeKeyboardCallbacks * pCallbacks);
 void		NativeRegisterMouseCallbacks(NativeWindow * pWindow, const NativeMouseCallbacks * pCallbacks);
 void		NativeInputPoll();
+// replaces the window's script, the events sorted by iFrame
+void		NativeScriptInput(NativeWindow * pWindow, const NativeInputEvent * pEvents, int nEvents);
+// Input thread: the window's keyboard and mouse callbacks run on a thread
+// of its own as input arrives, instead of in NativeInputPoll, and wake a
+// NativeWaitUntil(..., true). Win32: raw input to a message-only window
+// the thread owns. Headless: what NativeSendInput and scripts send.
+// Stopping delivers what is left; closing the window stops it too.
+bool		NativeWindowStartInputThread(NativeWindow * pWindow);
+void		NativeWindowStopInputThread(NativeWindow * pWindow);
+// Keyboard or mouse input as if the user did it now, from any thread: to
+// the input thread, or the next NativeInputPoll without one.
+void		NativeSendInput(NativeWindow * pWindow, int type, int x, int y);
 
 // Time
 int64_t		NativeGetTick();
+// Sleeps until NativeGetTick() reaches iTick on a high resolution timer,
+// or with bWakeOnInput until input is queued (iTick < 0: no deadline).
+// True if input woke it. Headless, a pending script counts as input as
+// it only moves on with polls; with NATIVE_HEADLESS_FRAMES it returns at
+// once and the tick skips ahead to iTick.
+bool		NativeWaitUntil(int64_t iTick, bool bWakeOnInput);
+// CPU time the calling thread has used, microseconds: what its work cost
+// whoever else shares the core.
+int64_t		NativeGetThreadCpuTick();
 
 // Memory
 void *		AlignedMalloc(size_t nSize, size_t nAlign);
+void *		AlignedMallocEx(size_t nSize, size_t nAlign, int policy);
 void		AlignedFree(void * p);
+void		NativeGetAllocStats(NativeAllocStats * pStats);
+
+// Shared memory, named, mapped read-write by every process that opens
+// it. The creator's close removes the name, existing mappings stay.
+NativeSharedMemory *	NativeSharedMemoryCreate(const char * pName, size_t nSize);
+NativeSharedMemory *	NativeSharedMemoryOpen(const char * pName);	// NULL if there is none
+void *			NativeSharedMemoryGetData(NativeSharedMemory * pMemory);
+size_t			NativeSharedMemoryGetSize(NativeSharedMemory * pMemory);
+void			NativeSharedMemoryClose(NativeSharedMemory * pMemory);
+
+// Process
+// Runs this executable again with pArgs after the program name, NULL
+// if it could not start.
+NativeProcess *	NativeProcessSpawnSelf(const char * const * pArgs, int nArgs);
+bool		NativeProcessIsRunning(NativeProcess * pProcess);
+// Waits for the exit and frees pProcess, the exit code.
+int		NativeProcessWait(NativeProcess * pProcess);
+
+// Socket
+// Local stream sockets on a path (Unix domain), blocking. Send and Recv
+// move all nSize bytes or fail. Shutdown wakes a thread blocked in
+// Accept or Recv on the socket, Close frees it and a listener's path.
+NativeSocket *	NativeSocketListen(const char * pPath);
+NativeSocket *	NativeSocketAccept(NativeSocket * pListener);	// NULL once shut down
+NativeSocket *	NativeSocketConnect(const char * pPath);
+bool		NativeSocketSend(NativeSocket * pSocket, const void * pData, size_t nSize);
+bool		NativeSocketRecv(NativeSocket * pSocket, void * pData, size_t nSize);
+void		NativeSocketShutdown(NativeSocket * pSocket);
+void		NativeSocketClose(NativeSocket * pSocket);
 
 // Image
 void		NativeLoadBmp(const wchar_t * pBmpFile, int * pWidth, int * pHeight, void ** ppPixels);
@@ -0,0 +1,446 @@
+#include "RenderServer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#define RENDER_SERVER_WARM_SCENES	(4)	// per worker, least recently used goes
+#define RENDER_SERVER_MAX_BATCH		(32)
+
+namespace Graphics
+{
+	static inline double	_MsSince(std::chrono::steady_clock::time_point begin)
+	{
+		return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - begin ).count();
+	}
+
+	// ---------------------------------------------------------------
+	// RenderServer
+	// ---------------------------------------------------------------
+
+	struct RenderServer::Connection
+	{
+		NativeSocket *		pSocket;
+		std::mutex		sendMutex;	// workers answer concurrently
+		std::thread		thread;		// reads the requests
+		std::atomic<bool>	bDone;
+
+		Connection(NativeSocket * pSocket)
+			: pSocket(pSocket)
+			, bDone(false)
+		{
+		}
+		~Connection()
+		{
+			NativeSocketClose(pSocket);
+		}
+	};
+
+	// A loaded scene and what it draws into, on a device of its own so
+	// dropping it frees everything. Any size up to the target's draws
+	// through the viewport, as SceneRenderer's dynamic resolution does;
+	// a larger one grows the target and depth buffer, the scene stays.
+	struct RenderServer::WarmScene
+	{
+		std::string		name;
+		Integer			nWidth;		// of the target
+		Integer			nHeight;
+
+		Buffer			frame;
+		Device			device;
+		RenderTarget		target;
+		RenderTarget		viewport;	// the requested size
+		SwapChain		swapChain;
+		DepthStencilBuffer	depthStencilBuffer;
+		RenderContext		context;
+		Ptr<IScene>		scene;
+		Camera *		pCamera;
+
+		WarmScene(const std::string & name, Integer nWidth, Integer nHeight, const SceneFactory & create)
+			: name(name)
+			, nWidth(0)
+			, nHeight(0)
+		{
+			device			= Device::Create();
+			context			= device.CreateRenderContext();
+			CreateTarget(nWidth, nHeight);
+
+			scene			= create();
+			scene->OnLoad(device, context);
+			pCamera			= scene->GetCamera();
+		}
+		~WarmScene()
+		{
+			scene->OnUnload();
+
+			// scenes hold device handles
+			scene.reset();
+			Device::Destroy(device);
+		}
+		// The device keeps what it had until the scene goes, so the target
+		// at least doubles: all it outgrew adds up to less than it.
+		void			Fit(Integer nW, Integer nH)
+		{
+			if ( nW > nWidth || nH > nHeight )
+			{
+				CreateTarget(Max(nW, Min< Integer >(nWidth * 2, RENDER_SERVER_MAX_SIZE)),
+					     Max(nH, Min< Integer >(nHeight * 2, RENDER_SERVER_MAX_SIZE)));
+			}
+
+			Rect rect { 0, nW, 0, nH };
+			if ( viewport.GetWidth() != nW || viewport.GetHeight() != nH )
+			{
+				viewport.SetRect(rect);
+				if ( pCamera )
+				{
+					pCamera->SetAspectRatio(static_cast< float >( nW ) / nH);
+				}
+			}
+		}
+		void			CreateTarget(Integer nW, Integer nH)
+		{
+			Rect rect { 0, nW, 0, nH };
+
+			nWidth			= nW;
+			nHeight			= nH;
+			frame			= Buffer(nW, nH, 3, 4, ( 4 - ( ( nW * 3 ) & 0x3 ) ) & 0x3);
+			target			= device.CreateRenderTarget(&frame, rect);
+			viewport		= device.CreateRenderTarget(target, rect);
+			swapChain		= device.CreateSwapChain(target, BufferLayout::TILED, 2, false);
+			depthStencilBuffer	= device.CreateDepthStencilBuffer(nW, nH, BufferLayout::TILED);
+
+			context.SetSwapChain(swapChain);
+			context.SetDepthStencilBuffer(depthStencilBuffer);
+			context.SetRenderTarget(viewport);
+		}
+	};
+
+	RenderServer::RenderServer(Integer nWorkers)
+		: m_nWorkers(nWorkers > 0 ? nWorkers : Max< Integer >(1, std::thread::hardware_concurrency()))
+		, m_bStop(false)
+		, m_pListener(nullptr)
+		, m_stats {}
+	{
+	}
+	RenderServer::~RenderServer()
+	{
+		ASSERT(!m_pListener);
+	}
+	void			RenderServer::RegisterScene(const char * pName, const SceneFactory & create)
+	{
+		ASSERT(strlen(pName) < RENDER_SERVER_SCENE_NAME);
+		m_scenes[ pName ] = create;
+	}
+	bool			RenderServer::Run(const char * pPath)
+	{
+		std::vector<std::thread> workers;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			ASSERT(!m_pListener);
+
+			m_pListener = NativeSocketListen(pPath);
+			if ( !m_pListener )
+			{
+				return false;
+			}
+		}
+
+		for ( Integer i = 0; i < m_nWorkers; ++i )
+		{
+			workers.emplace_back(&RenderServer::Work, this);
+		}
+
+		while ( NativeSocket * pSocket = NativeSocketAccept(m_pListener) )
+		{
+			Ref<Connection> connection = std::make_shared<Connection>(pSocket);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if ( m_bStop )
+			{
+				break;
+			}
+
+			// clients that left
+			for ( auto it = m_connections.begin(); it != m_connections.end(); )
+			{
+				if ( ( *it )->bDone )
+				{
+					( *it )->thread.join();
+					it = m_connections.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			connection->thread = std::thread(&RenderServer::Serve, this, connection);
+			m_connections.push_back(connection);
+		}
+
+		Stop();
+		for ( std::thread & worker : workers )
+		{
+			worker.join();
+		}
+		for ( Ref<Connection> & connection : m_connections )
+		{
+			connection->thread.join();
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connections.clear();
+		m_jobs.clear();
+		NativeSocketClose(m_pListener);
+		m_pListener = nullptr;
+		return true;
+	}
+	void			RenderServer::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_bStop = true;
+			if ( m_pListener )
+			{
+				NativeSocketShutdown(m_pListener);
+			}
+			for ( Ref<Connection> & connection : m_connections )
+			{
+				NativeSocketShutdown(connection->pSocket);
+			}
+		}
+		m_cvJob.notify_all();
+	}
+	RenderServer::Stats	RenderServer::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+	// Reads one client's requests, until it leaves or the server stops.
+	void			RenderServer::Serve(Ref<Connection> connection)
+	{
+		RenderJobRequest request;
+
+		while ( NativeSocketRecv(connection->pSocket, &request, sizeof(request)) )
+		{
+			if ( request.magic != RENDER_SERVER_MAGIC )
+			{
+				// not a client of ours
+				break;
+			}
+			if ( request.type == RENDER_JOB_STOP )
+			{
+				Stop();
+				break;
+			}
+			request.scene[ RENDER_SERVER_SCENE_NAME - 1 ] = 0;
+
+			RenderJobResponse response = {};
+			response.magic	= RENDER_SERVER_MAGIC;
+			response.iJob	= request.iJob;
+			response.status	= RENDER_JOB_OK;
+			if ( request.type != RENDER_JOB_RENDER ||
+			     ( request.format != static_cast< u32 >( FrameFileFormat::QOI ) && request.format != static_cast< u32 >( FrameFileFormat::PNG ) ) ||
+			     request.nWidth < 1 || request.nWidth > RENDER_SERVER_MAX_SIZE ||
+			     request.nHeight < 1 || request.nHeight > RENDER_SERVER_MAX_SIZE )
+			{
+				response.status = RENDER_JOB_BAD_REQUEST;
+			}
+			else if ( m_scenes.find(request.scene) == m_scenes.end() )
+			{
+				response.status = RENDER_JOB_NO_SCENE;
+			}
+			if ( response.status != RENDER_JOB_OK )
+			{
+				Respond(*connection, response, std::vector<u8>());
+				continue;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if ( m_bStop )
+				{
+					break;
+				}
+				m_jobs.push_back(Job { request, connection });
+			}
+			m_cvJob.notify_one();
+		}
+
+		connection->bDone = true;
+	}
+	RenderServer::WarmScene &	RenderServer::GetWarmScene(std::vector<Ptr<WarmScene>> & warm, const RenderJobRequest & request)
+	{
+		const Integer nWidth	= static_cast< Integer >( request.nWidth );
+		const Integer nHeight	= static_cast< Integer >( request.nHeight );
+
+		// most recently used last
+		for ( auto it = warm.begin(); it != warm.end(); ++it )
+		{
+			if ( ( *it )->name == request.scene )
+			{
+				std::rotate(it, it + 1, warm.end());
+				return *warm.back();
+			}
+		}
+
+		if ( warm.size() >= RENDER_SERVER_WARM_SCENES )
+		{
+			warm.erase(warm.begin());
+		}
+		// Serve checked the name, and m_scenes is fixed once Run starts
+		warm.emplace_back(new WarmScene(request.scene, nWidth, nHeight, m_scenes.at(request.scene)));
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_stats.nLoads;
+		return *warm.back();
+	}
+	void			RenderServer::Respond(Connection & connection, const RenderJobResponse & response, const std::vector<u8> & image)
+	{
+		ASSERT(response.nBytes == image.size());
+
+		// a client that left just misses its answers
+		std::lock_guard<std::mutex> lock(connection.sendMutex);
+		if ( NativeSocketSend(connection.pSocket, &response, sizeof(response)) && !image.empty() )
+		{
+			NativeSocketSend(connection.pSocket, image.data(), image.size());
+		}
+	}
+	void			RenderServer::Work()
+	{
+		std::vector<Ptr<WarmScene>> warm;
+		std::vector<Job> batch;
+		std::vector<u8> image;
+		std::vector<u8> scratch;
+
+		for ( ;; )
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvJob.wait(lock, [ this ] { return m_bStop || !m_jobs.empty(); });
+				if ( m_bStop )
+				{
+					break;
+				}
+
+				// the oldest job, and those of the same scene at any size
+				batch.clear();
+				batch.push_back(std::move(m_jobs.front()));
+				m_jobs.pop_front();
+
+				const RenderJobRequest & first = batch.front().request;
+				for ( auto it = m_jobs.begin(); it != m_jobs.end() && batch.size() < RENDER_SERVER_MAX_BATCH; )
+				{
+					if ( strcmp(it->request.scene, first.scene) == 0 )
+					{
+						batch.push_back(std::move(*it));
+						it = m_jobs.erase(it);
+					}
+					else
+					{
+						++it;
+					}
+				}
+				++m_stats.nBatches;
+			}
+
+			WarmScene & ws = GetWarmScene(warm, batch.front().request);
+			for ( Job & job : batch )
+			{
+				const RenderJobRequest & request = job.request;
+				auto begin = std::chrono::steady_clock::now();
+
+				ws.Fit(static_cast< Integer >( request.nWidth ), static_cast< Integer >( request.nHeight ));
+				ws.scene->OnUpdate(0.0);
+				if ( ws.pCamera )
+				{
+					Transform camera = Transform::Identity();
+					camera.tx	= request.camera[ 0 ];
+					camera.ty	= request.camera[ 1 ];
+					camera.tz	= request.camera[ 2 ];
+					camera.rx	= request.camera[ 3 ];
+					camera.ry	= request.camera[ 4 ];
+					camera.rz	= request.camera[ 5 ];
+					ws.pCamera->transform = camera;
+				}
+				if ( SceneState * pState = ws.scene->GetState() )
+				{
+					pState->Capture();
+					pState->Flip();
+				}
+
+				ws.swapChain.ResetBackBuffer(0);
+				ws.depthStencilBuffer.ResetDepthBuffer(1.0f);
+				ws.scene->OnDraw();
+				const Rect rect = ws.viewport.GetRect();
+				ws.swapChain.Swap(&rect, 1);
+
+				RenderJobResponse response = {};
+				response.magic		= RENDER_SERVER_MAGIC;
+				response.iJob		= request.iJob;
+				response.status		= RENDER_JOB_OK;
+				response.msRender	= _MsSince(begin);
+
+				begin = std::chrono::steady_clock::now();
+				BufferRect brFrame = ws.frame.GetBufferRect();
+				brFrame.nCCount	= request.nWidth;
+				brFrame.nRCount	= request.nHeight;
+				FrameEncodeStill(&image, &scratch, static_cast< FrameFileFormat >( request.format ), &brFrame);
+				response.msEncode	= _MsSince(begin);
+				response.nBytes		= static_cast< u32 >( image.size() );
+
+				Respond(*job.connection, response, image);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_stats.nJobs;
+				m_stats.msRender += response.msRender;
+				m_stats.msEncode += response.msEncode;
+			}
+		}
+	}
+
+	// ---------------------------------------------------------------
+	// RenderClient
+	// ---------------------------------------------------------------
+
+	RenderClient::RenderClient()
+		: m_pSocket(nullptr)
+	{
+	}
+	RenderClient::~RenderClient()
+	{
+		Close();
+	}
+	bool			RenderClient::Connect(const char * pPath)
+	{
+		ASSERT(!m_pSocket);
+		m_pSocket = NativeSocketConnect(pPath);
+		return m_pSocket != nullptr;
+	}
+	bool			RenderClient::Send(const RenderJobRequest & request)
+	{
+		RenderJobRequest copy = request;
+		copy.magic = RENDER_SERVER_MAGIC;
+		return NativeSocketSend(m_pSocket, &copy, sizeof(copy));
+	}
+	bool			RenderClient::Receive(RenderJobResponse * pResponse, std::vector<u8> * pImage)
+	{
+		if ( !NativeSocketRecv(m_pSocket, pResponse, sizeof(*pResponse)) || pResponse->magic != RENDER_SERVER_MAGIC )
+		{
+			return false;
+		}
+		pImage->resize(pResponse->nBytes);
+		return pResponse->nBytes == 0 || NativeSocketRecv(m_pSocket, pImage->data(), pImage->size());
+	}
+	void			RenderClient::Close()
+	{
+		if ( m_pSocket )
+		{
+			NativeSocketClose(m_pSocket);
+			m_pSocket = nullptr;
+		}
+	}
+}
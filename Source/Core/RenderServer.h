@@ -0,0 +1,157 @@
+#pragma once
+
+#include "FrameEncoder.h"
+#include "Native.h"
+#include "Scene.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// Wire format
+	//
+	// A client sends requests and reads one response per render job,
+	// each followed by its nBytes of encoded image. Responses come back
+	// as jobs finish, not in request order: iJob tells them apart. The
+	// socket is local, so everything is in native byte order.
+	// ---------------------------------------------------------------
+
+	#define RENDER_SERVER_MAGIC		(0x4a425352)	// "RSBJ"
+	#define RENDER_SERVER_SCENE_NAME	(32)
+	#define RENDER_SERVER_MAX_SIZE		(8192)		// per side
+
+	enum RenderJobType
+	{
+		RENDER_JOB_RENDER	= 0,
+		RENDER_JOB_STOP		= 1,	// the server stops, no response
+	};
+
+	enum RenderJobStatus
+	{
+		RENDER_JOB_OK		= 0,
+		RENDER_JOB_BAD_REQUEST	= 1,
+		RENDER_JOB_NO_SCENE	= 2,	// not registered
+	};
+
+	struct RenderJobRequest
+	{
+		u32			magic;
+		u32			type;
+		u32			iJob;		// the client's, echoed back
+		u32			format;		// FrameFileFormat, QOI or PNG
+		u32			nWidth;
+		u32			nHeight;
+		float			camera[ 6 ];	// tx, ty, tz, rx, ry, rz of the scene camera, if it has one
+		char			scene[ RENDER_SERVER_SCENE_NAME ];	// as registered, NUL terminated
+	};
+
+	struct RenderJobResponse
+	{
+		u32			magic;
+		u32			iJob;
+		u32			status;
+		u32			nBytes;		// of image after this
+		double			msRender;	// clear to swap
+		double			msEncode;
+	};
+
+	// ---------------------------------------------------------------
+	// RenderServer
+	// ---------------------------------------------------------------
+
+	// Renders stills of registered scenes for clients on a local socket,
+	// and keeps what that takes warm: each worker thread holds the last
+	// few scenes it loaded, each with its own device, target and
+	// textures, whatever size it is asked for. A worker takes the oldest
+	// job plus every queued job of the same scene, and streams each image
+	// back as it is encoded.
+	class RenderServer
+	{
+	public:
+		typedef std::function<Ptr<IScene> ()> SceneFactory;
+
+		struct Stats
+		{
+			u64		nJobs;		// answered
+			u64		nBatches;
+			u64		nLoads;		// scenes loaded, the rest found warm
+			double		msRender;	// summed over jobs
+			double		msEncode;
+		};
+
+		// nWorkers 0 is one per core
+		RenderServer(Integer nWorkers = 0);
+		~RenderServer();
+
+		RenderServer(const RenderServer &) = delete;
+		RenderServer & operator = (const RenderServer &) = delete;
+
+		// before Run
+		void			RegisterScene(const char * pName, const SceneFactory & create);
+
+		// Serves pPath until Stop, or a RENDER_JOB_STOP request. False
+		// if it can't listen.
+		bool			Run(const char * pPath);
+		void			Stop();	// any thread
+
+		Stats			GetStats();
+
+	private:
+		struct Connection;
+		struct WarmScene;
+
+		struct Job
+		{
+			RenderJobRequest	request;
+			Ref<Connection>		connection;
+		};
+
+		void			Serve(Ref<Connection> connection);
+		void			Work();
+		WarmScene &		GetWarmScene(std::vector<Ptr<WarmScene>> & warm, const RenderJobRequest & request);
+		void			Respond(Connection & connection, const RenderJobResponse & response, const std::vector<u8> & image);
+
+		std::map<std::string, SceneFactory>	m_scenes;
+		Integer				m_nWorkers;
+
+		std::mutex			m_mutex;
+		std::condition_variable		m_cvJob;
+		std::deque<Job>			m_jobs;
+		bool				m_bStop;
+		NativeSocket *			m_pListener;
+		std::vector<Ref<Connection>>	m_connections;
+		Stats				m_stats;
+	};
+
+	// ---------------------------------------------------------------
+	// RenderClient
+	// ---------------------------------------------------------------
+
+	// The other end, one thread sending and one receiving at most.
+	class RenderClient
+	{
+	public:
+		RenderClient();
+		~RenderClient();
+
+		RenderClient(const RenderClient &) = delete;
+		RenderClient & operator = (const RenderClient &) = delete;
+
+		bool			Connect(const char * pPath);
+		bool			Send(const RenderJobRequest & request);	// magic filled in
+		// the next response to arrive, its image in pImage
+		bool			Receive(RenderJobResponse * pResponse, std::vector<u8> * pImage);
+		void			Close();
+
+	private:
+		NativeSocket *		m_pSocket;
+	};
+}
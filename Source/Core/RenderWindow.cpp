@@ -10,6 +10,8 @@ namespace Graphics
 		, pOnMouseMove(nullptr)
 		, pOnKeyDown(nullptr)
 		, pOnKeyUp(nullptr)
+		, bInputQueued(false)
+		, nInputDropped(0)
 	{
 		memset(&cbMouse, 0, sizeof(cbMouse));
 		memset(&cbKeyboard, 0, sizeof(cbKeyboard));
@@ -46,32 +48,95 @@ namespace Graphics
 	}
 
 
-	void		RenderWindow::OnMouseMove(int x, int y)
+	void		RenderWindow::SetInputQueued(bool bEnable)
 	{
-		win32::MouseEventArgs args;
-		args.pixelX = x;
-		args.pixelY = y;
-		if ( gpWindow && gpWindow->pOnMouseMove )
+		InputEvent e;
+
+		NativeWindowStopInputThread(pWindow);
+
+		// the listener may be gone
+		while ( inputQueue.Pop(&e) )
+		{
+		}
+		bInputQueued	= bEnable;
+		nInputDropped	= 0;
+
+		if ( bEnable )
 		{
-			(*gpWindow->pOnMouseMove)(gpWindow, args);
+			NativeWindowStartInputThread(pWindow);
 		}
 	}
-	void		RenderWindow::OnKeyDown(int keycode)
+	int64_t		RenderWindow::DispatchInput()
 	{
-		win32::KeyboardEventArgs args;
-		args.virtualKeyCode = keycode;
-		if ( gpWindow && gpWindow->pOnKeyDown )
+		InputEvent e;
+		int64_t iTick = -1;
+
+		while ( inputQueue.Pop(&e) )
 		{
-			( *gpWindow->pOnKeyDown )( gpWindow, args );
+			if ( iTick < 0 )
+			{
+				iTick = e.iTick;
+			}
+			Dispatch(e);
 		}
+		return iTick;
+	}
+
+
+	void		RenderWindow::OnMouseMove(int x, int y)
+	{
+		OnInput(InputEvent { NATIVE_INPUT_MOUSE_MOVE, x, y, NativeGetTick() });
+	}
+	void		RenderWindow::OnKeyDown(int keycode)
+	{
+		OnInput(InputEvent { NATIVE_INPUT_KEY_DOWN, keycode, 0, NativeGetTick() });
 	}
 	void		RenderWindow::OnKeyUp(int keycode)
 	{
-		win32::KeyboardEventArgs args;
-		args.virtualKeyCode = keycode;
-		if ( gpWindow && gpWindow->pOnKeyUp )
+		OnInput(InputEvent { NATIVE_INPUT_KEY_UP, keycode, 0, NativeGetTick() });
+	}
+	void		RenderWindow::OnInput(const InputEvent & e)
+	{
+		if ( !gpWindow )
+		{
+			return;
+		}
+		if ( gpWindow->bInputQueued )
+		{
+			if ( !gpWindow->inputQueue.Push(e) )
+			{
+				gpWindow->nInputDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			gpWindow->Dispatch(e);
+		}
+	}
+	void		RenderWindow::Dispatch(const InputEvent & e)
+	{
+		if ( e.type == NATIVE_INPUT_MOUSE_MOVE )
+		{
+			win32::MouseEventArgs args;
+			args.pixelX = e.x;
+			args.pixelY = e.y;
+			if ( pOnMouseMove )
+			{
+				( *pOnMouseMove )( this, args );
+			}
+		}
+		else
 		{
-			( *gpWindow->pOnKeyUp )( gpWindow, args );
+			win32::KeyboardEventArgs args;
+			args.virtualKeyCode = e.x;
+			if ( e.type == NATIVE_INPUT_KEY_DOWN && pOnKeyDown )
+			{
+				( *pOnKeyDown )( this, args );
+			}
+			if ( e.type == NATIVE_INPUT_KEY_UP && pOnKeyUp )
+			{
+				( *pOnKeyUp )( this, args );
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -3,10 +3,64 @@
 #include "Native.h"
 #include "Resource.h"
 
+#include <atomic>
+
 namespace Graphics
 {
 	class IRenderer;
 
+	// Window input, stamped with NativeGetTick when it came in
+	struct InputEvent
+	{
+		int			type;	// NativeInputType
+		int			x;	// keycode for keys
+		int			y;
+		int64_t			iTick;
+	};
+
+	#define INPUT_QUEUE_SIZE (256) // power of two
+
+	// Lock-free, one thread pushing and one popping: the window's input
+	// thread and the render thread. When full the newest is dropped and
+	// Push returns false, which only a stalled consumer would see.
+	class InputQueue
+	{
+	public:
+		InputQueue()
+			: m_nPopped(0)
+			, m_nPushed(0)
+		{
+		}
+
+		bool			Push(const InputEvent & e)
+		{
+			u64 nPushed = m_nPushed.load(std::memory_order_relaxed);
+			if ( nPushed - m_nPopped.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE )
+			{
+				return false;
+			}
+			m_events[ nPushed & ( INPUT_QUEUE_SIZE - 1 ) ] = e;
+			m_nPushed.store(nPushed + 1, std::memory_order_release);
+			return true;
+		}
+		bool			Pop(InputEvent * pEvent)
+		{
+			u64 nPopped = m_nPopped.load(std::memory_order_relaxed);
+			if ( nPopped == m_nPushed.load(std::memory_order_acquire) )
+			{
+				return false;
+			}
+			*pEvent = m_events[ nPopped & ( INPUT_QUEUE_SIZE - 1 ) ];
+			m_nPopped.store(nPopped + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		alignas(64) std::atomic<u64>	m_nPopped;
+		alignas(64) std::atomic<u64>	m_nPushed;
+		InputEvent			m_events[ INPUT_QUEUE_SIZE ];
+	};
+
 	class RenderWindow : public IUnknown
 	{
 		_INTERFACE_DEFINE_IID(1610280267);
@@ -16,6 +70,18 @@ namespace Graphics
 		virtual bool		QueryInterface(Integer guid, void **  ppInterface) override;
 		void			RegisterEventListener(OnMouseMoveEventHandler * pOnMouseMove, OnKeyDownEventHandler * pOnKeyDown, OnKeyUpEventHandler * pOnKeyUp);
 
+		// Reads input on the window's input thread and queues it as it
+		// comes, until DispatchInput hands it to the listener on this
+		// thread. Drops what is queued, and the count of dropped input.
+		void			SetInputQueued(bool bEnable);
+		// the tick of the oldest input handled, -1 if none was queued
+		int64_t			DispatchInput();
+		// input that came with the queue full, since queueing began
+		u64			GetDroppedInputCount() const
+		{
+			return nInputDropped.load(std::memory_order_relaxed);
+		}
+
 		NativeWindow *		GetWindow()
 		{
 			return pWindow;
@@ -33,6 +99,8 @@ namespace Graphics
 		static void		OnMouseMove(int x, int y);
 		static void		OnKeyDown(int keycode);
 		static void		OnKeyUp(int keycode);
+		static void		OnInput(const InputEvent & e);
+		void			Dispatch(const InputEvent & e);
 
 		NativeWindow *			pWindow;
 		NativeMouseCallbacks		cbMouse;
@@ -41,5 +109,9 @@ namespace Graphics
 		OnMouseMoveEventHandler *	pOnMouseMove;
 		OnKeyDownEventHandler *		pOnKeyDown;
 		OnKeyUpEventHandler *		pOnKeyUp;
+
+		bool				bInputQueued;	// set only while no input thread runs
+		InputQueue			inputQueue;
+		std::atomic<u64>		nInputDropped;
 	};
 }
\ No newline at end of file
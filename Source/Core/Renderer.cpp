@@ -3,6 +3,9 @@
 #include "Scene.h"
 #include "Common.h"
 
+#include <cinttypes>
+#include <cstdio>
+
 static const float gUnitCubeVertices[] =
 {
 	// up
@@ -63,10 +66,6 @@ static const float gUnitCubeNorms[] =
 	 0.0f,  0.0f, -1.0f,
 };
 
-static inline int64_t TickToMs2(int64_t tick)
-{
-	return tick / 1000;
-}
 static inline double TickToMs(int64_t tick)
 {
 	return (double)(tick) * 0.001;
@@ -78,6 +77,33 @@ static inline int64_t MsToTick(double ms)
 
 namespace Graphics
 {
+	// How late timed waits wake up, reported with the frame stats
+	struct WaitJitter
+	{
+		int64_t		nWaits = 0;
+		int64_t		iLateSum = 0;
+		int64_t		iLateMax = 0;
+
+		void		Add(int64_t iLate)
+		{
+			++nWaits;
+			iLateSum += iLate;
+			iLateMax = Max(iLateMax, iLate);
+		}
+		double		AverageMs() const
+		{
+			return nWaits ? TickToMs(iLateSum) / nWaits : 0.0;
+		}
+		double		MaxMs() const
+		{
+			return TickToMs(iLateMax);
+		}
+		void		Reset()
+		{
+			nWaits = iLateSum = iLateMax = 0;
+		}
+	};
+
 	void		RenderMainLoop(NativeWindow * pWindow, IRenderer * pRenderer)
 	{
 		const double dTickCostMin = 1000.0 / 200.0; // 220 FPS
@@ -85,7 +111,7 @@ namespace Graphics
 		int64_t nFrame;
 		int64_t iTickBegin, iTickEnd;
 		int64_t iTickCost;
-		int64_t iTickFps;
+		WaitJitter jitter;
 
 		ASSERT(pWindow);
 		ASSERT(pRenderer);
@@ -107,7 +133,8 @@ namespace Graphics
 				// Throttle frame rate
 				if (iTickCost < iTickCostMin)
 				{
-					Sleep(TickToMs2(iTickCostMin - iTickCost));
+					NativeWaitUntil(iTickBegin + iTickCostMin, false);
+					jitter.Add(NativeGetTick() - ( iTickBegin + iTickCostMin ));
 				}
 
 				// Present frame N
@@ -116,7 +143,7 @@ namespace Graphics
 				// Show frame N debug info
 				{
 					static double accu = 0.0;
-					double cost = TickToMs(max(iTickCostMin, iTickCost));
+					double cost = TickToMs(Max(iTickCostMin, iTickCost));
 					double fps = 1000.0 / cost;
 					double fcost;
 
@@ -125,27 +152,114 @@ namespace Graphics
 					{
 						fcost = TickToMs(iTickCost);
 
-						printf("FPS=%.2lf Cost=%.2lf(ms) Frame=%lld\n",
+						// Work is the frame without the throttle, what a benchmark wants
+						printf("FPS=%.2lf Cost=%.2lf(ms) Work=%.2lf(ms) Frame=%" PRId64 " Late=%.3lf/%.3lf(ms)\n",
 						       fps,
 						       cost,
-						       nFrame);
+						       fcost,
+						       nFrame,
+						       jitter.AverageMs(),
+						       jitter.MaxMs());
 
 						accu = 0.0;
+						jitter.Reset();
 					}
 				}
 			}
 
 			// Count frame N+1 cost (begin)
-			iTickFps = iTickBegin = NativeGetTick();
+			iTickBegin = NativeGetTick();
 
 			// Reset drawing surface
 			pRenderer->Clear();
 
 			// Update and draw frame N+1
-			pRenderer->Update(TickToMs(max(iTickCostMin, iTickCost)));
+			pRenderer->Update(TickToMs(Max(iTickCostMin, iTickCost)));
+			pRenderer->Draw();
+
+			++nFrame;
+		}
+	}
+	void		RenderOnDemandLoop(NativeWindow * pWindow, IRenderer * pRenderer, double dTimerMs)
+	{
+		const int64_t iTickCostMin = MsToTick(1000.0 / 200.0); // while animated
+		const int64_t iTickTimer = MsToTick(dTimerMs);
+		const int64_t iTickReport = MsToTick(1000.0);
+		int64_t nFrame, nReportFrames, nReportWakes;
+		int64_t iTickNow, iTickLastUpdate, iTickTimerNext, iTickReportNext;
+		WaitJitter jitter;
+		bool bFrame;
+
+		ASSERT(pWindow);
+		ASSERT(pRenderer);
+
+		iTickNow = iTickLastUpdate = NativeGetTick();
+		iTickTimerNext = iTickNow + iTickTimer;
+		iTickReportNext = iTickNow + iTickReport;
+		nFrame = nReportFrames = nReportWakes = 0;
+		bFrame = true; // first frame
+
+		while ( NativeGetWindowCount() > 0 )
+		{
+			// Idle until input or the timer, any queued message counts
+			if ( !bFrame )
+			{
+				int64_t iDeadline = iTickTimer > 0 ? iTickTimerNext : -1;
+
+				bFrame = NativeWaitUntil(iDeadline, true);
+				if ( !bFrame )
+				{
+					jitter.Add(NativeGetTick() - iDeadline);
+				}
+				++nReportWakes;
+			}
+
+			NativeInputPoll();
+
+			iTickNow = NativeGetTick();
+			if ( iTickTimer > 0 && iTickNow >= iTickTimerNext )
+			{
+				iTickTimerNext = iTickNow + iTickTimer;
+				bFrame = true;
+			}
+
+			// Show debug info, at the first wake after each second
+			if ( iTickNow >= iTickReportNext )
+			{
+				printf("Frames=%" PRId64 " Wakes=%" PRId64 " Late=%.3lf/%.3lf(ms) Frame=%" PRId64 "\n",
+				       nReportFrames,
+				       nReportWakes,
+				       jitter.AverageMs(),
+				       jitter.MaxMs(),
+				       nFrame);
+
+				iTickReportNext = iTickNow + iTickReport;
+				nReportFrames = nReportWakes = 0;
+				jitter.Reset();
+			}
+
+			if ( !bFrame )
+			{
+				continue;
+			}
+
+			// Update, draw and present frame N, scene time is wall time
+			pRenderer->Clear();
+			pRenderer->Update(TickToMs(iTickNow - iTickLastUpdate));
 			pRenderer->Draw();
+			pRenderer->Present();
 
+			iTickLastUpdate = iTickNow;
 			++nFrame;
+			++nReportFrames;
+
+			// Keep going while animated, throttled like RenderMainLoop
+			bFrame = pRenderer->IsAnimated();
+			if ( bFrame && NativeGetTick() < iTickNow + iTickCostMin )
+			{
+				NativeWaitUntil(iTickNow + iTickCostMin, false);
+				jitter.Add(NativeGetTick() - ( iTickNow + iTickCostMin ));
+			}
 		}
 	}
 
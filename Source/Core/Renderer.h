@@ -26,6 +26,11 @@ namespace Graphics
 		virtual void		Clear() = 0;
 		virtual void		Update(double milliSeconds) = 0;
 		virtual void		Draw() = 0;
+		// the next frame would differ even without input
+		virtual bool		IsAnimated()
+		{
+			return true;
+		}
 	};
 
 	// --------------------------------------------------------------------------
@@ -33,6 +38,9 @@ namespace Graphics
 	// --------------------------------------------------------------------------
 
 	void	RenderMainLoop(NativeWindow * pWindow, IRenderer * pRenderer);
+	// Renders only on input, while the renderer is animated, or every
+	// dTimerMs (0: no timer), sleeping on NativeWaitUntil in between.
+	void	RenderOnDemandLoop(NativeWindow * pWindow, IRenderer * pRenderer, double dTimerMs);
 
 	// --------------------------------------------------------------------------
 	// Renderable Implementation
@@ -2,10 +2,21 @@
 #include "_Math.h"
 
 #include "RenderWindow.h"
+#include "FrameEncoder.h"
+#include "FrameRing.h"
 
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #define NUM_MAX_VERTEX_FIELD (5)
+#define STENCIL_TILE_SHIFT (3) // 8x8 pixels per stencil summary entry
+#define STENCIL_TILE_SIZE (1 << STENCIL_TILE_SHIFT)
+#define SWAP_CHAIN_SHARPEN (4) // of BUFFER_SHARPEN_MAX, for scaled presents
+#define TEMPORAL_BLEND_MIN (0.05f) // weight of a new sample far from the pixel
+#define TEMPORAL_BLEND_MAX (0.5f) // weight of a new sample on the pixel
 
 namespace Graphics
 {
@@ -22,14 +33,37 @@ namespace Graphics
 	struct SwapChain_Desc
 	{
 		DescIndex		iRenderTargetDesc;
-		BufferIndex		iBuffers[ 2 ];
-		bool			bSwapped;
+		BufferIndex		iBuffers[ SWAP_CHAIN_MAX_BUFFERS ];	// nBuffers of them in rotation
+		Integer			nBuffers;
+		Integer			iBackBuffer;	// the one before it is the front buffer
+		u64			nFrames;	// swapped so far
+		BufferIndex		iLinearBuffer;	// tiled only, front buffer detiled for presenting
+		BufferIndex		iScaledBuffer;	// valid if bHasScaledBuffer, made by the first scaled present
+		Integer			iPresentQueue;	// valid if bAsync
+		bool			bTiled;
+		bool			bHasScaledBuffer;
+		bool			bAsync;
+		BufferIndex		iHistoryBuffers[ 2 ];	// f32 BGR, ping-pong, valid if bHasTemporalBuffers
+		BufferIndex		iMotionBuffer;	// TemporalSample per source pixel
+		Integer			iHistory;	// history read by the next temporal present
+		bool			bHasTemporalBuffers;
+		bool			bHistoryValid;
+		Integer			iEncoder;	// valid if bHasEncoder, null while no output is set
+		bool			bHasEncoder;
+	};
+
+	struct TemporalSample
+	{
+		Vector2			motion;		// uv now - uv last frame
+		Byte			bgrMin[ 3 ];	// 3x3 neighbourhood bounds
+		Byte			bgrMax[ 3 ];
 	};
 
 	struct DepthStencil_Desc
 	{
 		BufferIndex		iDepthBuffer;
 		BufferIndex		iStencilBuffer;
+		BufferIndex		iStencilTiles;	// nonzero stencil count per tile: 0, all or mixed
 	};
 
 	struct VertexFormat_Desc
@@ -58,9 +92,18 @@ namespace Graphics
 		Rect			rect;
 	};
 
+	struct View_Desc
+	{
+		Matrix44		view;
+		Matrix44		proj;
+		DescIndex		iRenderTargetDesc;
+		bool			bFlipHorizontal;
+	};
+
 	struct VertexShader_Desc
 	{
 		VertexShaderFunc	pFunc;
+		PositionShaderFunc	pPosFunc;	// optional
 		DescIndex		iVSInFormat;
 		DescIndex		iVSOutFormat;
 	};
@@ -87,8 +130,111 @@ namespace Graphics
 		const void *		pPixelShaderData;
 
 		bool			bFlipHorizontal;
+		ShadingRate		shadingRate;
+		const ShadingRate *	pShadingRateImage;	// optional, per tile
+		Integer			nShadingRateCols;
+		Integer			nShadingRateRows;
+		std::vector<Rect>	vScissorRects;	// empty: no scissor test
 		DepthStencilState	stDepthStencil;
 		BlendState		stBlend;
+
+		bool			bStreamOut;
+		DescIndex		iStreamOutDesc;	// vertex buffer receiving VS output
+
+		View_Desc		views[ MAX_VIEW_COUNT ];
+		Integer			nViews;
+
+		std::vector<Vector3>	vPositions;	// position pass output, 2 per vertex
+		std::vector<Vector3>	vWorld;		// multi-view, world position per vertex
+		std::vector<Byte>	vShaded;	// multi-view, VS output per vertex
+		std::vector<bool>	vIsShaded;
+	};
+
+	// Present thread of an async swap chain. Runs presents in order and
+	// counts them: frame n is on the target once nCompleted >= n.
+	struct PresentQueue
+	{
+		std::mutex				mutex;
+		std::condition_variable			cvSubmit;
+		std::condition_variable			cvComplete;
+		std::deque<std::function<void ()>>	jobs;
+		u64					nSubmitted;
+		u64					nCompleted;
+		bool					bStop;
+		std::thread				thread;
+
+		PresentQueue()
+			: nSubmitted(0)
+			, nCompleted(0)
+			, bStop(false)
+		{
+			thread = std::thread(&PresentQueue::Run, this);
+		}
+		~PresentQueue()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				bStop = true;
+			}
+			cvSubmit.notify_one();
+			thread.join();
+		}
+		void		Submit(std::function<void ()> && job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				jobs.emplace_back(std::move(job));
+				++nSubmitted;
+			}
+			cvSubmit.notify_one();
+		}
+		// on the calling thread, after everything submitted before it
+		void		RunInline(const std::function<void ()> & job)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cvComplete.wait(lock, [ this ] { return nCompleted == nSubmitted; });
+			++nSubmitted;
+			lock.unlock();
+
+			job();
+
+			lock.lock();
+			++nCompleted;
+			cvComplete.notify_all();
+		}
+		u64		Completed()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return nCompleted;
+		}
+		void		Wait(u64 frame)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cvComplete.wait(lock, [ this, frame ] { return nCompleted >= frame; });
+		}
+		void		Run()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for ( ;; )
+			{
+				cvSubmit.wait(lock, [ this ] { return bStop || !jobs.empty(); });
+				if ( bStop )
+				{
+					// what is left may target windows already gone
+					break;
+				}
+
+				std::function<void ()> job = std::move(jobs.front());
+				jobs.pop_front();
+				lock.unlock();
+
+				job();
+
+				lock.lock();
+				++nCompleted;
+				cvComplete.notify_all();
+			}
+		}
 	};
 
 	struct Device_Impl
@@ -108,6 +254,11 @@ namespace Graphics
 		std::vector<RenderTarget_Desc>		renderTargetDescs;
 
 		std::vector<Ptr<RenderContext_Impl>>	renderContextImpls;
+
+		std::deque<Ptr<FrameEncoder>>		encoders;
+
+		// last, so the threads stop before the buffers they read go
+		std::deque<PresentQueue>		presentQueues;
 	};
 
 	struct ShaderContext
@@ -309,7 +460,7 @@ namespace Graphics
 		return
 			device.buffers[
 				swapChainDesc.iBuffers[
-					swapChainDesc.bSwapped ? 1 : 0
+					( swapChainDesc.iBackBuffer + swapChainDesc.nBuffers - 1 ) % swapChainDesc.nBuffers
 				].value
 			];
 	}
@@ -328,7 +479,7 @@ namespace Graphics
 		return
 			device.buffers[
 				swapChainDesc.iBuffers[
-					swapChainDesc.bSwapped ? 0 : 1
+					swapChainDesc.iBackBuffer
 				].value
 			];
 	}
@@ -362,6 +513,16 @@ namespace Graphics
 
 		return pDevice->buffers[ pDepthStencilDesc->iStencilBuffer.value ];
 	}
+	static inline Buffer &			_GetStencilTiles(RenderContext_Impl & context)
+	{
+		Device_Impl *		pDevice;
+		DepthStencil_Desc *	pDepthStencilDesc;
+
+		pDevice			= context.pDevice;
+		pDepthStencilDesc	= &pDevice->depthStencilDescs[ context.iDepthStencilDesc.value ];
+
+		return pDevice->buffers[ pDepthStencilDesc->iStencilTiles.value ];
+	}
 	static inline VertexShader_Desc *	_GetVertexShaderDesc(RenderContext_Impl & context)
 	{
 		Device_Impl *		pDevice;
@@ -439,6 +600,18 @@ namespace Graphics
 		return pRenderTargetDesc->rect;
 	}
 
+	// tiled buffers as one row over the whole allocation, element order
+	// is the same for every buffer of the same extent
+	static inline BufferRect		_GetStorageRect(Buffer & b)
+	{
+		if ( b.Layout() == BufferLayout::TILED )
+		{
+			BufferRect rect = { ( u8 * ) b.Data(), 1, ( u32 ) ( b.SizeInBytes() / b.ElementSize() ), ( u32 ) b.SizeInBytes(), ( u32 ) b.ElementSize() };
+			return rect;
+		}
+		return b.GetBufferRect();
+	}
+
 	static inline void			_ResetBackBuffer(Buffer & b, Byte value)
 	{
 		b.SetAll(value);
@@ -447,9 +620,83 @@ namespace Graphics
 	{
 		b.SetAllAs<float>(value);
 	}
-	static inline void			_ResetStencilBuffer(Buffer & b, Byte value = 0xff)
+	static inline Integer			_StencilTilePixels(const Buffer & b, Integer xTile, Integer yTile)
+	{
+		return Min(( Integer ) STENCIL_TILE_SIZE, b.Width() - ( xTile << STENCIL_TILE_SHIFT )) *
+		       Min(( Integer ) STENCIL_TILE_SIZE, b.Height() - ( yTile << STENCIL_TILE_SHIFT ));
+	}
+	static inline bool			_StencilTilesAllZero(const Buffer & tiles, Integer xTileMin, Integer yTileMin, Integer xTileMax, Integer yTileMax)
+	{
+		for ( Integer yTile = yTileMin; yTile <= yTileMax; ++yTile )
+		{
+			for ( Integer xTile = xTileMin; xTile <= xTileMax; ++xTile )
+			{
+				if ( *static_cast< const Byte * >( tiles.At(yTile, xTile) ) )
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	// rate image tiles are the stencil summary tiles
+	static_assert(SHADING_RATE_TILE_SIZE == STENCIL_TILE_SIZE, "shading rate tile");
+	static inline bool			_ScissorIntersects(const RenderContext_Impl & context, const Rect & rect)
+	{
+		for ( const Rect & scissor : context.vScissorRects )
+		{
+			if ( scissor.left < rect.right && rect.left < scissor.right &&
+			     scissor.top < rect.bottom && rect.top < scissor.bottom )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	// one scissor rect covers all of rect
+	static inline bool			_ScissorContains(const RenderContext_Impl & context, const Rect & rect)
+	{
+		for ( Rect scissor : context.vScissorRects )
+		{
+			if ( scissor.Contains(rect) )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	static inline ShadingRate		_GetShadingRate(const RenderContext_Impl & context, Integer xTile, Integer yTile)
+	{
+		ShadingRate rate = context.shadingRate;
+		if ( context.pShadingRateImage &&
+		     xTile < context.nShadingRateCols &&
+		     yTile < context.nShadingRateRows )
+		{
+			rate = Max(rate, context.pShadingRateImage[ yTile * context.nShadingRateCols + xTile ]);
+		}
+		return rate;
+	}
+	static inline void			_GetShadingRateSize(ShadingRate rate, Integer * pWidth, Integer * pHeight)
+	{
+		switch ( rate )
+		{
+			case ShadingRate::RATE_2X1:	*pWidth = 2; *pHeight = 1; break;
+			case ShadingRate::RATE_2X2:	*pWidth = 2; *pHeight = 2; break;
+			case ShadingRate::RATE_4X4:	*pWidth = 4; *pHeight = 4; break;
+			case ShadingRate::RATE_1X1:
+			default:			*pWidth = 1; *pHeight = 1; break;
+		}
+	}
+	static inline void			_ResetStencilBuffer(Buffer & b, Buffer & tiles, Byte value = 0xff)
 	{
 		b.SetAll(value);
+		for ( Integer yTile = 0; yTile < tiles.Height(); ++yTile )
+		{
+			for ( Integer xTile = 0; xTile < tiles.Width(); ++xTile )
+			{
+				*static_cast< Byte * >( tiles.At(yTile, xTile) ) = value ? static_cast< Byte >( _StencilTilePixels(b, xTile, yTile) ) : 0;
+			}
+		}
 		/*
 		Integer xMid = stencilBuffer.Width() / 2;
 		Integer yMid = stencilBuffer.Height() / 2;
@@ -463,12 +710,14 @@ namespace Graphics
 		*/
 	}
 
-	static inline BufferIndex		_CreateBuffer(Device_Impl & device, Integer width, Integer height, Integer elementSize, Integer alignment = 1, Integer rowPadding = 0)
+	static inline BufferIndex		_CreateBuffer(Device_Impl & device, Integer width, Integer height, Integer elementSize, Integer alignment = 1, Integer rowPadding = 0, BufferLayout layout = BufferLayout::LINEAR)
 	{
 		BufferIndex iBuffer;
 		iBuffer.value = device.buffers.size();
 
-		device.buffers.emplace_back(width, height, elementSize, alignment, rowPadding);
+		// every device buffer is a target, texture or vertex store, the
+		// allocator keeps small ones on regular pages
+		device.buffers.emplace_back(width, height, elementSize, alignment, rowPadding, BufferPolicy::HUGE_PAGE, layout);
 
 		return iBuffer;
 	}
@@ -477,7 +726,7 @@ namespace Graphics
 		BufferIndex iBuffer;
 		iBuffer.value = device.buffers.size();
 
-		device.buffers.emplace_back(width, height, elementSize, alignment, rowPadding);
+		device.buffers.emplace_back(width, height, elementSize, alignment, rowPadding, BufferPolicy::HUGE_PAGE);
 		
 		if (pData)
 		{
@@ -494,10 +743,12 @@ namespace Graphics
 
 		return iBuffer;
 	}
-	static inline SwapChain_Desc		_CreateSwapChain(Device_Impl & device, DescIndex iRenderTargetDesc)
+	static inline SwapChain_Desc		_CreateSwapChain(Device_Impl & device, DescIndex iRenderTargetDesc, BufferLayout layout, Integer nBuffers, bool bAsync)
 	{
 		RenderTarget_Desc * pRenderTargetDesc;
 
+		ASSERT(1 <= nBuffers && nBuffers <= SWAP_CHAIN_MAX_BUFFERS);
+
 		pRenderTargetDesc	= &device.renderTargetDescs[ iRenderTargetDesc.value ];
 
 		Integer nWidth		= pRenderTargetDesc->rect.right - pRenderTargetDesc->rect.left;
@@ -507,31 +758,95 @@ namespace Graphics
 		SwapChain_Desc sc;
 
 		sc.iRenderTargetDesc	= iRenderTargetDesc;
-		sc.iBuffers[0]		= _CreateBuffer(device, nWidth, nHeight, 3, 4, rowPadding);
-		sc.iBuffers[1]		= _CreateBuffer(device, nWidth, nHeight, 3, 4, rowPadding);
-		sc.bSwapped		= false;
+		for ( Integer i = 0; i < nBuffers; ++i )
+		{
+			sc.iBuffers[i]	= _CreateBuffer(device, nWidth, nHeight, 3, 4, rowPadding, layout);
+		}
+		sc.nBuffers		= nBuffers;
+		sc.iBackBuffer		= 0;
+		sc.nFrames		= 0;
+		sc.iLinearBuffer	= NULL_BUFFER;
+		sc.iScaledBuffer	= NULL_BUFFER;
+		sc.iPresentQueue	= 0;
+		sc.bTiled		= ( layout == BufferLayout::TILED );
+		sc.bHasScaledBuffer	= false;
+		sc.bAsync		= bAsync;
+		sc.iHistoryBuffers[0]	= NULL_BUFFER;
+		sc.iHistoryBuffers[1]	= NULL_BUFFER;
+		sc.iMotionBuffer	= NULL_BUFFER;
+		sc.iHistory		= 0;
+		sc.bHasTemporalBuffers	= false;
+		sc.bHistoryValid	= false;
+		sc.iEncoder		= 0;
+		sc.bHasEncoder		= false;
+
+		if ( sc.bTiled )
+		{
+			sc.iLinearBuffer = _CreateBuffer(device, nWidth, nHeight, 3, 4, rowPadding);
+		}
+		if ( sc.bAsync )
+		{
+			sc.iPresentQueue = device.presentQueues.size();
+			device.presentQueues.emplace_back();
+		}
 
 		return sc;
 	}
-	static inline DepthStencil_Desc		_CreateDepthStencilBuffer(Device_Impl & device, Integer nWidth, Integer nHeight)
+	static inline DepthStencil_Desc		_CreateDepthStencilBuffer(Device_Impl & device, Integer nWidth, Integer nHeight, BufferLayout layout)
 	{
 		DepthStencil_Desc dsb;
 
-		dsb.iDepthBuffer	= _CreateBuffer(device, nWidth, nHeight, 4, 1, 0);
-		dsb.iStencilBuffer	= _CreateBuffer(device, nWidth, nHeight, 1, 1, 0);
+		dsb.iDepthBuffer	= _CreateBuffer(device, nWidth, nHeight, 4, 1, 0, layout);
+		dsb.iStencilBuffer	= _CreateBuffer(device, nWidth, nHeight, 1, 1, 0, layout);
+		dsb.iStencilTiles	= _CreateBuffer(device,
+							( nWidth + STENCIL_TILE_SIZE - 1 ) >> STENCIL_TILE_SHIFT,
+							( nHeight + STENCIL_TILE_SIZE - 1 ) >> STENCIL_TILE_SHIFT,
+							1, 1, 0);
 
-		_ResetStencilBuffer(device.buffers[dsb.iStencilBuffer.value]);
+		_ResetStencilBuffer(device.buffers[dsb.iStencilBuffer.value], device.buffers[dsb.iStencilTiles.value]);
 
 		return dsb;
 	}
-	static inline VertexBuffer_Desc		_CreateVertexBuffer(Device_Impl & device, DescIndex iVertexFormatDesc)
+	static inline SwapChain_Desc		_CreatePrivateSwapChain(Device_Impl & device, SwapChain_Desc like)
+	{
+		Integer nWidth		= device.buffers[ like.iBuffers[ 0 ].value ].Width();
+		Integer nHeight		= device.buffers[ like.iBuffers[ 0 ].value ].Height();
+		BufferLayout layout	= device.buffers[ like.iBuffers[ 0 ].value ].Layout();
+		Integer rowPadding	= ( 4 - ( ( nWidth * 3 ) & 0x3 ) ) & 0x3;
+
+		SwapChain_Desc sc;
+
+		// never presented, front and back are the same buffer
+		sc.iRenderTargetDesc	= like.iRenderTargetDesc;
+		sc.iBuffers[0]		= _CreateBuffer(device, nWidth, nHeight, 3, 4, rowPadding, layout);
+		sc.nBuffers		= 1;
+		sc.iBackBuffer		= 0;
+		sc.nFrames		= 0;
+		sc.iLinearBuffer	= NULL_BUFFER;
+		sc.iScaledBuffer	= NULL_BUFFER;
+		sc.iPresentQueue	= 0;
+		sc.bTiled		= like.bTiled;
+		sc.bHasScaledBuffer	= false;
+		sc.bAsync		= false;
+		sc.iHistoryBuffers[0]	= NULL_BUFFER;
+		sc.iHistoryBuffers[1]	= NULL_BUFFER;
+		sc.iMotionBuffer	= NULL_BUFFER;
+		sc.iHistory		= 0;
+		sc.bHasTemporalBuffers	= false;
+		sc.bHistoryValid	= false;
+		sc.iEncoder		= 0;
+		sc.bHasEncoder		= false;
+
+		return sc;
+	}
+	static inline VertexBuffer_Desc		_CreateVertexBuffer(Device_Impl & device, DescIndex iVertexFormatDesc, Integer nCapacity)
 	{
 		VertexFormat_Desc * pVertexFormatDesc;
 		VertexBuffer_Desc vb;
 
 		pVertexFormatDesc	= &device.vertexFormatDescs[ iVertexFormatDesc.value ];
 
-		vb.iVertexBuffer	= _CreateBuffer(device, 1024, 1, pVertexFormatDesc->nSize, pVertexFormatDesc->nAlign);
+		vb.iVertexBuffer	= _CreateBuffer(device, nCapacity, 1, pVertexFormatDesc->nSize, pVertexFormatDesc->nAlign);
 		vb.iVertexFormat	= iVertexFormatDesc;
 		vb.nAllocated		= 0;
 
@@ -553,9 +868,18 @@ namespace Graphics
 		target.rect			= rect;
 
 		RenderWindow * pWindow;
+		FrameRing * pRing;
 		Buffer * pBuffer;
 		Rect rectOrigin;
-		if ( pUnknown->QueryInterface(&pWindow) )
+		// a ring may answer for a window too, see SceneRenderer
+		if ( pUnknown->QueryInterface(&pRing) )
+		{
+			rectOrigin.left		= 0;
+			rectOrigin.right	= pRing->Width();
+			rectOrigin.top		= 0;
+			rectOrigin.bottom	= pRing->Height();
+		}
+		else if ( pUnknown->QueryInterface(&pWindow) )
 		{
 			rectOrigin.left		= 0;
 			rectOrigin.right	= pWindow->GetWidth();
@@ -603,13 +927,24 @@ namespace Graphics
 		context->stBlend.dstFactorAlpha	= BlendFactor::ZERO;
 		context->stBlend.opAlpha	= BlendOp::ADD;
 
+		context->bStreamOut		= false;
+		context->iStreamOutDesc		= NULL_DESC;
+
+		context->nViews			= 0;
+
+		context->shadingRate		= ShadingRate::RATE_1X1;
+		context->pShadingRateImage	= nullptr;
+		context->nShadingRateCols	= 0;
+		context->nShadingRateRows	= 0;
+
 		return Ptr<RenderContext_Impl>(context);
 	}
 
-	static inline VertexShader_Desc		_CreateVertexShader(Device_Impl & device, VertexShaderFunc vs, VertexFormat fmtVSIn, VertexFormat fmtVSOut)
+	static inline VertexShader_Desc		_CreateVertexShader(Device_Impl & device, VertexShaderFunc vs, PositionShaderFunc pos, VertexFormat fmtVSIn, VertexFormat fmtVSOut)
 	{
 		VertexShader_Desc vertexShaderDesc;
 		vertexShaderDesc.pFunc = vs;
+		vertexShaderDesc.pPosFunc = pos;
 		_LoadIndex(fmtVSIn, &vertexShaderDesc.iVSInFormat);
 		_LoadIndex(fmtVSOut, &vertexShaderDesc.iVSOutFormat);
 		return vertexShaderDesc;
@@ -671,32 +1006,181 @@ namespace Graphics
 	}
 	static inline bool			_VertexFormat_IsEqual(const VertexFormat_Desc * pLeft, const VertexFormat_Desc * pRight)
 	{
-		return memcmp(pLeft, pRight, sizeof(VertexFormat_Desc)) == 0;
+		// field by field, VertexField has padding
+		if ( pLeft->nFields != pRight->nFields || pLeft->nSize != pRight->nSize || pLeft->nAlign != pRight->nAlign )
+		{
+			return false;
+		}
+		for ( Integer i = 0; i < pLeft->nFields; ++i )
+		{
+			if ( pLeft->vFields[ i ].offset != pRight->vFields[ i ].offset || pLeft->vFields[ i ].type != pRight->vFields[ i ].type )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Fragments that passed depth and stencil, shaded LANE_COUNT at a time.
+	// A fragment covers the pixels set in its 4x4 mask (bit 4 * dy + dx)
+	// from (xTgt, yTgt), more than one when shading coarse.
+	struct PixelBatch
+	{
+		Integer			nCount;
+		Integer			xTgt[ LANE_COUNT ];
+		Integer			yTgt[ LANE_COUNT ];
+		u32			coverage[ LANE_COUNT ];
+		f32			xPix[ LANE_COUNT ];
+		f32			yPix[ LANE_COUNT ];
+		f32			z[ LANE_COUNT ];
+		f32			w0[ LANE_COUNT ];
+		f32			w1[ LANE_COUNT ];
+		f32			w2[ LANE_COUNT ];
+	};
+
+	static inline void			_ShadeBatch(PixelBatch & batch, const VertexFormat_Desc & psFmtIn, const Byte * pVSOut0, const Byte * pVSOut1, const Byte * pVSOut2, Byte * pPSIn, Byte * pPSOut, PixelShaderFunc pixelShader, const void * pPSData, Buffer & frameBuffer, bool blendEnable)
+	{
+		const Integer nCount = batch.nCount;
+		const mask8 active = M8FirstN(( int ) nCount);
+
+		// Idle lanes repeat the first fragment
+		for ( Integer i = nCount; i < LANE_COUNT; ++i )
+		{
+			batch.xPix[ i ]	= batch.xPix[ 0 ];
+			batch.yPix[ i ]	= batch.yPix[ 0 ];
+			batch.z[ i ]	= batch.z[ 0 ];
+			batch.w0[ i ]	= batch.w0[ 0 ];
+			batch.w1[ i ]	= batch.w1[ 0 ];
+			batch.w2[ i ]	= batch.w2[ 0 ];
+		}
+
+		// Interpolate, one float8 per f32 of the PS input
+		float8 w0 = F8Load(batch.w0);
+		float8 w1 = F8Load(batch.w1);
+		float8 w2 = F8Load(batch.w2);
+		for ( const VertexField & field : psFmtIn.vFields )
+		{
+			const f32 * pVSField0 = reinterpret_cast< const f32 * >( pVSOut0 + field.offset );
+			const f32 * pVSField1 = reinterpret_cast< const f32 * >( pVSOut1 + field.offset );
+			const f32 * pVSField2 = reinterpret_cast< const f32 * >( pVSOut2 + field.offset );
+			float8 * pPSField = reinterpret_cast< float8 * >( pPSIn + field.offset * LANE_COUNT );
+			Integer nComponents = 0;
+			switch ( field.type )
+			{
+				case VertexFieldType::SV_POSITION:
+					pPSField[ 0 ] = F8Load(batch.xPix);
+					pPSField[ 1 ] = F8Load(batch.yPix);
+					pPSField[ 2 ] = F8Load(batch.z);
+					break;
+				case VertexFieldType::POSITION:
+				case VertexFieldType::COLOR:
+				case VertexFieldType::NORMAL:
+				case VertexFieldType::MATERIAL:
+					nComponents = 3;
+					break;
+				case VertexFieldType::TEXCOORD:
+					nComponents = 2;
+					break;
+				case VertexFieldType::UNKNOWN:
+				default:
+					break;
+			}
+			for ( Integer i = 0; i < nComponents; ++i )
+			{
+				pPSField[ i ] = F8Set(pVSField0[ i ]) * w0 + F8Set(pVSField1[ i ]) * w1 + F8Set(pVSField2[ i ]) * w2;
+			}
+		}
+		pixelShader(pPSOut, pPSIn, active, pPSData);
+
+		const vec3x8 & color8 = *reinterpret_cast< const vec3x8 * >( pPSOut );
+		f32 colorX[ LANE_COUNT ];
+		f32 colorY[ LANE_COUNT ];
+		f32 colorZ[ LANE_COUNT ];
+		F8Store(colorX, color8.x);
+		F8Store(colorY, color8.y);
+		F8Store(colorZ, color8.z);
+
+		for ( Integer i = 0; i < nCount; ++i )
+		{
+			Vector3 color = { colorX[ i ], colorY[ i ], colorZ[ i ] };
+			ASSERT(color.x >= 0.0f && color.y >= 0.0f && color.z >= 0.0f);
+			ASSERT(color.x <= 1.0001f && color.y <= 1.0001f && color.z <= 1.0001f);
+
+			// Broadcast to covered pixels
+			for ( Integer bit = 0; bit < 16; ++bit )
+			{
+				if ( !( batch.coverage[ i ] & ( 1 << bit ) ) )
+				{
+					continue;
+				}
+				Byte * bgr = ( Byte * ) frameBuffer.At(batch.yTgt[ i ] + ( bit >> 2 ), batch.xTgt[ i ] + ( bit & 3 ));
+
+				// Blend test
+				if (blendEnable)
+				{
+					bgr[0] = bgr[0] / 2 + static_cast< Byte >( color.x * 255.0f * 0.5f );
+					bgr[1] = bgr[1] / 2 + static_cast< Byte >( color.y * 255.0f * 0.5f );
+					bgr[2] = bgr[2] / 2 + static_cast< Byte >( color.z * 255.0f * 0.5f );
+					continue;
+				}
+
+				// Draw pixel
+				bgr[ 0 ] = static_cast< Byte >( color.x * 255.0f );
+				bgr[ 1 ] = static_cast< Byte >( color.y * 255.0f );
+				bgr[ 2 ] = static_cast< Byte >( color.z * 255.0f );
+			}
+		}
+
+		batch.nCount = 0;
 	}
 
+	static inline void			_StreamOut(RenderContext_Impl & context, const VertexFormat_Desc & vertexFormat, void * pVertexBegin, Integer nCount)
+	{
+		Device_Impl * pDevice		= context.pDevice;
+		VertexShader_Desc * pVSDesc	= _GetVertexShaderDesc(context);
+		VertexBuffer_Desc * pSODesc	= &pDevice->vertexBufferDescs[ context.iStreamOutDesc.value ];
+		Buffer & soBuffer		= pDevice->buffers[ pSODesc->iVertexBuffer.value ];
+
+		auto vertexShader = pVSDesc->pFunc;
+		ASSERT(vertexShader);
+
+		VertexFormat_Desc * pVSFmtIn	= &pDevice->vertexFormatDescs[ pVSDesc->iVSInFormat.value ];
+		VertexFormat_Desc * pVSFmtOut	= &pDevice->vertexFormatDescs[ pVSDesc->iVSOutFormat.value ];
+		VertexFormat_Desc * pSOFmt	= &pDevice->vertexFormatDescs[ pSODesc->iVertexFormat.value ];
+
+		ASSERT(_VertexFormat_IsEqual(&vertexFormat, pVSFmtIn));
+		ASSERT(_VertexFormat_IsEqual(pSOFmt, pVSFmtOut));
+		ASSERT(( pSODesc->nAllocated + nCount ) <= soBuffer.ElementCount());
+
+		Byte * pVSIn			= ( Byte * ) pVertexBegin;
+		const void * pVSData		= context.pVertexShaderData;
+
+		for ( Integer i = 0; i < nCount; ++i )
+		{
+			vertexShader(soBuffer.At(0, pSODesc->nAllocated + i), pVSIn + i * vertexFormat.nSize, pVSData);
+		}
+
+		pSODesc->nAllocated += nCount;
+	}
 	static inline void			_Rasterize(RenderContext_Impl & context, const VertexFormat_Desc & vertexFormat, void * pVertexBegin, Integer nCount)
 	{
 		Buffer & frameBuffer = _GetBackBuffer(context);
 		Buffer & depthBuffer = _GetDepthBuffer(context);
 		Buffer & stencilBuffer = _GetStencilBuffer(context);
+		Buffer & stencilTiles = _GetStencilTiles(context);
 
 		bool depthEnable = context.stDepthStencil.depthEnable;
 		bool stencilEnable = context.stDepthStencil.stencilEnable;
+		bool scissorEnable = !context.vScissorRects.empty();
 		bool depthWrite = (context.stDepthStencil.depthWriteMask == DepthWriteMask::ALL);
 		Byte stencilWriteMask = context.stDepthStencil.stencilWriteMask;
 		BlendState blendState = context.stBlend;
 
-		bool flipHorizontal = context.bFlipHorizontal;
-
-		Rect rect = _GetOutputTargetRect(context);
-		
-		Integer width = rect.right - rect.left;
-		Integer height = rect.bottom - rect.top;
-
 		VertexShader_Desc * pVSDesc = _GetVertexShaderDesc(context);
 		PixelShader_Desc * pPSDesc = _GetPixelShaderDesc(context);
 
 		auto vertexShader = pVSDesc->pFunc;
+		auto positionShader = pVSDesc->pPosFunc;
 		auto pixelShader = pPSDesc->pFunc;
 		ASSERT(vertexShader);
 		ASSERT(pixelShader);
@@ -713,272 +1197,991 @@ namespace Graphics
 		ASSERT(pPSFmtIn->nFields >= 2 && pPSFmtIn->vFields[ 0 ].type == VertexFieldType::POSITION && pPSFmtIn->vFields[ 1 ].type == VertexFieldType::SV_POSITION);
 		ASSERT(pPSFmtOut->nFields == 1 && pPSFmtOut->vFields[ 0 ].type == VertexFieldType::COLOR);
 
-		Byte * pVSIn			= ( Byte * ) pVertexBegin;
-		Byte * pVSOut			= ( Byte * ) _aligned_malloc(pVSFmtOut->nSize * 3, pVSFmtOut->nAlign);
-		Byte * pPSIn			= ( Byte * ) _aligned_malloc(pPSFmtIn->nSize, pPSFmtIn->nAlign);
-		Byte * pPSOut			= ( Byte * ) _aligned_malloc(pPSFmtOut->nSize, pPSFmtOut->nAlign);
+		const Byte * pVertices		= ( const Byte * ) pVertexBegin;
+		Byte * pVSOut			= ( Byte * ) AlignedMalloc(pVSFmtOut->nSize * 3, pVSFmtOut->nAlign);
+		Byte * pPSIn			= ( Byte * ) AlignedMalloc(pPSFmtIn->nSize * LANE_COUNT, sizeof(float8));
+		Byte * pPSOut			= ( Byte * ) AlignedMalloc(pPSFmtOut->nSize * LANE_COUNT, sizeof(float8));
 		const void * pVSData		= context.pVertexShaderData;
 		const void * pPSData		= context.pPixelShaderData;
-		
-		for (;
-		     nCount >= 3;
-		     nCount -= 3, pVSIn += 3 * vertexFormat.nSize )
+		PixelBatch batch;
+
+		batch.nCount			= 0;
+
+		// Multi-view: POSITION is world space, shared by every view along
+		// with the attributes, each view projects it on its own
+		const bool multiView		= context.nViews > 0;
+		const Integer nViews		= multiView ? context.nViews : 1;
+		const Integer nVSOutSize	= pVSFmtOut->nSize;
+		const Integer nPosOffset	= pVSFmtOut->vFields[ 0 ].offset;
+		Vector3 * pWorld		= nullptr;
+		Byte * pShaded			= nullptr;	// multi-view, VS output per vertex
+		if ( multiView )
 		{
-			// World(Wld) -> Camera(Cam) -> NDC -> Screen(Scn)+Depth -> Raster(Ras)+Depth
+			ASSERT(pVSFmtOut->nFields >= 1 && pVSFmtOut->vFields[ 0 ].type == VertexFieldType::POSITION);
+
+			context.vWorld.resize(nCount);
+			context.vShaded.resize(nCount * nVSOutSize);
+			context.vIsShaded.assign(nCount, false);
+			pWorld = context.vWorld.data();
+			pShaded = context.vShaded.data();
+			for ( Integer i = 0; i < nCount; ++i )
+			{
+				const Byte * pIn = pVertices + i * vertexFormat.nSize;
+				if ( positionShader )
+				{
+					Vector3 pos[ 2 ];
+					positionShader(pos, pIn, pVSData);
+					pWorld[ i ] = pos[ 0 ];
+				}
+				else
+				{
+					vertexShader(pShaded + i * nVSOutSize, pIn, pVSData);
+					context.vIsShaded[ i ] = true;
+					pWorld[ i ] = *reinterpret_cast< const Vector3 * >( pShaded + i * nVSOutSize + nPosOffset );
+				}
+			}
+		}
 
-			const void * pVSIn0 = pVSIn;
-			const void * pVSIn1 = pVSIn + pVSFmtIn->nSize;
-			const void * pVSIn2 = pVSIn + pVSFmtIn->nSize * 2;
+		// Position only pass, attributes are shaded for surviving triangles
+		Vector3 * pPositions		= nullptr;
+		if ( positionShader && !multiView )
+		{
+			context.vPositions.resize(nCount * 2);
+			pPositions = context.vPositions.data();
+			for ( Integer i = 0; i < nCount; ++i )
+			{
+				positionShader(pPositions + i * 2, pVertices + i * vertexFormat.nSize, pVSData);
+			}
+		}
 
-			Byte * pVSOut0 = pVSOut;
-			Byte * pVSOut1 = pVSOut + pVSFmtOut->nSize;
-			Byte * pVSOut2 = pVSOut + pVSFmtOut->nSize * 2;
+		for ( Integer iView = 0; iView < nViews; ++iView )
+		{
+			const View_Desc * pView = multiView ? &context.views[ iView ] : nullptr;
 
-			vertexShader(pVSOut0, pVSIn0, pVSData);
-			vertexShader(pVSOut1, pVSIn1, pVSData);
-			vertexShader(pVSOut2, pVSIn2, pVSData);
+			bool flipHorizontal = multiView ? pView->bFlipHorizontal : context.bFlipHorizontal;
 
-			const Vector3 & p0Cam = reinterpret_cast< Vector3 * >( pVSOut0 )[ 0 ];
-			const Vector3 & p1Cam = reinterpret_cast< Vector3 * >( pVSOut1 )[ 0 ];
-			const Vector3 & p2Cam = reinterpret_cast< Vector3 * >( pVSOut2 )[ 0 ];
+			Rect rect = multiView ? pDevice->renderTargetDescs[ pView->iRenderTargetDesc.value ].rect : _GetOutputTargetRect(context);
 
-			const Vector3 & p0NDC = reinterpret_cast< Vector3 * >( pVSOut0 )[ 1 ];
-			const Vector3 & p1NDC = reinterpret_cast< Vector3 * >( pVSOut1 )[ 1 ];
-			const Vector3 & p2NDC = reinterpret_cast< Vector3 * >( pVSOut2 )[ 1 ];
+			Integer width = rect.right - rect.left;
+			Integer height = rect.bottom - rect.top;
 
-			if (p0Cam.z <= 0.0f || p1Cam.z <= 0.0f || p2Cam.z <= 0.0f)
+			if ( multiView )
 			{
-				continue;
+				context.vPositions.resize(nCount * 2);
+				pPositions = context.vPositions.data();
+				for ( Integer i = 0; i < nCount; ++i )
+				{
+					pPositions[ i * 2 ]	= V3Transform(pWorld[ i ], pView->view);
+					pPositions[ i * 2 + 1 ]	= V3Transform(pPositions[ i * 2 ], pView->proj);
+				}
 			}
 
-			float z0CamInv = 1.0f / p0Cam.z;
-			float z1CamInv = 1.0f / p1Cam.z;
-			float z2CamInv = 1.0f / p2Cam.z;
+			const Byte * pVSIn		= pVertices;
+			Integer iVertex			= 0;
+
+			for ( Integer nRemaining = nCount;
+			      nRemaining >= 3;
+			      nRemaining -= 3, pVSIn += 3 * vertexFormat.nSize, iVertex += 3 )
+			{
+				// World(Wld) -> Camera(Cam) -> NDC -> Screen(Scn)+Depth -> Raster(Ras)+Depth
 
-			float z0NDCInv = 1.0f / p0NDC.z;
-			float z1NDCInv = 1.0f / p1NDC.z;
-			float z2NDCInv = 1.0f / p2NDC.z;
+				const void * pVSIn0 = pVSIn;
+				const void * pVSIn1 = pVSIn + pVSFmtIn->nSize;
+				const void * pVSIn2 = pVSIn + pVSFmtIn->nSize * 2;
 
-			Vector2 p0Scn = { ( p0NDC.x + 1.0f ) * 0.5f, ( 1.0f - p0NDC.y ) * 0.5f };
-			Vector2 p1Scn = { ( p1NDC.x + 1.0f ) * 0.5f, ( 1.0f - p1NDC.y ) * 0.5f };
-			Vector2 p2Scn = { ( p2NDC.x + 1.0f ) * 0.5f, ( 1.0f - p2NDC.y ) * 0.5f };
+				Byte * pVSOut0 = pVSOut;
+				Byte * pVSOut1 = pVSOut + pVSFmtOut->nSize;
+				Byte * pVSOut2 = pVSOut + pVSFmtOut->nSize * 2;
 
-			Vector2 p0Ras = { p0Scn.x * width, p0Scn.y * height };
-			Vector2 p1Ras = { p1Scn.x * width, p1Scn.y * height };
-			Vector2 p2Ras = { p2Scn.x * width, p2Scn.y * height };
+				if ( !pPositions )
+				{
+					vertexShader(pVSOut0, pVSIn0, pVSData);
+					vertexShader(pVSOut1, pVSIn1, pVSData);
+					vertexShader(pVSOut2, pVSIn2, pVSData);
+				}
 
-			Integer xRasMin = static_cast< Integer >( Min3(p0Ras.x, p1Ras.x, p2Ras.x) );
-			Integer xRasMax = static_cast< Integer >( Max3(p0Ras.x, p1Ras.x, p2Ras.x) );
-			Integer yRasMin = static_cast< Integer >( Min3(p0Ras.y, p1Ras.y, p2Ras.y) );
-			Integer yRasMax = static_cast< Integer >( Max3(p0Ras.y, p1Ras.y, p2Ras.y) );
+				// posCam, posNDC
+				const Vector3 * pPos0 = pPositions ? pPositions + iVertex * 2 : reinterpret_cast< Vector3 * >( pVSOut0 );
+				const Vector3 * pPos1 = pPositions ? pPositions + iVertex * 2 + 2 : reinterpret_cast< Vector3 * >( pVSOut1 );
+				const Vector3 * pPos2 = pPositions ? pPositions + iVertex * 2 + 4 : reinterpret_cast< Vector3 * >( pVSOut2 );
 
-			xRasMin = Bound(( Integer ) 0, xRasMin, width);
-			xRasMax = Bound(( Integer ) 0, xRasMax, width);
-			yRasMin = Bound(( Integer ) 0, yRasMin, height);
-			yRasMax = Bound(( Integer ) 0, yRasMax, height);
-			if (xRasMax <= xRasMin || yRasMax <= yRasMin)
-			{
-				continue;
-			}
+				const Vector3 & p0Cam = pPos0[ 0 ];
+				const Vector3 & p1Cam = pPos1[ 0 ];
+				const Vector3 & p2Cam = pPos2[ 0 ];
 
-			float areaInv = EdgeFunction(p0Ras, p1Ras, p2Ras);
-			areaInv = ( areaInv < 0.0001f ) ? 1000.0f : 1.0f / areaInv;
-			ASSERT(areaInv >= 0.0f);
+				const Vector3 & p0NDC = pPos0[ 1 ];
+				const Vector3 & p1NDC = pPos1[ 1 ];
+				const Vector3 & p2NDC = pPos2[ 1 ];
 
-			Integer xPix, yPix;
-			float xPixF, yPixF;
-			float xPixMinF = static_cast< float >( xRasMin );
-			float yPixMinF = static_cast< float >( yRasMin );
-			yPixF = static_cast< float >( yRasMin );
-			for ( yPix = yRasMin, yPixF = yPixMinF; yPix < yRasMax; ++yPix, yPixF += 1.0f )
-			{
-				for ( xPix = xRasMin, xPixF = xPixMinF; xPix < xRasMax; ++xPix, xPixF += 1.0f )
+				if (p0Cam.z <= 0.0f || p1Cam.z <= 0.0f || p2Cam.z <= 0.0f)
 				{
-					// Intersection test
-					Vector2 pixel = { xPixF, yPixF };
+					continue;
+				}
 
-					float e0 = EdgeFunction(p1Ras, p2Ras, pixel);
-					float e1 = EdgeFunction(p2Ras, p0Ras, pixel);
-					float e2 = EdgeFunction(p0Ras, p1Ras, pixel);
-					if ( e0 < 0 || e1 < 0 || e2 < 0 || ( e0 == 0 && e1 == 0 && e2 == 0 ) )
-					{
-						continue;
-					}
+				float z0CamInv = 1.0f / p0Cam.z;
+				float z1CamInv = 1.0f / p1Cam.z;
+				float z2CamInv = 1.0f / p2Cam.z;
 
-					// Barycentric coordinate
-					float bary0 = e0 * areaInv;
-					float bary1 = e1 * areaInv;
-					float bary2 = e2 * areaInv;
-					ASSERT(0.0f <= bary0 && bary0 <= 1.0001f);
-					ASSERT(0.0f <= bary1 && bary1 <= 1.0001f);
-					ASSERT(0.0f <= bary2 && bary2 <= 1.0001f);
-					ASSERT(( bary0 + bary1 + bary2 ) <= 1.0001f);
-
-					// Z
-					float zNDC = 1.0f / ( z0NDCInv * bary0 + z1NDCInv * bary1 + z2NDCInv * bary2 );
-					// ASSERT(0.0f <= zNDC && zNDC <= 1.0001f);
-					if ( !( 0.0f <= zNDC && zNDC <= 1.0001f ) )
-					{
-						continue;
-					}
+				float z0NDCInv = 1.0f / p0NDC.z;
+				float z1NDCInv = 1.0f / p1NDC.z;
+				float z2NDCInv = 1.0f / p2NDC.z;
 
-					Integer xPix2 = flipHorizontal ? ( width - xPix - 1 ) : xPix;
+				Vector2 p0Scn = { ( p0NDC.x + 1.0f ) * 0.5f, ( 1.0f - p0NDC.y ) * 0.5f };
+				Vector2 p1Scn = { ( p1NDC.x + 1.0f ) * 0.5f, ( 1.0f - p1NDC.y ) * 0.5f };
+				Vector2 p2Scn = { ( p2NDC.x + 1.0f ) * 0.5f, ( 1.0f - p2NDC.y ) * 0.5f };
 
-					// Depth test
-					float * depth = static_cast< float * >( depthBuffer.At(rect.top + yPix, rect.left + xPix2) );
-					if ( depthEnable && *depth <= zNDC )
-					{
-						continue;
-					}
+				Vector2 p0Ras = { p0Scn.x * width, p0Scn.y * height };
+				Vector2 p1Ras = { p1Scn.x * width, p1Scn.y * height };
+				Vector2 p2Ras = { p2Scn.x * width, p2Scn.y * height };
+
+				Integer xRasMin = static_cast< Integer >( Min3(p0Ras.x, p1Ras.x, p2Ras.x) );
+				Integer xRasMax = static_cast< Integer >( Max3(p0Ras.x, p1Ras.x, p2Ras.x) );
+				Integer yRasMin = static_cast< Integer >( Min3(p0Ras.y, p1Ras.y, p2Ras.y) );
+				Integer yRasMax = static_cast< Integer >( Max3(p0Ras.y, p1Ras.y, p2Ras.y) );
+
+				xRasMin = Bound(( Integer ) 0, xRasMin, width);
+				xRasMax = Bound(( Integer ) 0, xRasMax, width);
+				yRasMin = Bound(( Integer ) 0, yRasMin, height);
+				yRasMax = Bound(( Integer ) 0, yRasMax, height);
+				if (xRasMax <= xRasMin || yRasMax <= yRasMin)
+				{
+					continue;
+				}
+
+				// Target space bounds, mirrored if flipped
+				Integer xTgtMin = rect.left + ( flipHorizontal ? width - xRasMax : xRasMin );
+				Integer xTgtMax = rect.left + ( flipHorizontal ? width - xRasMin : xRasMax );
+				Integer yTgtMin = rect.top + yRasMin;
+				Integer yTgtMax = rect.top + yRasMax;
+
+				// Scissor, whole triangle outside
+				if ( scissorEnable && !_ScissorIntersects(context, Rect { xTgtMin, xTgtMax, yTgtMin, yTgtMax }) )
+				{
+					continue;
+				}
+
+				Integer xTileMin = xTgtMin >> STENCIL_TILE_SHIFT;
+				Integer xTileMax = ( xTgtMax - 1 ) >> STENCIL_TILE_SHIFT;
+				Integer yTileMin = yTgtMin >> STENCIL_TILE_SHIFT;
+				Integer yTileMax = ( yTgtMax - 1 ) >> STENCIL_TILE_SHIFT;
+
+				// Stencil summary, whole triangle masked out
+				if ( stencilEnable && _StencilTilesAllZero(stencilTiles, xTileMin, yTileMin, xTileMax, yTileMax) )
+				{
+					continue;
+				}
+
+				// Back facing, no pixel would pass the edge tests
+				float areaInv = EdgeFunction(p0Ras, p1Ras, p2Ras);
+				if ( areaInv <= 0.0f )
+				{
+					continue;
+				}
+				areaInv = ( areaInv < 0.0001f ) ? 1000.0f : 1.0f / areaInv;
+				ASSERT(areaInv >= 0.0f);
 
-					// Stencil test
-					Byte * stencil = static_cast< Byte * >( stencilBuffer.At(rect.top + yPix, rect.left + xPix2) );
-					if ( stencilEnable && *stencil == 0 )
+				// Survived culling, shade attributes
+				if ( multiView )
+				{
+					// once per vertex across views, then this view's POSITION
+					const void * pVSIns[ 3 ] = { pVSIn0, pVSIn1, pVSIn2 };
+					Byte * pVSOuts[ 3 ] = { pVSOut0, pVSOut1, pVSOut2 };
+					for ( Integer k = 0; k < 3; ++k )
 					{
-						continue;
+						Integer i = iVertex + k;
+						if ( !context.vIsShaded[ i ] )
+						{
+							vertexShader(pShaded + i * nVSOutSize, pVSIns[ k ], pVSData);
+							context.vIsShaded[ i ] = true;
+						}
+						memcpy(pVSOuts[ k ], pShaded + i * nVSOutSize, nVSOutSize);
+						memcpy(pVSOuts[ k ] + nPosOffset, pPositions + i * 2, sizeof(Vector3));
 					}
+				}
+				else if ( positionShader )
+				{
+					vertexShader(pVSOut0, pVSIn0, pVSData);
+					vertexShader(pVSOut1, pVSIn1, pVSData);
+					vertexShader(pVSOut2, pVSIn2, pVSData);
+				}
 
-					if ( depthWrite ) *depth = zNDC;
-					if ( stencilWriteMask ) *stencil |= stencilWriteMask;
-
-					// Vertex properties
-					float zCam = 1.0f / ( z0CamInv * bary0 + z1CamInv * bary1 + z2CamInv * bary2 );
-					float w0 = zCam * z0CamInv * bary0;
-					float w1 = zCam * z1CamInv * bary1;
-					float w2 = zCam * z2CamInv * bary2;
-					ASSERT(0.0f <= w0 && w0 <= 1.0001f);
-					ASSERT(0.0f <= w1 && w1 <= 1.0001f);
-					ASSERT(0.0f <= w2 && w2 <= 1.0001f);
-					ASSERT(( w0 + w1 + w2 ) <= 1.0001f);
-
-					void * pVSField0;
-					void * pVSField1;
-					void * pVSField2;
-					void * pPSField;
-					for ( const VertexField & field : pPSFmtIn->vFields )
+				// Walk stencil tiles, pixels inside in target space
+				for ( Integer yTile = yTileMin; yTile <= yTileMax; ++yTile )
+				{
+					for ( Integer xTile = xTileMin; xTile <= xTileMax; ++xTile )
 					{
-						pVSField0 = pVSOut0 + field.offset;
-						pVSField1 = pVSOut1 + field.offset;
-						pVSField2 = pVSOut2 + field.offset;
-						pPSField = pPSIn + field.offset;
-						switch ( field.type )
+						Byte * stencilTile = static_cast< Byte * >( stencilTiles.At(yTile, xTile) );
+						if ( stencilEnable && *stencilTile == 0 )
 						{
-							case VertexFieldType::SV_POSITION:
-								*static_cast< Vector3 * >( pPSField ) = { xPixF, yPixF, zNDC };
-								break;
-							case VertexFieldType::POSITION:
-							case VertexFieldType::COLOR:
-							case VertexFieldType::NORMAL:
-							case VertexFieldType::MATERIAL:
-								*static_cast< Vector3 * >( pPSField ) = WeightedAdd(*static_cast< Vector3 * >( pVSField0 ),
-														 *static_cast< Vector3 * >( pVSField1 ),
-														 *static_cast< Vector3 * >( pVSField2 ),
-														 w0,
-														 w1,
-														 w2);
-								break;
-							case VertexFieldType::TEXCOORD:
-								*static_cast< Vector2 * >( pPSField ) = WeightedAdd(*static_cast< Vector2 * >( pVSField0 ),
-														 *static_cast< Vector2 * >( pVSField1 ),
-														 *static_cast< Vector2 * >( pVSField2 ),
-														 w0,
-														 w1,
-														 w2);
-								break;
-							case VertexFieldType::UNKNOWN:
-							default:
-								break;
+							continue;
 						}
-					}
-					pixelShader(pPSOut, pPSIn, pPSData);
+						// all nonzero, skip per pixel test
+						bool stencilTest = stencilEnable && *stencilTile != _StencilTilePixels(stencilBuffer, xTile, yTile);
 
-					Vector3 color = (*reinterpret_cast<Vector3 *>(pPSOut));
-					ASSERT(color.x >= 0.0f && color.y >= 0.0f && color.z >= 0.0f);
-					ASSERT(color.x <= 1.0001f && color.y <= 1.0001f && color.z <= 1.0001f);
+						Integer xTgtBegin = Max(xTgtMin, xTile << STENCIL_TILE_SHIFT);
+						Integer xTgtEnd = Min(xTgtMax, ( xTile + 1 ) << STENCIL_TILE_SHIFT);
+						Integer yTgtBegin = Max(yTgtMin, yTile << STENCIL_TILE_SHIFT);
+						Integer yTgtEnd = Min(yTgtMax, ( yTile + 1 ) << STENCIL_TILE_SHIFT);
 
-					// Blend test
-					Byte * bgr = ( Byte * ) frameBuffer.At(rect.top + yPix, rect.left + xPix2);
-					if (blendState.blendEnable)
-					{
-						bgr[0] = bgr[0] / 2 + static_cast< Byte >( color.x * 255.0f * 0.5f );
-						bgr[1] = bgr[1] / 2 + static_cast< Byte >( color.y * 255.0f * 0.5f );
-						bgr[2] = bgr[2] / 2 + static_cast< Byte >( color.z * 255.0f * 0.5f );
-						continue;
+						// inside one scissor rect, skip per pixel test
+						Rect tileRect = { xTgtBegin, xTgtEnd, yTgtBegin, yTgtEnd };
+						if ( scissorEnable && !_ScissorIntersects(context, tileRect) )
+						{
+							continue;
+						}
+						bool scissorTest = scissorEnable && !_ScissorContains(context, tileRect);
+
+						// Coarse pixels are aligned blocks, never straddle a tile
+						Integer xCoarse, yCoarse;
+						_GetShadingRateSize(_GetShadingRate(context, xTile, yTile), &xCoarse, &yCoarse);
+
+						for ( Integer yBlock = yTgtBegin & ~( yCoarse - 1 ); yBlock < yTgtEnd; yBlock += yCoarse )
+						{
+							for ( Integer xBlock = xTgtBegin & ~( xCoarse - 1 ); xBlock < xTgtEnd; xBlock += xCoarse )
+							{
+								Integer iLane		= batch.nCount;
+								u32 coverage		= 0;
+
+								Integer yBlockEnd	= Min(yBlock + yCoarse, yTgtEnd);
+								Integer xBlockEnd	= Min(xBlock + xCoarse, xTgtEnd);
+								for ( Integer yTgt = Max(yBlock, yTgtBegin); yTgt < yBlockEnd; ++yTgt )
+								{
+									Integer yPix = yTgt - rect.top;
+									float yPixF = static_cast< float >( yPix );
+
+									for ( Integer xTgt = Max(xBlock, xTgtBegin); xTgt < xBlockEnd; ++xTgt )
+									{
+										if ( scissorTest && !_ScissorContains(context, Rect { xTgt, xTgt + 1, yTgt, yTgt + 1 }) )
+										{
+											continue;
+										}
+
+										Integer xPix = flipHorizontal ? ( rect.left + width - 1 - xTgt ) : ( xTgt - rect.left );
+										float xPixF = static_cast< float >( xPix );
+										// Intersection test
+										Vector2 pixel = { xPixF, yPixF };
+
+										float e0 = EdgeFunction(p1Ras, p2Ras, pixel);
+										float e1 = EdgeFunction(p2Ras, p0Ras, pixel);
+										float e2 = EdgeFunction(p0Ras, p1Ras, pixel);
+										if ( e0 < 0 || e1 < 0 || e2 < 0 || ( e0 == 0 && e1 == 0 && e2 == 0 ) )
+										{
+											continue;
+										}
+
+										// Barycentric coordinate
+										float bary0 = e0 * areaInv;
+										float bary1 = e1 * areaInv;
+										float bary2 = e2 * areaInv;
+										ASSERT(0.0f <= bary0 && bary0 <= 1.0001f);
+										ASSERT(0.0f <= bary1 && bary1 <= 1.0001f);
+										ASSERT(0.0f <= bary2 && bary2 <= 1.0001f);
+										ASSERT(( bary0 + bary1 + bary2 ) <= 1.0001f);
+
+										// Z
+										float zNDC = 1.0f / ( z0NDCInv * bary0 + z1NDCInv * bary1 + z2NDCInv * bary2 );
+										// ASSERT(0.0f <= zNDC && zNDC <= 1.0001f);
+										if ( !( 0.0f <= zNDC && zNDC <= 1.0001f ) )
+										{
+											continue;
+										}
+
+										// Depth test
+										float * depth = static_cast< float * >( depthBuffer.At(yTgt, xTgt) );
+										if ( depthEnable && *depth <= zNDC )
+										{
+											continue;
+										}
+
+										// Stencil test
+										Byte * stencil = static_cast< Byte * >( stencilBuffer.At(yTgt, xTgt) );
+										if ( stencilTest && *stencil == 0 )
+										{
+											continue;
+										}
+
+										if ( depthWrite ) *depth = zNDC;
+										if ( stencilWriteMask )
+										{
+											*stencilTile += ( *stencil == 0 );
+											*stencil |= stencilWriteMask;
+										}
+
+										// One shader invocation per coarse pixel, at its first covered pixel
+										if ( coverage == 0 )
+										{
+											// Vertex properties
+											float zCam = 1.0f / ( z0CamInv * bary0 + z1CamInv * bary1 + z2CamInv * bary2 );
+											float w0 = zCam * z0CamInv * bary0;
+											float w1 = zCam * z1CamInv * bary1;
+											float w2 = zCam * z2CamInv * bary2;
+											ASSERT(0.0f <= w0 && w0 <= 1.0001f);
+											ASSERT(0.0f <= w1 && w1 <= 1.0001f);
+											ASSERT(0.0f <= w2 && w2 <= 1.0001f);
+											ASSERT(( w0 + w1 + w2 ) <= 1.0001f);
+
+											batch.xTgt[ iLane ]	= xBlock;
+											batch.yTgt[ iLane ]	= yBlock;
+											batch.xPix[ iLane ]	= xPixF;
+											batch.yPix[ iLane ]	= yPixF;
+											batch.z[ iLane ]	= zNDC;
+											batch.w0[ iLane ]	= w0;
+											batch.w1[ iLane ]	= w1;
+											batch.w2[ iLane ]	= w2;
+										}
+										coverage |= 1 << ( 4 * ( yTgt - yBlock ) + ( xTgt - xBlock ) );
+									}
+								}
+
+								// Queue for shading
+								if ( coverage )
+								{
+									batch.coverage[ iLane ] = coverage;
+									if ( ++batch.nCount == LANE_COUNT )
+									{
+										_ShadeBatch(batch, *pPSFmtIn, pVSOut0, pVSOut1, pVSOut2, pPSIn, pPSOut, pixelShader, pPSData, frameBuffer, blendState.blendEnable);
+									}
+								}
+							}
+						}
 					}
+				}
 
-					// Draw depth
-					/*
-					float fDepth = Bound(0.0f, *depth, 1.0f);
-					fDepth *= fDepth;
-					fDepth *= fDepth;
-					fDepth *= fDepth;
-					color = {fDepth, fDepth, fDepth};
-					*/
-
-					// Draw stencil
-					/*
-					float fStencil = (*stencil ? 1.0f : 0.0f);
-					color = {fStencil, fStencil, fStencil};
-					*/
-
-					// Draw pixel
-					Byte * pixelData = ( Byte * ) frameBuffer.At(rect.top + yPix, rect.left + xPix2);
-					pixelData[ 0 ] = static_cast< Byte >( color.x * 255.0f );
-					pixelData[ 1 ] = static_cast< Byte >( color.y * 255.0f );
-					pixelData[ 2 ] = static_cast< Byte >( color.z * 255.0f );
+				// Weights belong to this triangle
+				if ( batch.nCount > 0 )
+				{
+					_ShadeBatch(batch, *pPSFmtIn, pVSOut0, pVSOut1, pVSOut2, pPSIn, pPSOut, pixelShader, pPSData, frameBuffer, blendState.blendEnable);
 				}
 			}
 		}
 
-		_aligned_free(pVSOut);
-		_aligned_free(pPSIn);
-		_aligned_free(pPSOut);
+		AlignedFree(pVSOut);
+		AlignedFree(pPSIn);
+		AlignedFree(pPSOut);
 	}
 
-	void			SwapChain::Swap()
+	// the whole frame, for the passes that need it linear
+	static inline Buffer &			_LinearizeFrame(Buffer & frame, Buffer * pLinear)
 	{
-		Device_Impl *		pDevice;
-		BufferIndex		iSwapChainDesc;
-		SwapChain_Desc *	pSwapChainDesc;
-		RenderTarget_Desc *	pRenderTargetDesc;
-		RenderWindow *		pWindow;
-		Buffer *		pBuffer;
-
-		_LoadIndex(*this, &iSwapChainDesc);
-
-		pDevice				= static_cast<Device_Impl *>(pParam);
-		pSwapChainDesc			= &pDevice->swapChainDescs[iSwapChainDesc.value];
-		pSwapChainDesc->bSwapped	= !pSwapChainDesc->bSwapped;
-
-		pRenderTargetDesc		= &pDevice->renderTargetDescs[ pSwapChainDesc->iRenderTargetDesc.value ];
-
-		Buffer & buffer	= _GetBackBuffer(*pDevice, *pSwapChainDesc);
-		Integer nWidth	= buffer.Width();
-		Integer nHeight	= buffer.Height();
-		ASSERT(buffer.ElementSize() == 3);
-		if ( pRenderTargetDesc->pUnknown->QueryInterface(&pWindow) )
+		if ( !pLinear )
 		{
-			ASSERT(pWindow->GetWidth() == nWidth &&
-			       pWindow->GetHeight() == nHeight);
-			
-			NativeWindowBilt(pWindow->GetWindow(), FrameBuffer(), NATIVE_BLIT_BGR);
+			return frame;
 		}
-		else
-		{
-			ENSURE_TRUE(pRenderTargetDesc->pUnknown->QueryInterface(&pBuffer));
 
-			ASSERT(pBuffer->Width() == nWidth && pBuffer->Height() == nHeight);
+		BufferRect brDst	= pLinear->GetBufferRect();
+		BufferTiled btSrc	= frame.GetBufferTiled();
+		Buffer2DLinearize(&brDst, BUFFER_FORMAT_BGR, &btSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
 
-			memcpy(pBuffer->Data(),
-			       FrameBuffer(),
-			       pBuffer->SizeInBytes());
+		return *pLinear;
+	}
+	static inline Buffer *			_GetLinearBuffer(Device_Impl & device, SwapChain_Desc & swapChainDesc)
+	{
+		return swapChainDesc.bTiled ? &device.buffers[ swapChainDesc.iLinearBuffer.value ] : nullptr;
+	}
+	static inline Buffer &			_GetScaledBuffer(Device_Impl & device, SwapChain_Desc & swapChainDesc)
+	{
+		if ( !swapChainDesc.bHasScaledBuffer )
+		{
+			const Buffer & back		= _GetBackBuffer(device, swapChainDesc);
+			Integer nWidth			= back.Width();
+			Integer nHeight			= back.Height();
+			swapChainDesc.iScaledBuffer	= _CreateBuffer(device, nWidth, nHeight, 3, 4, ( 4 - ( ( nWidth * 3 ) & 0x3 ) ) & 0x3);
+			swapChainDesc.bHasScaledBuffer	= true;
 		}
+		return device.buffers[ swapChainDesc.iScaledBuffer.value ];
 	}
-	void			SwapChain::ResetBackBuffer(Byte value)
+	// Per source pixel: where it was last frame, from depth and both
+	// view-projections, and the color bounds of its 3x3 neighbourhood.
+	static void				_TemporalMotion(Buffer & motion, const Buffer & color, const Buffer & depth, const Rect & srcRect, const TemporalDesc & desc)
 	{
-		Device_Impl *		pDevice;
-		DescIndex		iSwapChainDesc;
-		SwapChain_Desc *	pSwapChainDesc;
+		f32 det;
+		Integer nWidth		= srcRect.right - srcRect.left;
+		Integer nHeight		= srcRect.bottom - srcRect.top;
+		f32 xScale		= 1.0f / nWidth;
+		f32 yScale		= 1.0f / nHeight;
+
+		// NDC now -> NDC last frame, the homogeneous divide of the world
+		// position folds into the last one
+		Matrix44 reproject	= M44Multiply(M44Inverse(&det, desc.viewProj), desc.prevViewProj);
+
+		for ( Integer y = 0; y < nHeight; ++y )
+		{
+			Integer yUp	= Max<Integer>(y - 1, 0) + srcRect.top;
+			Integer yDown	= Min<Integer>(y + 1, nHeight - 1) + srcRect.top;
+
+			for ( Integer x = 0; x < nWidth; ++x )
+			{
+				TemporalSample * pSample = static_cast< TemporalSample * >( motion.At(y, x) );
+
+				// rendered with the jitter, (x, y) saw ( x - jx, y - jy )
+				Vector2 uv	= { ( x - desc.jitter.x ) * xScale, ( y - desc.jitter.y ) * yScale };
+				f32 z		= *static_cast< const f32 * >( depth.At(y + srcRect.top, x + srcRect.left) );
+				Vector3 prev	= V3Transform(Vector3 { uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, z }, reproject);
+
+				pSample->motion.x = uv.x - ( prev.x + 1.0f ) * 0.5f;
+				pSample->motion.y = uv.y - ( 1.0f - prev.y ) * 0.5f;
+
+				Integer xLeft	= Max<Integer>(x - 1, 0) + srcRect.left;
+				Integer xRight	= Min<Integer>(x + 1, nWidth - 1) + srcRect.left;
+				for ( Integer c = 0; c < 3; ++c )
+				{
+					pSample->bgrMin[ c ] = 255;
+					pSample->bgrMax[ c ] = 0;
+				}
+				for ( Integer yN = yUp; yN <= yDown; ++yN )
+				{
+					for ( Integer xN = xLeft; xN <= xRight; ++xN )
+					{
+						const Byte * bgr = static_cast< const Byte * >( color.At(yN, xN) );
+						for ( Integer c = 0; c < 3; ++c )
+						{
+							pSample->bgrMin[ c ] = Min(pSample->bgrMin[ c ], bgr[ c ]);
+							pSample->bgrMax[ c ] = Max(pSample->bgrMax[ c ], bgr[ c ]);
+						}
+					}
+				}
+			}
+		}
+	}
+	// Per target pixel: the nearest new sample, blended into the history
+	// reprojected by its motion and clamped to its neighbourhood. The
+	// closer the jittered sample lands to the pixel, the more it weighs.
+	static void				_TemporalAccumulate(Buffer & dst, Buffer & history, const Buffer & prevHistory, bool bHistoryValid,
+								    const Buffer & motion, const Buffer & color, const Rect & srcRect, const TemporalDesc & desc)
+	{
+		Integer nWidth		= dst.Width();
+		Integer nHeight		= dst.Height();
+		Integer nSrcWidth	= srcRect.right - srcRect.left;
+		Integer nSrcHeight	= srcRect.bottom - srcRect.top;
+		f32 xToSrc		= static_cast< f32 >( nSrcWidth ) / nWidth;
+		f32 yToSrc		= static_cast< f32 >( nSrcHeight ) / nHeight;
+
+		for ( Integer y = 0; y < nHeight; ++y )
+		{
+			f32 ySrcF	= y * yToSrc + desc.jitter.y;
+			Integer ySrc	= Bound<Integer>(0, static_cast< Integer >( ySrcF + 0.5f ), nSrcHeight - 1);
+			f32 dy		= ( ySrcF - ySrc ) / yToSrc;
+
+			for ( Integer x = 0; x < nWidth; ++x )
+			{
+				f32 xSrcF	= x * xToSrc + desc.jitter.x;
+				Integer xSrc	= Bound<Integer>(0, static_cast< Integer >( xSrcF + 0.5f ), nSrcWidth - 1);
+				f32 dx		= ( xSrcF - xSrc ) / xToSrc;
+
+				const TemporalSample * pSample	= static_cast< const TemporalSample * >( motion.At(ySrc, xSrc) );
+				const Byte * bgrNew		= static_cast< const Byte * >( color.At(ySrc + srcRect.top, xSrc + srcRect.left) );
+				f32 * bgrAcc			= static_cast< f32 * >( history.At(y, x) );
+
+				// history under the pixel last frame, bilinear
+				f32 xPrev	= x - pSample->motion.x * nWidth;
+				f32 yPrev	= y - pSample->motion.y * nHeight;
+				f32 blend	= 1.0f;
+				if ( bHistoryValid &&
+				     0.0f <= xPrev && xPrev <= nWidth - 1 &&
+				     0.0f <= yPrev && yPrev <= nHeight - 1 )
+				{
+					Integer x0	= Min<Integer>(static_cast< Integer >( xPrev ), nWidth - 2);
+					Integer y0	= Min<Integer>(static_cast< Integer >( yPrev ), nHeight - 2);
+					f32 fx		= xPrev - x0;
+					f32 fy		= yPrev - y0;
+					const f32 * p00	= static_cast< const f32 * >( prevHistory.At(y0, x0) );
+					const f32 * p01	= static_cast< const f32 * >( prevHistory.At(y0, x0 + 1) );
+					const f32 * p10	= static_cast< const f32 * >( prevHistory.At(y0 + 1, x0) );
+					const f32 * p11	= static_cast< const f32 * >( prevHistory.At(y0 + 1, x0 + 1) );
+					for ( Integer c = 0; c < 3; ++c )
+					{
+						f32 top		= p00[ c ] + ( p01[ c ] - p00[ c ] ) * fx;
+						f32 bottom	= p10[ c ] + ( p11[ c ] - p10[ c ] ) * fx;
+						bgrAcc[ c ]	= Bound<f32>(pSample->bgrMin[ c ], top + ( bottom - top ) * fy, pSample->bgrMax[ c ]);
+					}
+
+					f32 closeness	= Max(0.0f, 1.0f - ( dx * dx + dy * dy ));
+					blend		= TEMPORAL_BLEND_MIN + ( TEMPORAL_BLEND_MAX - TEMPORAL_BLEND_MIN ) * closeness;
+				}
+
+				Byte * bgrDst = static_cast< Byte * >( dst.At(y, x) );
+				for ( Integer c = 0; c < 3; ++c )
+				{
+					bgrAcc[ c ] = ( blend == 1.0f ) ? bgrNew[ c ] : bgrAcc[ c ] + ( bgrNew[ c ] - bgrAcc[ c ] ) * blend;
+					bgrDst[ c ] = static_cast< Byte >( bgrAcc[ c ] + 0.5f );
+				}
+			}
+		}
+	}
+
+	// Where a present goes: a window or a frame ring, stretched presents
+	// land in pScaled first, or a buffer.
+	struct PresentTarget
+	{
+		NativeWindow *		pWindow;
+		FrameRing *		pRing;
+		Buffer *		pScaled;
+		Buffer *		pBuffer;
+		i64			iSwapTick;	// ring only, FrameRingClock() at the Swap
+	};
+
+	static PresentTarget			_GetPresentTarget(Device_Impl & device, SwapChain_Desc & swapChainDesc, bool bScaled)
+	{
+		RenderTarget_Desc *	pRenderTargetDesc;
+		RenderWindow *		pWindow;
+		FrameRing *		pRing;
+		Buffer *		pBuffer;
+		PresentTarget		target = {};
+
+		pRenderTargetDesc	= &device.renderTargetDescs[ swapChainDesc.iRenderTargetDesc.value ];
+
+		const Buffer & back	= _GetBackBuffer(device, swapChainDesc);
+		if ( pRenderTargetDesc->pUnknown->QueryInterface(&pRing) )
+		{
+			ASSERT(pRing->Width() == back.Width() && pRing->Height() == back.Height());
+
+			target.pRing	= pRing;
+			target.pScaled	= bScaled ? &_GetScaledBuffer(device, swapChainDesc) : nullptr;
+			target.iSwapTick = FrameRingClock();
+		}
+		else if ( pRenderTargetDesc->pUnknown->QueryInterface(&pWindow) )
+		{
+			ASSERT(pWindow->GetWidth() == back.Width() &&
+			       pWindow->GetHeight() == back.Height());
+
+			target.pWindow	= pWindow->GetWindow();
+			target.pScaled	= bScaled ? &_GetScaledBuffer(device, swapChainDesc) : nullptr;
+		}
+		else
+		{
+			ENSURE_TRUE(pRenderTargetDesc->pUnknown->QueryInterface(&pBuffer));
+
+			ASSERT(pBuffer->Width() == back.Width() && pBuffer->Height() == back.Height());
+
+			target.pBuffer	= pBuffer;
+		}
+		return target;
+	}
+	static inline FrameEncoder *		_GetEncoder(Device_Impl & device, SwapChain_Desc & swapChainDesc)
+	{
+		return swapChainDesc.bHasEncoder ? device.encoders[ swapChainDesc.iEncoder ].get() : nullptr;
+	}
+	// Hands the present of the back buffer to the present thread, or runs
+	// it here, then moves the back buffer on. A present only sees what the
+	// caller resolved, never the device tables, which may grow meanwhile.
+	static void				_SubmitPresent(Device_Impl & device, SwapChain_Desc & swapChainDesc, std::function<void ()> && present, bool bInline)
+	{
+		++swapChainDesc.nFrames;
+
+		if ( !swapChainDesc.bAsync )
+		{
+			present();
+		}
+		else
+		{
+			PresentQueue & queue = device.presentQueues[ swapChainDesc.iPresentQueue ];
+			if ( bInline )
+			{
+				queue.RunInline(present);
+			}
+			else
+			{
+				queue.Submit(std::move(present));
+			}
+
+			// the next back buffer was the front buffer nBuffers - 1 frames ago
+			u64 nInFlight = static_cast< u64 >( swapChainDesc.nBuffers - 1 );
+			if ( swapChainDesc.nFrames > nInFlight )
+			{
+				queue.Wait(swapChainDesc.nFrames - nInFlight);
+			}
+		}
+
+		swapChainDesc.iBackBuffer = ( swapChainDesc.iBackBuffer + 1 ) % swapChainDesc.nBuffers;
+	}
+	static inline BufferRect		_GetSubRect(Buffer & buffer, const Rect & rect)
+	{
+		BufferRect br	= buffer.GetBufferRect();
+		br.pData	= static_cast< u8 * >( buffer.At(rect.top, rect.left) );
+		br.nRCount	= static_cast< u32 >( rect.bottom - rect.top );
+		br.nCCount	= static_cast< u32 >( rect.right - rect.left );
+		return br;
+	}
+	// rect of the window surface, BGRA, false once the window is gone
+	static inline bool			_GetSurfaceRect(NativeWindow * pWindow, const Rect & rect, BufferRect * pRect)
+	{
+		u8 * pSurface = static_cast< u8 * >( NativeWindowGetSurface(pWindow) );
+		if ( !pSurface )
+		{
+			return false;
+		}
+
+		pRect->nCStride	= 4;
+		pRect->nRStride	= static_cast< u32 >( NativeWindowGetWidth(pWindow) ) * 4;
+		pRect->pData	= pSurface + rect.top * pRect->nRStride + rect.left * pRect->nCStride;
+		pRect->nRCount	= static_cast< u32 >( rect.bottom - rect.top );
+		pRect->nCCount	= static_cast< u32 >( rect.right - rect.left );
+		return true;
+	}
+	// The tiles of a tiled frame around rect: a tile aligned window of a
+	// tiled buffer is a tiled buffer.
+	static inline BufferTiled		_GetTiledWindow(Buffer & frame, const Rect & rect, Rect * pTiles)
+	{
+		pTiles->top	= rect.top & ~static_cast< Integer >( BUFFER_TILE_SIZE - 1 );
+		pTiles->left	= rect.left & ~static_cast< Integer >( BUFFER_TILE_SIZE - 1 );
+		pTiles->bottom	= Min(( rect.bottom + BUFFER_TILE_SIZE - 1 ) & ~static_cast< Integer >( BUFFER_TILE_SIZE - 1 ), frame.Height());
+		pTiles->right	= Min(( rect.right + BUFFER_TILE_SIZE - 1 ) & ~static_cast< Integer >( BUFFER_TILE_SIZE - 1 ), frame.Width());
+
+		BufferTiled bt	= frame.GetBufferTiled();
+		bt.pData	+= static_cast< u64 >( BufferTiledIndex(bt.nTilesPerRow, static_cast< u32 >( pTiles->top ), static_cast< u32 >( pTiles->left )) ) * bt.nCStride;
+		bt.nRCount	= static_cast< u32 >( pTiles->bottom - pTiles->top );
+		bt.nCCount	= static_cast< u32 >( pTiles->right - pTiles->left );
+		return bt;
+	}
+	// Front buffer to target. Unscaled presents detile or convert straight
+	// into the window surface or target buffer, stretched ones go through
+	// the linear and scaled buffers.
+	static void				_PresentFrame(Buffer & frame, Buffer * pLinear, const PresentTarget & target, const Rect & srcRect)
+	{
+		Integer nWidth	= frame.Width();
+		Integer nHeight	= frame.Height();
+		const bool bScaled = srcRect.left != 0 || srcRect.top != 0 || srcRect.right != nWidth || srcRect.bottom != nHeight;
+
+		BufferRect brDst;
+		BufferFormat dstFormat;
+		if ( target.pWindow )
+		{
+			if ( !_GetSurfaceRect(target.pWindow, Rect { 0, nWidth, 0, nHeight }, &brDst) )
+			{
+				return;
+			}
+			dstFormat = BUFFER_FORMAT_BGRA;
+		}
+		else if ( target.pRing )
+		{
+			brDst		= target.pRing->BeginFrame(target.iSwapTick);
+			dstFormat	= BUFFER_FORMAT_BGRA;
+		}
+		else
+		{
+			brDst		= target.pBuffer->GetBufferRect();
+			dstFormat	= BUFFER_FORMAT_BGR;
+		}
+
+		if ( bScaled )
+		{
+			Buffer & linear		= _LinearizeFrame(frame, pLinear);
+			BufferRect brSrc	= _GetSubRect(linear, srcRect);
+
+			if ( target.pScaled )
+			{
+				BufferRect brScaled = target.pScaled->GetBufferRect();
+				Buffer2DUpscale(&brScaled, &brSrc, SWAP_CHAIN_SHARPEN);
+				Buffer2DConvert(&brDst, dstFormat, &brScaled, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+			}
+			else
+			{
+				Buffer2DUpscale(&brDst, &brSrc, SWAP_CHAIN_SHARPEN);
+			}
+		}
+		else if ( pLinear )
+		{
+			BufferTiled btSrc = frame.GetBufferTiled();
+			Buffer2DLinearize(&brDst, dstFormat, &btSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+		}
+		else
+		{
+			BufferRect brSrc = frame.GetBufferRect();
+			Buffer2DConvert(&brDst, dstFormat, &brSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+		}
+
+		if ( target.pWindow )
+		{
+			NativeWindowPresentRect(target.pWindow, 0, 0, nWidth, nHeight);
+		}
+		else if ( target.pRing )
+		{
+			target.pRing->EndFrame();
+		}
+	}
+	static void				_PresentRects(Buffer & frame, Buffer * pLinear, const PresentTarget & target, const Rect * pRects, Integer nRects)
+	{
+		for ( Integer i = 0; i < nRects; ++i )
+		{
+			const Rect & rect = pRects[ i ];
+
+			BufferRect brDst;
+			BufferFormat dstFormat;
+			if ( target.pWindow )
+			{
+				if ( !_GetSurfaceRect(target.pWindow, rect, &brDst) )
+				{
+					return;
+				}
+				dstFormat = BUFFER_FORMAT_BGRA;
+			}
+			else
+			{
+				brDst		= _GetSubRect(*target.pBuffer, rect);
+				dstFormat	= BUFFER_FORMAT_BGR;
+			}
+
+			if ( pLinear )
+			{
+				Rect tiles;
+				BufferTiled btSrc = _GetTiledWindow(frame, rect, &tiles);
+				if ( rect.Contains(tiles) )
+				{
+					Buffer2DLinearize(&brDst, dstFormat, &btSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+				}
+				else
+				{
+					// the tiles around rect go through the linear buffer
+					BufferRect brTiles	= _GetSubRect(*pLinear, tiles);
+					BufferRect brSrc	= _GetSubRect(*pLinear, rect);
+					Buffer2DLinearize(&brTiles, BUFFER_FORMAT_BGR, &btSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+					Buffer2DConvert(&brDst, dstFormat, &brSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+				}
+			}
+			else
+			{
+				BufferRect brSrc = _GetSubRect(frame, rect);
+				Buffer2DConvert(&brDst, dstFormat, &brSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+			}
+
+			if ( target.pWindow )
+			{
+				NativeWindowPresentRect(target.pWindow, rect.left, rect.top, rect.right, rect.bottom);
+			}
+		}
+	}
+
+	// What a present left in the target, to the encoder. Waits for a
+	// free slot, which holds the presents back if encoding falls behind.
+	static void				_CaptureTarget(FrameEncoder * pEncoder, const PresentTarget & target)
+	{
+		BufferRect brSrc;
+		BufferFormat srcFormat;
+		if ( target.pWindow )
+		{
+			Integer nWidth	= NativeWindowGetWidth(target.pWindow);
+			Integer nHeight	= NativeWindowGetHeight(target.pWindow);
+			if ( !_GetSurfaceRect(target.pWindow, Rect { 0, nWidth, 0, nHeight }, &brSrc) )
+			{
+				return;
+			}
+			srcFormat = BUFFER_FORMAT_BGRA;
+		}
+		else if ( target.pRing )
+		{
+			brSrc		= target.pRing->GetLastFrame();
+			srcFormat	= BUFFER_FORMAT_BGRA;
+		}
+		else
+		{
+			brSrc		= target.pBuffer->GetBufferRect();
+			srcFormat	= BUFFER_FORMAT_BGR;
+		}
+
+		BufferRect brDst;
+		Integer iSlot = pEncoder->Acquire(srcFormat, &brDst);
+		Buffer2DCopy(&brDst, &brSrc, BUFFER_FLIP_NONE);
+		pEncoder->Submit(iSlot);
+	}
+
+	void			SwapChain::Swap()
+	{
+		Device_Impl *		pDevice;
+		DescIndex		iSwapChainDesc;
+
+		_LoadIndex(*this, &iSwapChainDesc);
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+
+		Buffer & buffer		= _GetBackBuffer(*pDevice, pDevice->swapChainDescs[ iSwapChainDesc.value ]);
+
+		Swap(Rect { 0, buffer.Width(), 0, buffer.Height() });
+	}
+	void			SwapChain::Swap(const Rect & srcRect)
+	{
+		Device_Impl *		pDevice;
+		SwapChain_Desc *	pSwapChainDesc;
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pSwapChainDesc		= _GetSwapChainDesc(*pDevice, *this);
+
+		Buffer & buffer	= _GetBackBuffer(*pDevice, *pSwapChainDesc);
+		Integer nWidth	= buffer.Width();
+		Integer nHeight	= buffer.Height();
+		ASSERT(buffer.ElementSize() == 3);
+		ASSERT(( Rect { 0, nWidth, 0, nHeight } ).Contains(srcRect) && srcRect.left < srcRect.right && srcRect.top < srcRect.bottom);
+
+		const bool bScaled = srcRect.left != 0 || srcRect.top != 0 || srcRect.right != nWidth || srcRect.bottom != nHeight;
+
+		Buffer * pFrame		= &buffer;
+		Buffer * pLinear	= _GetLinearBuffer(*pDevice, *pSwapChainDesc);
+		PresentTarget target	= _GetPresentTarget(*pDevice, *pSwapChainDesc, bScaled);
+		FrameEncoder * pEncoder	= _GetEncoder(*pDevice, *pSwapChainDesc);
+		Rect rect		= srcRect;
+
+		_SubmitPresent(*pDevice, *pSwapChainDesc, [ pFrame, pLinear, target, pEncoder, rect ]
+		{
+			_PresentFrame(*pFrame, pLinear, target, rect);
+			if ( pEncoder )
+			{
+				_CaptureTarget(pEncoder, target);
+			}
+		}, false);
+	}
+	void			SwapChain::Swap(const Rect * pRects, Integer nRects)
+	{
+		Device_Impl *		pDevice;
+		SwapChain_Desc *	pSwapChainDesc;
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pSwapChainDesc		= _GetSwapChainDesc(*pDevice, *this);
+
+		Buffer & buffer	= _GetBackBuffer(*pDevice, *pSwapChainDesc);
+		Integer nWidth	= buffer.Width();
+		Integer nHeight	= buffer.Height();
+		for ( Integer i = 0; i < nRects; ++i )
+		{
+			const Rect & rect = pRects[ i ];
+			ASSERT(( Rect { 0, nWidth, 0, nHeight } ).Contains(rect) && rect.left < rect.right && rect.top < rect.bottom);
+		}
+
+		Buffer * pFrame		= &buffer;
+		Buffer * pLinear	= _GetLinearBuffer(*pDevice, *pSwapChainDesc);
+		PresentTarget target	= _GetPresentTarget(*pDevice, *pSwapChainDesc, false);
+		FrameEncoder * pEncoder	= _GetEncoder(*pDevice, *pSwapChainDesc);
+		std::vector<Rect> rects(pRects, pRects + nRects);
+
+		_SubmitPresent(*pDevice, *pSwapChainDesc, [ pFrame, pLinear, target, pEncoder, rects ]
+		{
+			if ( target.pRing )
+			{
+				// a ring slot holds a frame from nSlots presents ago
+				_PresentFrame(*pFrame, pLinear, target, Rect { 0, pFrame->Width(), 0, pFrame->Height() });
+			}
+			else
+			{
+				_PresentRects(*pFrame, pLinear, target, rects.data(), static_cast< Integer >( rects.size() ));
+			}
+			if ( pEncoder )
+			{
+				_CaptureTarget(pEncoder, target);
+			}
+		}, false);
+	}
+	void			SwapChain::SwapTemporal(const Rect & srcRect, DepthStencilBuffer dsb, const TemporalDesc & desc)
+	{
+		Device_Impl *		pDevice;
+		SwapChain_Desc *	pSwapChainDesc;
+		DepthStencil_Desc *	pDepthStencilDesc;
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pSwapChainDesc		= _GetSwapChainDesc(*pDevice, *this);
+		pDepthStencilDesc	= _GetDepthStencilDesc(*pDevice, dsb);
+
+		Buffer & frame	= _GetBackBuffer(*pDevice, *pSwapChainDesc);
+		Buffer * pLinear	= _GetLinearBuffer(*pDevice, *pSwapChainDesc);
+		Buffer & depth	= pDevice->buffers[ pDepthStencilDesc->iDepthBuffer.value ];
+		Integer nWidth	= frame.Width();
+		Integer nHeight	= frame.Height();
+		ASSERT(nWidth >= 2 && nHeight >= 2);
+		ASSERT(( Rect { 0, nWidth, 0, nHeight } ).Contains(srcRect) && srcRect.left < srcRect.right && srcRect.top < srcRect.bottom);
+		ASSERT(( Rect { 0, depth.Width(), 0, depth.Height() } ).Contains(srcRect));
+
+		if ( !pSwapChainDesc->bHasTemporalBuffers )
+		{
+			pSwapChainDesc->iHistoryBuffers[ 0 ]	= _CreateBuffer(*pDevice, nWidth, nHeight, 3 * sizeof(f32), 4);
+			pSwapChainDesc->iHistoryBuffers[ 1 ]	= _CreateBuffer(*pDevice, nWidth, nHeight, 3 * sizeof(f32), 4);
+			pSwapChainDesc->iMotionBuffer		= _CreateBuffer(*pDevice, nWidth, nHeight, sizeof(TemporalSample), 4);
+			pSwapChainDesc->bHasTemporalBuffers	= true;
+			pSwapChainDesc->bHistoryValid		= false;
+		}
+
+		Buffer & motion		= pDevice->buffers[ pSwapChainDesc->iMotionBuffer.value ];
+		Buffer & prevHistory	= pDevice->buffers[ pSwapChainDesc->iHistoryBuffers[ pSwapChainDesc->iHistory ].value ];
+		Buffer & history	= pDevice->buffers[ pSwapChainDesc->iHistoryBuffers[ pSwapChainDesc->iHistory ^ 1 ].value ];
+		bool bHistoryValid	= pSwapChainDesc->bHistoryValid && !desc.bReset;
+
+		PresentTarget target	= _GetPresentTarget(*pDevice, *pSwapChainDesc, true);
+		FrameEncoder * pEncoder	= _GetEncoder(*pDevice, *pSwapChainDesc);
+		ASSERT(target.pScaled || target.pBuffer->ElementSize() == 3);
+
+		// reads the depth buffer the next frame draws into, never deferred
+		_SubmitPresent(*pDevice, *pSwapChainDesc, [ & ]
+		{
+			Buffer & linear	= _LinearizeFrame(frame, pLinear);
+			Buffer & dst	= target.pScaled ? *target.pScaled : *target.pBuffer;
+
+			_TemporalMotion(motion, linear, depth, srcRect, desc);
+			_TemporalAccumulate(dst, history, prevHistory, bHistoryValid, motion, linear, srcRect, desc);
+
+			if ( target.pWindow )
+			{
+				NativeWindowBilt(target.pWindow, dst.Data(), NATIVE_BLIT_BGR);
+			}
+			else if ( target.pRing )
+			{
+				BufferRect brDst = target.pRing->BeginFrame(target.iSwapTick);
+				BufferRect brSrc = dst.GetBufferRect();
+				Buffer2DConvert(&brDst, BUFFER_FORMAT_BGRA, &brSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+				target.pRing->EndFrame();
+			}
+			if ( pEncoder )
+			{
+				_CaptureTarget(pEncoder, target);
+			}
+		}, true);
+
+		pSwapChainDesc->iHistory	^= 1;
+		pSwapChainDesc->bHistoryValid	= true;
+	}
+	u64			SwapChain::GetFrameCount() const
+	{
+		return _GetSwapChainDesc(*_GetDevice(*this), *this)->nFrames;
+	}
+	Fence			SwapChain::GetFence() const
+	{
+		Fence fence;
+		fence.pImpl	= pImpl;
+		fence.pParam	= pParam;
+		return fence;
+	}
+	bool			SwapChain::SetOutput(const FrameOutputDesc * pDesc)
+	{
+		Device_Impl *		pDevice;
+		SwapChain_Desc *	pSwapChainDesc;
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pSwapChainDesc		= _GetSwapChainDesc(*pDevice, *this);
+
+		// the present thread may be capturing into the old encoder
+		GetFence().Wait(pSwapChainDesc->nFrames);
+
+		if ( !pSwapChainDesc->bHasEncoder )
+		{
+			if ( !pDesc )
+			{
+				return true;
+			}
+			pSwapChainDesc->iEncoder	= pDevice->encoders.size();
+			pSwapChainDesc->bHasEncoder	= true;
+			pDevice->encoders.emplace_back();
+		}
+
+		Ptr<FrameEncoder> & encoder = pDevice->encoders[ pSwapChainDesc->iEncoder ];
+		bool bWritten = !encoder || encoder->Close();
+		encoder.reset();
+		if ( pDesc )
+		{
+			const Buffer & back = _GetBackBuffer(*pDevice, *pSwapChainDesc);
+			encoder.reset(new FrameEncoder(*pDesc, back.Width(), back.Height()));
+		}
+		return bWritten;
+	}
+	void			SwapChain::ResetBackBuffer(Byte value)
+	{
+		Device_Impl *		pDevice;
+		DescIndex		iSwapChainDesc;
+		SwapChain_Desc *	pSwapChainDesc;
 
 		_LoadIndex(*this, &iSwapChainDesc);
 
@@ -999,26 +2202,45 @@ namespace Graphics
 		pSwapChainDesc		= &pDevice->swapChainDescs[ iSwapChainDesc.value ];
 
 		Buffer & backBuffer	= _GetBackBuffer(*pDevice, *pSwapChainDesc);
-		Integer nBytesPerRow	= (rect.right - rect.left) * backBuffer.ElementSize();
-		for (Integer row = rect.top; row < rect.bottom; ++row)
+		if ( pSwapChainDesc->bTiled )
 		{
-			FillMemory(backBuffer.At(row, rect.left),
-				   nBytesPerRow,
-				   value);
+			BufferTiled btBack = backBuffer.GetBufferTiled();
+			Byte element[ 4 ] = { value, value, value, value };
+			Buffer2DFillTiled(&btBack, ( u32 ) rect.top, ( u32 ) rect.left, ( u32 ) rect.bottom, ( u32 ) rect.right, element);
+			return;
 		}
+
+		BufferRect brBack	= backBuffer.GetBufferRect();
+		brBack.pData		= static_cast< u8 * >( backBuffer.At(rect.top, rect.left) );
+		brBack.nRCount		= ( u32 ) ( rect.bottom - rect.top );
+		brBack.nCCount		= ( u32 ) ( ( rect.right - rect.left ) * backBuffer.ElementSize() );
+		brBack.nCStride		= 1;
+		Buffer2DFill(&brBack, &value);
 	}
-	void *			SwapChain::FrameBuffer()
+	u64			Fence::GetCompletedValue() const
 	{
 		Device_Impl *		pDevice;
-		DescIndex		iSwapChainDesc;
-		SwapChain_Desc *	pSwapChainDesc;
+		const SwapChain_Desc *	pSwapChainDesc;
 
-		_LoadIndex(*this, &iSwapChainDesc);
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pSwapChainDesc		= _GetSwapChainDesc(*_GetDevice(*this), *this);
+
+		return pSwapChainDesc->bAsync ? pDevice->presentQueues[ pSwapChainDesc->iPresentQueue ].Completed() : pSwapChainDesc->nFrames;
+	}
+	void			Fence::Wait(u64 value) const
+	{
+		Device_Impl *		pDevice;
+		const SwapChain_Desc *	pSwapChainDesc;
 
 		pDevice			= static_cast< Device_Impl * >( pParam );
-		pSwapChainDesc		= &pDevice->swapChainDescs[ iSwapChainDesc.value ];
+		pSwapChainDesc		= _GetSwapChainDesc(*_GetDevice(*this), *this);
 
-		return _GetFrontBuffer(*pDevice, *pSwapChainDesc).Data();
+		ASSERT(value <= pSwapChainDesc->nFrames);
+
+		if ( pSwapChainDesc->bAsync )
+		{
+			pDevice->presentQueues[ pSwapChainDesc->iPresentQueue ].Wait(value);
+		}
 	}
 
 	Integer			VertexFormat::Alignment()
@@ -1076,6 +2298,12 @@ namespace Graphics
 	{
 		//ASSERT(false);
 	}
+	void			VertexBuffer::Reset()
+	{
+		VertexBuffer_Desc * pVertexBufferDesc;
+		_GetVertexBufferDesc(*this, &pVertexBufferDesc, nullptr);
+		pVertexBufferDesc->nAllocated = 0;
+	}
 	VertexFormat		VertexBuffer::GetVertexFormat()
 	{
 		Device_Impl * pDevice;
@@ -1115,6 +2343,28 @@ namespace Graphics
 
 		_ResetDepthBuffer(pDevice->buffers[ pDepthStencilDesc->iDepthBuffer.value ], value);
 	}
+	void			DepthStencilBuffer::ResetDepthBuffer(const Rect & rect, float value)
+	{
+		Device_Impl *		pDevice;
+		DepthStencil_Desc *	pDepthStencilDesc;
+
+		pDevice			= static_cast< Device_Impl * >( pParam );
+		pDepthStencilDesc	= _GetDepthStencilDesc(*pDevice, *this);
+
+		Buffer & depthBuffer	= pDevice->buffers[ pDepthStencilDesc->iDepthBuffer.value ];
+		if ( depthBuffer.Layout() == BufferLayout::TILED )
+		{
+			BufferTiled btDepth = depthBuffer.GetBufferTiled();
+			Buffer2DFillTiled(&btDepth, ( u32 ) rect.top, ( u32 ) rect.left, ( u32 ) rect.bottom, ( u32 ) rect.right, &value);
+			return;
+		}
+
+		BufferRect brDepth	= depthBuffer.GetBufferRect();
+		brDepth.pData		= static_cast< u8 * >( depthBuffer.At(rect.top, rect.left) );
+		brDepth.nRCount		= ( u32 ) ( rect.bottom - rect.top );
+		brDepth.nCCount		= ( u32 ) ( rect.right - rect.left );
+		Buffer2DFill(&brDepth, &value);
+	}
 	void			DepthStencilBuffer::ResetStencilBuffer(Byte value)
 	{
 		Device_Impl *		pDevice;
@@ -1126,7 +2376,9 @@ namespace Graphics
 		pDevice			= static_cast< Device_Impl * >( pParam );
 		pDepthStencilDesc	= &pDevice->depthStencilDescs[ iDepthStencilDesc.value ];
 
-		_ResetStencilBuffer(pDevice->buffers[ pDepthStencilDesc->iStencilBuffer.value ], value);
+		_ResetStencilBuffer(pDevice->buffers[ pDepthStencilDesc->iStencilBuffer.value ],
+				    pDevice->buffers[ pDepthStencilDesc->iStencilTiles.value ],
+				    value);
 	}
 
 	void			Texture2D::Sample(float u, float v, float * pColor) const
@@ -1140,13 +2392,13 @@ namespace Graphics
 
 		const Buffer & texData			= _GetBuffer(*pDevice, pTextureDesc->iTexDataBuffer);
 
-		LONG width = texData.Width();
-		LONG height = texData.Height();
-		LONG col = static_cast< LONG >( width * u ) % width;
-		LONG row = static_cast< LONG >( height * v ) % height;
+		Integer width = texData.Width();
+		Integer height = texData.Height();
+		Integer col = static_cast< Integer >( width * u ) % width;
+		Integer row = static_cast< Integer >( height * v ) % height;
 		
-		col = Bound(( LONG ) 0, col, width - 1);
-		row = Bound(( LONG ) 0, row, height - 1);
+		col = Bound(( Integer ) 0, col, width - 1);
+		row = Bound(( Integer ) 0, row, height - 1);
 
 		const Byte * bgra	= ( Byte * ) texData.At(row, col);
 
@@ -1154,11 +2406,63 @@ namespace Graphics
 		pColor[ 1 ] = static_cast< float >( bgra[ 1 ] ) / 255.f;
 		pColor[ 2 ] = static_cast< float >( bgra[ 2 ] ) / 255.f;
 	}
+	void			Texture2D::Sample(const vec2x8 & uv, const mask8 & active, vec3x8 * pColor) const
+	{
+		const Device_Impl * pDevice		= _GetDevice(*this);
+		const Texture2D_Desc * pTextureDesc	= _GetTextureDesc(*pDevice, *this);
+
+		const Buffer & texData			= _GetBuffer(*pDevice, pTextureDesc->iTexDataBuffer);
+
+		Integer width = texData.Width();
+		Integer height = texData.Height();
+
+		f32 u[ LANE_COUNT ];
+		f32 v[ LANE_COUNT ];
+		f32 b[ LANE_COUNT ];
+		f32 g[ LANE_COUNT ];
+		f32 r[ LANE_COUNT ];
+		F8Store(u, uv.x * static_cast< f32 >( width ));
+		F8Store(v, uv.y * static_cast< f32 >( height ));
+
+		// Gather, inactive lanes stay black
+		int bits = M8Bits(active);
+		for ( int i = 0; i < LANE_COUNT; ++i )
+		{
+			if ( !( bits & ( 1 << i ) ) )
+			{
+				b[ i ] = g[ i ] = r[ i ] = 0.0f;
+				continue;
+			}
+
+			Integer col = static_cast< Integer >( u[ i ] ) % width;
+			Integer row = static_cast< Integer >( v[ i ] ) % height;
+
+			col = Bound(( Integer ) 0, col, width - 1);
+			row = Bound(( Integer ) 0, row, height - 1);
+
+			const Byte * bgra	= ( Byte * ) texData.At(row, col);
+
+			b[ i ] = static_cast< float >( bgra[ 0 ] );
+			g[ i ] = static_cast< float >( bgra[ 1 ] );
+			r[ i ] = static_cast< float >( bgra[ 2 ] );
+		}
+
+		float8 scale = F8Set(255.f);
+		pColor->x = F8Load(b) / scale;
+		pColor->y = F8Load(g) / scale;
+		pColor->z = F8Load(r) / scale;
+	}
 
 	Rect			RenderTarget::GetRect() const
 	{
 		return _GetRenderTargetDesc(*static_cast< Device_Impl * >( pParam ), *this)->rect;
 	}
+	void			RenderTarget::SetRect(const Rect & rect)
+	{
+		RenderTarget_Desc * pRenderTargetDesc = _GetRenderTargetDesc(*static_cast< Device_Impl * >( pParam ), *this);
+
+		*pRenderTargetDesc = _CreateRenderTarget(*static_cast< Device_Impl * >( pParam ), pRenderTargetDesc->pUnknown, rect);
+	}
 	Integer			RenderTarget::GetWidth() const
 	{
 		const Rect & rect = _GetRenderTargetDesc(*static_cast< Device_Impl * >( pParam ), *this)->rect;
@@ -1219,6 +2523,44 @@ namespace Graphics
 	{
 		static_cast< RenderContext_Impl * >( pImpl )->bFlipHorizontal = bFlipHorizontal;
 	}
+	void			RenderContext::RSSetViews(const View * pViews, Integer nViews)
+	{
+		RenderContext_Impl * context = static_cast< RenderContext_Impl * >( pImpl );
+
+		ASSERT(0 <= nViews && nViews <= MAX_VIEW_COUNT);
+
+		for ( Integer i = 0; i < nViews; ++i )
+		{
+			View_Desc & view	= context->views[ i ];
+			view.view		= pViews[ i ].view;
+			view.proj		= pViews[ i ].proj;
+			view.bFlipHorizontal	= pViews[ i ].bFlipHorizontal;
+			_LoadIndex(pViews[ i ].target, &view.iRenderTargetDesc);
+		}
+		context->nViews = nViews;
+	}
+	void			RenderContext::RSSetShadingRate(ShadingRate rate)
+	{
+		static_cast< RenderContext_Impl * >( pImpl )->shadingRate = rate;
+	}
+	void			RenderContext::RSSetShadingRateImage(const ShadingRate * pRates, Integer nCols, Integer nRows)
+	{
+		RenderContext_Impl * context = static_cast< RenderContext_Impl * >( pImpl );
+
+		ASSERT(!pRates || ( nCols > 0 && nRows > 0 ));
+
+		context->pShadingRateImage	= pRates;
+		context->nShadingRateCols	= pRates ? nCols : 0;
+		context->nShadingRateRows	= pRates ? nRows : 0;
+	}
+	void			RenderContext::RSSetScissorRects(const Rect * pRects, Integer nRects)
+	{
+		RenderContext_Impl * context = static_cast< RenderContext_Impl * >( pImpl );
+
+		ASSERT(nRects >= 0 && ( pRects || nRects == 0 ));
+
+		context->vScissorRects.assign(pRects, pRects + nRects);
+	}
 	void			RenderContext::OMSetDepthStencilState(DepthStencilState st)
 	{
 		static_cast< RenderContext_Impl * >( pImpl )->stDepthStencil = st;
@@ -1227,6 +2569,36 @@ namespace Graphics
 	{
 		static_cast< RenderContext_Impl * >( pImpl )->stBlend = bs;
 	}
+	void			RenderContext::SOSetTarget(VertexBuffer vb)
+	{
+		static_cast< RenderContext_Impl * >( pImpl )->bStreamOut = true;
+		_LoadIndex(vb,	&static_cast< RenderContext_Impl * >( pImpl )->iStreamOutDesc);
+	}
+	void			RenderContext::SOResetTarget()
+	{
+		static_cast< RenderContext_Impl * >( pImpl )->bStreamOut = false;
+	}
+	void			RenderContext::CompositeByDepth(RenderContext src)
+	{
+		RenderContext_Impl * self = static_cast< RenderContext_Impl * >( pImpl );
+		RenderContext_Impl * other = static_cast< RenderContext_Impl * >( src.pImpl );
+
+		Buffer & dstColor	= _GetBackBuffer(*self);
+		Buffer & dstDepth	= _GetDepthBuffer(*self);
+		Buffer & srcColor	= _GetBackBuffer(*other);
+		Buffer & srcDepth	= _GetDepthBuffer(*other);
+
+		ASSERT(dstColor.Width() == srcColor.Width() && dstColor.Height() == srcColor.Height() && dstColor.Layout() == srcColor.Layout());
+		ASSERT(dstDepth.Width() == srcDepth.Width() && dstDepth.Height() == srcDepth.Height() && dstDepth.Layout() == srcDepth.Layout());
+		ASSERT(dstColor.Width() == dstDepth.Width() && dstColor.Height() == dstDepth.Height() && dstColor.Layout() == dstDepth.Layout());
+
+		BufferRect brDstColor	= _GetStorageRect(dstColor);
+		BufferRect brDstDepth	= _GetStorageRect(dstDepth);
+		BufferRect brSrcColor	= _GetStorageRect(srcColor);
+		BufferRect brSrcDepth	= _GetStorageRect(srcDepth);
+
+		Buffer2DDepthComposite(&brDstColor, &brDstDepth, &brSrcColor, &brSrcDepth);
+	}
 	DepthStencilBuffer	RenderContext::GetDepthStencilBuffer()
 	{
 		Device_Impl * pDevice = static_cast< Device_Impl * >( pParam );
@@ -1265,7 +2637,14 @@ namespace Graphics
 		pBytes			= (Byte *)pVertexBuffer->Data();
 		nVSize			= pVertexFormatDesc->nSize;
 
-		_Rasterize(*self, *pVertexFormatDesc, (pBytes + nOffset * nVSize), nCount);
+		if ( self->bStreamOut )
+		{
+			_StreamOut(*self, *pVertexFormatDesc, (pBytes + nOffset * nVSize), nCount);
+		}
+		else
+		{
+			_Rasterize(*self, *pVertexFormatDesc, (pBytes + nOffset * nVSize), nCount);
+		}
 	}
 
 	Device			Device::Default()
@@ -1276,6 +2655,17 @@ namespace Graphics
 		device.pImpl = &deviceImpl;
 		return device;
 	}	
+	Device			Device::Create()
+	{
+		Device device;
+		device.pImpl = new Device_Impl;
+		return device;
+	}
+	void			Device::Destroy(Device device)
+	{
+		ASSERT(device.pImpl != Default().pImpl);
+		delete static_cast< Device_Impl * >( device.pImpl );
+	}
 	RenderContext		Device::CreateRenderContext()
 	{
 		Device_Impl * self = static_cast< Device_Impl * >( pImpl );
@@ -1289,7 +2679,30 @@ namespace Graphics
 		handle.pParam = self;
 		return handle;
 	}
-	SwapChain		Device::CreateSwapChain(RenderTarget renderTarget)
+	RenderContext		Device::CreatePrivateContext(RenderContext context)
+	{
+		Device_Impl * self = static_cast< Device_Impl * >( pImpl );
+
+		RenderContext_Impl * pSource = static_cast< RenderContext_Impl * >( context.pImpl );
+		RenderContext handle = CreateRenderContext();
+		RenderContext_Impl * pPrivate = static_cast< RenderContext_Impl * >( handle.pImpl );
+
+		Buffer & depthBuffer = _GetDepthBuffer(*pSource);
+		Integer nWidth = depthBuffer.Width();
+		Integer nHeight = depthBuffer.Height();
+		BufferLayout layout = depthBuffer.Layout();
+
+		pPrivate->iSwapChainDesc.value = self->swapChainDescs.size();
+		self->swapChainDescs.emplace_back(_CreatePrivateSwapChain(*self, self->swapChainDescs[ pSource->iSwapChainDesc.value ]));
+
+		pPrivate->iDepthStencilDesc.value = self->depthStencilDescs.size();
+		self->depthStencilDescs.emplace_back(_CreateDepthStencilBuffer(*self, nWidth, nHeight, layout));
+
+		pPrivate->iRenderTargetDesc = pSource->iRenderTargetDesc;
+
+		return handle;
+	}
+	SwapChain		Device::CreateSwapChain(RenderTarget renderTarget, BufferLayout layout, Integer nBuffers, bool bAsyncPresent)
 	{
 		Device_Impl * self = static_cast<Device_Impl *>(pImpl);
 
@@ -1298,21 +2711,21 @@ namespace Graphics
 
 		DescIndex iRenderTargetDesc;
 		_LoadIndex(renderTarget, &iRenderTargetDesc);
-		self->swapChainDescs.emplace_back(_CreateSwapChain(*self, iRenderTargetDesc));
+		self->swapChainDescs.emplace_back(_CreateSwapChain(*self, iRenderTargetDesc, layout, nBuffers, bAsyncPresent));
 
 		SwapChain handle;
 		_StoreIndex(&handle, iSwapChain);
 		handle.pParam = self;
 		return handle;
 	}
-	DepthStencilBuffer	Device::CreateDepthStencilBuffer(Integer width, Integer height)
+	DepthStencilBuffer	Device::CreateDepthStencilBuffer(Integer width, Integer height, BufferLayout layout)
 	{
 		Device_Impl * self = static_cast<Device_Impl *>(pImpl);
 
 		DescIndex iDepthStencil;
 		iDepthStencil.value = self->depthStencilDescs.size();
 
-		self->depthStencilDescs.emplace_back(_CreateDepthStencilBuffer(*self, width, height));
+		self->depthStencilDescs.emplace_back(_CreateDepthStencilBuffer(*self, width, height, layout));
 
 		DepthStencilBuffer handle;
 		_StoreIndex(&handle, iDepthStencil);
@@ -1473,7 +2886,7 @@ namespace Graphics
 		handle.pParam = self;
 		return handle;
 	}
-	VertexBuffer		Device::CreateVertexBuffer(VertexFormat hVertexFormat)
+	VertexBuffer		Device::CreateVertexBuffer(VertexFormat hVertexFormat, Integer nCapacity)
 	{
 		Device_Impl * self = static_cast< Device_Impl * >( pImpl );
 
@@ -1483,21 +2896,21 @@ namespace Graphics
 		DescIndex iVertexBufferDesc;
 		iVertexBufferDesc.value = self->vertexBufferDescs.size();
 
-		self->vertexBufferDescs.emplace_back(_CreateVertexBuffer(*self, iVertexFormatDesc));
+		self->vertexBufferDescs.emplace_back(_CreateVertexBuffer(*self, iVertexFormatDesc, nCapacity));
 
 		VertexBuffer handle;
 		_StoreIndex(&handle, iVertexBufferDesc);
 		handle.pParam = self;
 		return handle;
 	}
-	VertexShader		Device::CreateVertexShader(VertexShaderFunc vs, VertexFormat fmtVSIn, VertexFormat fmtVSOut)
+	VertexShader		Device::CreateVertexShader(VertexShaderFunc vs, VertexFormat fmtVSIn, VertexFormat fmtVSOut, PositionShaderFunc pos)
 	{
 		Device_Impl * self = static_cast< Device_Impl * >( pImpl );
 
 		ShaderIndex iVertexShader;
 		iVertexShader.value = self->vertexShaderDescs.size();
 
-		self->vertexShaderDescs.emplace_back(_CreateVertexShader(*self, vs, fmtVSIn, fmtVSOut));
+		self->vertexShaderDescs.emplace_back(_CreateVertexShader(*self, vs, pos, fmtVSIn, fmtVSOut));
 
 		VertexShader handle;
 		_StoreIndex(&handle, iVertexShader);
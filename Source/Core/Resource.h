@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Buffer.h"
+#include "Lanes.h"
 #include "Unknown.h"
 
 namespace Graphics
@@ -63,6 +64,7 @@ namespace Graphics
 	public:
 		VertexRange	Alloc(Integer nCount);
 		void		Free(VertexRange v);
+		void		Reset();
 		
 		VertexFormat	GetVertexFormat();
 		Integer		Count();
@@ -77,24 +79,68 @@ namespace Graphics
 	{
 	public:
 		void		Sample(float u, float v, float * pColor) const;
+		void		Sample(const vec2x8 & uv, const mask8 & active, vec3x8 * pColor) const;
 	};
 
 	struct Rect;
+	struct DepthStencilBuffer;
+	struct FrameOutputDesc;
 
+	// Temporal upsampling input, see SwapChain::SwapTemporal. Matrices
+	// are view * proj without jitter, jitter is in source pixels.
+	struct TemporalDesc
+	{
+		Matrix44	viewProj;
+		Matrix44	prevViewProj;
+		Vector2		jitter;
+		bool		bReset;		// drop the history, e.g. after a cut
+	};
+
+	#define SWAP_CHAIN_MAX_BUFFERS (4)
+
+	// Frame n of a swap chain, counting its swaps from 1, has reached the
+	// target once the completed value is n or more.
+	struct Fence : public Handle
+	{
+	public:
+		u64		GetCompletedValue() const;
+		void		Wait(u64 value) const;
+	};
+
+	// Async swap chains present on their own thread: a Swap hands the back
+	// buffer over and returns as soon as the next back buffer is free. Wait
+	// on the fence before touching the target, e.g. destroying a window.
 	struct SwapChain : public Handle
 	{
 	public:
 		void		Swap();
+		// presents srcRect of the back buffer stretched over the target
+		void		Swap(const Rect & srcRect);
+		// Presents only the rects, the rest of the target keeps what the
+		// last present left there. Tiled: best with BUFFER_TILE_SIZE
+		// aligned rects, anything else linearizes the enclosing tiles.
+		// A FrameRing target gets the whole frame.
+		void		Swap(const Rect * pRects, Integer nRects);
+		// As Swap(srcRect), but accumulated over frames: motion vectors
+		// from dsb's depth reproject a full size history, which is clamped
+		// to the source neighbourhood and blended with the new samples.
+		void		SwapTemporal(const Rect & srcRect, DepthStencilBuffer dsb, const TemporalDesc & desc);
 		void		ResetBackBuffer(Byte value = 0);
 		void		ResetBackBuffer(const Rect & rect, Byte value);
-	private:
-		void *		FrameBuffer();
+		u64		GetFrameCount() const;	// swaps so far
+		Fence		GetFence() const;
+		// Every present after this is also encoded to files, see
+		// FrameEncoder: what reached the target, captured on the present
+		// thread. nullptr stops and writes out what is queued. False if
+		// the output it replaces failed to write a frame.
+		bool		SetOutput(const FrameOutputDesc * pDesc);
 	};
 
 	struct DepthStencilBuffer : public Handle
 	{
 	public:
 		void		ResetDepthBuffer(float value = 1.0f);
+		void		ResetDepthBuffer(const Rect & rect, float value);
 		void		ResetStencilBuffer(Byte value);
 	};
 
@@ -151,12 +197,31 @@ namespace Graphics
 		BlendOp		opAlpha;
 	};
 
+	// Pixels (w x h) covered by one pixel shader invocation, coarser
+	// is larger. Depth and stencil stay per pixel.
+	enum class ShadingRate
+	{
+		RATE_1X1,
+		RATE_2X1,
+		RATE_2X2,
+		RATE_4X4,
+	};
+
+	#define SHADING_RATE_TILE_SIZE (8) // pixels per side of a rate image tile
+
 	// ---------------------------------------------------------------
 	// Functions
 	// ---------------------------------------------------------------
 
 	typedef void (*VertexShaderFunc)(void * pVSOut, const void * pVSIn, const void * pContext);
-	typedef void (*PixelShaderFunc)(void * pPSOut, const void * pPSIn, const void * pContext);
+	// Positions only, runs before culling: pPosIn is the POSITION field of
+	// the VS input, pPosOut receives the POSITION and SV_POSITION fields of
+	// the VS output. Must match what the full VS writes there.
+	typedef void (*PositionShaderFunc)(void * pPosOut, const void * pPosIn, const void * pContext);
+	// Shades LANE_COUNT pixels per call. pPSIn and pPSOut hold the formats
+	// in SoA form, every f32 widened to a float8 (offsets scale by
+	// LANE_COUNT). Inactive lanes repeat an active pixel.
+	typedef void (*PixelShaderFunc)(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext);
 
 	class VertexShader : public Handle
 	{
@@ -176,7 +241,7 @@ namespace Graphics
 		Integer top;
 		Integer bottom;
 
-		bool			Contains(const Rect & other)
+		bool			Contains(const Rect & other) const
 		{
 			return	left <= other.left &&
 				right >= other.right &&
@@ -189,11 +254,21 @@ namespace Graphics
 	{
 	public:
 		Rect			GetRect() const;
+		void			SetRect(const Rect & rect);	// inside the window or buffer
 		Integer			GetWidth() const;
 		Integer			GetHeight() const;
 		virtual bool		QueryInterface(Integer iid, void ** ppvObject) override;
 	};
 
+	// One viewport of a multi-view draw, see RenderContext::RSSetViews
+	#define MAX_VIEW_COUNT (4)
+	struct View
+	{
+		Matrix44		view;
+		Matrix44		proj;
+		RenderTarget		target;
+		bool			bFlipHorizontal;
+	};
 
 	class RenderContext : public Handle
 	{
@@ -209,9 +284,34 @@ namespace Graphics
 		void			SetRenderTarget(RenderTarget target);
 
 		void			RSSetFlipHorizontal(bool bFlipHorizontal);
+		// Multi-view: with nViews > 0, the vertex (and position) shader
+		// leaves POSITION in world space, each Draw shades a vertex once
+		// and projects, culls and rasterizes it into every view's target.
+		// nViews = 0 goes back to the render target and flip set above.
+		void			RSSetViews(const View * pViews, Integer nViews);
+		// Variable rate shading: the coarser of the draw rate and the rate
+		// image tile under a pixel applies. The image (row-major, nCols x
+		// nRows tiles of SHADING_RATE_TILE_SIZE, render target space) is
+		// not copied, nullptr clears it.
+		void			RSSetShadingRate(ShadingRate rate);
+		void			RSSetShadingRateImage(const ShadingRate * pRates, Integer nCols, Integer nRows);
+		// Pixels outside every rect (render target space) are not
+		// touched. Copied, nRects = 0 turns the test off.
+		void			RSSetScissorRects(const Rect * pRects, Integer nRects);
 		void			OMSetDepthStencilState(DepthStencilState st);
 		void			OMSetBlendState(BlendState bs);
 
+		// Stream-out: while a target is set, Draw runs only the vertex
+		// shader and appends its output (format must match the target's)
+		// to the target, nothing is rasterized.
+		void			SOSetTarget(VertexBuffer vb);
+		void			SOResetTarget();
+
+		// Sort-last merge: keeps, per pixel, the nearer of this context's
+		// and src's back buffer color and depth. Sizes and layouts match,
+		// see Device::CreatePrivateContext.
+		void			CompositeByDepth(RenderContext src);
+
 		DepthStencilBuffer	GetDepthStencilBuffer();
 		RenderTarget		GetRenderTarget();
 
@@ -227,10 +327,21 @@ namespace Graphics
 	{
 	public:
 		static Device		Default();
+		// Its own resources, contexts and swap chains, shared with no
+		// other device: one per thread renders without locks. Destroy
+		// after everything made from it is done with.
+		static Device		Create();
+		static void		Destroy(Device device);
 
 		RenderContext		CreateRenderContext();
-		SwapChain		CreateSwapChain(RenderTarget renderTarget);
-		DepthStencilBuffer	CreateDepthStencilBuffer(Integer width, Integer height);
+		// Draws into its own color and depth buffers, sized and laid out
+		// like context's. Never presented, merge with CompositeByDepth.
+		RenderContext		CreatePrivateContext(RenderContext context);
+		// nBuffers (up to SWAP_CHAIN_MAX_BUFFERS) in rotation, with
+		// bAsyncPresent up to nBuffers - 1 frames queued for presenting.
+		SwapChain		CreateSwapChain(RenderTarget renderTarget, BufferLayout layout = BufferLayout::LINEAR, Integer nBuffers = 2, bool bAsyncPresent = false);
+		DepthStencilBuffer	CreateDepthStencilBuffer(Integer width, Integer height, BufferLayout layout = BufferLayout::LINEAR);
+		// a RenderWindow, Buffer (BGR) or FrameRing
 		RenderTarget		CreateRenderTarget(IUnknown * pUnknown, const Rect & rect);
 		RenderTarget		CreateRenderTarget(Texture2D texture, const Rect & rect);
 		RenderTarget		CreateRenderTarget(RenderTarget renderTarget, const Rect & rectSub);
@@ -240,8 +351,8 @@ namespace Graphics
 		VertexFormat		CreateVertexFormat(VertexFieldType type0, VertexFieldType type1, VertexFieldType type2);
 		VertexFormat		CreateVertexFormat(VertexFieldType type0, VertexFieldType type1, VertexFieldType type2, VertexFieldType type3);
 		VertexFormat		CreateVertexFormat(VertexFieldType type0, VertexFieldType type1, VertexFieldType type2, VertexFieldType type3, VertexFieldType type4);
-		VertexBuffer		CreateVertexBuffer(VertexFormat format);
-		VertexShader		CreateVertexShader(VertexShaderFunc vs, VertexFormat fmtVSIn, VertexFormat fmtVSOut);
+		VertexBuffer		CreateVertexBuffer(VertexFormat format, Integer nCapacity = 1024);
+		VertexShader		CreateVertexShader(VertexShaderFunc vs, VertexFormat fmtVSIn, VertexFormat fmtVSOut, PositionShaderFunc pos = nullptr);
 		PixelShader		CreatePixelShader(PixelShaderFunc ps, VertexFormat fmtPSIn, VertexFormat fmtPSOut);
 
 		Texture2D		CreateTexture2D(Integer width, Integer height, Integer elementSize, Integer alignment, Integer rowPadding, const void * pData);
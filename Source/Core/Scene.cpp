@@ -1,4 +1,17 @@
 #include "Scene.h"
+#include "FrameRing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#define DYNAMIC_RES_SCALE_MIN	(0.4)	// of each side
+#define DYNAMIC_RES_KP		(0.30)
+#define DYNAMIC_RES_KI		(0.10)
+#define DYNAMIC_RES_KD		(0.05)
+#define TEMPORAL_JITTER_COUNT	(8)	// Halton (2, 3) points before repeating
 
 namespace Graphics
 {
@@ -37,7 +50,6 @@ namespace Graphics
 	}
 	void			SceneObject::ApplyChangeToConnectionTree(SceneObject * pRootObject, Transform * pSourceTransform)
 	{
-		SceneObject * pMaster;
 		SceneObject * pSlave;
 		Transform * pPassTransform;
 
@@ -50,7 +62,6 @@ namespace Graphics
 
 		ASSERT(pSourceTransform);
 
-		pMaster = pRootObject;
 		for ( Connection & connection : pRootObject->vConnectSlaves )
 		{
 			pSlave		= connection.pTargetObject;
@@ -85,6 +96,122 @@ namespace Graphics
 		}
 	}
 
+	DirtyRegion::DirtyRegion()
+		: m_width(0)
+		, m_height(0)
+		, m_nCols(0)
+		, m_nRows(0)
+		, m_nMarked(0)
+	{
+	}
+	void			DirtyRegion::Resize(Integer width, Integer height)
+	{
+		m_width		= width;
+		m_height	= height;
+		m_nCols		= ( width + DIRTY_TILE_SIZE - 1 ) >> DIRTY_TILE_SHIFT;
+		m_nRows		= ( height + DIRTY_TILE_SIZE - 1 ) >> DIRTY_TILE_SHIFT;
+		m_tiles.assign(m_nCols * m_nRows, 0);
+		m_nMarked	= 0;
+	}
+	void			DirtyRegion::Clear()
+	{
+		std::fill(m_tiles.begin(), m_tiles.end(), 0);
+		m_nMarked	= 0;
+	}
+	void			DirtyRegion::MarkAll()
+	{
+		std::fill(m_tiles.begin(), m_tiles.end(), 1);
+		m_nMarked	= m_nCols * m_nRows;
+	}
+	void			DirtyRegion::Mark(const Rect & rect)
+	{
+		Integer xMin = Max<Integer>(rect.left, 0) >> DIRTY_TILE_SHIFT;
+		Integer yMin = Max<Integer>(rect.top, 0) >> DIRTY_TILE_SHIFT;
+		Integer xEnd = ( Min(rect.right, m_width) + DIRTY_TILE_SIZE - 1 ) >> DIRTY_TILE_SHIFT;
+		Integer yEnd = ( Min(rect.bottom, m_height) + DIRTY_TILE_SIZE - 1 ) >> DIRTY_TILE_SHIFT;
+
+		for ( Integer y = yMin; y < yEnd; ++y )
+		{
+			for ( Integer x = xMin; x < xEnd; ++x )
+			{
+				Byte & tile = m_tiles[ y * m_nCols + x ];
+				m_nMarked += ( tile == 0 );
+				tile = 1;
+			}
+		}
+	}
+	void			DirtyRegion::Merge(const DirtyRegion & other)
+	{
+		ASSERT(other.m_nCols == m_nCols && other.m_nRows == m_nRows);
+
+		m_nMarked = 0;
+		for ( size_t i = 0; i < m_tiles.size(); ++i )
+		{
+			m_tiles[ i ] |= other.m_tiles[ i ];
+			m_nMarked += m_tiles[ i ];
+		}
+	}
+	void			DirtyRegion::GetRects(std::vector<Rect> * pRects) const
+	{
+		pRects->clear();
+
+		size_t iRowAbove = 0;	// first rect of the row above
+		for ( Integer y = 0; y < m_nRows; ++y )
+		{
+			size_t iRow = pRects->size();
+			size_t iAbove = iRowAbove;
+
+			for ( Integer x = 0; x < m_nCols; )
+			{
+				if ( !m_tiles[ y * m_nCols + x ] )
+				{
+					++x;
+					continue;
+				}
+
+				Integer xEnd = x + 1;
+				while ( xEnd < m_nCols && m_tiles[ y * m_nCols + xEnd ] )
+				{
+					++xEnd;
+				}
+
+				Rect run =
+				{
+					x << DIRTY_TILE_SHIFT,
+					Min(xEnd << DIRTY_TILE_SHIFT, m_width),
+					y << DIRTY_TILE_SHIFT,
+					Min(( y + 1 ) << DIRTY_TILE_SHIFT, m_height),
+				};
+
+				// runs of both rows are sorted by left
+				while ( iAbove < iRow && ( *pRects )[ iAbove ].left < run.left )
+				{
+					++iAbove;
+				}
+				if ( iAbove < iRow &&
+				     ( *pRects )[ iAbove ].left == run.left &&
+				     ( *pRects )[ iAbove ].right == run.right &&
+				     ( *pRects )[ iAbove ].bottom == run.top )
+				{
+					// carried down: move it to this row, keeping the order
+					Rect merged = ( *pRects )[ iAbove ];
+					merged.bottom = run.bottom;
+					pRects->erase(pRects->begin() + iAbove);
+					--iRow;
+					pRects->push_back(merged);
+				}
+				else
+				{
+					pRects->push_back(run);
+				}
+
+				x = xEnd;
+			}
+
+			iRowAbove = iRow;
+		}
+	}
+
 	void			Entity::DrawAll(Entity * pEntity, RenderContext & context, Effect & effect)
 	{
 		ASSERT(pEntity);
@@ -95,18 +222,160 @@ namespace Graphics
 			DrawAll(static_cast< Entity * >( pNode ), context, effect);
 		}
 	}
+	void			Entity::DrawAll(Entity * pEntity, RenderContext & context, Effect & effect, const SceneState & state)
+	{
+		ASSERT(pEntity);
+		effect.CBSetModelTransform(state.GetModelTransform(pEntity));
+		pEntity->Draw(context);
+		for ( TreeNode * pNode = FirstChild(pEntity); pNode; pNode = NextChild(pNode) )
+		{
+			DrawAll(static_cast< Entity * >( pNode ), context, effect, state);
+		}
+	}
+	void			Entity::InvalidateAll(Entity * pEntity, const Matrix44 & viewProj, DirtyRegion & region)
+	{
+		ASSERT(pEntity);
+
+		Rect bounds = {};
+		bool bHasBounds = pEntity->GetScreenBounds(viewProj, region.GetWidth(), region.GetHeight(), &bounds);
+		bool bChanged = pEntity->bDirty ||
+				bHasBounds != pEntity->bHasLastBounds ||
+				memcmp(&pEntity->transform, &pEntity->lastTransform, sizeof(Transform)) != 0 ||
+				memcmp(&bounds, &pEntity->lastBounds, sizeof(Rect)) != 0;
+
+		if ( bChanged )
+		{
+			if ( bHasBounds )
+			{
+				region.Mark(bounds);
+			}
+			else
+			{
+				region.MarkAll();
+			}
+			if ( pEntity->bHasLastBounds )
+			{
+				region.Mark(pEntity->lastBounds);
+			}
+		}
+
+		pEntity->bDirty		= false;
+		pEntity->bHasLastBounds	= bHasBounds;
+		pEntity->lastTransform	= pEntity->transform;
+		pEntity->lastBounds	= bounds;
+
+		for ( TreeNode * pNode = FirstChild(pEntity); pNode; pNode = NextChild(pNode) )
+		{
+			InvalidateAll(static_cast< Entity * >( pNode ), viewProj, region);
+		}
+	}
+	// Raster bounds of the projected box, one pixel of slack. False if
+	// the entity has no box or it crosses the camera plane.
+	bool			Entity::GetScreenBounds(const Matrix44 & viewProj, Integer width, Integer height, Rect * pRect)
+	{
+		Vector3 vMin, vMax;
+		if ( !GetBounds(&vMin, &vMax) )
+		{
+			return false;
+		}
+
+		Matrix44 m	= transform.GetMatrix() * viewProj;
+		f32 xMin	= FLT_MAX;
+		f32 yMin	= FLT_MAX;
+		f32 xMax	= -FLT_MAX;
+		f32 yMax	= -FLT_MAX;
+		for ( Integer i = 0; i < 8; ++i )
+		{
+			Vector4 corner	= { ( i & 1 ) ? vMax.x : vMin.x, ( i & 2 ) ? vMax.y : vMin.y, ( i & 4 ) ? vMax.z : vMin.z, 1.0f };
+			Vector4 clip	= V4Transform(corner, m);
+			if ( clip.w < 1e-4f )
+			{
+				return false;
+			}
+			f32 x	= ( clip.x / clip.w + 1.0f ) * 0.5f * width;
+			f32 y	= ( 1.0f - clip.y / clip.w ) * 0.5f * height;
+			xMin	= Min(xMin, x);
+			yMin	= Min(yMin, y);
+			xMax	= Max(xMax, x);
+			yMax	= Max(yMax, y);
+		}
+
+		*pRect = Rect
+		{
+			Bound<Integer>(0, static_cast< Integer >( floorf(xMin) ) - 1, width),
+			Bound<Integer>(0, static_cast< Integer >( floorf(xMax) ) + 2, width),
+			Bound<Integer>(0, static_cast< Integer >( floorf(yMin) ) - 1, height),
+			Bound<Integer>(0, static_cast< Integer >( floorf(yMax) ) + 2, height),
+		};
+		return true;
+	}
 
 	void			Camera::DrawObservedEntity(RenderContext & context, Effect & effect)
 	{
 		Entity::DrawAll(m_observedEntity, context, effect);
 	}
+	void			Camera::DrawObservedEntity(RenderContext & context, Effect & effect, const SceneState & state)
+	{
+		Entity::DrawAll(m_observedEntity, context, effect, state);
+	}
+
+	SceneState::SceneState()
+		: m_camera(nullptr)
+		, m_iFront(0)
+		, m_bEmpty(true)
+	{
+		m_frames[ 0 ].view = m_frames[ 1 ].view = M44Identity();
+	}
+	void			SceneState::Register(Entity * pRoot)
+	{
+		ASSERT(pRoot);
+		pRoot->iStateSlot = static_cast< Integer >( m_entities.size() );
+		m_entities.push_back(pRoot);
+		for ( TreeNode * pNode = Entity::FirstChild(pRoot); pNode; pNode = Entity::NextChild(pNode) )
+		{
+			Register(static_cast< Entity * >( pNode ));
+		}
+	}
+	void			SceneState::Register(Camera * pCamera)
+	{
+		m_camera = pCamera;
+	}
+	void			SceneState::Capture()
+	{
+		Frame & back = m_frames[ m_iFront ^ 1 ];
+
+		back.models.resize(m_entities.size());
+		for ( size_t i = 0; i < m_entities.size(); ++i )
+		{
+			back.models[ i ] = m_entities[ i ]->transform.GetMatrix();
+		}
+		if ( m_camera )
+		{
+			back.view = m_camera->GetViewTransform();
+		}
+	}
+	void			SceneState::Flip()
+	{
+		m_iFront	^= 1;
+		m_bEmpty	= false;
+	}
+	void			SceneState::LatchView()
+	{
+		if ( m_camera )
+		{
+			m_frames[ m_iFront ].view = m_camera->GetViewTransform();
+		}
+	}
 
 	void			Controller::Initialize(RenderContext & context, VertexBuffer & vertexBuffer)
 	{
 		RenderWindow * pWindow;
 
-		ENSURE_TRUE(
-			static_cast< IUnknown && >( context.GetRenderTarget() ).QueryInterface(&pWindow));
+		// offline renders have no window, and no input
+		if ( !static_cast< IUnknown && >( context.GetRenderTarget() ).QueryInterface(&pWindow) )
+		{
+			return;
+		}
 
 		pWindow->RegisterEventListener(&this->GetOnMouseMoveEventHandler(),
 					       &this->GetOnKeyDownEventHandler(),
@@ -116,7 +385,6 @@ namespace Graphics
 	{
 		const Vector3 up	= { 0.0f, 1.0f, 0.0f };
 		const Vector3 fwd	= { 0.0f, 0.0f, 1.0f };
-		const Vector3 rt	= { 1.0f, 0.0f, 0.0f };
 
 		float hRotRad;
 		float vRotRad;
@@ -176,6 +444,11 @@ namespace Graphics
 			hRotDeg += 0.2f * ( args.pixelX - pixelX );
 			vRotDeg -= 0.2f * ( args.pixelY - pixelY );
 			vRotDeg = Bound(-80.0f, vRotDeg, 80.0f);
+
+			// looks at once, for late latching; moves wait for Update
+			transform.rx = -ConvertToRadians(vRotDeg);
+			transform.ry = ConvertToRadians(hRotDeg);
+			ApplyChangeToConnectionTree(this, &transform);
 		}
 		pixelX = args.pixelX;
 		pixelY = args.pixelY;
@@ -215,56 +488,775 @@ namespace Graphics
 		}
 	}
 
-	SceneRenderer::SceneRenderer(RenderWindow & window) : m_window(window)
+	SortLastRenderer::SortLastRenderer(Device & device, RenderContext & context, Integer nPartitions)
+	{
+		ASSERT(nPartitions >= 1);
+
+		m_contexts.reserve(nPartitions);
+		m_contexts.emplace_back(context);
+		for ( Integer i = 1; i < nPartitions; ++i )
+		{
+			m_contexts.emplace_back(device.CreatePrivateContext(context));
+		}
+	}
+	void			SortLastRenderer::Draw(const DrawFunc & drawPartition)
+	{
+		std::vector<std::thread> threads;
+
+		threads.reserve(m_contexts.size() - 1);
+		for ( Integer i = 1; i < PartitionCount(); ++i )
+		{
+			threads.emplace_back([ this, i, &drawPartition ] ()
+			{
+				m_contexts[ i ].GetDepthStencilBuffer().ResetDepthBuffer();
+				drawPartition(i, m_contexts[ i ]);
+			});
+		}
+		drawPartition(0, m_contexts[ 0 ]);
+
+		for ( std::thread & t : threads )
+		{
+			t.join();
+		}
+
+		// private color is never cleared, its depth is 1.0 wherever
+		// nothing was drawn so it never wins
+		for ( Integer i = 1; i < PartitionCount(); ++i )
+		{
+			m_contexts[ 0 ].CompositeByDepth(m_contexts[ i ]);
+		}
+	}
+
+	// radical inverse of i in base, in [0, 1)
+	static float		Halton(Integer i, Integer base)
+	{
+		float f = 1.0f;
+		float r = 0.0f;
+		for ( ; i > 0; i /= base )
+		{
+			f /= base;
+			r += f * ( i % base );
+		}
+		return r;
+	}
+
+	namespace
+	{
+		// Controllers find the window, for its input, through the render
+		// target, so a ring stands in for it without hiding it.
+		class RingTarget : public IUnknown
+		{
+		public:
+			RingTarget(FrameRing & ring, RenderWindow & window)
+				: m_ring(ring)
+				, m_window(window)
+			{
+			}
+			virtual bool		QueryInterface(Integer iid, void ** ppvObject) override
+			{
+				return m_ring.QueryInterface(iid, ppvObject) || m_window.QueryInterface(iid, ppvObject);
+			}
+
+		private:
+			FrameRing &		m_ring;
+			RenderWindow &		m_window;
+		};
+	}
+
+	SceneRenderer::SceneRenderer(RenderWindow & window, FrameRing * pRing) : m_window(window)
+		, m_dFrameBudget(0.0)
+		, m_dScale(1.0)
+		, m_dError { 0.0, 0.0 }
+		, m_iTickFrameBegin(0)
+		, m_iTickPresentCost(0)
+		, m_bTemporal(false)
+		, m_bHasViewProj(false)
+		, m_bHasPrevViewProj(false)
+		, m_iJitter(0)
+		, m_jitter { 0.0f, 0.0f }
+		, m_nMaxLatency(0)
+		, m_bDirtyRendering(false)
+		, m_nFullFrames(0)
+		, m_iDirty(0)
+		, m_bLateLatching(false)
+		, m_iTickInput(-1)
+		, m_nLatencyFrames(0)
+		, m_iLatencySum(0)
+		, m_iLatencyMax(0)
+		, m_dUpdateMs(0.0)
+		, m_bUpdatePending(false)
+		, m_bUpdateStop(false)
+		, m_bUpdateQueued(false)
 		, m_scene(nullptr)
 	{
-		RenderTarget target;
 		Rect rect;
 
 		m_device		= Device::Default();
 
 		rect			= Rect { 0, m_window.GetWidth(), 0, m_window.GetHeight() };
-		target			= m_device.CreateRenderTarget(&m_window, rect);
+		if ( pRing )
+		{
+			m_ringTarget.reset(new RingTarget(*pRing, m_window));
+		}
+		m_target		= m_device.CreateRenderTarget(pRing ? m_ringTarget.get() : &m_window, rect);
+		m_viewport		= m_device.CreateRenderTarget(m_target, rect);
 
 		m_context		= m_device.CreateRenderContext();
-		m_swapChain		= m_device.CreateSwapChain(target);
-		m_depthStencilBuffer	= m_device.CreateDepthStencilBuffer(target.GetWidth(), target.GetHeight());
+		m_swapChain		= m_device.CreateSwapChain(m_target, BufferLayout::TILED, SCENE_SWAP_CHAIN_BUFFERS, true);
+		m_depthStencilBuffer	= m_device.CreateDepthStencilBuffer(m_target.GetWidth(), m_target.GetHeight(), BufferLayout::TILED);
 
 		m_context.SetSwapChain(m_swapChain);
 		m_context.SetDepthStencilBuffer(m_depthStencilBuffer);
-		m_context.SetRenderTarget(target);
+		m_context.SetRenderTarget(m_viewport);
+
+		for ( DirtyRegion & dirty : m_dirty )
+		{
+			dirty.Resize(m_target.GetWidth(), m_target.GetHeight());
+		}
+		m_redraw.Resize(m_target.GetWidth(), m_target.GetHeight());
+	}
+	SceneRenderer::~SceneRenderer()
+	{
+		StopUpdate();
+		m_window.SetInputQueued(false);
+
+		// queued presents still write to the window, captured frames to files
+		m_swapChain.GetFence().Wait(m_swapChain.GetFrameCount());
+		m_swapChain.SetOutput(nullptr);
+	}
+	void			SceneRenderer::SetFrameBudget(double ms)
+	{
+		m_dFrameBudget	= ms;
+		m_dScale	= 1.0;
+		m_dError[ 0 ]	= m_dError[ 1 ] = 0.0;
+		m_viewport.SetRect(m_target.GetRect());
+	}
+	void			SceneRenderer::SetTemporalUpsampling(bool bEnable)
+	{
+		m_bTemporal		= bEnable;
+		m_bHasViewProj		= false;
+		m_bHasPrevViewProj	= false;
+		m_viewport.SetRect(m_target.GetRect());
+	}
+	void			SceneRenderer::SetDirtyRendering(bool bEnable)
+	{
+		m_bDirtyRendering	= bEnable;
+		m_nFullFrames		= SCENE_SWAP_CHAIN_BUFFERS;
+		m_viewport.SetRect(m_target.GetRect());
+		m_presentRects.clear();
+	}
+	void			SceneRenderer::SetMaxFrameLatency(Integer nFrames)
+	{
+		m_nMaxLatency = nFrames;
+	}
+	bool			SceneRenderer::SetOutput(const FrameOutputDesc * pDesc)
+	{
+		return m_swapChain.SetOutput(pDesc);
+	}
+	void			SceneRenderer::SetLateLatching(bool bEnable)
+	{
+		m_bLateLatching		= bEnable;
+		m_iTickInput		= -1;
+		m_nLatencyFrames	= 0;
+		m_iLatencySum		= 0;
+		m_iLatencyMax		= 0;
+		m_latchedFrames.clear();
+		m_window.SetInputQueued(bEnable);
+	}
+	InputLatency		SceneRenderer::GetInputLatency() const
+	{
+		InputLatency latency;
+
+		// ticks are microseconds
+		latency.nFrames		= m_nLatencyFrames;
+		latency.msAverage	= m_nLatencyFrames ? m_iLatencySum * 0.001 / m_nLatencyFrames : 0.0;
+		latency.msMax		= m_iLatencyMax * 0.001;
+		latency.nDropped	= m_window.GetDroppedInputCount();
+		return latency;
+	}
+	// Cost is roughly linear in pixels, so the error is taken on the side
+	// scale that would have met the budget: sqrt(budget / cost) - 1.
+	void			SceneRenderer::UpdateScale(double msCost)
+	{
+		double error = sqrt(m_dFrameBudget / Max(msCost, 0.001)) - 1.0;
+
+		// incremental form, no integral to wind up while clamped
+		m_dScale += DYNAMIC_RES_KP * ( error - m_dError[ 0 ] ) +
+			    DYNAMIC_RES_KI * error +
+			    DYNAMIC_RES_KD * ( error - 2.0 * m_dError[ 0 ] + m_dError[ 1 ] );
+		m_dScale = Bound(DYNAMIC_RES_SCALE_MIN, m_dScale, 1.0);
+
+		m_dError[ 1 ] = m_dError[ 0 ];
+		m_dError[ 0 ] = error;
 	}
 	void			SceneRenderer::SwitchScene(IScene & scene)
 	{
+		StopUpdate();
 		if ( m_scene )
 		{
 			m_scene->OnUnload();
 		}
 		m_scene = &scene;
 		m_scene->OnLoad(m_device, m_context);
+
+		m_bHasViewProj		= false;
+		m_bHasPrevViewProj	= false;
+		m_nFullFrames		= SCENE_SWAP_CHAIN_BUFFERS;
 	}
 	void			SceneRenderer::Present()
 	{
-		m_swapChain.Swap();
+		int64_t iTickBegin = NativeGetTick();
+
+		if ( m_bDirtyRendering )
+		{
+			m_swapChain.Swap(m_presentRects.data(), static_cast< Integer >( m_presentRects.size() ));
+		}
+		else if ( m_bTemporal && m_bHasViewProj )
+		{
+			TemporalDesc desc;
+
+			desc.viewProj		= m_viewProj;
+			desc.prevViewProj	= m_bHasPrevViewProj ? m_prevViewProj : m_viewProj;
+			desc.jitter		= m_jitter;
+			desc.bReset		= !m_bHasPrevViewProj;
+			m_swapChain.SwapTemporal(m_viewport.GetRect(), m_depthStencilBuffer, desc);
+
+			m_prevViewProj		= m_viewProj;
+			m_bHasPrevViewProj	= true;
+		}
+		else if ( m_bTemporal || m_dFrameBudget > 0.0 )
+		{
+			m_swapChain.Swap(m_viewport.GetRect());
+		}
+		else
+		{
+			m_swapChain.Swap();
+		}
+
+		u64 nFrames = m_swapChain.GetFrameCount();
+		if ( m_iTickInput >= 0 )
+		{
+			m_latchedFrames.push_back(LatchedFrame { nFrames, m_iTickInput });
+			m_iTickInput = -1;
+		}
+		if ( m_nMaxLatency > 0 && nFrames > static_cast< u64 >( m_nMaxLatency ) )
+		{
+			m_swapChain.GetFence().Wait(nFrames - m_nMaxLatency);
+		}
+		CountLatency();
+
+		m_iTickPresentCost = NativeGetTick() - iTickBegin;
 	}
 	void			SceneRenderer::Clear()
 	{
-		m_swapChain.ResetBackBuffer();
+		m_iTickFrameBegin = NativeGetTick();
+		CountLatency();
+
+		if ( m_bDirtyRendering )
+		{
+			// what to clear is known once the scene updated, see Draw
+			return;
+		}
+		if ( m_bTemporal )
+		{
+			Rect rect = m_target.GetRect();
+			rect.right	= Max<Integer>(1, rect.right / 2);
+			rect.bottom	= Max<Integer>(1, rect.bottom / 2);
+			m_viewport.SetRect(rect);
+
+			m_swapChain.ResetBackBuffer(rect, 0);
+
+			// sub-pixel offset in [-0.5, 0.5) source pixels, y down
+			m_iJitter	= m_iJitter % TEMPORAL_JITTER_COUNT + 1;
+			m_jitter.x	= Halton(m_iJitter, 2) - 0.5f;
+			m_jitter.y	= Halton(m_iJitter, 3) - 0.5f;
+
+			Camera * pCamera = m_scene ? m_scene->GetCamera() : nullptr;
+			if ( pCamera )
+			{
+				pCamera->SetJitter(2.0f * m_jitter.x / rect.right, -2.0f * m_jitter.y / rect.bottom);
+			}
+		}
+		else if ( m_dFrameBudget > 0.0 )
+		{
+			Rect rect = m_target.GetRect();
+			rect.right	= Max<Integer>(1, static_cast< Integer >( rect.right * m_dScale + 0.5 ));
+			rect.bottom	= Max<Integer>(1, static_cast< Integer >( rect.bottom * m_dScale + 0.5 ));
+			m_viewport.SetRect(rect);
+
+			m_swapChain.ResetBackBuffer(rect, 0);
+		}
+		else
+		{
+			m_swapChain.ResetBackBuffer();
+		}
 		//m_swapChain.ResetBackBuffer(Rect { m_window.GetWidth() / 2, m_window.GetWidth(), 0, m_window.GetHeight() }, 50);
 		m_depthStencilBuffer.ResetDepthBuffer();
 	}
 	void			SceneRenderer::Update(double ms)
 	{
+		if ( !m_scene )
+		{
+			return;
+		}
+
+		SceneState * pState = m_scene->GetState();
+		if ( pState && !m_bDirtyRendering )
+		{
+			// Draw starts on frame N right after this, latch into it
+			if ( m_bLateLatching )
+			{
+				LatchInput();
+				pState->LatchView();
+			}
+
+			// frame N+1 while Draw draws frame N, joined there
+			if ( !m_updateThread.joinable() )
+			{
+				m_bUpdateStop	= false;
+				m_updateThread	= std::thread(&SceneRenderer::RunUpdate, this);
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_updateMutex);
+				m_dUpdateMs		= ms;
+				m_bUpdatePending	= true;
+			}
+			m_bUpdateQueued = true;
+			m_cvUpdate.notify_one();
+			return;
+		}
+
+		m_scene->OnUpdate(ms);
+		if ( m_bLateLatching )
+		{
+			LatchInput();
+		}
+		if ( pState )
+		{
+			pState->Capture();
+			pState->Flip();
+		}
+	}
+	void			SceneRenderer::Draw()
+	{
+		if ( m_bDirtyRendering )
+		{
+			JoinUpdate();
+			DrawDirty();
+			return;
+		}
+
+		SceneState * pState = m_scene ? m_scene->GetState() : nullptr;
+		if ( pState && pState->IsEmpty() )
+		{
+			// first frame, nothing to draw meanwhile
+			JoinUpdate();
+		}
+
 		if ( m_scene )
 		{
+			m_scene->OnDraw();
+		}
+
+		if ( m_bTemporal )
+		{
+			Camera * pCamera = m_scene ? m_scene->GetCamera() : nullptr;
+
+			m_bHasViewProj = ( pCamera != nullptr );
+			if ( pCamera )
+			{
+				m_viewProj = ( pState ? pState->GetViewTransform() : pCamera->GetViewTransform() ) * pCamera->GetUnjitteredProjTransform();
+			}
+		}
+
+		JoinUpdate();
+
+		if ( !m_bTemporal && m_dFrameBudget > 0.0 )
+		{
+			// ticks are microseconds
+			UpdateScale(( NativeGetTick() - m_iTickFrameBegin + m_iTickPresentCost ) * 0.001);
+		}
+	}
+	// the sync point of concurrent updates
+	void			SceneRenderer::JoinUpdate()
+	{
+		if ( m_bUpdateQueued )
+		{
+			std::unique_lock<std::mutex> lock(m_updateMutex);
+			m_cvUpdateDone.wait(lock, [ this ] () { return !m_bUpdatePending; });
+			lock.unlock();
+
+			m_bUpdateQueued = false;
+			m_scene->GetState()->Flip();
+		}
+	}
+	// before the scene goes
+	void			SceneRenderer::StopUpdate()
+	{
+		JoinUpdate();
+		if ( m_updateThread.joinable() )
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_updateMutex);
+				m_bUpdateStop = true;
+			}
+			m_cvUpdate.notify_one();
+			m_updateThread.join();
+		}
+	}
+	void			SceneRenderer::RunUpdate()
+	{
+		std::unique_lock<std::mutex> lock(m_updateMutex);
+		for ( ; ; )
+		{
+			m_cvUpdate.wait(lock, [ this ] () { return m_bUpdatePending || m_bUpdateStop; });
+			if ( !m_bUpdatePending )
+			{
+				return;
+			}
+
+			double ms = m_dUpdateMs;
+			lock.unlock();
 			m_scene->OnUpdate(ms);
+			m_scene->GetState()->Capture();
+			lock.lock();
+
+			m_bUpdatePending = false;
+			m_cvUpdateDone.notify_one();
 		}
 	}
-	void			SceneRenderer::Draw()
+	// the update thread must not run
+	void			SceneRenderer::LatchInput()
+	{
+		int64_t iTick = m_window.DispatchInput();
+		if ( iTick >= 0 && m_iTickInput < 0 )
+		{
+			m_iTickInput = iTick;
+		}
+	}
+	void			SceneRenderer::CountLatency()
+	{
+		if ( m_latchedFrames.empty() )
+		{
+			return;
+		}
+
+		u64 nCompleted	= m_swapChain.GetFence().GetCompletedValue();
+		int64_t iTick	= NativeGetTick();
+		while ( !m_latchedFrames.empty() && m_latchedFrames.front().nFrame <= nCompleted )
+		{
+			int64_t iLatency = iTick - m_latchedFrames.front().iTickInput;
+
+			++m_nLatencyFrames;
+			m_iLatencySum	+= iLatency;
+			m_iLatencyMax	= Max(m_iLatencyMax, iLatency);
+			m_latchedFrames.pop_front();
+		}
+	}
+	bool			SceneRenderer::IsAnimated()
+	{
+		return m_scene && m_scene->IsAnimated();
+	}
+	void			SceneRenderer::DrawDirty()
 	{
+		m_iDirty = ( m_iDirty + 1 ) % SCENE_SWAP_CHAIN_BUFFERS;
+
+		DirtyRegion & dirty = m_dirty[ m_iDirty ];
+		dirty.Clear();
+		if ( m_scene )
+		{
+			m_scene->OnInvalidate(dirty);
+		}
+		if ( m_nFullFrames > 0 )
+		{
+			dirty.MarkAll();
+			--m_nFullFrames;
+		}
+
+		// the back buffer last drew SCENE_SWAP_CHAIN_BUFFERS frames ago,
+		// it misses whatever changed since
+		m_redraw = dirty;
+		for ( Integer i = 1; i < SCENE_SWAP_CHAIN_BUFFERS; ++i )
+		{
+			m_redraw.Merge(m_dirty[ ( m_iDirty + i ) % SCENE_SWAP_CHAIN_BUFFERS ]);
+		}
+		m_redraw.GetRects(&m_redrawRects);
+		dirty.GetRects(&m_presentRects);
+
+		if ( m_redrawRects.empty() )
+		{
+			return;
+		}
+
+		for ( const Rect & rect : m_redrawRects )
+		{
+			m_swapChain.ResetBackBuffer(rect, 0);
+			m_depthStencilBuffer.ResetDepthBuffer(rect, 1.0f);
+		}
+
+		m_context.RSSetScissorRects(m_redrawRects.data(), static_cast< Integer >( m_redrawRects.size() ));
 		if ( m_scene )
 		{
 			m_scene->OnDraw();
 		}
+		m_context.RSSetScissorRects(nullptr, 0);
+	}
+
+	// ---------------------------------------------------------------
+	// TiledStillRenderer
+	// ---------------------------------------------------------------
+
+	static bool		_SeekTo(FILE * pFile, u64 nOffset)
+	{
+	#ifdef _WIN32
+		return _fseeki64(pFile, static_cast< __int64 >( nOffset ), SEEK_SET) == 0;
+	#else
+		return fseeko(pFile, static_cast< off_t >( nOffset ), SEEK_SET) == 0;
+	#endif
+	}
+	static inline void	_WriteLE(u8 * p, u32 value, Integer nBytes)
+	{
+		for ( Integer i = 0; i < nBytes; ++i )
+		{
+			p[ i ] = static_cast< u8 >( value >> ( 8 * i ) );
+		}
+	}
+	// 24-bit BMP: bottom-up, rows padded to 4 bytes
+	#define BMP_HEADER_SIZE (54)
+
+	static inline u64	_BmpRowStride(Integer nWidth)
+	{
+		return ( static_cast< u64 >( nWidth ) * 3 + 3 ) & ~3ull;
+	}
+	static bool		_WriteBmpHeader(FILE * pFile, Integer nWidth, Integer nHeight)
+	{
+		const u64 nImageSize	= _BmpRowStride(nWidth) * nHeight;
+		if ( BMP_HEADER_SIZE + nImageSize > 0xffffffffull )
+		{
+			return false;
+		}
+
+		u8 header[ BMP_HEADER_SIZE ] = { 'B', 'M' };
+		_WriteLE(header + 2, static_cast< u32 >( BMP_HEADER_SIZE + nImageSize ), 4);
+		_WriteLE(header + 10, BMP_HEADER_SIZE, 4);
+		_WriteLE(header + 14, 40, 4);
+		_WriteLE(header + 18, static_cast< u32 >( nWidth ), 4);
+		_WriteLE(header + 22, static_cast< u32 >( nHeight ), 4);
+		_WriteLE(header + 26, 1, 2);
+		_WriteLE(header + 28, 24, 2);
+		_WriteLE(header + 34, static_cast< u32 >( nImageSize ), 4);
+		return fwrite(header, 1, sizeof(header), pFile) == sizeof(header);
+	}
+
+	// before the tile buffer is built from it
+	static Integer		_CheckTileSize(Integer nTileSize)
+	{
+		ENSURE_TRUE(nTileSize > 0 && nTileSize <= TILED_STILL_MAX_TILE_SIZE);
+		return nTileSize;
+	}
+
+	TiledStillRenderer::TiledStillRenderer(Integer nTileSize)
+		: m_nTileSize(_CheckTileSize(nTileSize))
+		, m_tile(m_nTileSize, m_nTileSize, 3, 4, ( 4 - ( ( m_nTileSize * 3 ) & 0x3 ) ) & 0x3)
+	{
+		Rect rect { 0, nTileSize, 0, nTileSize };
+
+		m_device		= Device::Default();
+
+		m_target		= m_device.CreateRenderTarget(&m_tile, rect);
+		m_context		= m_device.CreateRenderContext();
+		m_swapChain		= m_device.CreateSwapChain(m_target, BufferLayout::TILED, 2, false);
+		m_depthStencilBuffer	= m_device.CreateDepthStencilBuffer(nTileSize, nTileSize, BufferLayout::TILED);
+
+		m_context.SetSwapChain(m_swapChain);
+		m_context.SetDepthStencilBuffer(m_depthStencilBuffer);
+		m_context.SetRenderTarget(m_target);
+	}
+	bool			TiledStillRenderer::Render(IScene & scene, Integer nWidth, Integer nHeight, const char * pPath)
+	{
+		ASSERT(nWidth > 0 && nHeight > 0);
+
+		scene.OnLoad(m_device, m_context);
+
+		Camera * pCamera = scene.GetCamera();
+		if ( !pCamera )
+		{
+			scene.OnUnload();
+			return false;
+		}
+		pCamera->SetAspectRatio(static_cast< float >( nWidth ) / nHeight);
+
+		scene.OnUpdate(0.0);
+		if ( SceneState * pState = scene.GetState() )
+		{
+			pState->Capture();
+			pState->Flip();
+		}
+
+		bool bWritten	= false;
+		FILE * pFile	= fopen(pPath, "wb");
+		if ( pFile )
+		{
+			bWritten = WriteTiles(scene, pCamera, pFile, nWidth, nHeight);
+			bWritten = fclose(pFile) == 0 && bWritten;
+		}
+
+		pCamera->SetViewWindow(-1.0f, 1.0f, -1.0f, 1.0f);
+		scene.OnUnload();
+
+		return bWritten;
+	}
+	bool			TiledStillRenderer::WriteTiles(IScene & scene, Camera * pCamera, FILE * pFile, Integer nWidth, Integer nHeight)
+	{
+		const u64 nRowStride	= _BmpRowStride(nWidth);
+		const u64 nImageSize	= nRowStride * nHeight;
+
+		if ( !_WriteBmpHeader(pFile, nWidth, nHeight) )
+		{
+			return false;
+		}
+
+		// the whole file up front, row padding reads as zero
+		const u8 zero = 0;
+		if ( !_SeekTo(pFile, BMP_HEADER_SIZE + nImageSize - 1) || fwrite(&zero, 1, 1, pFile) != 1 )
+		{
+			return false;
+		}
+
+		const Integer T = m_nTileSize;
+		for ( Integer y0 = 0; y0 < nHeight; y0 += T )
+		{
+			for ( Integer x0 = 0; x0 < nWidth; x0 += T )
+			{
+				// the full tile, edge tiles keep only what is inside
+				pCamera->SetViewWindow(-1.0f + 2.0f * x0 / nWidth,
+						       -1.0f + 2.0f * ( x0 + T ) / nWidth,
+						       1.0f - 2.0f * ( y0 + T ) / nHeight,
+						       1.0f - 2.0f * y0 / nHeight);
+
+				m_swapChain.ResetBackBuffer(0);
+				m_depthStencilBuffer.ResetDepthBuffer(1.0f);
+				scene.OnDraw();
+				m_swapChain.Swap();
+
+				const Integer nCols	= std::min(T, nWidth - x0);
+				const Integer nRows	= std::min(T, nHeight - y0);
+				BufferRect rect		= m_tile.GetBufferRect();
+				for ( Integer y = 0; y < nRows; ++y )
+				{
+					const u64 iRow = static_cast< u64 >( nHeight - 1 - ( y0 + y ) );
+					if ( !_SeekTo(pFile, BMP_HEADER_SIZE + iRow * nRowStride + static_cast< u64 >( x0 ) * 3) ||
+					     fwrite(rect.pData + y * rect.nRStride, 3, nCols, pFile) != static_cast< size_t >( nCols ) )
+					{
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+	// ---------------------------------------------------------------
+	// BatchRenderer
+	// ---------------------------------------------------------------
+
+	BatchRenderer::BatchRenderer(Integer nWidth, Integer nHeight, Integer nWorkers)
+		: m_nWidth(nWidth)
+		, m_nHeight(nHeight)
+		, m_nWorkers(nWorkers > 0 ? nWorkers : Max< Integer >(1, std::thread::hardware_concurrency()))
+	{
+		ASSERT(nWidth > 0 && nHeight > 0);
+	}
+	Integer			BatchRenderer::Render(const SceneFactory & createScene, const std::vector<BatchView> & views)
+	{
+		std::atomic<size_t> iNext(0);
+		std::atomic<Integer> nFailed(0);
+		std::vector<std::thread> threads;
+
+		const Integer nThreads = Min< Integer >(m_nWorkers, static_cast< Integer >( views.size() ));
+
+		threads.reserve(nThreads);
+		for ( Integer i = 0; i < nThreads; ++i )
+		{
+			threads.emplace_back(&BatchRenderer::RunWorker, this, std::cref(createScene), std::cref(views), &iNext, &nFailed);
+		}
+		for ( std::thread & t : threads )
+		{
+			t.join();
+		}
+		return nFailed;
+	}
+	void			BatchRenderer::RunWorker(const SceneFactory & createScene, const std::vector<BatchView> & views, std::atomic<size_t> * pNext, std::atomic<Integer> * pFailed)
+	{
+		Rect rect { 0, m_nWidth, 0, m_nHeight };
+		Buffer frame(m_nWidth, m_nHeight, 3, 4, ( 4 - ( ( m_nWidth * 3 ) & 0x3 ) ) & 0x3);
+
+		Device device				= Device::Create();
+		RenderTarget target			= device.CreateRenderTarget(&frame, rect);
+		RenderContext context			= device.CreateRenderContext();
+		SwapChain swapChain			= device.CreateSwapChain(target, BufferLayout::TILED, 2, false);
+		DepthStencilBuffer depthStencilBuffer	= device.CreateDepthStencilBuffer(m_nWidth, m_nHeight, BufferLayout::TILED);
+
+		context.SetSwapChain(swapChain);
+		context.SetDepthStencilBuffer(depthStencilBuffer);
+		context.SetRenderTarget(target);
+
+		Ptr<IScene> scene = createScene();
+		scene->OnLoad(device, context);
+
+		Camera * pCamera = scene->GetCamera();
+
+		for ( size_t i; ( i = pNext->fetch_add(1, std::memory_order_relaxed) ) < views.size(); )
+		{
+			if ( !pCamera )
+			{
+				pFailed->fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			// the camera may follow a controller, the view has the last word
+			scene->OnUpdate(0.0);
+			pCamera->transform = views[ i ].camera;
+			if ( SceneState * pState = scene->GetState() )
+			{
+				pState->Capture();
+				pState->Flip();
+			}
+
+			swapChain.ResetBackBuffer(0);
+			depthStencilBuffer.ResetDepthBuffer(1.0f);
+			scene->OnDraw();
+			swapChain.Swap();
+
+			if ( !WriteView(frame.GetBufferRect(), views[ i ].path.c_str()) )
+			{
+				pFailed->fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		scene->OnUnload();
+
+		// scenes hold device handles
+		scene.reset();
+		Device::Destroy(device);
+	}
+	bool			BatchRenderer::WriteView(const BufferRect & brFrame, const char * pPath)
+	{
+		const u64 nRowStride	= _BmpRowStride(m_nWidth);
+		const u64 nRowBytes	= static_cast< u64 >( m_nWidth ) * 3;
+		const u8 padding[ 4 ]	= {};
+
+		FILE * pFile = fopen(pPath, "wb");
+		if ( !pFile )
+		{
+			return false;
+		}
+
+		bool bWritten = _WriteBmpHeader(pFile, m_nWidth, m_nHeight);
+		for ( Integer y = m_nHeight - 1; bWritten && y >= 0; --y )
+		{
+			bWritten = fwrite(brFrame.pData + y * brFrame.nRStride, 1, nRowBytes, pFile) == nRowBytes &&
+				   fwrite(padding, 1, nRowStride - nRowBytes, pFile) == nRowStride - nRowBytes;
+		}
+		return fclose(pFile) == 0 && bWritten;
 	}
 }
\ No newline at end of file
@@ -5,6 +5,15 @@
 #include "RenderWindow.h"
 #include "VisualEffects.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
 namespace Graphics
 {
 	struct TreeNode
@@ -157,13 +166,84 @@ namespace Graphics
 		static void		ApplyChangeToConnectionTree(SceneObject * pRootObject, Transform * pSourceTransform);
 	};
 
+	// Screen tiles that changed since the last frame. Tiles are the
+	// tiled layout's, so a tiled swap chain presents them whole.
+	#define DIRTY_TILE_SHIFT	(BUFFER_TILE_SHIFT)
+	#define DIRTY_TILE_SIZE		(1 << DIRTY_TILE_SHIFT)
+
+	class DirtyRegion
+	{
+	public:
+		DirtyRegion();
+
+		void			Resize(Integer width, Integer height);	// clears
+		void			Clear();
+		void			MarkAll();
+		void			Mark(const Rect & rect);	// clipped to the screen
+		void			Merge(const DirtyRegion & other);
+
+		Integer			GetWidth() const
+		{
+			return m_width;
+		}
+		Integer			GetHeight() const
+		{
+			return m_height;
+		}
+		bool			IsEmpty() const
+		{
+			return m_nMarked == 0;
+		}
+		// runs of marked tiles per tile row, runs equal to the ones of
+		// the row above are merged into them
+		void			GetRects(std::vector<Rect> * pRects) const;
+
+	private:
+		Integer			m_width;
+		Integer			m_height;
+		Integer			m_nCols;
+		Integer			m_nRows;
+		Integer			m_nMarked;
+		std::vector<Byte>	m_tiles;
+	};
+
+	class SceneState;
+
 	struct Entity : SceneObject
 	{
 		virtual void		Draw(RenderContext & context)
 		{
 		}
+		// Local box around what Draw renders, false if unknown: a change
+		// then dirties the whole screen.
+		virtual bool		GetBounds(Vector3 * pMin, Vector3 * pMax)
+		{
+			return false;
+		}
+		// Material or geometry changed. Transforms are compared by value,
+		// no need to mark those.
+		void			MarkDirty()
+		{
+			bDirty = true;
+		}
 
 		static void		DrawAll(Entity * pEntity, RenderContext & context, Effect & effect);
+		// model transforms from the front copy of state
+		static void		DrawAll(Entity * pEntity, RenderContext & context, Effect & effect, const SceneState & state);
+		// Marks where changed entities were at the last call and where
+		// they are now.
+		static void		InvalidateAll(Entity * pEntity, const Matrix44 & viewProj, DirtyRegion & region);
+
+	private:
+		friend class SceneState;
+
+		bool			GetScreenBounds(const Matrix44 & viewProj, Integer width, Integer height, Rect * pRect);
+
+		Integer			iStateSlot = 0;
+		bool			bDirty = true;
+		bool			bHasLastBounds = false;
+		Transform		lastTransform = Transform::Identity();
+		Rect			lastBounds = {};
 	};
 
 	struct Light : Entity
@@ -203,6 +283,8 @@ namespace Graphics
 			: m_context(nullptr)
 			, m_observedEntity(nullptr)
 			, m_aspectRatio(1.6f)
+			, m_jitter { 0.0f, 0.0f }
+			, m_window { -1.0f, 1.0f, -1.0f, 1.0f }
 		{
 		}
 
@@ -216,6 +298,7 @@ namespace Graphics
 			m_observedEntity	= pEntity;
 		}
 		void			DrawObservedEntity(RenderContext & context, Effect & effect);
+		void			DrawObservedEntity(RenderContext & context, Effect & effect, const SceneState & state);
 
 		void			SetAspectRatio(float value)
 		{
@@ -225,18 +308,44 @@ namespace Graphics
 		{
 			return transform.GetInvertedMatrix();
 		}
+		// sub-pixel offset of the projection, in NDC
+		void			SetJitter(float x, float y)
+		{
+			m_jitter		= Vector2 { x, y };
+		}
+		// The part of the view the projection covers, in NDC of the
+		// whole view, e.g. a tile of a still. Defaults to all of it.
+		void			SetViewWindow(float left, float right, float bottom, float top)
+		{
+			m_window[ 0 ]		= left;
+			m_window[ 1 ]		= right;
+			m_window[ 2 ]		= bottom;
+			m_window[ 3 ]		= top;
+		}
 		Matrix44		GetProjTransform()
 		{
-			return M44PerspectiveFovLH(ConvertToRadians(90),
-						   m_aspectRatio,
-						   0.1f,
-						   1000.0f);
+			// clip space translation by jitter * w, so NDC moves by jitter
+			return GetUnjitteredProjTransform() * M44Translation(m_jitter.x, m_jitter.y, 0.0f);
+		}
+		Matrix44		GetUnjitteredProjTransform()
+		{
+			// 90 degrees vertical fov
+			const float fNearZ	= 0.1f;
+			const float fFarZ	= 1000.0f;
+			const float h		= fNearZ;
+			const float w		= h * m_aspectRatio;
+			return M44PerspectiveOffCenterLH(w * m_window[ 0 ], w * m_window[ 1 ],
+							 h * m_window[ 2 ], h * m_window[ 3 ],
+							 fNearZ,
+							 fFarZ);
 		}
 
 	private:
 		RenderContext *		m_context;
 		Entity *		m_observedEntity;
 		float			m_aspectRatio;
+		Vector2			m_jitter;
+		float			m_window[ 4 ];	// left, right, bottom, top
 	};
 
 	struct EntityGroup : Entity
@@ -251,6 +360,82 @@ namespace Graphics
 	{
 	};
 
+	// What a frame draws with, double-buffered so a scene can update frame
+	// N+1 while frame N draws: Capture copies the transforms of what was
+	// registered into compact arrays of the back copy, draws read the
+	// front copy, Flip swaps the two at a point where neither side runs.
+	class SceneState
+	{
+	public:
+		SceneState();
+
+		// load time, gives every entity of the tree a slot
+		void			Register(Entity * pRoot);
+		void			Register(Camera * pCamera);
+
+		// update side
+		void			Capture();
+		void			Flip();
+		// The camera's view as it is now into the front copy, for input
+		// that came in after the capture. Not while an update runs.
+		void			LatchView();
+
+		// draw side
+		bool			IsEmpty() const	// nothing flipped to the front yet
+		{
+			return m_bEmpty;
+		}
+		const Matrix44 &	GetModelTransform(const Entity * pEntity) const
+		{
+			return m_frames[ m_iFront ].models[ pEntity->iStateSlot ];
+		}
+		const Matrix44 &	GetViewTransform() const
+		{
+			return m_frames[ m_iFront ].view;
+		}
+
+	private:
+		struct Frame
+		{
+			std::vector<Matrix44>	models;	// by entity slot
+			Matrix44		view;
+		};
+
+		std::vector<Entity *>	m_entities;	// by slot
+		Camera *		m_camera;
+		Frame			m_frames[ 2 ];
+		Integer			m_iFront;
+		bool			m_bEmpty;
+	};
+
+
+	// Sort-last parallel rendering: partition 0 draws into the scene
+	// context, every other partition on its own thread into a private
+	// context, then the private targets are depth composited into the
+	// scene context's back buffer. Scales with geometry, not screen area.
+	class SortLastRenderer
+	{
+	public:
+		typedef std::function<void (Integer iPartition, RenderContext & context)> DrawFunc;
+
+		SortLastRenderer(Device & device, RenderContext & context, Integer nPartitions);
+
+		Integer			PartitionCount() const
+		{
+			return static_cast< Integer >( m_contexts.size() );
+		}
+		RenderContext &		GetContext(Integer iPartition)
+		{
+			return m_contexts[ iPartition ];
+		}
+
+		// drawPartition runs concurrently: partitions must not share
+		// effects or other mutable state
+		void			Draw(const DrawFunc & drawPartition);
+
+	private:
+		std::vector<RenderContext>	m_contexts;
+	};
 
 	class IScene
 	{
@@ -260,30 +445,235 @@ namespace Graphics
 		virtual void		OnUnload() = 0;
 		virtual void		OnUpdate(double ms) = 0;
 		virtual void		OnDraw() = 0;
+		// something moves on its own, see RenderOnDemandLoop
+		virtual bool		IsAnimated()
+		{
+			return true;
+		}
+		// the camera temporal upsampling jitters, if any
+		virtual Camera *	GetCamera()
+		{
+			return nullptr;
+		}
+		// What OnDraw reads, if the scene keeps it in a SceneState:
+		// OnUpdate and a capture then run on another thread while the
+		// last capture draws. OnDraw must read nothing else OnUpdate writes.
+		virtual SceneState *	GetState()
+		{
+			return nullptr;
+		}
+		// Marks what changed on screen since the last call, see
+		// SceneRenderer::SetDirtyRendering. By default everything does.
+		virtual void		OnInvalidate(DirtyRegion & region)
+		{
+			region.MarkAll();
+		}
 	};
 
+	#define SCENE_SWAP_CHAIN_BUFFERS (3) // one drawn, up to two queued for presenting
+
+	// Input-to-present latency of the frames that had input: from when
+	// the window got the oldest input a frame drew with, to when the
+	// renderer saw the frame's present done (at the next Clear or Present).
+	struct InputLatency
+	{
+		u64			nFrames;
+		double			msAverage;
+		double			msMax;
+		u64			nDropped;	// input events the window's queue had no room for
+	};
+
+	class FrameRing;
+
 	class SceneRenderer : public IRenderer
 	{
 	public:
-		SceneRenderer(RenderWindow & window);
+		// Presents into pRing, of the window's size, if set. The window
+		// still takes the input.
+		SceneRenderer(RenderWindow & window, FrameRing * pRing = nullptr);
+		~SceneRenderer();
+
+		// Scenes with a SceneState update frame N+1 concurrently with the
+		// draw of frame N and flip at the end of Draw, one frame behind.
+		// With dirty rendering they update in turn.
 
 		void			SwitchScene(IScene & scene);
 
+		// Dynamic resolution: with a budget, the context renders into a
+		// top-left sub-rect of the swap chain, scaled so the frame cost
+		// (clear to draw, plus present) holds the budget, and present
+		// stretches it over the window. Render targets the scene makes
+		// itself don't scale. 0 renders at full size.
+		void			SetFrameBudget(double ms);
+		// Temporal upsampling: the context renders half size into the
+		// top-left of the swap chain with the scene camera jittered, and
+		// present accumulates the frames at full size, see
+		// SwapChain::SwapTemporal. Takes over from a frame budget.
+		void			SetTemporalUpsampling(bool bEnable);
+		// Dirty-region rendering: only the tiles the scene invalidates,
+		// plus those of the frames since the back buffer last drew, are
+		// cleared, drawn (scissored) and presented. An idle frame costs
+		// next to nothing. Takes over from the two modes above.
+		void			SetDirtyRendering(bool bEnable);
+		// Presents run on their own thread while the next frame draws.
+		// Caps the frames queued ahead of the screen when a Present
+		// returns, 0 leaves it to the swap chain (one less than buffers).
+		void			SetMaxFrameLatency(Integer nFrames);
+		// Encodes every presented frame to files, see SwapChain::SetOutput.
+		// The window size, after any scaling. nullptr stops.
+		bool			SetOutput(const FrameOutputDesc * pDesc);
+		// Late latching: input is read on the window's input thread and
+		// queued as it comes, then handed to the scene right before the
+		// frame rasterizes, with whatever came in meanwhile. A scene with
+		// a SceneState draws the frame with the latched camera, not the
+		// next one.
+		void			SetLateLatching(bool bEnable);
+		// since late latching was enabled
+		InputLatency		GetInputLatency() const;
+
 		virtual void		Present() override;
 		virtual void		Clear() override;
 		virtual void		Update(double ms) override;
 		virtual void		Draw() override;
+		virtual bool		IsAnimated() override;
 
 		// TODO: handle window resize
 
 	private:
+		void			UpdateScale(double msCost);
+		void			DrawDirty();
+		void			JoinUpdate();
+		void			StopUpdate();
+		void			RunUpdate();
+		void			LatchInput();
+		void			CountLatency();
+
 		RenderWindow &		m_window;
+		Ptr<IUnknown>		m_ringTarget;	// the ring, answering for the window too
 
 		Device			m_device;
 		SwapChain		m_swapChain;
 		RenderContext		m_context;
 		DepthStencilBuffer	m_depthStencilBuffer;
+		RenderTarget		m_target;	// whole window
+		RenderTarget		m_viewport;	// what the context draws into
+
+		double			m_dFrameBudget;
+		double			m_dScale;
+		double			m_dError[ 2 ];	// last two frames, for the incremental PID
+		int64_t			m_iTickFrameBegin;
+		int64_t			m_iTickPresentCost;
+
+		bool			m_bTemporal;
+		bool			m_bHasViewProj;	// a frame was drawn through the scene camera
+		bool			m_bHasPrevViewProj;
+		Integer			m_iJitter;
+		Vector2			m_jitter;	// of the frame being drawn, source pixels
+		Matrix44		m_viewProj;
+		Matrix44		m_prevViewProj;
+
+		Integer			m_nMaxLatency;
+
+		bool			m_bDirtyRendering;
+		Integer			m_nFullFrames;	// drawn whole, until every buffer is
+		DirtyRegion		m_dirty[ SCENE_SWAP_CHAIN_BUFFERS ];	// ring of the last frames'
+		Integer			m_iDirty;	// this frame's
+		DirtyRegion		m_redraw;
+		std::vector<Rect>	m_redrawRects;
+		std::vector<Rect>	m_presentRects;
+
+		struct LatchedFrame
+		{
+			u64		nFrame;		// swap count
+			int64_t		iTickInput;
+		};
+
+		bool			m_bLateLatching;
+		int64_t			m_iTickInput;	// of the frame drawing, -1 without input
+		std::deque<LatchedFrame>	m_latchedFrames;	// presenting
+		u64			m_nLatencyFrames;
+		int64_t			m_iLatencySum;
+		int64_t			m_iLatencyMax;
+
+		// one update worker per scene, woken each frame
+		std::thread		m_updateThread;
+		std::mutex		m_updateMutex;
+		std::condition_variable	m_cvUpdate;
+		std::condition_variable	m_cvUpdateDone;
+		double			m_dUpdateMs;
+		bool			m_bUpdatePending;	// worker's, under the mutex
+		bool			m_bUpdateStop;
+		bool			m_bUpdateQueued;	// drawing thread's, until the flip
 
 		IScene *		m_scene;
 	};
+
+	#define TILED_STILL_TILE_SIZE (256)
+	#define TILED_STILL_MAX_TILE_SIZE (4096)
+
+	// Stills of any size, without a window: the scene camera's view is cut
+	// into tiles, each drawn through an off-center projection into one
+	// tile-sized color/depth pair and written straight to its place in a
+	// 24-bit BMP. Memory depends on the tile size, not the image.
+	class TiledStillRenderer
+	{
+	public:
+		TiledStillRenderer(Integer nTileSize = TILED_STILL_TILE_SIZE);
+
+		// Loads, updates once and unloads the scene. False if it has no
+		// camera, or the file could not be written, or is over 4 GB.
+		bool			Render(IScene & scene, Integer nWidth, Integer nHeight, const char * pPath);
+
+	private:
+		bool			WriteTiles(IScene & scene, Camera * pCamera, FILE * pFile, Integer nWidth, Integer nHeight);
+
+		Integer			m_nTileSize;
+		Buffer			m_tile;
+
+		Device			m_device;
+		SwapChain		m_swapChain;
+		RenderContext		m_context;
+		DepthStencilBuffer	m_depthStencilBuffer;
+		RenderTarget		m_target;
+	};
+
+	// One view of a batch: the scene camera's transform, and the 24-bit
+	// BMP it goes to.
+	struct BatchView
+	{
+		Transform		camera;
+		std::string		path;
+	};
+
+	// Many views of a scene at once, e.g. for dataset generation. Each
+	// worker thread owns a device (see Device::Create), a target and a
+	// scene of its own, and takes the next view as it finishes one:
+	// nothing is shared, so throughput scales with cores.
+	class BatchRenderer
+	{
+	public:
+		typedef std::function<Ptr<IScene> ()> SceneFactory;
+
+		// nWorkers 0 is one per core
+		BatchRenderer(Integer nWidth, Integer nHeight, Integer nWorkers = 0);
+
+		Integer			WorkerCount() const
+		{
+			return m_nWorkers;
+		}
+
+		// createScene runs once per worker, on its thread. Scenes load,
+		// update once per view and unload. A view that could not be
+		// written, or drawn for want of a camera, doesn't stop the others;
+		// returns how many failed.
+		Integer			Render(const SceneFactory & createScene, const std::vector<BatchView> & views);
+
+	private:
+		void			RunWorker(const SceneFactory & createScene, const std::vector<BatchView> & views, std::atomic<size_t> * pNext, std::atomic<Integer> * pFailed);
+		bool			WriteView(const BufferRect & brFrame, const char * pPath);
+
+		Integer			m_nWidth;
+		Integer			m_nHeight;
+		Integer			m_nWorkers;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,480 @@
+#include "SplitFrame.h"
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace Graphics
+{
+	// Spins a little, then sleeps in short steps: a frame is milliseconds,
+	// and the other side may want this core.
+	template <typename TDone>
+	static void		_WaitUntil(TDone done)
+	{
+		for ( Integer nSpins = 0; !done(); ++nSpins )
+		{
+			if ( nSpins < 64 )
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+		}
+	}
+
+	// ---------------------------------------------------------------
+	// SplitFrameCoordinator
+	// ---------------------------------------------------------------
+
+	SplitFrameCoordinator::SplitFrameCoordinator(RenderWindow & window, const char * pName, Integer nWorkers, const char * const * pWorkerArgs, int nWorkerArgs)
+		: m_window(window)
+		, m_nWorkers(nWorkers)
+		, m_pMemory(nullptr)
+		, m_pHeader(nullptr)
+		, m_ms(0.0)
+		, m_fit { 0.0, 0.0, 0.0, 0.0, 0.0 }
+		, m_msFixed(0.0)
+		, m_nIssued(0)
+		, m_nPresented(0)
+		, m_scene(nullptr)
+	{
+		ASSERT(nWorkers >= 1 && nWorkers <= SPLIT_FRAME_MAX_WORKERS);
+
+		const Integer nWidth	= window.GetWidth();
+		const Integer nHeight	= window.GetHeight();
+		ENSURE_TRUE(nHeight >= nWorkers * SPLIT_FRAME_ROW_ALIGN);
+
+		// the frame starts on its own page
+		const u64 nPage		= 4096;
+		const u64 nOffset	= ( sizeof(SplitFrameHeader) + nPage - 1 ) & ~( nPage - 1 );
+		const u64 nRowStride	= ( static_cast< u64 >( nWidth ) * 3 + 3 ) & ~3ull;
+
+		m_pMemory = NativeSharedMemoryCreate(pName, static_cast< size_t >( nOffset + nRowStride * nHeight ));
+		ENSURE_NOT_NULL(m_pMemory);
+
+		m_pHeader		= new ( NativeSharedMemoryGetData(m_pMemory) ) SplitFrameHeader();
+		m_pHeader->version	= SPLIT_FRAME_VERSION;
+		m_pHeader->nWidth	= static_cast< u32 >( nWidth );
+		m_pHeader->nHeight	= static_cast< u32 >( nHeight );
+		m_pHeader->nRowStride	= static_cast< u32 >( nRowStride );
+		m_pHeader->nWorkers	= static_cast< u32 >( nWorkers );
+		m_pHeader->nFrameOffset	= nOffset;
+		m_pHeader->bQuit	= 0;
+		m_pHeader->nIssued	= 0;
+		for ( SplitFrameWorkerSlot & slot : m_pHeader->workers )
+		{
+			slot.nDone	= 0;
+			slot.msDraw	= 0.0;
+		}
+
+		std::atomic_thread_fence(std::memory_order_release);
+		m_pHeader->magic	= SPLIT_FRAME_MAGIC;
+
+		// even bands until there are timings
+		for ( Integer i = 0; i <= nWorkers; ++i )
+		{
+			m_bands[ i ] = static_cast< u32 >( nHeight * i / nWorkers );
+		}
+		for ( Integer i = 0; i < nWorkers; ++i )
+		{
+			m_msBands[ i ]		= 0.0;
+			m_msAverage[ i ]	= 0.0;
+		}
+
+		std::vector<const char *> args(pWorkerArgs, pWorkerArgs + nWorkerArgs);
+		args.push_back(nullptr);
+		for ( Integer i = 0; i < nWorkers; ++i )
+		{
+			std::string index = std::to_string(i);
+			args.back() = index.c_str();
+
+			NativeProcess * pProcess = NativeProcessSpawnSelf(args.data(), static_cast< int >( args.size() ));
+			ENSURE_NOT_NULL(pProcess);
+			m_processes.push_back(pProcess);
+		}
+
+		Rect rect	= Rect { 0, nWidth, 0, nHeight };
+		m_device	= Device::Default();
+		m_target	= m_device.CreateRenderTarget(&m_window, rect);
+		m_context	= m_device.CreateRenderContext();
+		m_context.SetRenderTarget(m_target);
+	}
+	SplitFrameCoordinator::~SplitFrameCoordinator()
+	{
+		m_pHeader->bQuit.store(1, std::memory_order_release);
+		for ( NativeProcess * pProcess : m_processes )
+		{
+			NativeProcessWait(pProcess);
+		}
+		NativeSharedMemoryClose(m_pMemory);
+	}
+	void			SplitFrameCoordinator::SwitchScene(IScene & scene)
+	{
+		ASSERT(!m_scene);	// the workers load theirs once
+
+		m_scene = &scene;
+		m_scene->OnLoad(m_device, m_context);
+	}
+	Rect			SplitFrameCoordinator::GetBand(Integer iWorker) const
+	{
+		ASSERT(iWorker >= 0 && iWorker < m_nWorkers);
+		return Rect { 0, static_cast< Integer >( m_pHeader->nWidth ), static_cast< Integer >( m_bands[ iWorker ] ), static_cast< Integer >( m_bands[ iWorker + 1 ] ) };
+	}
+	double			SplitFrameCoordinator::GetBandMs(Integer iWorker) const
+	{
+		ASSERT(iWorker >= 0 && iWorker < m_nWorkers);
+		return m_msBands[ iWorker ];
+	}
+	double			SplitFrameCoordinator::GetBandAverageMs(Integer iWorker) const
+	{
+		ASSERT(iWorker >= 0 && iWorker < m_nWorkers);
+		return m_msAverage[ iWorker ];
+	}
+	void			SplitFrameCoordinator::WaitWorkers(u64 nFrame)
+	{
+		for ( Integer i = 0; i < m_nWorkers; ++i )
+		{
+			const SplitFrameWorkerSlot & slot = m_pHeader->workers[ i ];
+			NativeProcess * pProcess = m_processes[ i ];
+
+			_WaitUntil([ &slot, pProcess, nFrame ] ()
+			{
+				if ( slot.nDone.load(std::memory_order_acquire) >= nFrame )
+				{
+					return true;
+				}
+				// a worker that died never finishes
+				ENSURE_TRUE(NativeProcessIsRunning(pProcess));
+				return false;
+			});
+			m_msBands[ i ]		= slot.msDraw;
+			m_msAverage[ i ]	= m_msAverage[ i ] > 0.0 ? m_msAverage[ i ] + SPLIT_FRAME_AVERAGE_BLEND * ( slot.msDraw - m_msAverage[ i ] ) : slot.msDraw;
+		}
+	}
+	// A band costs ms = fixed + rows * slope, least squares over the
+	// bands of the last frames. The fixed part can't move, so it is kept
+	// under the cheapest band: whatever the fit says, rows still cost.
+	void			SplitFrameCoordinator::FitCost()
+	{
+		double msMin = m_msBands[ 0 ];
+
+		for ( double & sum : m_fit )
+		{
+			sum *= SPLIT_FRAME_FIT_DECAY;
+		}
+		for ( Integer i = 0; i < m_nWorkers; ++i )
+		{
+			const double dRows = static_cast< double >( m_bands[ i + 1 ] - m_bands[ i ] );
+
+			m_fit[ 0 ]	+= 1.0;
+			m_fit[ 1 ]	+= dRows;
+			m_fit[ 2 ]	+= m_msBands[ i ];
+			m_fit[ 3 ]	+= dRows * dRows;
+			m_fit[ 4 ]	+= dRows * m_msBands[ i ];
+			msMin		= Min(msMin, m_msBands[ i ]);
+		}
+
+		// even bands, nothing to tell the parts apart yet
+		const double dDet = m_fit[ 0 ] * m_fit[ 3 ] - m_fit[ 1 ] * m_fit[ 1 ];
+		m_msFixed = 0.0;
+		if ( dDet > 1e-6 * m_fit[ 0 ] * m_fit[ 3 ] )
+		{
+			m_msFixed = ( m_fit[ 2 ] * m_fit[ 3 ] - m_fit[ 1 ] * m_fit[ 4 ] ) / dDet;
+		}
+		m_msFixed = Bound(0.0, m_msFixed, 0.75 * msMin);
+	}
+	// Past the fixed part, the cost of a band goes to its steps of rows:
+	// evenly the first time, then scaled to the band's time keeping how
+	// it is spread, halfway, so one noisy frame doesn't swing the edges.
+	// Each edge then goes to the step where every band would cost the
+	// same.
+	void			SplitFrameCoordinator::Balance()
+	{
+		const u32 nHeight	= m_pHeader->nHeight;
+		const u32 nAlign	= SPLIT_FRAME_ROW_ALIGN;
+		const u32 nSteps	= ( nHeight + nAlign - 1 ) / nAlign;
+
+		for ( Integer i = 0; i < m_nWorkers; ++i )
+		{
+			if ( m_msBands[ i ] <= 0.0 )
+			{
+				// no timings yet
+				return;
+			}
+		}
+
+		FitCost();
+
+		// the last step may be short
+		auto stepCost = [ & ] (u32 iStep)
+		{
+			return m_rowCost[ iStep ] * Min(nAlign, nHeight - iStep * nAlign);
+		};
+
+		const bool bFirst = m_rowCost.empty();
+		m_rowCost.resize(nSteps, 0.0);
+		for ( Integer i = 0; i < m_nWorkers; ++i )
+		{
+			const u32 iFirst	= m_bands[ i ] / nAlign;
+			const u32 iEnd		= ( m_bands[ i + 1 ] + nAlign - 1 ) / nAlign;
+			const double dMs	= Max(m_msBands[ i ] - m_msFixed, 1e-3);
+			double dPredicted	= 0.0;
+
+			for ( u32 iStep = iFirst; iStep < iEnd; ++iStep )
+			{
+				dPredicted += stepCost(iStep);
+			}
+			for ( u32 iStep = iFirst; iStep < iEnd; ++iStep )
+			{
+				double & dCost = m_rowCost[ iStep ];
+				if ( bFirst || dPredicted <= 0.0 )
+				{
+					dCost = dMs / ( m_bands[ i + 1 ] - m_bands[ i ] );
+				}
+				else
+				{
+					dCost *= 1.0 + SPLIT_FRAME_ROW_COST_BLEND * ( dMs / dPredicted - 1.0 );
+				}
+			}
+		}
+
+		double dTotal = 0.0;
+		for ( u32 iStep = 0; iStep < nSteps; ++iStep )
+		{
+			dTotal += stepCost(iStep);
+		}
+
+		u32 bands[ SPLIT_FRAME_MAX_WORKERS + 1 ];
+		u32 iStep	= 0;
+		double dBelow	= 0.0;	// cost of the steps before iStep
+
+		bands[ 0 ]		= 0;
+		bands[ m_nWorkers ]	= nHeight;
+		for ( Integer i = 1; i < m_nWorkers; ++i )
+		{
+			// to the nearest step edge
+			const double dTarget = dTotal * i / m_nWorkers;
+			while ( iStep < nSteps && dBelow + 0.5 * stepCost(iStep) < dTarget )
+			{
+				dBelow += stepCost(iStep);
+				++iStep;
+			}
+
+			// at least one step of rows per band
+			u32 edge	= iStep * nAlign;
+			edge		= Max(edge, bands[ i - 1 ] + nAlign);
+			edge		= Min(edge, nHeight - static_cast< u32 >( m_nWorkers - i ) * nAlign);
+			bands[ i ]	= edge;
+		}
+
+		memcpy(m_bands, bands, sizeof(u32) * ( m_nWorkers + 1 ));
+	}
+	void			SplitFrameCoordinator::Present()
+	{
+		if ( m_nPresented == m_nIssued )
+		{
+			return;
+		}
+		WaitWorkers(m_nIssued);
+		m_nPresented = m_nIssued;
+
+		NativeWindow * pWindow	= m_window.GetWindow();
+		const u32 nWidth	= m_pHeader->nWidth;
+		const u32 nHeight	= m_pHeader->nHeight;
+
+		BufferRect brSrc;
+		brSrc.pData	= static_cast< u8 * >( NativeSharedMemoryGetData(m_pMemory) ) + m_pHeader->nFrameOffset;
+		brSrc.nRCount	= nHeight;
+		brSrc.nCCount	= nWidth;
+		brSrc.nRStride	= m_pHeader->nRowStride;
+		brSrc.nCStride	= 3;
+
+		BufferRect brDst;
+		brDst.pData	= static_cast< u8 * >( NativeWindowGetSurface(pWindow) );
+		brDst.nRCount	= nHeight;
+		brDst.nCCount	= nWidth;
+		brDst.nRStride	= nWidth * 4;
+		brDst.nCStride	= 4;
+		if ( !brDst.pData )
+		{
+			// closed meanwhile
+			return;
+		}
+
+		Buffer2DConvert(&brDst, BUFFER_FORMAT_BGRA, &brSrc, BUFFER_FORMAT_BGR, BUFFER_FLIP_NONE);
+		NativeWindowPresentRect(pWindow, 0, 0, nWidth, nHeight);
+	}
+	void			SplitFrameCoordinator::Clear()
+	{
+		// each worker clears its band
+	}
+	void			SplitFrameCoordinator::Update(double ms)
+	{
+		if ( m_scene )
+		{
+			m_scene->OnUpdate(ms);
+		}
+		m_ms += ms;
+	}
+	void			SplitFrameCoordinator::Draw()
+	{
+		if ( !m_scene )
+		{
+			return;
+		}
+		// the last command is done with once presented
+		ASSERT(m_nPresented == m_nIssued);
+
+		Balance();
+
+		SplitFrameCommand & command	= m_pHeader->command;
+		Camera * pCamera		= m_scene->GetCamera();
+
+		command.ms		= m_ms;
+		command.bHasCamera	= pCamera ? 1 : 0;
+		if ( pCamera )
+		{
+			command.camera	= pCamera->transform;
+		}
+		memcpy(command.bands, m_bands, sizeof(u32) * ( m_nWorkers + 1 ));
+
+		m_ms = 0.0;
+		m_pHeader->nIssued.store(++m_nIssued, std::memory_order_release);
+	}
+	bool			SplitFrameCoordinator::IsAnimated()
+	{
+		return m_scene ? m_scene->IsAnimated() : false;
+	}
+
+	// ---------------------------------------------------------------
+	// SplitFrameWorker
+	// ---------------------------------------------------------------
+
+	SplitFrameWorker::SplitFrameWorker()
+		: m_pMemory(nullptr)
+		, m_pHeader(nullptr)
+		, m_iWorker(0)
+	{
+	}
+	SplitFrameWorker::~SplitFrameWorker()
+	{
+		if ( m_pMemory )
+		{
+			NativeSharedMemoryClose(m_pMemory);
+		}
+	}
+	bool			SplitFrameWorker::Open(const char * pName, Integer iWorker)
+	{
+		ASSERT(!m_pMemory);
+
+		NativeSharedMemory * pMemory = NativeSharedMemoryOpen(pName);
+		if ( !pMemory )
+		{
+			return false;
+		}
+
+		SplitFrameHeader * pHeader = static_cast< SplitFrameHeader * >( NativeSharedMemoryGetData(pMemory) );
+		if ( NativeSharedMemoryGetSize(pMemory) < sizeof(SplitFrameHeader) ||
+		     pHeader->magic != SPLIT_FRAME_MAGIC )
+		{
+			// not ready yet
+			NativeSharedMemoryClose(pMemory);
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		ENSURE_TRUE(pHeader->version == SPLIT_FRAME_VERSION);
+		ENSURE_TRUE(iWorker >= 0 && iWorker < static_cast< Integer >( pHeader->nWorkers ));
+
+		m_pMemory	= pMemory;
+		m_pHeader	= pHeader;
+		m_iWorker	= iWorker;
+		return true;
+	}
+	void			SplitFrameWorker::Run(IScene & scene)
+	{
+		ASSERT(m_pMemory);
+
+		const Integer nWidth	= m_pHeader->nWidth;
+		const Integer nHeight	= m_pHeader->nHeight;
+		SplitFrameWorkerSlot & slot = m_pHeader->workers[ m_iWorker ];
+
+		// a private frame, only the band is presented into it and copied out
+		Rect rect { 0, nWidth, 0, nHeight };
+		Buffer frame(nWidth, nHeight, 3, 4, ( 4 - ( ( nWidth * 3 ) & 0x3 ) ) & 0x3);
+
+		Device device				= Device::Default();
+		RenderTarget target			= device.CreateRenderTarget(&frame, rect);
+		RenderContext context			= device.CreateRenderContext();
+		SwapChain swapChain			= device.CreateSwapChain(target, BufferLayout::TILED, 2, false);
+		DepthStencilBuffer depthStencilBuffer	= device.CreateDepthStencilBuffer(nWidth, nHeight, BufferLayout::TILED);
+
+		context.SetSwapChain(swapChain);
+		context.SetDepthStencilBuffer(depthStencilBuffer);
+		context.SetRenderTarget(target);
+
+		scene.OnLoad(device, context);
+		Camera * pCamera = scene.GetCamera();
+
+		u8 * pShared		= static_cast< u8 * >( NativeSharedMemoryGetData(m_pMemory) ) + m_pHeader->nFrameOffset;
+		u64 nDone		= 0;
+		for ( ;; )
+		{
+			_WaitUntil([ this, nDone ] ()
+			{
+				return m_pHeader->nIssued.load(std::memory_order_acquire) > nDone ||
+				       m_pHeader->bQuit.load(std::memory_order_acquire) != 0;
+			});
+			if ( m_pHeader->bQuit.load(std::memory_order_acquire) )
+			{
+				break;
+			}
+			nDone = m_pHeader->nIssued.load(std::memory_order_acquire);
+
+			const SplitFrameCommand command = m_pHeader->command;
+
+			// the same update as the coordinator's, and its camera
+			scene.OnUpdate(command.ms);
+			if ( pCamera && command.bHasCamera )
+			{
+				pCamera->transform = command.camera;
+			}
+			if ( SceneState * pState = scene.GetState() )
+			{
+				pState->Capture();
+				pState->Flip();
+			}
+
+			// workers may share cores, only their own work counts
+			const int64_t iTickBegin = NativeGetThreadCpuTick();
+
+			const Rect band { 0, nWidth, static_cast< Integer >( command.bands[ m_iWorker ] ), static_cast< Integer >( command.bands[ m_iWorker + 1 ] ) };
+			if ( band.bottom > band.top )
+			{
+				swapChain.ResetBackBuffer(band, 0);
+				depthStencilBuffer.ResetDepthBuffer(band, 1.0f);
+
+				context.RSSetScissorRects(&band, 1);
+				scene.OnDraw();
+				context.RSSetScissorRects(nullptr, 0);
+				swapChain.Swap(&band, 1);
+
+				BufferRect brFrame = frame.GetBufferRect();
+				for ( Integer y = band.top; y < band.bottom; ++y )
+				{
+					memcpy(pShared + static_cast< u64 >( y ) * m_pHeader->nRowStride,
+					       brFrame.pData + static_cast< u64 >( y ) * brFrame.nRStride,
+					       static_cast< size_t >( nWidth ) * 3);
+				}
+			}
+
+			slot.msDraw = ( NativeGetThreadCpuTick() - iTickBegin ) * 0.001;
+			slot.nDone.store(nDone, std::memory_order_release);
+		}
+
+		scene.OnUnload();
+	}
+}
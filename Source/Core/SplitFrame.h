@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Native.h"
+#include "Scene.h"
+
+#include <atomic>
+#include <vector>
+
+namespace Graphics
+{
+	// ---------------------------------------------------------------
+	// Shared memory layout
+	//
+	// A header, then one BGR frame. The coordinator writes the command
+	// of frame n (from 1) and sets nIssued to n; every worker replays it
+	// on its own copy of the scene, draws its band of rows, copies it
+	// into the frame and sets its nDone to n. The next command waits for
+	// all of them, so nothing is written while it is read.
+	// ---------------------------------------------------------------
+
+	#define SPLIT_FRAME_MAGIC	(0x544c5053)	// "SPLT"
+	#define SPLIT_FRAME_VERSION	(1)
+	#define SPLIT_FRAME_MAX_WORKERS	(16)
+	#define SPLIT_FRAME_ROW_ALIGN	(8)		// band edges, rows
+	#define SPLIT_FRAME_FIT_DECAY	(0.9)		// per frame, of the band cost fit
+	#define SPLIT_FRAME_ROW_COST_BLEND (0.5)	// of the last frame, into the cost of rows
+	#define SPLIT_FRAME_AVERAGE_BLEND (0.2)		// of the last frame, into the reported band times
+
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(std::atomic<u64>) == sizeof(u64), "split frame counters are shared between processes");
+
+	// what every worker replays
+	struct SplitFrameCommand
+	{
+		double			ms;		// scene update
+		Transform		camera;		// the scene camera, after the update
+		u32			bHasCamera;
+		u32			bands[ SPLIT_FRAME_MAX_WORKERS + 1 ];	// worker i: rows [bands[i], bands[i+1])
+	};
+
+	struct alignas(64) SplitFrameWorkerSlot
+	{
+		std::atomic<u64>	nDone;		// last frame drawn
+		double			msDraw;		// its band, clear to copy out, CPU time
+	};
+
+	struct SplitFrameHeader
+	{
+		u32			magic;		// written last
+		u32			version;
+		u32			nWidth;
+		u32			nHeight;
+		u32			nRowStride;	// bytes
+		u32			nWorkers;
+		u64			nFrameOffset;	// from the header
+		std::atomic<u32>	bQuit;
+
+		alignas(64) std::atomic<u64>	nIssued;
+		SplitFrameCommand	command;	// of frame nIssued
+		SplitFrameWorkerSlot	workers[ SPLIT_FRAME_MAX_WORKERS ];
+	};
+
+	// ---------------------------------------------------------------
+	// SplitFrameCoordinator
+	// ---------------------------------------------------------------
+
+	// Sort-first split-frame rendering over worker processes: each frame
+	// is cut into bands of rows, one per worker, sized so the workers'
+	// draw times come out even. A band costs a fixed part every worker
+	// pays (the vertex pass) plus its rows, fitted over the last frames;
+	// only the rows are moved around. The
+	// coordinator's own copy of the scene takes the input and moves the
+	// camera but never draws; it presents the assembled frame.
+	class SplitFrameCoordinator : public IRenderer
+	{
+	public:
+		// Creates the shared frame pName, of the window's size, and
+		// starts nWorkers copies of this executable with pWorkerArgs plus
+		// the worker index, which run a SplitFrameWorker on pName.
+		SplitFrameCoordinator(RenderWindow & window, const char * pName, Integer nWorkers, const char * const * pWorkerArgs, int nWorkerArgs);
+		~SplitFrameCoordinator();	// stops the workers
+
+		void			SwitchScene(IScene & scene);
+
+		Integer			WorkerCount() const
+		{
+			return m_nWorkers;
+		}
+		u64			GetFrameCount() const
+		{
+			return m_nPresented;
+		}
+		// of the last frame presented, CPU time
+		Rect			GetBand(Integer iWorker) const;
+		double			GetBandMs(Integer iWorker) const;
+		// smoothed over the last frames
+		double			GetBandAverageMs(Integer iWorker) const;
+
+		virtual void		Present() override;
+		virtual void		Clear() override;
+		virtual void		Update(double ms) override;
+		virtual void		Draw() override;
+		virtual bool		IsAnimated() override;
+
+	private:
+		void			WaitWorkers(u64 nFrame);
+		void			FitCost();
+		void			Balance();
+
+		RenderWindow &		m_window;
+		Integer			m_nWorkers;
+		NativeSharedMemory *	m_pMemory;
+		SplitFrameHeader *	m_pHeader;
+		std::vector<NativeProcess *>	m_processes;
+
+		Device			m_device;
+		RenderContext		m_context;	// for the scene to load on, input goes to the window
+		RenderTarget		m_target;
+
+		double			m_ms;		// updated, not issued yet
+		u32			m_bands[ SPLIT_FRAME_MAX_WORKERS + 1 ];
+		double			m_msBands[ SPLIT_FRAME_MAX_WORKERS ];
+		double			m_msAverage[ SPLIT_FRAME_MAX_WORKERS ];
+		double			m_fit[ 5 ];	// decayed sums of 1, rows, ms, rows^2, rows*ms
+		double			m_msFixed;	// of every band, from the fit
+		std::vector<double>	m_rowCost;	// ms per row past the fixed part, per step of rows
+		u64			m_nIssued;
+		u64			m_nPresented;
+
+		IScene *		m_scene;
+	};
+
+	// ---------------------------------------------------------------
+	// SplitFrameWorker
+	// ---------------------------------------------------------------
+
+	// The worker process side: draws its band of every frame issued, on
+	// a scene loaded the way the coordinator's was.
+	class SplitFrameWorker
+	{
+	public:
+		SplitFrameWorker();
+		~SplitFrameWorker();
+
+		SplitFrameWorker(const SplitFrameWorker &) = delete;
+		SplitFrameWorker & operator = (const SplitFrameWorker &) = delete;
+
+		bool			Open(const char * pName, Integer iWorker);	// false until the coordinator made it
+		// Until the coordinator stops, the scene loaded on the way in and
+		// unloaded on the way out.
+		void			Run(IScene & scene);
+
+	private:
+		NativeSharedMemory *	m_pMemory;
+		SplitFrameHeader *	m_pHeader;
+		Integer			m_iWorker;
+	};
+}
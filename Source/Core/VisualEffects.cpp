@@ -21,8 +21,10 @@ namespace Graphics
 		ASSERT(m_vsOut.Size() == sizeof(VS_OUT));
 		ASSERT(m_psIn.Size() == sizeof(PS_IN));
 		ASSERT(m_psOut.Size() == sizeof(PS_OUT));
+		ASSERT(sizeof(PS_IN8) == sizeof(PS_IN) * LANE_COUNT);
+		ASSERT(sizeof(PS_OUT8) == sizeof(PS_OUT) * LANE_COUNT);
 
-		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut);
+		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut, PosImpl);
 		m_pixelShader		= device.CreatePixelShader(m_ps, m_psIn, m_psOut);
 
 		m_vsData.model		= M44Identity();
@@ -39,10 +41,12 @@ namespace Graphics
 	void		RgbEffect::CBSetModelTransform(const Matrix44 & modelTransform)
 	{
 		m_vsData.model = m_psData.model = modelTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		RgbEffect::CBSetViewTransform(const Matrix44 & viewTransform)
 	{
 		m_vsData.view = m_psData.view = viewTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		RgbEffect::CBSetProjTransform(const Matrix44 & projTransform)
 	{
@@ -51,23 +55,29 @@ namespace Graphics
 	void		RgbEffect::VSImpl(void * pVSOut, const void * pVSIn, const void * pContext)
 	{
 		const VS_IN & in	= *static_cast< const VS_IN * >( pVSIn );
-		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
 		VS_OUT & out		= *static_cast< VS_OUT * >( pVSOut );
 
-		out.posCam		= V3Transform(in.posWld, M44Multiply(ctx.model, ctx.view));
-		out.posNDC		= V3Transform(out.posCam, ctx.proj);
+		PosImpl(&out.posCam, &in.posWld, pContext);
 		out.color		= in.color;
 	}
-	void		RgbEffect::PSImpl(void * pPSOut, const void * pPSIn, const void * pContext)
+	void		RgbEffect::PosImpl(void * pPosOut, const void * pPosIn, const void * pContext)
 	{
-		const PS_IN & in	= *static_cast< const PS_IN * >( pPSIn );
-		const PS_DATA & ctx	= *static_cast< const PS_DATA * >( pContext );
-		PS_OUT & out		= *static_cast< PS_OUT * >( pPSOut );
+		const Vector3 & posWld	= *static_cast< const Vector3 * >( pPosIn );
+		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
+		Vector3 * pos		= static_cast< Vector3 * >( pPosOut );
+
+		pos[ 0 ]		= V3Transform(posWld, ctx.modelView);
+		pos[ 1 ]		= V3Transform(pos[ 0 ], ctx.proj);
+	}
+	void		RgbEffect::PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext)
+	{
+		const PS_IN8 & in	= *static_cast< const PS_IN8 * >( pPSIn );
+		PS_OUT8 & out		= *static_cast< PS_OUT8 * >( pPSOut );
 
 		out.color		= in.color;
 	}
 
-	TextureEffect::TextureEffect(LPCWSTR lpTexFilePath)
+	TextureEffect::TextureEffect(const wchar_t * lpTexFilePath)
 		: m_texFilePath(lpTexFilePath)
 	{
 		m_vs = VSImpl;
@@ -90,22 +100,25 @@ namespace Graphics
 		ASSERT(m_vsOut.Size() == sizeof(VS_OUT));
 		ASSERT(m_psIn.Size() == sizeof(PS_IN));
 		ASSERT(m_psOut.Size() == sizeof(PS_OUT));
+		ASSERT(sizeof(PS_IN8) == sizeof(PS_IN) * LANE_COUNT);
+		ASSERT(sizeof(PS_OUT8) == sizeof(PS_OUT) * LANE_COUNT);
 
-		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut);
+		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut, PosImpl);
+		m_worldShader		= device.CreateVertexShader(WorldImpl, m_vsIn, m_vsIn);
 		m_pixelShader		= device.CreatePixelShader(m_ps, m_psIn, m_psOut);
 
 		if ( m_texFilePath != NULL )
 		{
 			int nWidth;
 			int nHeight;
-			LPVOID lpPixelData = nullptr;
+			void * lpPixelData = nullptr;
 
 			NativeLoadBmp(m_texFilePath, &nWidth, &nHeight, &lpPixelData);
 			ASSERT(nWidth > 0 && nHeight > 0 && lpPixelData != nullptr);
 
 			m_texture2D	= device.CreateTexture2D(nWidth, nHeight, 4, 4, 0, lpPixelData);
 
-			delete[] lpPixelData;
+			delete[] static_cast< u32 * >( lpPixelData );
 		}
 		m_vsData.tex		= m_texture2D;
 		m_psData.tex		= m_texture2D;
@@ -121,13 +134,21 @@ namespace Graphics
 		ctx.VSSetConstantBuffer(&m_vsData);
 		ctx.PSSetConstantBuffer(&m_psData);
 	}
+	void		TextureEffect::ApplyStreamOut(RenderContext & ctx)
+	{
+		ctx.SetVertexShader(m_worldShader);
+
+		ctx.VSSetConstantBuffer(&m_vsData);
+	}
 	void		TextureEffect::CBSetModelTransform(const Matrix44 & modelTransform)
 	{
 		m_vsData.model = m_psData.model = modelTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		TextureEffect::CBSetViewTransform(const Matrix44 & viewTransform)
 	{
 		m_vsData.view = m_psData.view = viewTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		TextureEffect::CBSetProjTransform(const Matrix44 & projTransform)
 	{
@@ -136,20 +157,36 @@ namespace Graphics
 	void		TextureEffect::VSImpl(void * pVSOut, const void * pVSIn, const void * pContext)
 	{
 		const VS_IN & in	= *static_cast< const VS_IN * >( pVSIn );
-		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
 		VS_OUT & out		= *static_cast< VS_OUT * >( pVSOut );
 
-		out.posCam		= V3Transform(in.posWld, M44Multiply(ctx.model, ctx.view));
-		out.posNDC		= V3Transform(out.posCam, ctx.proj);
+		PosImpl(&out.posCam, &in.posWld, pContext);
 		out.uv			= in.uv;
 	}
-	void		TextureEffect::PSImpl(void * pPSOut, const void * pPSIn, const void * pContext)
+	void		TextureEffect::PosImpl(void * pPosOut, const void * pPosIn, const void * pContext)
+	{
+		const Vector3 & posWld	= *static_cast< const Vector3 * >( pPosIn );
+		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
+		Vector3 * pos		= static_cast< Vector3 * >( pPosOut );
+
+		pos[ 0 ]		= V3Transform(posWld, ctx.modelView);
+		pos[ 1 ]		= V3Transform(pos[ 0 ], ctx.proj);
+	}
+	void		TextureEffect::PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext)
 	{
-		const PS_IN & in	= *static_cast< const PS_IN * >( pPSIn );
+		const PS_IN8 & in	= *static_cast< const PS_IN8 * >( pPSIn );
 		const PS_DATA & ctx	= *static_cast< const PS_DATA * >( pContext );
-		PS_OUT & out		= *static_cast< PS_OUT * >( pPSOut );
+		PS_OUT8 & out		= *static_cast< PS_OUT8 * >( pPSOut );
 
-		ctx.tex.Sample(in.uv.x, in.uv.y, reinterpret_cast< float * >( &out.color ));
+		ctx.tex.Sample(in.uv, active, &out.color);
+	}
+	void		TextureEffect::WorldImpl(void * pVSOut, const void * pVSIn, const void * pContext)
+	{
+		const VS_IN & in	= *static_cast< const VS_IN * >( pVSIn );
+		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
+		VS_IN & out		= *static_cast< VS_IN * >( pVSOut );
+
+		out.posWld		= V3Transform(in.posWld, ctx.model);
+		out.uv			= in.uv;
 	}
 
 	BlinnPhongEffect::BlinnPhongEffect(const MaterialParams & materialParams, const LightParams & lightParams)
@@ -170,8 +207,10 @@ namespace Graphics
 		ASSERT(m_vsOut.Size() == sizeof(VS_OUT));
 		ASSERT(m_psIn.Size() == sizeof(PS_IN));
 		ASSERT(m_psOut.Size() == sizeof(PS_OUT));
+		ASSERT(sizeof(PS_IN8) == sizeof(PS_IN) * LANE_COUNT);
+		ASSERT(sizeof(PS_OUT8) == sizeof(PS_OUT) * LANE_COUNT);
 
-		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut);
+		m_vertexShader		= device.CreateVertexShader(m_vs, m_vsIn, m_vsOut, PosImpl);
 		m_pixelShader		= device.CreatePixelShader(m_ps, m_psIn, m_psOut);
 
 		m_vsData.model		= M44Identity();
@@ -188,10 +227,12 @@ namespace Graphics
 	void		BlinnPhongEffect::CBSetModelTransform(const Matrix44 & modelTransform)
 	{
 		m_vsData.model = m_psData.model = modelTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		BlinnPhongEffect::CBSetViewTransform(const Matrix44 & viewTransform)
 	{
 		m_vsData.view = m_psData.view = viewTransform;
+		m_vsData.modelView = m_psData.modelView = M44Multiply(m_vsData.model, m_vsData.view);
 	}
 	void		BlinnPhongEffect::CBSetProjTransform(const Matrix44 & projTransform)
 	{
@@ -204,80 +245,85 @@ namespace Graphics
 	void		BlinnPhongEffect::VSImpl(void * pVSOut, const void * pVSIn, const void * pContext)
 	{
 		const VS_IN & in	= *static_cast< const VS_IN * >( pVSIn );
-		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
 		VS_OUT & out		= *static_cast< VS_OUT * >( pVSOut );
 
-		out.posCam		= V3Transform(in.posWld, M44Multiply(ctx.model, ctx.view));
-		out.posNDC		= V3Transform(out.posCam, ctx.proj);
+		PosImpl(&out.posCam, &in.posWld, pContext);
 		out.posWld		= in.posWld;
 		out.normWld		= in.normWld;
 	}
-	void		BlinnPhongEffect::PSImpl(void * pPSOut, const void * pPSIn, const void * pContext)
+	void		BlinnPhongEffect::PosImpl(void * pPosOut, const void * pPosIn, const void * pContext)
 	{
-		const PS_IN & in	= *static_cast< const PS_IN * >( pPSIn );
+		const Vector3 & posWld	= *static_cast< const Vector3 * >( pPosIn );
+		const VS_DATA & ctx	= *static_cast< const VS_DATA * >( pContext );
+		Vector3 * pos		= static_cast< Vector3 * >( pPosOut );
+
+		pos[ 0 ]		= V3Transform(posWld, ctx.modelView);
+		pos[ 1 ]		= V3Transform(pos[ 0 ], ctx.proj);
+	}
+	void		BlinnPhongEffect::PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext)
+	{
+		const PS_IN8 & in	= *static_cast< const PS_IN8 * >( pPSIn );
 		const PS_DATA & ctx	= *static_cast< const PS_DATA * >( pContext );
-		PS_OUT & out		= *static_cast< PS_OUT * >( pPSOut );
+		PS_OUT8 & out		= *static_cast< PS_OUT8 * >( pPSOut );
 
 		ComputeBlinnPhong(&out.color, in.posWld, ctx.cameraPosWld, in.normWld, ctx.material, ctx.light);
 	}
-	void		BlinnPhongEffect::ComputeBlinnPhong(Vector3 * rgb, Vector3 posWld, Vector3 eyeWld, Vector3 normWld, const MaterialParams & material, const LightParams & light)
+	void		BlinnPhongEffect::ComputeBlinnPhong(vec3x8 * rgb, const vec3x8 & posWld, Vector3 eyeWld, const vec3x8 & normWld, const MaterialParams & material, const LightParams & light)
 	{
-		Vector3 lightDir;
-		float lightDistance;
+		const float8 zero = F8Set(0.0f);
+		const float8 one = F8Set(1.0f);
+
+		vec3x8 lightDir;
+		float8 lightDistance;
 		{
-			lightDir	= posWld - light.posWld;
-			lightDistance	= lightDir.Length();
-			lightDir.Normalize();
+			lightDir	= posWld - V3x8Set(light.posWld);
+			lightDistance	= V3x8Length(lightDir);
+			lightDir	= V3x8Scale(lightDir, one / lightDistance);
 		}
 
 		// Ambient Color = C_material
-		Vector3 ambient;
+		vec3x8 ambient;
 		{
-			ambient	= V3Multiply(material.rgbiAmbient.xyz, light.rgbiAmbient.xyz);
+			ambient	= V3x8Set(V3Multiply(material.rgbiAmbient.xyz, light.rgbiAmbient.xyz));
 		}
 
 		// Diffuse Color = max( cos(-L, norm), 0) * ElementwiseProduce(C_light, C_material)
-		Vector3 diffuse;
+		vec3x8 diffuse;
 		{
-			float decayFactor = Max(0.0f, V3Dot(-lightDir, normWld));
+			float8 decayFactor = F8Max(zero, V3x8Dot(-lightDir, normWld));
 
 			diffuse =
-				V3Scale(
-					V3Multiply(light.rgbiDiffuse.xyz, material.rgbiDiffuse.xyz),
+				V3x8Scale(
+					V3x8Set(V3Multiply(light.rgbiDiffuse.xyz, material.rgbiDiffuse.xyz)),
 					decayFactor);
 		}
 
 		// Specular Color = max( cos(L', to-eye), 0) * ElementwiseProduce(C_light, C_material)
-		Vector3 specular;
+		vec3x8 specular;
 		{
-			Vector3 reflectLightDir = V3Normalize(lightDir - V3Scale(normWld, 2 * V3Dot(normWld, lightDir)));
-			Vector3 toEyeDir = V3Normalize(eyeWld - posWld);
+			vec3x8 reflectLightDir = V3x8Normalize(lightDir - V3x8Scale(normWld, V3x8Dot(normWld, lightDir) * 2.0f));
+			vec3x8 toEyeDir = V3x8Normalize(V3x8Set(eyeWld) - posWld);
 
-			float decayFactor = Max(0.0f, V3Dot(reflectLightDir, toEyeDir));
+			float8 decayFactor = F8Max(zero, V3x8Dot(reflectLightDir, toEyeDir));
 			decayFactor = decayFactor * decayFactor;
 			decayFactor = decayFactor * decayFactor;
 			decayFactor = decayFactor * decayFactor;
 
 			specular =
-				V3Scale(
-					V3Multiply(light.rgbiSpecular.xyz, material.rgbiSpecular.xyz),
+				V3x8Scale(
+					V3x8Set(V3Multiply(light.rgbiSpecular.xyz, material.rgbiSpecular.xyz)),
 					decayFactor);
 		}
 
-		float atteFactor = 1.0f / V3Dot(light.attenuation, Vector3 { 1.0f, lightDistance, lightDistance * lightDistance });
+		float8 atteFactor = one / ( F8Set(light.attenuation.x) +
+					    lightDistance * light.attenuation.y +
+					    lightDistance * lightDistance * light.attenuation.z );
 
-		Vector3 color = WeightedAdd(ambient,
-					    diffuse,
-					    specular,
-					    material.rgbiAmbient.w,
-					    material.rgbiDiffuse.w * atteFactor,
-					    material.rgbiSpecular.w * atteFactor);
+		vec3x8 color =
+			V3x8Scale(ambient, F8Set(material.rgbiAmbient.w)) +
+			V3x8Scale(diffuse, atteFactor * material.rgbiDiffuse.w) +
+			V3x8Scale(specular, atteFactor * material.rgbiSpecular.w);
 
-		*rgb = Vector3
-		{
-			Bound(0.0f, color.x, 1.0f),
-			Bound(0.0f, color.y, 1.0f),
-			Bound(0.0f, color.z, 1.0f),
-		};
+		*rgb = V3x8Bound(zero, color, one);
 	}
 }
\ No newline at end of file
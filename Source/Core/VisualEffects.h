@@ -84,6 +84,7 @@ namespace Graphics
 			Matrix44 model;
 			Matrix44 view;
 			Matrix44 proj;
+			Matrix44 modelView;
 		};
 
 		typedef VS_OUT PS_IN;
@@ -92,9 +93,20 @@ namespace Graphics
 		{
 			Vector3 color;
 		};
+		struct PS_IN8
+		{
+			vec3x8 posCam;
+			vec3x8 posNDC;
+			vec3x8 color;
+		};
+		struct PS_OUT8
+		{
+			vec3x8 color;
+		};
 
 		static void VSImpl(void * pVSOut, const void * pVSIn, const void * pContext);
-		static void PSImpl(void * pPSOut, const void * pPSIn, const void * pContext);
+		static void PosImpl(void * pPosOut, const void * pPosIn, const void * pContext);
+		static void PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext);
 
 	private:
 		VertexShader	m_vertexShader;
@@ -106,11 +118,14 @@ namespace Graphics
 	class TextureEffect : public Effect
 	{
 	public:
-		explicit TextureEffect(LPCWSTR lpTexFilePath);
+		explicit TextureEffect(const wchar_t * lpTexFilePath);
 		explicit TextureEffect(Texture2D texture2D);
 
 		virtual void		Initialize(Device & device) override;
 		virtual void		Apply(RenderContext & context) override;
+		// Stream-out pass: VS input with positions moved to world space,
+		// draw the result again with an identity model transform.
+		void			ApplyStreamOut(RenderContext & context);
 
 		virtual void		CBSetModelTransform(const Matrix44 & modelTransform) override;
 		virtual void		CBSetViewTransform(const Matrix44 & viewTransform) override;
@@ -133,6 +148,7 @@ namespace Graphics
 			Matrix44 model;
 			Matrix44 view;
 			Matrix44 proj;
+			Matrix44 modelView;
 			Texture2D tex;
 		};
 
@@ -142,18 +158,31 @@ namespace Graphics
 		{
 			Vector3 color;
 		};
+		struct PS_IN8
+		{
+			vec3x8 posCam;
+			vec3x8 posNDC;
+			vec2x8 uv;
+		};
+		struct PS_OUT8
+		{
+			vec3x8 color;
+		};
 
 		static void VSImpl(void * pVSOut, const void * pVSIn, const void * pContext);
-		static void PSImpl(void * pPSOut, const void * pPSIn, const void * pContext);
+		static void PosImpl(void * pPosOut, const void * pPosIn, const void * pContext);
+		static void PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext);
+		static void WorldImpl(void * pVSOut, const void * pVSIn, const void * pContext);
 
 	private:
 		VertexShader	m_vertexShader;
+		VertexShader	m_worldShader;
 		PixelShader	m_pixelShader;
 		VS_DATA		m_vsData;
 		PS_DATA		m_psData;
 
 		// Texture Data
-		LPCWSTR		m_texFilePath;
+		const wchar_t *	m_texFilePath;
 		Texture2D	m_texture2D;
 	};
 
@@ -204,6 +233,7 @@ namespace Graphics
 			Matrix44	model;
 			Matrix44	view;
 			Matrix44	proj;
+			Matrix44	modelView;
 			Vector3		cameraPosWld;
 			MaterialParams	material;
 			LightParams	light;
@@ -215,10 +245,22 @@ namespace Graphics
 		{
 			Vector3 color;
 		};
+		struct PS_IN8
+		{
+			vec3x8 posCam;
+			vec3x8 posNDC;
+			vec3x8 posWld;
+			vec3x8 normWld;
+		};
+		struct PS_OUT8
+		{
+			vec3x8 color;
+		};
 
 		static void VSImpl(void * pVSOut, const void * pVSIn, const void * pContext);
-		static void PSImpl(void * pPSOut, const void * pPSIn, const void * pContext);
-		static void ComputeBlinnPhong(Vector3 * rgb, Vector3 posWld, Vector3 eyeWld, Vector3 normWld, const MaterialParams & material, const LightParams & light);
+		static void PosImpl(void * pPosOut, const void * pPosIn, const void * pContext);
+		static void PSImpl(void * pPSOut, const void * pPSIn, const mask8 & active, const void * pContext);
+		static void ComputeBlinnPhong(vec3x8 * rgb, const vec3x8 & posWld, Vector3 eyeWld, const vec3x8 & normWld, const MaterialParams & material, const LightParams & light);
 
 	private:
 		VertexShader	m_vertexShader;
@@ -545,11 +545,11 @@ namespace Graphics
 	// Vector3 - Comparison
 	inline bool		V3HasInfinite(Vector3 v)
 	{
-		return isinf(v.x) || isinf(v.y) || isinf(v.z);
+		return std::isinf(v.x) || std::isinf(v.y) || std::isinf(v.z);
 	}
 	inline bool		V3HasNaN(Vector3 v)
 	{
-		return isnan(v.x) || isnan(v.y) || isnan(v.z);
+		return std::isnan(v.x) || std::isnan(v.y) || std::isnan(v.z);
 	}
 	inline bool		V3Equal(Vector3 v0, Vector3 v1)
 	{
@@ -758,7 +758,7 @@ namespace Graphics
 
 		do
 		{
-			if ( isinf(*p) )
+			if ( std::isinf(*p) )
 			{
 				return true;
 			}
@@ -774,7 +774,7 @@ namespace Graphics
 
 		do
 		{
-			if ( isnan(*p) )
+			if ( std::isnan(*p) )
 			{
 				return true;
 			}
@@ -940,7 +940,24 @@ namespace Graphics
 	inline Matrix44		M44PerspectiveFovRH(f32 fFovAngleY, f32 fAspectRatio, f32 fNearZ, f32 fFarZ);
 	inline Matrix44		M44PerspectiveLH(f32 fViewWidth, f32 fViewHeight, f32 fNearZ, f32 fFarZ);
 	inline Matrix44		M44PerspectiveRH(f32 fViewWidth, f32 fViewHeight, f32 fNearZ, f32 fFarZ);
-	inline Matrix44		M44PerspectiveOffCenterLH(f32 fViewLeft, f32 fViewRight, f32 fViewBottom, f32 fViewTop, f32 fNearZ, f32 fFarZ);
+	// the view volume through [left, right] x [bottom, top] on the near plane
+	inline Matrix44		M44PerspectiveOffCenterLH(f32 fViewLeft, f32 fViewRight, f32 fViewBottom, f32 fViewTop, f32 fNearZ, f32 fFarZ)
+	{
+		f32 twoNearZ = fNearZ + fNearZ;
+		f32 fReciprocalWidth = 1.0f / ( fViewRight - fViewLeft );
+		f32 fReciprocalHeight = 1.0f / ( fViewTop - fViewBottom );
+		f32 fRange = fFarZ / ( fFarZ - fNearZ );
+
+		Matrix44 m =
+		{
+			twoNearZ * fReciprocalWidth, 0.0f, 0.0f, 0.0f,
+			0.0f, twoNearZ * fReciprocalHeight, 0.0f, 0.0f,
+			-( fViewLeft + fViewRight ) * fReciprocalWidth, -( fViewTop + fViewBottom ) * fReciprocalHeight, fRange, 1.0f,
+			0.0f, 0.0f, -fRange * fNearZ, 0.0f
+		};
+
+		return m;
+	}
 	inline Matrix44		M44PerspectiveOffCenterRH(f32 fViewLeft, f32 fViewRight, f32 fViewBottom, f32 fViewTop, f32 fNearZ, f32 fFarZ);
 
 	// Matrix44 - Transform
@@ -1072,11 +1089,11 @@ namespace Graphics
 	}
 	inline bool		Q4HasInfinite(Quaternion q)
 	{
-		return isinf(q.x) || isinf(q.y) || isinf(q.z);
+		return std::isinf(q.x) || std::isinf(q.y) || std::isinf(q.z);
 	}
 	inline bool		Q4HasNaN(Quaternion q)
 	{
-		return isnan(q.x) || isnan(q.y) || isnan(q.z);
+		return std::isnan(q.x) || std::isnan(q.y) || std::isnan(q.z);
 	}
 
 	// Quaternion - Geometric
@@ -0,0 +1,830 @@
+#include "../Core/Native.h"
+#include "../Core/BufferKernels.h"
+
+#if !defined(_WIN32)
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <errno.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <assert.h>
+
+// Constants
+
+#define NUM_MAX_WINDOW (10)
+#define BYTES_PER_PIXEL (4)
+#define SURFACE_ALIGN (64)
+#define BMP_MAX_SIDE (1 << 15)
+
+// Structures
+
+struct NativeWindow
+{
+	bool		bOpen;
+
+	int		nWidth;
+	int		nHeight;
+
+	// Surface, BGRA top-down like the Win32 DIB
+	void *		pPixels;
+
+	NativeWindowCallbacks	cbWindow;
+	NativeKeyboardCallbacks cbKeyboard;
+	NativeMouseCallbacks	cbMouse;
+
+	// Input
+	NativeInputEvent *	pScript;
+	int			nScript;
+	int			iScript;
+	int64_t			nFrames;
+	int64_t			nPresents;
+};
+
+// Keyboard and mouse input of a window, sent or scripted, waiting for
+// its input thread, or for the next poll without one
+struct NativeInputThread
+{
+	std::thread			thread;
+	std::deque<NativeInputEvent>	events;		// iFrame unused
+	std::condition_variable		cv;
+	bool				bRunning;
+	bool				bStop;
+};
+
+struct NativeHeadless
+{
+	bool		bInitialized;
+
+	// windows
+	NativeWindow	sWindows[ NUM_MAX_WINDOW ];
+	bool		bWindows[ NUM_MAX_WINDOW ];
+
+	// time, us
+	bool			bSkipWaits;	// NATIVE_HEADLESS_FRAMES runs
+	std::atomic<int64_t>	iSkipped;
+
+	// guards the input threads, and wakes NativeWaitUntil(..., true)
+	std::mutex		inputMutex;
+	std::condition_variable	inputCv;
+	int64_t			nInputSignals;
+	int64_t			nInputSeen;	// by the last wait
+	NativeInputThread	inputThreads[ NUM_MAX_WINDOW ];
+};
+
+// Globals
+
+static NativeHeadless native;
+
+// Methods
+
+static int		_CountFreeWindow()
+{
+	int nCount = 0;
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		if ( !native.bWindows[ i ] ) ++nCount;
+	}
+	return nCount;
+}
+static NativeWindow *	_AllocWindow()
+{
+	NativeWindow * pWindow = NULL;
+
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		if ( !native.bWindows[ i ] )
+		{
+			native.bWindows[ i ] = true;
+			pWindow = native.sWindows + i;
+			break;
+		}
+	}
+
+	return pWindow;
+}
+static void		_ReleaseWindow(NativeWindow * pWindow)
+{
+	assert(native.sWindows <= pWindow && pWindow < ( native.sWindows + NUM_MAX_WINDOW ));
+	assert(!pWindow->bOpen);
+
+	native.bWindows[ pWindow - native.sWindows ] = false;
+}
+
+// A closed window keeps its surface until it is destroyed or the slot
+// is reused, a present thread may still be on its way there.
+static void		_DestroySurface(NativeWindow * pWindow)
+{
+	if ( pWindow->pPixels )
+	{
+		AlignedFree(pWindow->pPixels);
+		pWindow->pPixels = NULL;
+	}
+	delete[] pWindow->pScript;
+	pWindow->pScript = NULL;
+	pWindow->nScript = 0;
+	pWindow->iScript = 0;
+}
+static void		_CloseWindow(NativeWindow * pWindow)
+{
+	NativeWindowStopInputThread(pWindow);
+	if ( pWindow->cbWindow.close ) pWindow->cbWindow.close();
+
+	pWindow->bOpen = false;
+	_ReleaseWindow(pWindow);
+}
+
+static void		_SignalInput()
+{
+	{
+		std::lock_guard<std::mutex> lock(native.inputMutex);
+		++native.nInputSignals;
+	}
+	native.inputCv.notify_all();
+}
+static void		_DeliverInput(NativeWindow * pWindow, const NativeInputEvent & e)
+{
+	switch ( e.type )
+	{
+		case NATIVE_INPUT_KEY_DOWN:	if ( pWindow->cbKeyboard.down ) pWindow->cbKeyboard.down(e.x); break;
+		case NATIVE_INPUT_KEY_UP:	if ( pWindow->cbKeyboard.up ) pWindow->cbKeyboard.up(e.x); break;
+		case NATIVE_INPUT_MOUSE_MOVE:	if ( pWindow->cbMouse.move ) pWindow->cbMouse.move(e.x, e.y); break;
+		case NATIVE_INPUT_LEFT_DOWN:	if ( pWindow->cbMouse.leftdown ) pWindow->cbMouse.leftdown(e.x, e.y); break;
+		case NATIVE_INPUT_LEFT_UP:	if ( pWindow->cbMouse.leftup ) pWindow->cbMouse.leftup(e.x, e.y); break;
+		case NATIVE_INPUT_RIGHT_DOWN:	if ( pWindow->cbMouse.rightdown ) pWindow->cbMouse.rightdown(e.x, e.y); break;
+		case NATIVE_INPUT_RIGHT_UP:	if ( pWindow->cbMouse.rightup ) pWindow->cbMouse.rightup(e.x, e.y); break;
+		case NATIVE_INPUT_MIDDLE_DOWN:	if ( pWindow->cbMouse.middledown ) pWindow->cbMouse.middledown(e.x, e.y); break;
+		case NATIVE_INPUT_MIDDLE_UP:	if ( pWindow->cbMouse.middleup ) pWindow->cbMouse.middleup(e.x, e.y); break;
+		default:			break;
+	}
+}
+// to the input thread if there is one, else for the next poll
+static void		_QueueInput(NativeWindow * pWindow, const NativeInputEvent & e)
+{
+	NativeInputThread & input = native.inputThreads[ pWindow - native.sWindows ];
+	{
+		std::lock_guard<std::mutex> lock(native.inputMutex);
+		input.events.push_back(e);
+	}
+	input.cv.notify_one();
+}
+static void		_RunInputThread(NativeWindow * pWindow)
+{
+	NativeInputThread & input = native.inputThreads[ pWindow - native.sWindows ];
+
+	for ( ;; )
+	{
+		NativeInputEvent e;
+		{
+			std::unique_lock<std::mutex> lock(native.inputMutex);
+			input.cv.wait(lock, [ &input ] { return input.bStop || !input.events.empty(); });
+			if ( input.events.empty() )
+			{
+				return;
+			}
+			e = input.events.front();
+			input.events.pop_front();
+		}
+
+		_DeliverInput(pWindow, e);
+		_SignalInput();
+	}
+}
+static void		_PlayScript(NativeWindow * pWindow)
+{
+	NativeInputThread & input = native.inputThreads[ pWindow - native.sWindows ];
+
+	++pWindow->nFrames;
+
+	// what was sent since the last poll, if no input thread took it
+	if ( !input.bRunning )
+	{
+		std::deque<NativeInputEvent> events;
+		{
+			std::lock_guard<std::mutex> lock(native.inputMutex);
+			events.swap(input.events);
+		}
+		for ( const NativeInputEvent & e : events )
+		{
+			_DeliverInput(pWindow, e);
+		}
+	}
+
+	while ( pWindow->bOpen && pWindow->iScript < pWindow->nScript &&
+		pWindow->pScript[ pWindow->iScript ].iFrame <= pWindow->nFrames )
+	{
+		const NativeInputEvent & e = pWindow->pScript[ pWindow->iScript++ ];
+
+		if ( e.type == NATIVE_INPUT_CLOSE )
+		{
+			_CloseWindow(pWindow);
+		}
+		else if ( input.bRunning )
+		{
+			_QueueInput(pWindow, e);
+		}
+		else
+		{
+			_DeliverInput(pWindow, e);
+		}
+	}
+}
+static bool		_HasDueInput()
+{
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		const NativeWindow * pWindow = native.sWindows + i;
+		if ( native.bWindows[ i ] && pWindow->bOpen && pWindow->iScript < pWindow->nScript &&
+		     pWindow->pScript[ pWindow->iScript ].iFrame <= pWindow->nFrames + 1 )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static int64_t		_GetClock()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast< int64_t >( ts.tv_sec ) * 1000000 + ts.tv_nsec / 1000;
+}
+// the first call's clock, whichever thread makes it
+static int64_t		_GetClockBegin()
+{
+	static const int64_t iClockBegin = _GetClock();
+	return iClockBegin;
+}
+static bool		_HasScript()
+{
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		const NativeWindow * pWindow = native.sWindows + i;
+		if ( native.bWindows[ i ] && pWindow->bOpen && pWindow->iScript < pWindow->nScript )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool			NativeInitialize()
+{
+	const char * pFrames;
+
+	if ( native.bInitialized )
+	{
+		return true;
+	}
+
+	native.bInitialized = true;
+	memset(native.sWindows, 0, sizeof(native.sWindows));
+	memset(native.bWindows, 0, sizeof(native.bWindows));
+
+	pFrames = getenv("NATIVE_HEADLESS_FRAMES");
+	native.bSkipWaits = pFrames && atoll(pFrames) > 0;
+	_GetClockBegin();
+
+	return true;
+}
+void			NativeTerminate()
+{
+	if ( !native.bInitialized )
+	{
+		return;
+	}
+
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		if ( native.bWindows[ i ] )
+		{
+			NativeDestroyWindow(native.sWindows + i);
+			native.bWindows[ i ] = false;
+		}
+		_DestroySurface(native.sWindows + i);
+	}
+}
+
+NativeWindow *		NativeCreateWindow(const wchar_t * pWindowTitle, int nWidth, int nHeight)
+{
+	return NativeCreateWindow(pWindowTitle, nWidth, nHeight, 0, 0);
+}
+NativeWindow *		NativeCreateWindow(const wchar_t * pWindowTitle, int nWidth, int nHeight, int nLeft, int nTop)
+{
+	NativeWindow * pWindow;
+	const char * pFrames;
+
+	assert(pWindowTitle);
+	assert(nWidth > 0 && nHeight > 0);
+
+	pWindow = _AllocWindow();
+	if ( !pWindow )
+	{
+		return NULL;
+	}
+
+	_DestroySurface(pWindow);
+	memset(pWindow, 0, sizeof(NativeWindow));
+	{
+		// sent to whatever had the slot before
+		std::lock_guard<std::mutex> lock(native.inputMutex);
+		native.inputThreads[ pWindow - native.sWindows ].events.clear();
+	}
+
+	pWindow->pPixels = AlignedMalloc(static_cast< size_t >( nWidth ) * nHeight * BYTES_PER_PIXEL, SURFACE_ALIGN);
+	if ( !pWindow->pPixels )
+	{
+		_ReleaseWindow(pWindow);
+		return NULL;
+	}
+	memset(pWindow->pPixels, 0, static_cast< size_t >( nWidth ) * nHeight * BYTES_PER_PIXEL);
+
+	pWindow->bOpen = true;
+	pWindow->nWidth = nWidth;
+	pWindow->nHeight = nHeight;
+
+	// batch runs end by themselves
+	pFrames = getenv("NATIVE_HEADLESS_FRAMES");
+	if ( pFrames && atoll(pFrames) > 0 )
+	{
+		NativeInputEvent close = { atoll(pFrames), NATIVE_INPUT_CLOSE, 0, 0 };
+		NativeScriptInput(pWindow, &close, 1);
+	}
+
+	return pWindow;
+}
+void			NativeDestroyWindow(NativeWindow * pWindow)
+{
+	NativeWindowStopInputThread(pWindow);
+	if ( pWindow->bOpen )
+	{
+		pWindow->bOpen = false;
+	}
+
+	_DestroySurface(pWindow);
+	_ReleaseWindow(pWindow);
+}
+void			NativeDestroyAllWindows()
+{
+	for (int i = 0; i < NUM_MAX_WINDOW; ++i)
+	{
+		if (native.bWindows[i])
+		{
+			NativeDestroyWindow(native.sWindows + i);
+		}
+	}
+}
+
+int			NativeGetWindowCount()
+{
+	return NUM_MAX_WINDOW - _CountFreeWindow();
+}
+
+int			NativeWindowGetWidth(NativeWindow * pWindow)
+{
+	return pWindow->nWidth;
+}
+int			NativeWindowGetHeight(NativeWindow * pWindow)
+{
+	return pWindow->nHeight;
+}
+
+bool			NativeWindowBilt(NativeWindow * pWindow, const void * pSrc, int mode)
+{
+	return NativeWindowBiltRect(pWindow, pSrc, mode, 0, 0, pWindow->nWidth, pWindow->nHeight);
+}
+bool			NativeWindowBiltRect(NativeWindow * pWindow, const void * pSrc, int mode, int nLeft, int nTop, int nRight, int nBottom)
+{
+	using namespace Graphics;
+
+	const u32 nWidth = ( u32 ) pWindow->nWidth;
+	const u32 nHeight = ( u32 ) pWindow->nHeight;
+
+	BufferFormat srcFormat;
+	BufferRect brSrc;
+	BufferRect brDst;
+	int flip;
+
+	switch ( mode & NATIVE_BLIT_COLOR_MASK )
+	{
+		case NATIVE_BLIT_BGRA:	srcFormat = BUFFER_FORMAT_BGRA; break;
+		case NATIVE_BLIT_BGR:	srcFormat = BUFFER_FORMAT_BGR; break;
+		case NATIVE_BLIT_F32:	srcFormat = BUFFER_FORMAT_F32; break;
+		case NATIVE_BLIT_U8:	srcFormat = BUFFER_FORMAT_U8; break;
+		default:		return false;
+	}
+
+	if ( !pWindow->bOpen || nLeft < 0 || nTop < 0 || nRight > ( int ) nWidth || nBottom > ( int ) nHeight || nLeft >= nRight || nTop >= nBottom )
+	{
+		return false;
+	}
+
+	flip = ( ( mode & NATIVE_BLIT_FLIP_H ) ? BUFFER_FLIP_H : 0 ) |
+	       ( ( mode & NATIVE_BLIT_FLIP_V ) ? BUFFER_FLIP_V : 0 );
+
+	// the source rect is the window rect mirrored by the flip
+	const u32 nSrcLeft = ( flip & BUFFER_FLIP_H ) ? nWidth - nRight : nLeft;
+	const u32 nSrcTop = ( flip & BUFFER_FLIP_V ) ? nHeight - nBottom : nTop;
+
+	brSrc.nCStride	= BufferFormatSize(srcFormat);
+	brSrc.nRStride	= nWidth * brSrc.nCStride;
+	brSrc.pData	= ( u8 * ) pSrc + nSrcTop * brSrc.nRStride + nSrcLeft * brSrc.nCStride;
+	brSrc.nRCount	= nBottom - nTop;
+	brSrc.nCCount	= nRight - nLeft;
+
+	brDst.nCStride	= BYTES_PER_PIXEL;
+	brDst.nRStride	= nWidth * BYTES_PER_PIXEL;
+	brDst.pData	= ( u8 * ) pWindow->pPixels + nTop * brDst.nRStride + nLeft * BYTES_PER_PIXEL;
+	brDst.nRCount	= nBottom - nTop;
+	brDst.nCCount	= nRight - nLeft;
+
+	return Buffer2DConvert(&brDst, BUFFER_FORMAT_BGRA, &brSrc, srcFormat, flip) &&
+	       NativeWindowPresentRect(pWindow, nLeft, nTop, nRight, nBottom);
+}
+void *			NativeWindowGetSurface(NativeWindow * pWindow)
+{
+	return pWindow->bOpen ? pWindow->pPixels : NULL;
+}
+bool			NativeWindowPresentRect(NativeWindow * pWindow, int nLeft, int nTop, int nRight, int nBottom)
+{
+	if ( !pWindow->bOpen || nLeft < 0 || nTop < 0 || nRight > pWindow->nWidth || nBottom > pWindow->nHeight || nLeft >= nRight || nTop >= nBottom )
+	{
+		return false;
+	}
+
+	// nothing to show, the surface is the result
+	++pWindow->nPresents;
+	return true;
+}
+
+void			NativeRegisterWindowCallbacks(NativeWindow * pWindow, const NativeWindowCallbacks * pCallbacks)
+{
+	assert(pCallbacks);
+
+	pWindow->cbWindow = *pCallbacks;
+}
+void			NativeRegisterKeyboardCallbacks(NativeWindow * pWindow, const NativeKeyboardCallbacks * pCallbacks)
+{
+	assert(pCallbacks);
+
+	pWindow->cbKeyboard = *pCallbacks;
+}
+void			NativeRegisterMouseCallbacks(NativeWindow * pWindow, const NativeMouseCallbacks * pCallbacks)
+{
+	assert(pCallbacks);
+
+	pWindow->cbMouse = *pCallbacks;
+}
+void			NativeScriptInput(NativeWindow * pWindow, const NativeInputEvent * pEvents, int nEvents)
+{
+	assert(nEvents >= 0 && ( pEvents || nEvents == 0 ));
+
+	delete[] pWindow->pScript;
+	pWindow->pScript = nEvents > 0 ? new NativeInputEvent[ nEvents ] : NULL;
+	pWindow->nScript = nEvents;
+	pWindow->iScript = 0;
+
+	for ( int i = 0; i < nEvents; ++i )
+	{
+		pWindow->pScript[ i ] = pEvents[ i ];
+		pWindow->pScript[ i ].iFrame += pWindow->nFrames;
+	}
+
+	_SignalInput();
+}
+
+void			NativeInputPoll()
+{
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		if ( native.bWindows[ i ] && native.sWindows[ i ].bOpen )
+		{
+			_PlayScript(native.sWindows + i);
+		}
+	}
+}
+
+bool			NativeWindowStartInputThread(NativeWindow * pWindow)
+{
+	NativeInputThread & input = native.inputThreads[ pWindow - native.sWindows ];
+
+	if ( !pWindow->bOpen )
+	{
+		return false;
+	}
+	if ( !input.bRunning )
+	{
+		input.bStop	= false;
+		input.bRunning	= true;
+		input.thread	= std::thread(_RunInputThread, pWindow);
+	}
+	return true;
+}
+void			NativeWindowStopInputThread(NativeWindow * pWindow)
+{
+	NativeInputThread & input = native.inputThreads[ pWindow - native.sWindows ];
+
+	if ( !input.bRunning )
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(native.inputMutex);
+		input.bStop = true;
+	}
+	input.cv.notify_one();
+
+	// it delivers what is left first
+	input.thread.join();
+	input.bRunning = false;
+}
+void			NativeSendInput(NativeWindow * pWindow, int type, int x, int y)
+{
+	assert(type != NATIVE_INPUT_CLOSE);
+
+	_QueueInput(pWindow, NativeInputEvent { 0, type, x, y });
+	_SignalInput();
+}
+
+int64_t			NativeGetTick()
+{
+	return _GetClock() - _GetClockBegin() + native.iSkipped;
+}
+
+int64_t			NativeGetThreadCpuTick()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return static_cast< int64_t >( ts.tv_sec ) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// nobody watches, skip the clock ahead instead of sleeping
+static void		_SkipUntil(int64_t iTick)
+{
+	int64_t iWait = iTick - NativeGetTick();
+	if ( iWait > 0 )
+	{
+		native.iSkipped += iWait;
+	}
+}
+
+bool			NativeWaitUntil(int64_t iTick, bool bWakeOnInput)
+{
+	assert(iTick >= 0 || bWakeOnInput);
+
+	if ( bWakeOnInput )
+	{
+		std::unique_lock<std::mutex> lock(native.inputMutex);
+		auto woken = [ ] { return native.nInputSignals != native.nInputSeen; };
+
+		// a script only moves on with polls, skipping the clock only the
+		// event due at the next one counts
+		if ( _HasScript() && ( iTick < 0 || !native.bSkipWaits || _HasDueInput() ) )
+		{
+			return true;
+		}
+
+		bool bWoken;
+		if ( iTick < 0 )
+		{
+			native.inputCv.wait(lock, woken);
+			bWoken = true;
+		}
+		else if ( native.bSkipWaits )
+		{
+			bWoken = woken();
+			if ( !bWoken )
+			{
+				_SkipUntil(iTick);
+			}
+		}
+		else
+		{
+			// steady_clock is CLOCK_MONOTONIC, as _GetClock
+			std::chrono::steady_clock::time_point deadline(std::chrono::microseconds(iTick - native.iSkipped + _GetClockBegin()));
+			bWoken = native.inputCv.wait_until(lock, deadline, woken);
+		}
+
+		// input that came before a wait still ends it
+		native.nInputSeen = native.nInputSignals;
+		return bWoken;
+	}
+
+	if ( native.bSkipWaits )
+	{
+		_SkipUntil(iTick);
+		return false;
+	}
+
+	// absolute, so a late wake-up doesn't stack up
+	int64_t iDeadline = iTick - native.iSkipped + _GetClockBegin();
+	struct timespec ts;
+	ts.tv_sec	= iDeadline / 1000000;
+	ts.tv_nsec	= ( iDeadline % 1000000 ) * 1000;
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR )
+	{
+	}
+
+	return false;
+}
+
+// Image
+
+static uint32_t		_ReadU32(const unsigned char * p)
+{
+	return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( static_cast< uint32_t >( p[ 3 ] ) << 24 );
+}
+static uint16_t		_ReadU16(const unsigned char * p)
+{
+	return static_cast< uint16_t >( p[ 0 ] | ( p[ 1 ] << 8 ) );
+}
+
+// Uncompressed 24 and 32 bit bitmaps, ARGB rows bottom-up as GDI+ gives them.
+void			NativeLoadBmp(const wchar_t * pBmpFile, int * pWidth, int * pHeight, void ** ppPixels)
+{
+	char path[ 1024 ];
+	unsigned char header[ 54 ];
+	FILE * file;
+	int w;
+	int h;
+	int bpp;
+	uint32_t compression;
+	bool bTopDown;
+	size_t nRowBytes;
+	unsigned char * row;
+	uint32_t * pixels;
+
+	*pWidth		= 0;
+	*pHeight	= 0;
+	*ppPixels	= NULL;
+
+	size_t nPath = wcstombs(path, pBmpFile, sizeof(path));
+	if ( nPath == static_cast< size_t >( -1 ) || nPath >= sizeof(path) )
+	{
+		return;
+	}
+
+	file = fopen(path, "rb");
+	if ( !file )
+	{
+		return;
+	}
+
+	if ( fread(header, 1, sizeof(header), file) != sizeof(header) || header[ 0 ] != 'B' || header[ 1 ] != 'M' )
+	{
+		fclose(file);
+		return;
+	}
+
+	w		= static_cast< int >( _ReadU32(header + 18) );
+	h		= static_cast< int >( _ReadU32(header + 22) );
+	bpp		= _ReadU16(header + 28);
+	compression	= _ReadU32(header + 30);
+	bTopDown	= h < 0;
+
+	// BI_RGB, or BI_BITFIELDS with the usual 32 bit masks
+	if ( w <= 0 || w > BMP_MAX_SIDE || h == 0 || h < -BMP_MAX_SIDE || h > BMP_MAX_SIDE ||
+	     ( bpp != 24 && bpp != 32 ) || !( compression == 0 || ( compression == 3 && bpp == 32 ) ) ||
+	     fseek(file, static_cast< long >( _ReadU32(header + 10) ), SEEK_SET) != 0 )
+	{
+		fclose(file);
+		return;
+	}
+	h		= bTopDown ? -h : h;
+
+	nRowBytes	= ( static_cast< size_t >( w ) * ( bpp / 8 ) + 3 ) & ~static_cast< size_t >( 3 );
+	row		= new unsigned char[ nRowBytes ];
+	pixels		= new uint32_t[ static_cast< size_t >( w ) * h ];
+
+	for ( int y = 0; y < h; ++y )
+	{
+		// stored rows are bottom-up unless the height is negative
+		uint32_t * pixel = pixels + static_cast< size_t >( bTopDown ? h - y - 1 : y ) * w;
+
+		if ( fread(row, 1, nRowBytes, file) != nRowBytes )
+		{
+			delete[] pixels;
+			delete[] row;
+			fclose(file);
+			return;
+		}
+		for ( int x = 0; x < w; ++x )
+		{
+			const unsigned char * p = row + x * ( bpp / 8 );
+			*( pixel++ ) = 0xff000000u | ( p[ 2 ] << 16 ) | ( p[ 1 ] << 8 ) | p[ 0 ];
+		}
+	}
+
+	delete[] row;
+	fclose(file);
+
+	*pWidth	= w;
+	*pHeight = h;
+	*ppPixels = pixels;
+}
+
+// Debug
+
+static void		DebugWindow_Move(int x, int y)
+{
+	printf("Wnd Move:   %d, %d\n", x, y);
+}
+static void		DebugWindow_Resize(int width, int height)
+{
+	printf("Wnd Resize: %d, %d\n", width, height);
+}
+static void		DebugWindow_Close()
+{
+	printf("Wnd Close.\n");
+}
+
+static void		DebugKeyboard_Down(int keycode)
+{
+	printf("Key Down:   %d(%c)\n", keycode, isprint(keycode) ? (char)keycode : '?');
+}
+static void		DebugKeyboard_Up(int keycode)
+{
+	printf("Key Up:     %d(%c)\n", keycode, isprint(keycode) ? (char)keycode : '?');
+}
+
+static void		DebugMouse_Move(int x, int y)
+{
+	printf("Mse Move:   %d, %d\n", x, y);
+}
+static void		DebugMouse_LeftDown(int x, int y)
+{
+	printf("Mse L Down: %d, %d\n", x, y);
+}
+static void		DebugMouse_LeftUp(int x, int y)
+{
+	printf("Mse L Up:   %d, %d\n", x, y);
+}
+static void		DebugMouse_RightDown(int x, int y)
+{
+	printf("Mse R Down: %d, %d\n", x, y);
+}
+static void		DebugMouse_RightUp(int x, int y)
+{
+	printf("Mse R Up:   %d, %d\n", x, y);
+}
+static void		DebugMouse_MiddleDown(int x, int y)
+{
+	printf("Mse M Down: %d, %d\n", x, y);
+}
+static void		DebugMouse_MiddleUp(int x, int y)
+{
+	printf("Mse M Up:   %d, %d\n", x, y);
+}
+
+const NativeWindowCallbacks *		NativeDebugGetWindowCallbacks()
+{
+	static NativeWindowCallbacks cbs;
+	static bool init = false;
+	if ( !init )
+	{
+		cbs.move =   &DebugWindow_Move;
+		cbs.resize = &DebugWindow_Resize;
+		cbs.close =  &DebugWindow_Close;
+		init = true;
+	}
+	return &cbs;
+}
+const NativeKeyboardCallbacks *		NativeDebugGetKeyboardCallbacks()
+{
+	static NativeKeyboardCallbacks cbs;
+	static bool init = false;
+	if ( !init )
+	{
+		cbs.down = &DebugKeyboard_Down;
+		cbs.up = &DebugKeyboard_Up;
+		init = true;
+	}
+	return &cbs;
+}
+const NativeMouseCallbacks *		NativeDebugGetMouseCallbacks()
+{
+	static NativeMouseCallbacks cbs;
+	static bool init = false;
+	if ( !init )
+	{
+		cbs.move = &DebugMouse_Move;
+		cbs.leftdown = &DebugMouse_LeftDown;
+		cbs.leftup = &DebugMouse_LeftUp;
+		cbs.rightdown = &DebugMouse_RightDown;
+		cbs.rightup = &DebugMouse_RightUp;
+		cbs.middledown = &DebugMouse_MiddleDown;
+		cbs.middleup = &DebugMouse_MiddleUp;
+		init = true;
+	}
+	return &cbs;
+}
+
+#endif
@@ -0,0 +1,422 @@
+#include "../Core/Native.h"
+
+#include <atomic>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <malloc.h>
+#include <crtdbg.h>
+#else
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Constants
+
+#define HUGE_PAGE_MIN_BYTES	(NATIVE_HUGE_PAGE_BYTES / 2)	// smaller requests stay on the heap
+#define ALLOC_MAGIC		(0x416c6c63)
+
+// Structures
+
+// Sits right before every returned pointer so AlignedFree can tell heap
+// blocks from page mappings.
+struct AllocHeader
+{
+	void *		pBase;
+	size_t		nMapped;	// 0 for heap blocks
+	uint32_t	magic;
+};
+
+struct NativeMemory
+{
+	std::atomic<int64_t>	nHugeAllocs;
+	std::atomic<int64_t>	nHugeBytes;
+	std::atomic<int64_t>	nAdvisedAllocs;
+	std::atomic<int64_t>	nAdvisedBytes;
+	std::atomic<int64_t>	nFallbackAllocs;
+	std::atomic<int64_t>	nFallbackBytes;
+};
+
+struct NativeSharedMemory
+{
+	void *		pData;
+	size_t		nSize;
+	bool		bOwner;
+#if defined(_WIN32)
+	HANDLE		hMapping;
+#else
+	char		name[ 256 ];
+#endif
+};
+
+// Globals
+
+static NativeMemory memory;
+
+// Methods
+
+static size_t		_AlignCeiling(size_t n, size_t nAlign)
+{
+	return ( n + nAlign - 1 ) & ~( nAlign - 1 );
+}
+static size_t		_HeaderSize(size_t nAlign)
+{
+	return _AlignCeiling(sizeof(AllocHeader), nAlign);
+}
+static void *		_Place(void * pBase, size_t nHeader, size_t nMapped)
+{
+	char * p = ( char * ) pBase + nHeader;
+	AllocHeader * pHeader = ( AllocHeader * ) p - 1;
+
+	pHeader->pBase		= pBase;
+	pHeader->nMapped	= nMapped;
+	pHeader->magic		= ALLOC_MAGIC;
+
+	return p;
+}
+
+static void *		_HeapMalloc(size_t nSize, size_t nAlign)
+{
+	const size_t nHeader = _HeaderSize(nAlign);
+	void * pBase;
+
+#if defined(_WIN32)
+#ifdef _DEBUG
+	pBase = _aligned_malloc_dbg(nSize + nHeader, nAlign, __FILE__, __LINE__);
+#else
+	pBase = _aligned_malloc(nSize + nHeader, nAlign);
+#endif
+#else
+	if ( posix_memalign(&pBase, nAlign, nSize + nHeader) != 0 )
+	{
+		pBase = nullptr;
+	}
+#endif
+
+	return pBase ? _Place(pBase, nHeader, 0) : nullptr;
+}
+static void		_HeapFree(void * pBase)
+{
+#if defined(_WIN32)
+#ifdef _DEBUG
+	_aligned_free_dbg(pBase);
+#else
+	_aligned_free(pBase);
+#endif
+#else
+	free(pBase);
+#endif
+}
+
+#if defined(_WIN32)
+
+static size_t		_EnableLargePages()
+{
+	HANDLE hToken;
+	TOKEN_PRIVILEGES tp;
+	bool bEnabled;
+
+	if ( !OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken) )
+	{
+		return 0;
+	}
+
+	tp.PrivilegeCount		= 1;
+	tp.Privileges[ 0 ].Attributes	= SE_PRIVILEGE_ENABLED;
+
+	bEnabled =
+		LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[ 0 ].Luid) &&
+		AdjustTokenPrivileges(hToken, FALSE, &tp, 0, NULL, NULL) &&
+		GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(hToken);
+
+	return bEnabled ? GetLargePageMinimum() : 0;
+}
+
+// Large pages need SeLockMemoryPrivilege ("Lock pages in memory"),
+// without it every request falls back.
+static void *		_HugeMalloc(size_t nSize, size_t nAlign)
+{
+	static const size_t nLargePage = _EnableLargePages();
+
+	const size_t nHeader = _HeaderSize(nAlign);
+	size_t nMapped;
+	void * pBase;
+
+	if ( nLargePage == 0 || nAlign > nLargePage )
+	{
+		return nullptr;
+	}
+
+	nMapped	= _AlignCeiling(nSize + nHeader, nLargePage);
+	pBase	= VirtualAlloc(NULL, nMapped, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if ( !pBase )
+	{
+		return nullptr;
+	}
+
+	++memory.nHugeAllocs;
+	memory.nHugeBytes += nMapped;
+
+	return _Place(pBase, nHeader, nMapped);
+}
+static void		_HugeFree(void * pBase, size_t nMapped)
+{
+	VirtualFree(pBase, 0, MEM_RELEASE);
+}
+
+#else
+
+// Try the reserved hugetlb pool first, then a 2 MiB aligned mapping
+// advised for transparent huge pages.
+static void *		_HugeMalloc(size_t nSize, size_t nAlign)
+{
+	const size_t nHeader = _HeaderSize(nAlign);
+	const size_t nMapped = _AlignCeiling(nSize + nHeader, NATIVE_HUGE_PAGE_BYTES);
+	char * pRaw;
+	char * pBase;
+	size_t nRaw;
+
+	if ( nAlign > NATIVE_HUGE_PAGE_BYTES )
+	{
+		return nullptr;
+	}
+
+#if defined(MAP_HUGETLB)
+	pBase = ( char * ) mmap(NULL, nMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if ( pBase != MAP_FAILED )
+	{
+		++memory.nHugeAllocs;
+		memory.nHugeBytes += nMapped;
+
+		return _Place(pBase, nHeader, nMapped);
+	}
+#endif
+
+#if defined(MADV_HUGEPAGE)
+	nRaw = nMapped + NATIVE_HUGE_PAGE_BYTES;
+	pRaw = ( char * ) mmap(NULL, nRaw, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ( pRaw == MAP_FAILED )
+	{
+		return nullptr;
+	}
+
+	// trim to a 2 MiB boundary so every page can be promoted
+	pBase = ( char * ) _AlignCeiling(( size_t ) pRaw, NATIVE_HUGE_PAGE_BYTES);
+	if ( pBase > pRaw )
+	{
+		munmap(pRaw, pBase - pRaw);
+	}
+	if ( pRaw + nRaw > pBase + nMapped )
+	{
+		munmap(pBase + nMapped, ( pRaw + nRaw ) - ( pBase + nMapped ));
+	}
+
+	if ( madvise(pBase, nMapped, MADV_HUGEPAGE) != 0 )
+	{
+		munmap(pBase, nMapped);
+		return nullptr;
+	}
+
+	++memory.nAdvisedAllocs;
+	memory.nAdvisedBytes += nMapped;
+
+	return _Place(pBase, nHeader, nMapped);
+#else
+	return nullptr;
+#endif
+}
+static void		_HugeFree(void * pBase, size_t nMapped)
+{
+	munmap(pBase, nMapped);
+}
+
+#endif
+
+void *			AlignedMalloc(size_t nSize, size_t nAlign)
+{
+	return AlignedMallocEx(nSize, nAlign, NATIVE_ALLOC_DEFAULT);
+}
+void *			AlignedMallocEx(size_t nSize, size_t nAlign, int policy)
+{
+	void * p;
+
+	assert(nAlign > 0 && ( nAlign & ( nAlign - 1 ) ) == 0);
+
+	nAlign = nAlign < sizeof(void *) ? sizeof(void *) : nAlign;
+
+	if ( policy == NATIVE_ALLOC_HUGE_PAGE && nSize >= HUGE_PAGE_MIN_BYTES )
+	{
+		if ( ( p = _HugeMalloc(nSize, nAlign) ) != nullptr )
+		{
+			return p;
+		}
+
+		++memory.nFallbackAllocs;
+		memory.nFallbackBytes += nSize;
+	}
+
+	return _HeapMalloc(nSize, nAlign);
+}
+void			AlignedFree(void * p)
+{
+	AllocHeader * pHeader;
+
+	if ( !p )
+	{
+		return;
+	}
+
+	pHeader = ( AllocHeader * ) p - 1;
+	assert(pHeader->magic == ALLOC_MAGIC);
+
+	if ( pHeader->nMapped )
+	{
+		_HugeFree(pHeader->pBase, pHeader->nMapped);
+	}
+	else
+	{
+		_HeapFree(pHeader->pBase);
+	}
+}
+void			NativeGetAllocStats(NativeAllocStats * pStats)
+{
+	pStats->nHugeAllocs	= memory.nHugeAllocs;
+	pStats->nHugeBytes	= memory.nHugeBytes;
+	pStats->nAdvisedAllocs	= memory.nAdvisedAllocs;
+	pStats->nAdvisedBytes	= memory.nAdvisedBytes;
+	pStats->nFallbackAllocs	= memory.nFallbackAllocs;
+	pStats->nFallbackBytes	= memory.nFallbackBytes;
+}
+
+// Shared memory
+
+#if defined(_WIN32)
+
+static NativeSharedMemory *	_MapShared(HANDLE hMapping, bool bOwner)
+{
+	NativeSharedMemory * pMemory;
+	MEMORY_BASIC_INFORMATION info;
+	void * pData;
+
+	pData = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if ( !pData || !VirtualQuery(pData, &info, sizeof(info)) )
+	{
+		if ( pData )
+		{
+			UnmapViewOfFile(pData);
+		}
+		CloseHandle(hMapping);
+		return NULL;
+	}
+
+	pMemory			= new NativeSharedMemory;
+	pMemory->pData		= pData;
+	pMemory->nSize		= info.RegionSize;	// page granular
+	pMemory->bOwner		= bOwner;
+	pMemory->hMapping	= hMapping;
+	return pMemory;
+}
+NativeSharedMemory *	NativeSharedMemoryCreate(const char * pName, size_t nSize)
+{
+	HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+					     ( DWORD ) ( ( uint64_t ) nSize >> 32 ), ( DWORD ) nSize, pName);
+	return hMapping ? _MapShared(hMapping, true) : NULL;
+}
+NativeSharedMemory *	NativeSharedMemoryOpen(const char * pName)
+{
+	HANDLE hMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, pName);
+	return hMapping ? _MapShared(hMapping, false) : NULL;
+}
+void			NativeSharedMemoryClose(NativeSharedMemory * pMemory)
+{
+	// the name goes with the last handle
+	UnmapViewOfFile(pMemory->pData);
+	CloseHandle(pMemory->hMapping);
+	delete pMemory;
+}
+
+#else
+
+static NativeSharedMemory *	_MapShared(int fd, const char * pName, size_t nSize, bool bOwner)
+{
+	NativeSharedMemory * pMemory;
+	void * pData;
+
+	pData = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if ( pData == MAP_FAILED )
+	{
+		if ( bOwner )
+		{
+			shm_unlink(pName);
+		}
+		return NULL;
+	}
+
+	pMemory		= new NativeSharedMemory;
+	pMemory->pData	= pData;
+	pMemory->nSize	= nSize;
+	pMemory->bOwner	= bOwner;
+	strncpy(pMemory->name, pName, sizeof(pMemory->name) - 1);
+	pMemory->name[ sizeof(pMemory->name) - 1 ] = 0;
+	return pMemory;
+}
+NativeSharedMemory *	NativeSharedMemoryCreate(const char * pName, size_t nSize)
+{
+	int fd = shm_open(pName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	if ( ftruncate(fd, ( off_t ) nSize) != 0 )
+	{
+		close(fd);
+		shm_unlink(pName);
+		return NULL;
+	}
+	return _MapShared(fd, pName, nSize, true);
+}
+NativeSharedMemory *	NativeSharedMemoryOpen(const char * pName)
+{
+	struct stat st;
+
+	int fd = shm_open(pName, O_RDWR, 0);
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	if ( fstat(fd, &st) != 0 || st.st_size == 0 )
+	{
+		close(fd);
+		return NULL;
+	}
+	return _MapShared(fd, pName, ( size_t ) st.st_size, false);
+}
+void			NativeSharedMemoryClose(NativeSharedMemory * pMemory)
+{
+	munmap(pMemory->pData, pMemory->nSize);
+	if ( pMemory->bOwner )
+	{
+		shm_unlink(pMemory->name);
+	}
+	delete pMemory;
+}
+
+#endif
+
+void *			NativeSharedMemoryGetData(NativeSharedMemory * pMemory)
+{
+	return pMemory->pData;
+}
+size_t			NativeSharedMemoryGetSize(NativeSharedMemory * pMemory)
+{
+	return pMemory->nSize;
+}
@@ -0,0 +1,195 @@
+#include "../Core/Native.h"
+
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <limits.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char ** environ;
+#endif
+
+// Structures
+
+struct NativeProcess
+{
+#if defined(_WIN32)
+	HANDLE		hProcess;
+#else
+	pid_t		pid;
+#endif
+	bool		bExited;
+	int		nExitCode;
+};
+
+// Methods
+
+#if defined(_WIN32)
+
+// CommandLineToArgvW rules: backslashes only escape quotes
+static void		_AppendQuoted(std::string & cmdLine, const char * pArg)
+{
+	cmdLine += '"';
+	for ( const char * p = pArg; ; ++p )
+	{
+		size_t nBackslashes = 0;
+		while ( *p == '\\' )
+		{
+			++p;
+			++nBackslashes;
+		}
+		if ( !*p )
+		{
+			cmdLine.append(nBackslashes * 2, '\\');
+			break;
+		}
+		if ( *p == '"' )
+		{
+			cmdLine.append(nBackslashes * 2 + 1, '\\');
+		}
+		else
+		{
+			cmdLine.append(nBackslashes, '\\');
+		}
+		cmdLine += *p;
+	}
+	cmdLine += '"';
+}
+
+NativeProcess *		NativeProcessSpawnSelf(const char * const * pArgs, int nArgs)
+{
+	char path[ MAX_PATH ];
+	std::string cmdLine;
+	STARTUPINFOA si = {};
+	PROCESS_INFORMATION pi = {};
+
+	DWORD nPath = GetModuleFileNameA(NULL, path, sizeof(path));
+	if ( nPath == 0 || nPath >= sizeof(path) )
+	{
+		return NULL;
+	}
+
+	_AppendQuoted(cmdLine, path);
+	for ( int i = 0; i < nArgs; ++i )
+	{
+		cmdLine += ' ';
+		_AppendQuoted(cmdLine, pArgs[ i ]);
+	}
+
+	si.cb = sizeof(si);
+	if ( !CreateProcessA(path, &cmdLine[ 0 ], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi) )
+	{
+		return NULL;
+	}
+	CloseHandle(pi.hThread);
+
+	NativeProcess * pProcess	= new NativeProcess;
+	pProcess->hProcess		= pi.hProcess;
+	pProcess->bExited		= false;
+	pProcess->nExitCode		= 0;
+	return pProcess;
+}
+bool			NativeProcessIsRunning(NativeProcess * pProcess)
+{
+	DWORD nExitCode;
+
+	if ( !pProcess->bExited && WaitForSingleObject(pProcess->hProcess, 0) == WAIT_OBJECT_0 )
+	{
+		GetExitCodeProcess(pProcess->hProcess, &nExitCode);
+		pProcess->bExited	= true;
+		pProcess->nExitCode	= ( int ) nExitCode;
+	}
+	return !pProcess->bExited;
+}
+int			NativeProcessWait(NativeProcess * pProcess)
+{
+	DWORD nExitCode;
+	int nResult;
+
+	if ( !pProcess->bExited )
+	{
+		WaitForSingleObject(pProcess->hProcess, INFINITE);
+		GetExitCodeProcess(pProcess->hProcess, &nExitCode);
+		pProcess->nExitCode = ( int ) nExitCode;
+	}
+	nResult = pProcess->nExitCode;
+
+	CloseHandle(pProcess->hProcess);
+	delete pProcess;
+	return nResult;
+}
+
+#else
+
+static int		_ExitCode(int status)
+{
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + ( WIFSIGNALED(status) ? WTERMSIG(status) : 0 );
+}
+
+NativeProcess *		NativeProcessSpawnSelf(const char * const * pArgs, int nArgs)
+{
+	char path[ PATH_MAX ];
+	std::vector<char *> argv;
+	pid_t pid;
+
+	ssize_t nPath = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if ( nPath <= 0 )
+	{
+		return NULL;
+	}
+	path[ nPath ] = 0;
+
+	argv.push_back(path);
+	for ( int i = 0; i < nArgs; ++i )
+	{
+		argv.push_back(const_cast< char * >( pArgs[ i ] ));
+	}
+	argv.push_back(NULL);
+
+	if ( posix_spawn(&pid, path, NULL, NULL, argv.data(), environ) != 0 )
+	{
+		return NULL;
+	}
+
+	NativeProcess * pProcess	= new NativeProcess;
+	pProcess->pid			= pid;
+	pProcess->bExited		= false;
+	pProcess->nExitCode		= 0;
+	return pProcess;
+}
+bool			NativeProcessIsRunning(NativeProcess * pProcess)
+{
+	int status;
+
+	if ( !pProcess->bExited && waitpid(pProcess->pid, &status, WNOHANG) == pProcess->pid )
+	{
+		pProcess->bExited	= true;
+		pProcess->nExitCode	= _ExitCode(status);
+	}
+	return !pProcess->bExited;
+}
+int			NativeProcessWait(NativeProcess * pProcess)
+{
+	int status = 0;
+	int nResult;
+
+	if ( !pProcess->bExited )
+	{
+		while ( waitpid(pProcess->pid, &status, 0) < 0 && errno == EINTR )
+		{
+		}
+		pProcess->nExitCode = _ExitCode(status);
+	}
+	nResult = pProcess->nExitCode;
+
+	delete pProcess;
+	return nResult;
+}
+
+#endif
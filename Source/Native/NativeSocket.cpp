@@ -0,0 +1,296 @@
+#include "../Core/Native.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#include <afunix.h>
+#include <mutex>
+#else
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Structures
+
+struct NativeSocket
+{
+#if defined(_WIN32)
+	SOCKET		s;
+#else
+	int		fd;
+#endif
+	bool		bListener;
+	char		path[ 108 ];	// listeners, removed on close
+};
+
+// Methods
+
+static bool		_MakeAddress(sockaddr_un * pAddr, const char * pPath)
+{
+	memset(pAddr, 0, sizeof(*pAddr));
+	pAddr->sun_family = AF_UNIX;
+	if ( strlen(pPath) >= sizeof(pAddr->sun_path) )
+	{
+		return false;
+	}
+	strcpy(pAddr->sun_path, pPath);
+	return true;
+}
+
+#if defined(_WIN32)
+
+// AF_UNIX needs Windows 10 1803 or later
+static bool		_Startup()
+{
+	static std::once_flag once;
+	static bool bStarted = false;
+
+	std::call_once(once, [ ] ()
+	{
+		WSADATA data;
+		bStarted = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	});
+	return bStarted;
+}
+static NativeSocket *	_Wrap(SOCKET s, bool bListener, const char * pPath)
+{
+	NativeSocket * pSocket	= new NativeSocket;
+	pSocket->s		= s;
+	pSocket->bListener	= bListener;
+	strncpy(pSocket->path, pPath ? pPath : "", sizeof(pSocket->path) - 1);
+	pSocket->path[ sizeof(pSocket->path) - 1 ] = 0;
+	return pSocket;
+}
+
+NativeSocket *		NativeSocketListen(const char * pPath)
+{
+	sockaddr_un addr;
+
+	if ( !_Startup() || !_MakeAddress(&addr, pPath) )
+	{
+		return NULL;
+	}
+
+	SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( s == INVALID_SOCKET )
+	{
+		return NULL;
+	}
+	DeleteFileA(pPath);
+	if ( bind(s, ( sockaddr * ) &addr, sizeof(addr)) != 0 || listen(s, SOMAXCONN) != 0 )
+	{
+		closesocket(s);
+		return NULL;
+	}
+	return _Wrap(s, true, pPath);
+}
+NativeSocket *		NativeSocketAccept(NativeSocket * pListener)
+{
+	SOCKET s = accept(pListener->s, NULL, NULL);
+	return s != INVALID_SOCKET ? _Wrap(s, false, NULL) : NULL;
+}
+NativeSocket *		NativeSocketConnect(const char * pPath)
+{
+	sockaddr_un addr;
+
+	if ( !_Startup() || !_MakeAddress(&addr, pPath) )
+	{
+		return NULL;
+	}
+
+	SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( s == INVALID_SOCKET )
+	{
+		return NULL;
+	}
+	if ( connect(s, ( sockaddr * ) &addr, sizeof(addr)) != 0 )
+	{
+		closesocket(s);
+		return NULL;
+	}
+	return _Wrap(s, false, NULL);
+}
+bool			NativeSocketSend(NativeSocket * pSocket, const void * pData, size_t nSize)
+{
+	const char * p = static_cast< const char * >( pData );
+	while ( nSize > 0 )
+	{
+		int n = send(pSocket->s, p, static_cast< int >( nSize < 0x40000000 ? nSize : 0x40000000 ), 0);
+		if ( n <= 0 )
+		{
+			return false;
+		}
+		p	+= n;
+		nSize	-= n;
+	}
+	return true;
+}
+bool			NativeSocketRecv(NativeSocket * pSocket, void * pData, size_t nSize)
+{
+	char * p = static_cast< char * >( pData );
+	while ( nSize > 0 )
+	{
+		int n = recv(pSocket->s, p, static_cast< int >( nSize < 0x40000000 ? nSize : 0x40000000 ), 0);
+		if ( n <= 0 )
+		{
+			return false;
+		}
+		p	+= n;
+		nSize	-= n;
+	}
+	return true;
+}
+void			NativeSocketShutdown(NativeSocket * pSocket)
+{
+	if ( pSocket->bListener )
+	{
+		// accept only returns once the socket is closed
+		closesocket(pSocket->s);
+		pSocket->s = INVALID_SOCKET;
+	}
+	else
+	{
+		shutdown(pSocket->s, SD_BOTH);
+	}
+}
+void			NativeSocketClose(NativeSocket * pSocket)
+{
+	if ( pSocket->s != INVALID_SOCKET )
+	{
+		closesocket(pSocket->s);
+	}
+	if ( pSocket->bListener )
+	{
+		DeleteFileA(pSocket->path);
+	}
+	delete pSocket;
+}
+
+#else
+
+static NativeSocket *	_Wrap(int fd, bool bListener, const char * pPath)
+{
+	NativeSocket * pSocket	= new NativeSocket;
+	pSocket->fd		= fd;
+	pSocket->bListener	= bListener;
+	strncpy(pSocket->path, pPath ? pPath : "", sizeof(pSocket->path) - 1);
+	pSocket->path[ sizeof(pSocket->path) - 1 ] = 0;
+	return pSocket;
+}
+
+NativeSocket *		NativeSocketListen(const char * pPath)
+{
+	sockaddr_un addr;
+
+	if ( !_MakeAddress(&addr, pPath) )
+	{
+		return NULL;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	// a stale socket file from a server that didn't close
+	unlink(pPath);
+	if ( bind(fd, ( sockaddr * ) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0 )
+	{
+		close(fd);
+		return NULL;
+	}
+	return _Wrap(fd, true, pPath);
+}
+NativeSocket *		NativeSocketAccept(NativeSocket * pListener)
+{
+	for ( ;; )
+	{
+		int fd = accept4(pListener->fd, NULL, NULL, SOCK_CLOEXEC);
+		if ( fd >= 0 )
+		{
+			return _Wrap(fd, false, NULL);
+		}
+		if ( errno != EINTR && errno != ECONNABORTED )
+		{
+			return NULL;
+		}
+	}
+}
+NativeSocket *		NativeSocketConnect(const char * pPath)
+{
+	sockaddr_un addr;
+
+	if ( !_MakeAddress(&addr, pPath) )
+	{
+		return NULL;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	if ( connect(fd, ( sockaddr * ) &addr, sizeof(addr)) != 0 )
+	{
+		close(fd);
+		return NULL;
+	}
+	return _Wrap(fd, false, NULL);
+}
+bool			NativeSocketSend(NativeSocket * pSocket, const void * pData, size_t nSize)
+{
+	const char * p = static_cast< const char * >( pData );
+	while ( nSize > 0 )
+	{
+		// a peer gone is an error, not SIGPIPE
+		ssize_t n = send(pSocket->fd, p, nSize, MSG_NOSIGNAL);
+		if ( n < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		if ( n <= 0 )
+		{
+			return false;
+		}
+		p	+= n;
+		nSize	-= n;
+	}
+	return true;
+}
+bool			NativeSocketRecv(NativeSocket * pSocket, void * pData, size_t nSize)
+{
+	char * p = static_cast< char * >( pData );
+	while ( nSize > 0 )
+	{
+		ssize_t n = recv(pSocket->fd, p, nSize, 0);
+		if ( n < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		if ( n <= 0 )
+		{
+			return false;
+		}
+		p	+= n;
+		nSize	-= n;
+	}
+	return true;
+}
+void			NativeSocketShutdown(NativeSocket * pSocket)
+{
+	shutdown(pSocket->fd, SHUT_RDWR);
+}
+void			NativeSocketClose(NativeSocket * pSocket)
+{
+	close(pSocket->fd);
+	if ( pSocket->bListener )
+	{
+		unlink(pSocket->path);
+	}
+	delete pSocket;
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include "../Core/Native.h"
+#include "../Core/BufferKernels.h"
+
+#if defined(_WIN32)
 
 #include <WindowsX.h>
 #include <Windows.h>
@@ -8,13 +11,21 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include <thread>
+
 // Constants
 
 #define NUM_MAX_WINDOW (10)
 #define NUM_MAX_EVENT_PER_POLL (10)
 #define BYTES_PER_PIXEL (4)
+#define WM_NATIVE_INPUT ( WM_APP + 1 ) // wParam: NativeInputType, lParam: x, y
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION (0x00000002) // Windows 10 1803
+#endif
 
 static LPCWSTR		StrWndClassName = L"Win32 Window Class";
+static LPCWSTR		StrInputWndClassName = L"Win32 Input Window Class";
 static UINT		DwWndClassStyle = CS_HREDRAW | CS_VREDRAW | CS_OWNDC;
 static DWORD		DwWndStyle = WS_CAPTION;
 
@@ -36,6 +47,15 @@ struct NativeWindow
 	NativeWindowCallbacks	cbWindow;
 	NativeKeyboardCallbacks cbKeyboard;
 	NativeMouseCallbacks	cbMouse;
+
+	// Scripted input
+	NativeInputEvent *	pScript;
+	int			nScript;
+	int			iScript;
+	int64_t			nFrames;
+
+	// the input thread's message-only window, NULL without one
+	HWND			hInputWnd;
 };
 
 struct NativeWin32
@@ -47,6 +67,11 @@ struct NativeWin32
 	// windows
 	NativeWindow	sWindows[ NUM_MAX_WINDOW ];
 	bool		bWindows[ NUM_MAX_WINDOW ];
+
+	// waits
+	HANDLE		hWaitTimer;
+
+	std::thread	inputThreads[ NUM_MAX_WINDOW ];
 };
 
 // Globals
@@ -57,12 +82,15 @@ static NativeWin32 native =
 	false,
 	{},
 	{},
+	NULL,
+	{},
 };
 ULONG_PTR tkGdiPlus = NULL;
 
 // Methods
 
 static LRESULT CALLBACK _WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+static LRESULT CALLBACK _InputWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 static bool		_RegisterWindowClass()
 {
@@ -80,6 +108,16 @@ static bool		_RegisterWindowClass()
 
 	return RegisterClass(&wndClass) != NULL;
 }
+static bool		_RegisterInputWindowClass()
+{
+	WNDCLASS wndClass;
+	memset(&wndClass, 0, sizeof(wndClass));
+	wndClass.lpfnWndProc	= _InputWindowProc;
+	wndClass.hInstance	= native.hInstance;
+	wndClass.lpszClassName	= StrInputWndClassName;
+
+	return RegisterClass(&wndClass) != NULL;
+}
 static int		_CountFreeWindow()
 {
 	int nCount = 0;
@@ -159,7 +197,7 @@ static void		_DestroySurface(NativeWindow * pWindow)
 	pWindow->hWndDC = NULL;
 	pWindow->pPixels = NULL;
 }
-static bool		_PresentSurface(HWND hWnd, HDC hMemDC, int nWidth, int nHeight)
+static bool		_PresentSurface(HWND hWnd, HDC hMemDC, int nLeft, int nTop, int nWidth, int nHeight)
 {
 	HDC hDC;
 	bool bRet;
@@ -167,13 +205,13 @@ static bool		_PresentSurface(HWND hWnd, HDC hMemDC, int nWidth, int nHeight)
 	hDC	= GetDC(hWnd);
 
 	bRet	= BitBlt(hDC,
-			 0,
-			 0,
+			 nLeft,
+			 nTop,
 			 nWidth,
 			 nHeight,
 			 hMemDC,
-			 0,
-			 0,
+			 nLeft,
+			 nTop,
 			 SRCCOPY);
 
 	ReleaseDC(hWnd, hDC);
@@ -208,6 +246,12 @@ static LRESULT CALLBACK _WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 		pWindow = ( NativeWindow * ) GetWindowLongPtr(hWnd, GWLP_USERDATA);
 	}
 
+	// the input thread has the keyboard and mouse
+	if ( pWindow && pWindow->hInputWnd && ( ( WM_KEYFIRST <= uMsg && uMsg <= WM_KEYLAST ) || ( WM_MOUSEFIRST <= uMsg && uMsg <= WM_MOUSELAST ) ) )
+	{
+		return DefWindowProc(hWnd, uMsg, wParam, lParam);
+	}
+
 	switch ( uMsg )
 	{
 		case WM_KEYDOWN:	if ( pWindow->cbKeyboard.down ) pWindow->cbKeyboard.down(wParam); break;
@@ -222,7 +266,7 @@ static LRESULT CALLBACK _WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 		case WM_MOVE:		if ( pWindow->cbWindow.move ) pWindow->cbWindow.move(LOWORD(lParam), HIWORD(lParam)); break;
 		case WM_SIZE:		if ( pWindow->cbWindow.resize ) pWindow->cbWindow.resize(LOWORD(lParam), HIWORD(lParam)); break;
 		case WM_CLOSE:		if ( pWindow->cbWindow.close ) pWindow->cbWindow.close(); bCallDefault = true; break;
-		case WM_DESTROY:	pWindow->hWnd = NULL; _ReleaseWindow(pWindow); bCallDefault = true; break;
+		case WM_DESTROY:	NativeWindowStopInputThread(pWindow); pWindow->hWnd = NULL; _ReleaseWindow(pWindow); bCallDefault = true; break;
 		default:		bCallDefault = true; break;
 	}
 
@@ -248,6 +292,14 @@ bool			NativeInitialize()
 	memset(native.bWindows, 0, sizeof(native.bWindows));
 
 	( void ) _RegisterWindowClass();
+	( void ) _RegisterInputWindowClass();
+
+	// high resolution if the system has it, else timer resolution (~1 ms with timeBeginPeriod)
+	native.hWaitTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if ( native.hWaitTimer == NULL )
+	{
+		native.hWaitTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
 
 	// GDI+
 	Gdiplus::GdiplusStartupInput input;
@@ -271,6 +323,12 @@ void			NativeTerminate()
 		}
 	}
 
+	if ( native.hWaitTimer )
+	{
+		CloseHandle(native.hWaitTimer);
+		native.hWaitTimer = NULL;
+	}
+
 	// GDI+
 	Gdiplus::GdiplusShutdown(tkGdiPlus);
 }
@@ -333,6 +391,10 @@ NativeWindow *		NativeCreateWindow(const wchar_t * pWindowTitle, int nWidth, int
 }
 void			NativeDestroyWindow(NativeWindow * pWindow)
 {
+	delete[] pWindow->pScript;
+	pWindow->pScript = NULL;
+	pWindow->nScript = 0;
+
 	if ( pWindow->hWnd )
 	{
 		_DestroySurface(pWindow);
@@ -368,358 +430,76 @@ int			NativeWindowGetHeight(NativeWindow * pWindow)
 	return pWindow->nHeight;
 }
 
-static bool		_NativeWindowBilt(NativeWindow * pWindow, const void * pSrc, NativeBlitMode mode)
+bool			NativeWindowBilt(NativeWindow * pWindow, const void * pSrc, int mode)
 {
-	const int nWidth = pWindow->nWidth;
-	const int nHeight = pWindow->nHeight;
-
-	const BYTE * pbSrc;
-	const float * pfSrc;
-	DWORD * pDst;
-	bool bBadMode;
-
-	assert(( mode & NATIVE_BLIT_COLOR_MASK ) == mode);
-
-	pDst = ( DWORD * ) pWindow->pPixels;
-	bBadMode = false;
-	switch ( mode )
-	{
-		case NATIVE_BLIT_BGRA:
-			memcpy(pDst,
-			       pSrc,
-			       ( size_t ) nWidth * nHeight * BYTES_PER_PIXEL);
-			break;
-		case NATIVE_BLIT_BGR:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					*pDst = ( 0xff000000 ) |
-						( pbSrc[ 2 ] << 16 ) |
-						( pbSrc[ 1 ] << 8 ) |
-						( pbSrc[ 0 ] );
-
-					++pDst;
-					pbSrc += 3;
-				}
-			}
-			break;
-		case NATIVE_BLIT_F32:
-			pfSrc	= ( const float * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = ( BYTE ) ( *pfSrc * 255.0f );
-
-					*pDst = ( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pDst;
-					++pfSrc;
-				}
-			}
-			break;
-		case NATIVE_BLIT_U8:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = *pbSrc;
-
-					*pDst = ( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pDst;
-					++pbSrc;
-				}
-			}
-			break;
-		default:
-			bBadMode = true;
-			break;
-	}
-
-	return !bBadMode;
+	return NativeWindowBiltRect(pWindow, pSrc, mode, 0, 0, pWindow->nWidth, pWindow->nHeight);
 }
-static bool		_NativeWindowBiltFlipH(NativeWindow * pWindow, const void * pSrc, NativeBlitMode mode)
+bool			NativeWindowBiltRect(NativeWindow * pWindow, const void * pSrc, int mode, int nLeft, int nTop, int nRight, int nBottom)
 {
-	const int nWidth = pWindow->nWidth;
-	const int nHeight = pWindow->nHeight;
+	using namespace Graphics;
+
+	const u32 nWidth = ( u32 ) pWindow->nWidth;
+	const u32 nHeight = ( u32 ) pWindow->nHeight;
 
-	const DWORD * pdSrc;
-	const BYTE * pbSrc;
-	const float * pfSrc;
-	DWORD * pDst;
-	bool bBadMode;
+	// read once, a present thread may get here after the window closed
+	const HWND hWnd = pWindow->hWnd;
 
-	assert(( mode & NATIVE_BLIT_COLOR_MASK ) == mode);
+	BufferFormat srcFormat;
+	BufferRect brSrc;
+	BufferRect brDst;
+	int flip;
 
-	pDst = ( DWORD * ) pWindow->pPixels;
-	bBadMode = false;
-	switch ( mode )
+	switch ( mode & NATIVE_BLIT_COLOR_MASK )
 	{
-		case NATIVE_BLIT_BGRA:
-			pdSrc = ( const DWORD * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ r * nWidth + nWidth - 1 - c ] = pdSrc[ r * nWidth + c ];
-				}
-			}
-			break;
-		case NATIVE_BLIT_BGR:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ r * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( pbSrc[ 2 ] << 16 ) |
-						( pbSrc[ 1 ] << 8 ) |
-						( pbSrc[ 0 ] );
-
-					pbSrc += 3;
-				}
-			}
-			break;
-		case NATIVE_BLIT_F32:
-			pfSrc	= ( const float * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = ( BYTE ) ( *pfSrc * 255.0f );
-
-					pDst[ r * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pfSrc;
-				}
-			}
-			break;
-		case NATIVE_BLIT_U8:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = *pbSrc;
-
-					pDst[ r * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pbSrc;
-				}
-			}
-			break;
-		default:
-			bBadMode = true;
-			break;
+		case NATIVE_BLIT_BGRA:	srcFormat = BUFFER_FORMAT_BGRA; break;
+		case NATIVE_BLIT_BGR:	srcFormat = BUFFER_FORMAT_BGR; break;
+		case NATIVE_BLIT_F32:	srcFormat = BUFFER_FORMAT_F32; break;
+		case NATIVE_BLIT_U8:	srcFormat = BUFFER_FORMAT_U8; break;
+		default:		return false;
 	}
 
-	return !bBadMode;
-}
-static bool		_NativeWindowBiltFlipV(NativeWindow * pWindow, const void * pSrc, NativeBlitMode mode)
-{
-	const int nWidth = pWindow->nWidth;
-	const int nHeight = pWindow->nHeight;
-
-	const DWORD * pdSrc;
-	const BYTE * pbSrc;
-	const float * pfSrc;
-	DWORD * pDst;
-	bool bBadMode;
-
-	assert(( mode & NATIVE_BLIT_COLOR_MASK ) == mode);
-
-	pDst = ( DWORD * ) pWindow->pPixels;
-	bBadMode = false;
-	switch ( mode )
+	if ( hWnd == NULL || nLeft < 0 || nTop < 0 || nRight > ( int ) nWidth || nBottom > ( int ) nHeight || nLeft >= nRight || nTop >= nBottom )
 	{
-		case NATIVE_BLIT_BGRA:
-			pdSrc = ( const DWORD * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ ( nHeight - 1 - r ) * nWidth + c ] = pdSrc[ r * nWidth + c ];
-				}
-			}
-			break;
-		case NATIVE_BLIT_BGR:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ ( nHeight - 1 - r ) * nWidth + c ] =
-						( 0xff000000 ) |
-						( pbSrc[ 2 ] << 16 ) |
-						( pbSrc[ 1 ] << 8 ) |
-						( pbSrc[ 0 ] );
-
-					pbSrc += 3;
-				}
-			}
-			break;
-		case NATIVE_BLIT_F32:
-			pfSrc	= ( const float * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = ( BYTE ) ( *pfSrc * 255.0f );
-
-					pDst[ ( nHeight - 1 - r ) * nWidth + c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pfSrc;
-				}
-			}
-			break;
-		case NATIVE_BLIT_U8:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = *pbSrc;
-
-					pDst[ ( nHeight - 1 - r ) * nWidth + c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pbSrc;
-				}
-			}
-			break;
-		default:
-			bBadMode = true;
-			break;
+		return false;
 	}
 
-	return !bBadMode;
-}
-static bool		_NativeWindowBiltFlipHV(NativeWindow * pWindow, const void * pSrc, NativeBlitMode mode)
-{
-	const int nWidth = pWindow->nWidth;
-	const int nHeight = pWindow->nHeight;
+	flip = ( ( mode & NATIVE_BLIT_FLIP_H ) ? BUFFER_FLIP_H : 0 ) |
+	       ( ( mode & NATIVE_BLIT_FLIP_V ) ? BUFFER_FLIP_V : 0 );
 
-	const DWORD * pdSrc;
-	const BYTE * pbSrc;
-	const float * pfSrc;
-	DWORD * pDst;
-	bool bBadMode;
+	// the source rect is the window rect mirrored by the flip
+	const u32 nSrcLeft = ( flip & BUFFER_FLIP_H ) ? nWidth - nRight : nLeft;
+	const u32 nSrcTop = ( flip & BUFFER_FLIP_V ) ? nHeight - nBottom : nTop;
 
-	assert(( mode & NATIVE_BLIT_COLOR_MASK ) == mode);
+	brSrc.nCStride	= BufferFormatSize(srcFormat);
+	brSrc.nRStride	= nWidth * brSrc.nCStride;
+	brSrc.pData	= ( u8 * ) pSrc + nSrcTop * brSrc.nRStride + nSrcLeft * brSrc.nCStride;
+	brSrc.nRCount	= nBottom - nTop;
+	brSrc.nCCount	= nRight - nLeft;
 
-	pDst = ( DWORD * ) pWindow->pPixels;
-	bBadMode = false;
-	switch ( mode )
-	{
-		case NATIVE_BLIT_BGRA:
-			pdSrc = ( const DWORD * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ ( nHeight - 1 - r ) * nWidth + nWidth - 1 - c ] = pdSrc[ r * nWidth + c ];
-				}
-			}
-			break;
-		case NATIVE_BLIT_BGR:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					pDst[ ( nHeight - 1 - r ) * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( pbSrc[ 2 ] << 16 ) |
-						( pbSrc[ 1 ] << 8 ) |
-						( pbSrc[ 0 ] );
-
-					pbSrc += 3;
-				}
-			}
-			break;
-		case NATIVE_BLIT_F32:
-			pfSrc	= ( const float * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = ( BYTE ) ( *pfSrc * 255.0f );
-
-					pDst[ ( nHeight - 1 - r ) * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pfSrc;
-				}
-			}
-			break;
-		case NATIVE_BLIT_U8:
-			pbSrc	= ( const BYTE * ) pSrc;
-			for ( int r = 0; r < nHeight; ++r )
-			{
-				for ( int c = 0; c < nWidth; ++c )
-				{
-					BYTE grey = *pbSrc;
-
-					pDst[ ( nHeight - 1 - r ) * nWidth + nWidth - 1 - c ] =
-						( 0xff000000 ) |
-						( grey << 16 ) |
-						( grey << 8 ) |
-						( grey );
-
-					++pbSrc;
-				}
-			}
-			break;
-		default:
-			bBadMode = true;
-			break;
-	}
+	brDst.nCStride	= BYTES_PER_PIXEL;
+	brDst.nRStride	= nWidth * BYTES_PER_PIXEL;
+	brDst.pData	= ( u8 * ) pWindow->pPixels + nTop * brDst.nRStride + nLeft * BYTES_PER_PIXEL;
+	brDst.nRCount	= nBottom - nTop;
+	brDst.nCCount	= nRight - nLeft;
 
-	return !bBadMode;
+	return Buffer2DConvert(&brDst, BUFFER_FORMAT_BGRA, &brSrc, srcFormat, flip) &&
+	       _PresentSurface(hWnd, pWindow->hMemDC, nLeft, nTop, nRight - nLeft, nBottom - nTop);
 }
-bool			NativeWindowBilt(NativeWindow * pWindow, const void * pSrc, int mode)
+void *			NativeWindowGetSurface(NativeWindow * pWindow)
 {
-	NativeBlitMode mColor = (NativeBlitMode)(mode & NATIVE_BLIT_COLOR_MASK);
-	bool bSuccess;
+	return pWindow->pPixels;
+}
+bool			NativeWindowPresentRect(NativeWindow * pWindow, int nLeft, int nTop, int nRight, int nBottom)
+{
+	// read once, a present thread may get here after the window closed
+	const HWND hWnd = pWindow->hWnd;
 
-	switch ((mode >> 30) & 3)
+	if ( hWnd == NULL || nLeft < 0 || nTop < 0 || nRight > pWindow->nWidth || nBottom > pWindow->nHeight || nLeft >= nRight || nTop >= nBottom )
 	{
-		case 0: bSuccess = _NativeWindowBilt(pWindow, pSrc, mColor); break;
-		case 1: bSuccess = _NativeWindowBiltFlipH(pWindow, pSrc, mColor); break;
-		case 2: bSuccess = _NativeWindowBiltFlipV(pWindow, pSrc, mColor); break;
-		case 3: bSuccess = _NativeWindowBiltFlipHV(pWindow, pSrc, mColor); break;
+		return false;
 	}
 
-	return bSuccess && _PresentSurface(pWindow->hWnd, pWindow->hMemDC, pWindow->nWidth, pWindow->nHeight);
+	return _PresentSurface(hWnd, pWindow->hMemDC, nLeft, nTop, nRight - nLeft, nBottom - nTop);
 }
 
 void			NativeRegisterWindowCallbacks(NativeWindow * pWindow, const NativeWindowCallbacks * pCallbacks)
@@ -741,10 +521,77 @@ void			NativeRegisterMouseCallbacks(NativeWindow * pWindow, const NativeMouseCal
 	pWindow->cbMouse = *pCallbacks;
 }
 
+void			NativeScriptInput(NativeWindow * pWindow, const NativeInputEvent * pEvents, int nEvents)
+{
+	assert(nEvents >= 0 && ( pEvents || nEvents == 0 ));
+
+	delete[] pWindow->pScript;
+	pWindow->pScript = nEvents > 0 ? new NativeInputEvent[ nEvents ] : NULL;
+	pWindow->nScript = nEvents;
+	pWindow->iScript = 0;
+
+	for ( int i = 0; i < nEvents; ++i )
+	{
+		pWindow->pScript[ i ] = pEvents[ i ];
+		pWindow->pScript[ i ].iFrame += pWindow->nFrames;
+	}
+}
+
+static UINT		_GetInputMessage(int type)
+{
+	switch ( type )
+	{
+		case NATIVE_INPUT_KEY_DOWN:	return WM_KEYDOWN;
+		case NATIVE_INPUT_KEY_UP:	return WM_KEYUP;
+		case NATIVE_INPUT_MOUSE_MOVE:	return WM_MOUSEMOVE;
+		case NATIVE_INPUT_LEFT_DOWN:	return WM_LBUTTONDOWN;
+		case NATIVE_INPUT_LEFT_UP:	return WM_LBUTTONUP;
+		case NATIVE_INPUT_RIGHT_DOWN:	return WM_RBUTTONDOWN;
+		case NATIVE_INPUT_RIGHT_UP:	return WM_RBUTTONUP;
+		case NATIVE_INPUT_MIDDLE_DOWN:	return WM_MBUTTONDOWN;
+		case NATIVE_INPUT_MIDDLE_UP:	return WM_MBUTTONUP;
+		case NATIVE_INPUT_CLOSE:	return WM_CLOSE;
+		default:			return WM_NULL;
+	}
+}
+static void		_PlayScript(NativeWindow * pWindow)
+{
+	++pWindow->nFrames;
+
+	while ( pWindow->hWnd && pWindow->iScript < pWindow->nScript &&
+		pWindow->pScript[ pWindow->iScript ].iFrame <= pWindow->nFrames )
+	{
+		const NativeInputEvent & e = pWindow->pScript[ pWindow->iScript++ ];
+		const UINT uMsg = _GetInputMessage(e.type);
+
+		// through the window procedure, as if the user did it
+		if ( pWindow->hInputWnd && uMsg != WM_CLOSE )
+		{
+			PostMessage(pWindow->hInputWnd, WM_NATIVE_INPUT, e.type, MAKELPARAM(e.x, e.y));
+		}
+		else if ( uMsg == WM_KEYDOWN || uMsg == WM_KEYUP )
+		{
+			SendMessage(pWindow->hWnd, uMsg, e.x, 0);
+		}
+		else if ( uMsg != WM_NULL )
+		{
+			SendMessage(pWindow->hWnd, uMsg, 0, uMsg == WM_CLOSE ? 0 : MAKELPARAM(e.x, e.y));
+		}
+	}
+}
+
 void			NativeInputPoll()
 {
 	MSG msg;
 
+	for ( int i = 0; i < NUM_MAX_WINDOW; ++i )
+	{
+		if ( native.bWindows[ i ] && native.sWindows[ i ].hWnd )
+		{
+			_PlayScript(native.sWindows + i);
+		}
+	}
+
 	do
 	{
 		msg.message = WM_NULL;
@@ -761,40 +608,268 @@ void			NativeInputPoll()
 	while ( msg.message != WM_QUIT );
 }
 
-int64_t			NativeGetTick()
+// On the input thread: the callbacks, then a posted WM_NULL wakes a
+// NativeWaitUntil(..., true) on the window's thread.
+static void		_DeliverInput(NativeWindow * pWindow, int type, int x, int y)
 {
-	static LARGE_INTEGER liFrequence = { 0 };
-	static LARGE_INTEGER liBegin = { 0 };
-	LARGE_INTEGER liEnd;
-	
-	if (liFrequence.QuadPart == 0)
+	switch ( type )
 	{
-		QueryPerformanceFrequency(&liFrequence);
-		QueryPerformanceCounter(&liBegin);
-		return 0;
+		case NATIVE_INPUT_KEY_DOWN:	if ( pWindow->cbKeyboard.down ) pWindow->cbKeyboard.down(x); break;
+		case NATIVE_INPUT_KEY_UP:	if ( pWindow->cbKeyboard.up ) pWindow->cbKeyboard.up(x); break;
+		case NATIVE_INPUT_MOUSE_MOVE:	if ( pWindow->cbMouse.move ) pWindow->cbMouse.move(x, y); break;
+		case NATIVE_INPUT_LEFT_DOWN:	if ( pWindow->cbMouse.leftdown ) pWindow->cbMouse.leftdown(x, y); break;
+		case NATIVE_INPUT_LEFT_UP:	if ( pWindow->cbMouse.leftup ) pWindow->cbMouse.leftup(x, y); break;
+		case NATIVE_INPUT_RIGHT_DOWN:	if ( pWindow->cbMouse.rightdown ) pWindow->cbMouse.rightdown(x, y); break;
+		case NATIVE_INPUT_RIGHT_UP:	if ( pWindow->cbMouse.rightup ) pWindow->cbMouse.rightup(x, y); break;
+		case NATIVE_INPUT_MIDDLE_DOWN:	if ( pWindow->cbMouse.middledown ) pWindow->cbMouse.middledown(x, y); break;
+		case NATIVE_INPUT_MIDDLE_UP:	if ( pWindow->cbMouse.middleup ) pWindow->cbMouse.middleup(x, y); break;
+		default:			return;
+	}
+	PostMessage(pWindow->hWnd, WM_NULL, 0, 0);
+}
+static void		_DeliverRawInput(NativeWindow * pWindow, HRAWINPUT hRawInput)
+{
+	static const struct { USHORT flag; int type; } buttons[] =
+	{
+		{ RI_MOUSE_LEFT_BUTTON_DOWN,	NATIVE_INPUT_LEFT_DOWN },
+		{ RI_MOUSE_LEFT_BUTTON_UP,	NATIVE_INPUT_LEFT_UP },
+		{ RI_MOUSE_RIGHT_BUTTON_DOWN,	NATIVE_INPUT_RIGHT_DOWN },
+		{ RI_MOUSE_RIGHT_BUTTON_UP,	NATIVE_INPUT_RIGHT_UP },
+		{ RI_MOUSE_MIDDLE_BUTTON_DOWN,	NATIVE_INPUT_MIDDLE_DOWN },
+		{ RI_MOUSE_MIDDLE_BUTTON_UP,	NATIVE_INPUT_MIDDLE_UP },
+	};
+	RAWINPUT raw;
+	UINT nSize = sizeof(raw);
+	POINT pt;
+
+	// sinks see everything, keep what the window would have had
+	if ( GetForegroundWindow() != pWindow->hWnd ||
+	     GetRawInputData(hRawInput, RID_INPUT, &raw, &nSize, sizeof(RAWINPUTHEADER)) == ( UINT ) -1 )
+	{
+		return;
+	}
+
+	if ( raw.header.dwType == RIM_TYPEKEYBOARD && raw.data.keyboard.VKey != 0xff )
+	{
+		_DeliverInput(pWindow, ( raw.data.keyboard.Flags & RI_KEY_BREAK ) ? NATIVE_INPUT_KEY_UP : NATIVE_INPUT_KEY_DOWN, raw.data.keyboard.VKey, 0);
+	}
+	else if ( raw.header.dwType == RIM_TYPEMOUSE && GetCursorPos(&pt) && ScreenToClient(pWindow->hWnd, &pt) )
+	{
+		// raw motion is in counts, the callbacks want the window's pixels
+		if ( raw.data.mouse.lLastX != 0 || raw.data.mouse.lLastY != 0 )
+		{
+			_DeliverInput(pWindow, NATIVE_INPUT_MOUSE_MOVE, pt.x, pt.y);
+		}
+		for ( size_t i = 0; i < _countof(buttons); ++i )
+		{
+			if ( raw.data.mouse.usButtonFlags & buttons[ i ].flag )
+			{
+				_DeliverInput(pWindow, buttons[ i ].type, pt.x, pt.y);
+			}
+		}
+	}
+}
+static LRESULT CALLBACK _InputWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	NativeWindow * pWindow;
+
+	if ( WM_NCCREATE == uMsg )
+	{
+		pWindow = ( NativeWindow * ) ( ( CREATESTRUCT * ) lParam )->lpCreateParams;
+		SetWindowLongPtr(hWnd, GWLP_USERDATA, ( LONG_PTR ) pWindow);
+		return TRUE;
+	}
+
+	pWindow = ( NativeWindow * ) GetWindowLongPtr(hWnd, GWLP_USERDATA);
+	switch ( uMsg )
+	{
+		case WM_INPUT:		_DeliverRawInput(pWindow, ( HRAWINPUT ) lParam); break;
+		case WM_NATIVE_INPUT:	_DeliverInput(pWindow, ( int ) wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)); return 0;
+		case WM_DESTROY:	PostQuitMessage(0); break;
+		default:		break;
+	}
+	return DefWindowProc(hWnd, uMsg, wParam, lParam);
+}
+static void		_RunInputThread(NativeWindow * pWindow, HANDLE hReady, HWND * phInputWnd)
+{
+	RAWINPUTDEVICE devices[ 2 ];
+	HWND hInputWnd;
+	MSG msg;
+
+	hInputWnd = CreateWindow(StrInputWndClassName, NULL, 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, native.hInstance, ( LPVOID ) pWindow);
+
+	// generic desktop mouse and keyboard, also while this window isn't foreground
+	devices[ 0 ].usUsagePage	= 0x01;
+	devices[ 0 ].usUsage		= 0x02;
+	devices[ 0 ].dwFlags		= RIDEV_INPUTSINK;
+	devices[ 0 ].hwndTarget		= hInputWnd;
+	devices[ 1 ]			= devices[ 0 ];
+	devices[ 1 ].usUsage		= 0x06;
+	if ( hInputWnd && !RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE)) )
+	{
+		DestroyWindow(hInputWnd);
+		hInputWnd = NULL;
+	}
+
+	*phInputWnd = hInputWnd;
+	SetEvent(hReady);
+	if ( !hInputWnd )
+	{
+		return;
+	}
+
+	while ( GetMessage(&msg, NULL, 0, 0) > 0 )
+	{
+		DispatchMessage(&msg);
+	}
+
+	devices[ 0 ].dwFlags	= devices[ 1 ].dwFlags		= RIDEV_REMOVE;
+	devices[ 0 ].hwndTarget	= devices[ 1 ].hwndTarget	= NULL;
+	RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE));
+}
+
+bool			NativeWindowStartInputThread(NativeWindow * pWindow)
+{
+	std::thread & thread = native.inputThreads[ pWindow - native.sWindows ];
+	HANDLE hReady;
+	HWND hInputWnd;
+
+	if ( pWindow->hInputWnd )
+	{
+		return true;
+	}
+	if ( !pWindow->hWnd || ( hReady = CreateEvent(NULL, TRUE, FALSE, NULL) ) == NULL )
+	{
+		return false;
+	}
+
+	// the window and raw input belong to the thread that made them
+	thread = std::thread(_RunInputThread, pWindow, hReady, &hInputWnd);
+	WaitForSingleObject(hReady, INFINITE);
+	CloseHandle(hReady);
+
+	if ( !hInputWnd )
+	{
+		thread.join();
+		return false;
+	}
+	pWindow->hInputWnd = hInputWnd;
+	return true;
+}
+void			NativeWindowStopInputThread(NativeWindow * pWindow)
+{
+	std::thread & thread = native.inputThreads[ pWindow - native.sWindows ];
+	HWND hInputWnd = pWindow->hInputWnd;
+
+	if ( !hInputWnd )
+	{
+		return;
+	}
+
+	// back to the window procedure, once the thread delivered what it has
+	PostMessage(hInputWnd, WM_CLOSE, 0, 0);
+	thread.join();
+	pWindow->hInputWnd = NULL;
+}
+void			NativeSendInput(NativeWindow * pWindow, int type, int x, int y)
+{
+	const UINT uMsg = _GetInputMessage(type);
+
+	assert(uMsg != WM_CLOSE);
+
+	if ( pWindow->hInputWnd )
+	{
+		PostMessage(pWindow->hInputWnd, WM_NATIVE_INPUT, type, MAKELPARAM(x, y));
+	}
+	else if ( uMsg == WM_KEYDOWN || uMsg == WM_KEYUP )
+	{
+		PostMessage(pWindow->hWnd, uMsg, x, 0);
+	}
+	else if ( uMsg != WM_NULL )
+	{
+		PostMessage(pWindow->hWnd, uMsg, 0, MAKELPARAM(x, y));
+	}
+}
+
+static LARGE_INTEGER	_QueryCounter(bool bFrequency)
+{
+	LARGE_INTEGER li;
+	if ( bFrequency )
+	{
+		QueryPerformanceFrequency(&li);
 	}
 	else
 	{
-		QueryPerformanceCounter(&liEnd);
-		return (liEnd.QuadPart - liBegin.QuadPart) * 1000000 / liFrequence.QuadPart;
+		QueryPerformanceCounter(&li);
 	}
+	return li;
+}
+int64_t			NativeGetTick()
+{
+	// set by the first call, whichever thread makes it
+	static const LARGE_INTEGER liFrequence = _QueryCounter(true);
+	static const LARGE_INTEGER liBegin = _QueryCounter(false);
+	LARGE_INTEGER liEnd = _QueryCounter(false);
+
+	return (liEnd.QuadPart - liBegin.QuadPart) * 1000000 / liFrequence.QuadPart;
 }
 
-void *			AlignedMalloc(size_t nSize, size_t nAlign)
+int64_t			NativeGetThreadCpuTick()
 {
-#ifdef _DEBUG
-	return _aligned_malloc_dbg(nSize, nAlign, __FILE__, __LINE__);
-#else
-	return _aligned_malloc(nSize, nAlign);
-#endif
+	FILETIME ftCreation, ftExit, ftKernel, ftUser;
+	ULARGE_INTEGER uliKernel, uliUser;
+
+	GetThreadTimes(GetCurrentThread(), &ftCreation, &ftExit, &ftKernel, &ftUser);
+	uliKernel.LowPart	= ftKernel.dwLowDateTime;
+	uliKernel.HighPart	= ftKernel.dwHighDateTime;
+	uliUser.LowPart		= ftUser.dwLowDateTime;
+	uliUser.HighPart	= ftUser.dwHighDateTime;
+
+	// 100 ns units
+	return static_cast< int64_t >( ( uliKernel.QuadPart + uliUser.QuadPart ) / 10 );
 }
-void			AlignedFree(void * p)
+
+bool			NativeWaitUntil(int64_t iTick, bool bWakeOnInput)
 {
-#ifdef _DEBUG
-	return _aligned_free_dbg(p);
-#else
-	return _aligned_free(p);
-#endif
+	HANDLE hTimer;
+	DWORD nHandles;
+	DWORD dwResult;
+
+	assert(native.hWaitTimer);
+	assert(iTick >= 0 || bWakeOnInput);
+
+	hTimer = native.hWaitTimer;
+	nHandles = 0;
+	if ( iTick >= 0 )
+	{
+		int64_t iWait = iTick - NativeGetTick();
+		if ( iWait <= 0 )
+		{
+			return false;
+		}
+
+		// relative due time, 100 ns units
+		LARGE_INTEGER liDue;
+		liDue.QuadPart = -iWait * 10;
+		if ( !SetWaitableTimer(hTimer, &liDue, 0, NULL, NULL, FALSE) )
+		{
+			return false;
+		}
+		nHandles = 1;
+	}
+
+	dwResult = MsgWaitForMultipleObjectsEx(nHandles,
+					       nHandles ? &hTimer : NULL,
+					       INFINITE,
+					       bWakeOnInput ? QS_ALLINPUT : 0,
+					       MWMO_INPUTAVAILABLE);
+
+	if ( nHandles && dwResult != WAIT_OBJECT_0 )
+	{
+		CancelWaitableTimer(hTimer);
+	}
+
+	return dwResult == WAIT_OBJECT_0 + nHandles;
 }
 
 // Image
@@ -928,4 +1003,6 @@ const NativeMouseCallbacks *		NativeDebugGetMouseCallbacks()
 		init = true;
 	}
 	return &cbs;
-}
\ No newline at end of file
+}
+
+#endif
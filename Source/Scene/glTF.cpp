@@ -18,12 +18,12 @@
 		type objects[ size ];								 \
 	};											 \
 	static struct type##Pool g##type##Pool;							 \
-	static type## *	Get##type()								 \
+	static type *	Get##type()								 \
 	{											 \
 		int byte;									 \
 		int bit;									 \
 		int msk;									 \
-		type## * obj;									 \
+		type * obj;									 \
 												 \
 		if ( g##type##Pool.used < size )						 \
 		{										 \
@@ -50,7 +50,7 @@
 			return NULL;								 \
 		}										 \
 	}											 \
-	static void		Put##type(type * object)					 \
+	static inline void	Put##type(type * object)					 \
 	{											 \
 		int byte;									 \
 		int msk;									 \
@@ -158,7 +158,8 @@ static bool			ReadFile(const char * filename, char * buf, int cnt)
 	assert(buf);
 	assert(cnt > 0);
 
-	if ( !fopen_s(&file, filename, "rb") )
+	file = fopen(filename, "rb");
+	if ( file )
 	{
 		ret = fread(buf, 1, cnt, file);
 		fclose(file);
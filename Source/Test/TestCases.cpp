@@ -6,6 +6,7 @@ static TestSuit suits[] =
 	{"scene",	TestSuit_Scene},
 	{"graphics",	TestSuit_Graphics},
 	{"gltf",	TestSuit_glTF},
+	{"server",	TestSuit_Server},
 };
 
 void		TestMain(int argc, char * argv[])
@@ -16,7 +17,7 @@ void		TestMain(int argc, char * argv[])
 	pName = TestCaseName();
 	pSuit = nullptr;
 
-	if (pSuit = TestFindCase(suits, pName))
+	if ( ( pSuit = TestFindCase(suits, pName) ) )
 	{
 		pSuit->pEntry(argc - 1, argv + 1);
 		return;
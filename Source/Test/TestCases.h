@@ -5,6 +5,9 @@
 #include "../Core/Scene.h"
 #include "../Core/VisualEffects.h"
 
+#include <cstdio>
+#include <cstring>
+
 struct TestCase
 {
 	const char * pName;
@@ -52,7 +55,7 @@ void			TestSuit_##suit(int argc, char * argv[]) \
 	TestCase * pCase; \
 	pName = TestCaseName(); \
 	pCase = nullptr; \
-	if ( pCase = TestFindCase(cases, pName) ) \
+	if ( ( pCase = TestFindCase(cases, pName) ) ) \
 	{ \
 		pCase->pFunc(argc - 1, argv + 1); \
 		return; \
@@ -65,4 +68,5 @@ void			TestMain(int argc, char * argv[]);
 void			TestSuit_Native(int argc, char * argv[]);
 void			TestSuit_Scene(int argc, char * argv[]);
 void			TestSuit_Graphics(int argc, char * argv[]);
-void			TestSuit_glTF(int argc, char * argv[]);
\ No newline at end of file
+void			TestSuit_glTF(int argc, char * argv[]);
+void			TestSuit_Server(int argc, char * argv[]);
\ No newline at end of file
@@ -1,10 +1,20 @@
 #include "TestCases.h"
 #include "../Core/Graphics.h"
+#include "../Core/BufferKernels.h"
+#include "../Core/FrameEncoder.h"
+#include "../Core/FrameRing.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <thread>
 
 using namespace Graphics;
 
 extern void		TestGraphics_Buffer0(int argc, char * argv[]);
 extern void		TestGraphics_Buffer1(int argc, char * argv[]);
+extern void		TestGraphics_Kernel(int argc, char * argv[]);
+extern void		TestGraphics_Ring(int argc, char * argv[]);
+extern void		TestGraphics_Png(int argc, char * argv[]);
 extern void		TestGraphics_Clipping(int argc, char * argv[]);
 extern void		TestGraphics_Rasterization(int argc, char * argv[]);
 
@@ -12,6 +22,9 @@ static TestCase		cases[] =
 {
 	{"buffer0",	TestGraphics_Buffer0},
 	{"buffer1",	TestGraphics_Buffer1},
+	{"kernel",	TestGraphics_Kernel},
+	{"ring",	TestGraphics_Ring},
+	{"png",		TestGraphics_Png},
 	{"clip",	TestGraphics_Clipping},
 	{"raster",	TestGraphics_Rasterization},
 };
@@ -58,10 +71,6 @@ static int	Max(int a, int b)
 {
 	return a >= b ? a : b;
 }
-static int	Min(int a, int b)
-{
-	return a <= b ? a : b;
-}
 static f32	Area(const Vector4 & a, const Vector4 & b, const Vector4 & c)
 {
 	return fabsf(( c.x - a.x ) * ( b.y - a.y ) - ( c.y - a.y ) * ( b.x - a.x ));
@@ -246,11 +255,11 @@ void		TestGraphics_Buffer0(int argc, char * argv[])
 
 	DestroyBuffer(&buf);
 
-	printf("1D Raw:    %7.lld ticks (checksum: %lld records: %lld)\n", iTicks[ 0 ], iChksm[ 0 ], iCount[ 0 ]);
-	printf("1D Buf:    %7.lld ticks (checksum: %lld records: %lld)\n", iTicks[ 1 ], iChksm[ 1 ], iCount[ 1 ]);
-	printf("2D Raw:    %7.lld ticks (checksum: %lld records: %lld)\n", iTicks[ 2 ], iChksm[ 2 ], iCount[ 2 ]);
-	printf("2D Buf:    %7.lld ticks (checksum: %lld records: %lld)\n", iTicks[ 3 ], iChksm[ 3 ], iCount[ 3 ]);
-	printf("2D BufRaw: %7.lld ticks (checksum: %lld records: %lld)\n", iTicks[ 4 ], iChksm[ 4 ], iCount[ 4 ]);
+	printf("1D Raw:    %7" PRId64 " ticks (checksum: %" PRId64 " records: %" PRId64 ")\n", iTicks[ 0 ], iChksm[ 0 ], iCount[ 0 ]);
+	printf("1D Buf:    %7" PRId64 " ticks (checksum: %" PRId64 " records: %" PRId64 ")\n", iTicks[ 1 ], iChksm[ 1 ], iCount[ 1 ]);
+	printf("2D Raw:    %7" PRId64 " ticks (checksum: %" PRId64 " records: %" PRId64 ")\n", iTicks[ 2 ], iChksm[ 2 ], iCount[ 2 ]);
+	printf("2D Buf:    %7" PRId64 " ticks (checksum: %" PRId64 " records: %" PRId64 ")\n", iTicks[ 3 ], iChksm[ 3 ], iCount[ 3 ]);
+	printf("2D BufRaw: %7" PRId64 " ticks (checksum: %" PRId64 " records: %" PRId64 ")\n", iTicks[ 4 ], iChksm[ 4 ], iCount[ 4 ]);
 }
 
 void		TestGraphics_Buffer1(int argc, char * argv[])
@@ -287,7 +296,7 @@ void		TestGraphics_Buffer1(int argc, char * argv[])
 			while ( NativeGetWindowCount() > 0 )
 			{
 				NativeInputPoll();
-				Sleep(10);
+				NativeWaitUntil(NativeGetTick() + 10000, true);
 			}
 			NativeDestroyWindow(pMain);
 		}
@@ -296,6 +305,438 @@ void		TestGraphics_Buffer1(int argc, char * argv[])
 	}
 }
 
+void		TestGraphics_Kernel(int argc, char * argv[])
+{
+	if ( argc < 3 )
+	{
+		printf("Not enough arguments.\n");
+		return;
+	}
+
+	const u32 ROUNDS = Max(1, atoi(argv[ 2 ]));
+	const u32 WIDTH = Max(1, atoi(argv[ 0 ]));
+	const u32 HEIGHT = Max(1, atoi(argv[ 1 ]));
+	const u32 SIZE = WIDTH * HEIGHT * 4;
+	const char * ISA_NAME[] = { "scalar", "sse", "avx2" };
+
+	struct Op
+	{
+		const char *	pName;
+		BufferFormat	dstFormat;
+		BufferFormat	srcFormat;
+		int		flip;
+	};
+	const Op OPS[] =
+	{
+		{ "fill u32",		BUFFER_FORMAT_UNKNOWN,	BUFFER_FORMAT_BGRA,	BUFFER_FLIP_NONE },
+		{ "copy bgra",		BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_BGRA,	BUFFER_FLIP_NONE },
+		{ "copy bgra hv",	BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_BGRA,	BUFFER_FLIP_HV },
+		{ "bgr -> bgra",	BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_BGR,	BUFFER_FLIP_NONE },
+		{ "bgr -> bgra h",	BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_BGR,	BUFFER_FLIP_H },
+		{ "f32 -> bgra v",	BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_F32,	BUFFER_FLIP_V },
+		{ "u8 -> bgra",		BUFFER_FORMAT_BGRA,	BUFFER_FORMAT_U8,	BUFFER_FLIP_NONE },
+		{ "f32 -> u8",		BUFFER_FORMAT_U8,	BUFFER_FORMAT_F32,	BUFFER_FLIP_NONE },
+	};
+
+	Buffer1 bufSrc = CreateBuffer(SIZE + 64);
+	Buffer1 bufDst = CreateBuffer(SIZE + 64);
+	for ( u32 i = 0; i < SIZE / 4; ++i )
+	{
+		( ( f32 * ) bufSrc.pData )[ i ] = ( i % 1024 ) / 1023.0f;
+	}
+
+	const BufferKernelISA isaMax = BufferKernelSetISA(BUFFER_KERNEL_AVX2);
+	for ( const Op & op : OPS )
+	{
+		i64 iChksmScalar = 0;
+		printf("%-14s", op.pName);
+		for ( int isa = BUFFER_KERNEL_SCALAR; isa <= isaMax; ++isa )
+		{
+			BufferKernelSetISA(( BufferKernelISA ) isa);
+
+			const u32 nSrcSize = BufferFormatSize(op.srcFormat);
+			const u32 nDstSize = op.dstFormat ? BufferFormatSize(op.dstFormat) : nSrcSize;
+			BufferRect brSrc = { bufSrc.pData, HEIGHT, WIDTH, WIDTH * nSrcSize, nSrcSize };
+			BufferRect brDst = { bufDst.pData, HEIGHT, WIDTH, WIDTH * nDstSize, nDstSize };
+			u32 value = GREY;
+			i64 iChksm = 0;
+
+			memset(bufDst.pData, 0, SIZE);
+			i64 iBegin = NativeGetTick();
+			for ( u32 iRound = 0; iRound < ROUNDS; ++iRound )
+			{
+				if ( op.dstFormat == BUFFER_FORMAT_UNKNOWN )
+				{
+					Buffer2DFill(&brDst, &value);
+				}
+				else
+				{
+					Buffer2DConvert(&brDst, op.dstFormat, &brSrc, op.srcFormat, op.flip);
+				}
+			}
+			i64 iEnd = NativeGetTick();
+
+			for ( u32 i = 0; i < SIZE / 8; ++i ) iChksm ^= ( ( i64 * ) bufDst.pData )[ i ] * ( i + 1 );
+			if ( isa == BUFFER_KERNEL_SCALAR )
+			{
+				iChksmScalar = iChksm;
+			}
+			printf("  %s %7" PRId64 " ticks%s", ISA_NAME[ isa ], ( iEnd - iBegin ) / ROUNDS, iChksm == iChksmScalar ? "" : " MISMATCH");
+		}
+		printf("\n");
+	}
+	BufferKernelSetISA(isaMax);
+
+	DestroyBuffer(&bufSrc);
+	DestroyBuffer(&bufDst);
+}
+
+// Reference consumer of a frame ring, e.g. of scene minecraft-ring:
+// takes the newest frame in place, sums it as a compositor would read
+// it, and prints the latency from Swap to here once a second.
+void		TestGraphics_Ring(int argc, char * argv[])
+{
+	const char * pName = argc >= 1 ? argv[ 0 ] : "/renderer-ring";
+
+	FrameRingReader reader;
+	printf("Waiting for ring '%s'.\n", pName);
+	while ( !reader.Open(pName) )
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	u64 nSeen = reader.GetFrameCount();
+	u64 iNext = nSeen;
+	i64 nFrames = 0, nDropped = 0, nTorn = 0;
+	i64 iLatency = 0, iLatencyMax = 0, iPresent = 0;
+	i64 iReport = FrameRingClock();
+	u32 chksm = 0;
+	while ( !reader.IsClosed() || reader.GetFrameCount() > nSeen )
+	{
+		FrameRingView view;
+		if ( !reader.Acquire(&view) )
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+		i64 iPickup = FrameRingClock();
+
+		for ( u32 r = 0; r < view.rect.nRCount; ++r )
+		{
+			const u32 * pRow = ( const u32 * ) ( view.rect.pData + r * view.rect.nRStride );
+			for ( u32 c = 0; c < view.rect.nCCount; ++c )
+			{
+				chksm += pRow[ c ];
+			}
+		}
+
+		nSeen		= view.iFrame + 1;
+		nDropped	+= view.iFrame - iNext;
+		iNext		= view.iFrame + 1;
+		if ( !reader.Release(view) )
+		{
+			++nTorn;
+			continue;
+		}
+
+		++nFrames;
+		iLatency	+= iPickup - view.iSwapTick;
+		iLatencyMax	= Max(iLatencyMax, iPickup - view.iSwapTick);
+		iPresent	+= view.iPublishTick - view.iSwapTick;
+
+		if ( iPickup - iReport >= 1000000 )
+		{
+			printf("Frames=%" PRId64 " Dropped=%" PRId64 " Torn=%" PRId64 " Latency=%.2lf/%.2lf(ms) Present=%.2lf(ms) Sum=%08x\n",
+			       nFrames, nDropped, nTorn, iLatency / 1000.0 / nFrames, iLatencyMax / 1000.0, iPresent / 1000.0 / nFrames, chksm);
+			nFrames = nDropped = nTorn = 0;
+			iLatency = iLatencyMax = iPresent = 0;
+			iReport = iPickup;
+		}
+	}
+	printf("Ring closed.\n");
+}
+
+// ---------------------------------------------------------------
+// PNG check: chunk CRCs, the zlib stream (stored and fixed Huffman
+// blocks, which is all the encoder writes) and its Adler-32, the row
+// filters, then every pixel against what was encoded.
+// ---------------------------------------------------------------
+
+struct PngBits
+{
+	const u8 *	pData;
+	size_t		nSize;
+	size_t		iBit;
+
+	u32		Get(u32 n)	// LSB first
+	{
+		u32 value = 0;
+		for ( u32 i = 0; i < n; ++i, ++iBit )
+		{
+			ENSURE_TRUE(iBit / 8 < nSize);
+			value |= ( ( pData[ iBit / 8 ] >> ( iBit % 8 ) ) & 1u ) << i;
+		}
+		return value;
+	}
+};
+
+struct PngHuffman
+{
+	u32		count[ 16 ];
+	u32		symbol[ 288 ];
+
+	void		Build(const u8 * pLengths, u32 n)
+	{
+		u32 offset[ 16 ] = { 0 };
+
+		memset(count, 0, sizeof(count));
+		for ( u32 i = 0; i < n; ++i )
+		{
+			++count[ pLengths[ i ] ];
+		}
+		count[ 0 ] = 0;
+		for ( u32 len = 1; len < 15; ++len )
+		{
+			offset[ len + 1 ] = offset[ len ] + count[ len ];
+		}
+		for ( u32 i = 0; i < n; ++i )
+		{
+			if ( pLengths[ i ] )
+			{
+				symbol[ offset[ pLengths[ i ] ]++ ] = i;
+			}
+		}
+	}
+	u32		Decode(PngBits & bits) const	// codes come MSB first
+	{
+		i32 code = 0, first = 0, index = 0;
+		for ( u32 len = 1; len < 16; ++len )
+		{
+			code |= static_cast< i32 >( bits.Get(1) );
+			if ( code - static_cast< i32 >( count[ len ] ) < first )
+			{
+				return symbol[ index + ( code - first ) ];
+			}
+			index	+= static_cast< i32 >( count[ len ] );
+			first	= ( first + static_cast< i32 >( count[ len ] ) ) << 1;
+			code	<<= 1;
+		}
+		ENSURE_TRUE(false);
+		return 0;
+	}
+};
+
+static u32	_PngCrc(const u8 * pData, size_t nSize)
+{
+	u32 crc = 0xffffffffu;
+	while ( nSize-- > 0 )
+	{
+		crc ^= *pData++;
+		for ( int k = 0; k < 8; ++k )
+		{
+			crc = ( crc & 1 ) ? 0xedb88320u ^ ( crc >> 1 ) : crc >> 1;
+		}
+	}
+	return ~crc;
+}
+static u32	_PngBE(const u8 * p)
+{
+	return ( static_cast< u32 >( p[ 0 ] ) << 24 ) | ( p[ 1 ] << 16 ) | ( p[ 2 ] << 8 ) | p[ 3 ];
+}
+
+static void	_PngInflate(std::vector<u8> * pOut, const std::vector<u8> & zlib)
+{
+	static const u32 lengthBase[ 29 ]	= { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const u8 lengthExtra[ 29 ]	= { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const u32 distBase[ 30 ]		= { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const u8 distExtra[ 30 ]		= { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	ENSURE_TRUE(zlib.size() >= 6);
+	ENSURE_TRUE(( zlib[ 0 ] & 0x0f ) == 8 && ( zlib[ 0 ] * 256 + zlib[ 1 ] ) % 31 == 0 && !( zlib[ 1 ] & 0x20 ));
+
+	u8 lengths[ 288 ];
+	PngHuffman literals, distances;
+	for ( u32 i = 0; i < 288; ++i )
+	{
+		lengths[ i ] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+	}
+	literals.Build(lengths, 288);
+	memset(lengths, 5, 30);
+	distances.Build(lengths, 30);
+
+	PngBits bits = { zlib.data() + 2, zlib.size() - 6, 0 };
+	for ( u32 bFinal = 0; !bFinal; )
+	{
+		bFinal		= bits.Get(1);
+		u32 type	= bits.Get(2);
+		ENSURE_TRUE(type == 0 || type == 1);
+
+		if ( type == 0 )
+		{
+			bits.iBit = ( bits.iBit + 7 ) / 8 * 8;
+			u32 n = bits.Get(16);
+			ENSURE_TRUE(bits.Get(16) == ( ~n & 0xffff ));
+			while ( n-- > 0 )
+			{
+				pOut->push_back(static_cast< u8 >( bits.Get(8) ));
+			}
+			continue;
+		}
+
+		for ( ;; )
+		{
+			u32 sym = literals.Decode(bits);
+			if ( sym < 256 )
+			{
+				pOut->push_back(static_cast< u8 >( sym ));
+				continue;
+			}
+			if ( sym == 256 )
+			{
+				break;
+			}
+			ENSURE_TRUE(sym - 257 < 29);
+			u32 nLength	= lengthBase[ sym - 257 ] + bits.Get(lengthExtra[ sym - 257 ]);
+			u32 iDist	= distances.Decode(bits);
+			ENSURE_TRUE(iDist < 30);
+			u32 nDist	= distBase[ iDist ] + bits.Get(distExtra[ iDist ]);
+			ENSURE_TRUE(nDist <= pOut->size());
+			while ( nLength-- > 0 )
+			{
+				pOut->push_back((*pOut)[ pOut->size() - nDist ]);
+			}
+		}
+	}
+
+	u32 a = 1, b = 0;
+	for ( u8 v : *pOut )
+	{
+		a = ( a + v ) % 65521;
+		b = ( b + a ) % 65521;
+	}
+	ENSURE_TRUE(_PngBE(zlib.data() + zlib.size() - 4) == ( ( b << 16 ) | a ));
+}
+
+// the frame's BGRA pixel: gradients with repeats for the matcher, and noise
+static u32	_PngPixel(Integer iFrame, u32 x, u32 y)
+{
+	u32 n = ( x * 73856093u ) ^ ( y * 19349663u ) ^ ( static_cast< u32 >( iFrame ) * 83492791u );
+	u8 r = static_cast< u8 >( x * 2 + iFrame * 16 );
+	u8 g = static_cast< u8 >( ( y / 4 ) * 8 );
+	u8 bl = static_cast< u8 >( ( x / 16 + y / 16 ) & 1 ? 0xff : n >> 24 );
+	return 0xff000000u | ( r << 16 ) | ( g << 8 ) | bl;
+}
+
+static void	_PngCheck(const char * pPath, Integer iFrame, u32 nWidth, u32 nHeight)
+{
+	static const u8 signature[ 8 ] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	FILE * pFile = fopen(pPath, "rb");
+	ENSURE_NOT_NULL(pFile);
+	std::vector<u8> file;
+	u8 buf[ 4096 ];
+	for ( size_t n; ( n = fread(buf, 1, sizeof(buf), pFile) ) > 0; )
+	{
+		file.insert(file.end(), buf, buf + n);
+	}
+	fclose(pFile);
+
+	ENSURE_TRUE(file.size() >= 8 && memcmp(file.data(), signature, 8) == 0);
+
+	std::vector<u8> zlib;
+	bool bHeader = false, bEnd = false;
+	for ( size_t i = 8; !bEnd; )
+	{
+		ENSURE_TRUE(i + 12 <= file.size());
+		const u32 nSize		= _PngBE(&file[ i ]);
+		ENSURE_TRUE(i + 12 + nSize <= file.size());
+		const u8 * pType	= &file[ i + 4 ];
+		const u8 * pData	= pType + 4;
+		ENSURE_TRUE(_PngBE(pData + nSize) == _PngCrc(pType, nSize + 4));
+
+		if ( memcmp(pType, "IHDR", 4) == 0 )
+		{
+			ENSURE_TRUE(nSize == 13 && _PngBE(pData) == nWidth && _PngBE(pData + 4) == nHeight);
+			ENSURE_TRUE(pData[ 8 ] == 8 && pData[ 9 ] == 2 && pData[ 10 ] == 0 && pData[ 11 ] == 0 && pData[ 12 ] == 0);
+			bHeader = true;
+		}
+		else if ( memcmp(pType, "IDAT", 4) == 0 )
+		{
+			zlib.insert(zlib.end(), pData, pData + nSize);
+		}
+		bEnd	= memcmp(pType, "IEND", 4) == 0;
+		i	+= 12 + nSize;
+	}
+	ENSURE_TRUE(bHeader);
+
+	std::vector<u8> rows;
+	_PngInflate(&rows, zlib);
+
+	const size_t nRowSize = 1 + nWidth * 3;
+	ENSURE_TRUE(rows.size() == nRowSize * nHeight);
+	for ( u32 y = 0; y < nHeight; ++y )
+	{
+		u8 * pRow	= &rows[ y * nRowSize + 1 ];
+		const u8 * pUp	= y > 0 ? pRow - nRowSize : nullptr;
+		const u8 filter	= pRow[ -1 ];
+		ENSURE_TRUE(filter <= 4);
+		for ( u32 i = 0; i < nWidth * 3; ++i )
+		{
+			const int a	= i >= 3 ? pRow[ i - 3 ] : 0;
+			const int b	= pUp ? pUp[ i ] : 0;
+			const int c	= pUp && i >= 3 ? pUp[ i - 3 ] : 0;
+			const int p	= a + b - c;
+			const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+			const int predict[ 5 ] = { 0, a, b, ( a + b ) / 2, pa <= pb && pa <= pc ? a : pb <= pc ? b : c };
+			pRow[ i ] = static_cast< u8 >( pRow[ i ] + predict[ filter ] );
+		}
+		for ( u32 x = 0; x < nWidth; ++x )
+		{
+			const u32 pixel = _PngPixel(iFrame, x, y);
+			ENSURE_TRUE(pRow[ x * 3 ] == ( ( pixel >> 16 ) & 0xff ) && pRow[ x * 3 + 1 ] == ( ( pixel >> 8 ) & 0xff ) && pRow[ x * 3 + 2 ] == ( pixel & 0xff ));
+		}
+	}
+}
+
+// Encodes frames through the FrameEncoder to PNG, then decodes and checks
+// each file. Path pattern of the frame number, frames, width, height.
+void		TestGraphics_Png(int argc, char * argv[])
+{
+	const char * pPattern	= argc >= 1 ? argv[ 0 ] : "png-%03lld.png";
+	const Integer nFrames	= argc >= 2 ? Max(1, atoi(argv[ 1 ])) : 4;
+	const u32 nWidth	= argc >= 3 ? Max(1, atoi(argv[ 2 ])) : 333;
+	const u32 nHeight	= argc >= 4 ? Max(1, atoi(argv[ 3 ])) : 211;
+
+	{
+		FrameOutputDesc desc = { FrameFileFormat::PNG, pPattern, 2, 2, 0 };
+		FrameEncoder encoder(desc, nWidth, nHeight);
+
+		for ( Integer i = 0; i < nFrames; ++i )
+		{
+			BufferRect rect;
+			Integer iSlot = encoder.Acquire(BUFFER_FORMAT_BGRA, &rect);
+			for ( u32 y = 0; y < nHeight; ++y )
+			{
+				u32 * pRow = ( u32 * ) ( rect.pData + y * rect.nRStride );
+				for ( u32 x = 0; x < nWidth; ++x )
+				{
+					pRow[ x ] = _PngPixel(i, x, y);
+				}
+			}
+			encoder.Submit(iSlot);
+		}
+		ENSURE_TRUE(encoder.Close());
+	}
+
+	for ( Integer i = 0; i < nFrames; ++i )
+	{
+		char path[ 1024 ];
+		snprintf(path, sizeof(path), pPattern, static_cast< long long >( i ));
+		_PngCheck(path, i, nWidth, nHeight);
+		printf("%s: %ux%u, checked.\n", path, nWidth, nHeight);
+	}
+}
+
 void		TestGraphics_Clipping(int argc, char * argv[])
 {
 	Buffer1 bufColor = CreateBuffer(WINDOW_WIDTH * WINDOW_HEIGHT * BYTES_PER_PIXEL);
@@ -322,7 +763,6 @@ void		TestGraphics_Clipping(int argc, char * argv[])
 		{inClipCoord[1], inClipCoord[1]},
 		{inClipCoord[2], inClipCoord[2]},
 	};
-	int inCount = 3;
 
 	Varyings outVaryings[ 64 ];
 	Vector4 outClipCoord[ 64 ];
@@ -442,7 +882,7 @@ void		TestGraphics_Clipping(int argc, char * argv[])
 						{
 							printf("\tpos=(%.2f, %.2f, %.2f, %.2f)", outClipCoord[ tri + i ].x, outClipCoord[ tri + i ].y, outClipCoord[ tri + i ].z, outClipCoord[ tri + i ].w );
 							printf("\tvar=(");
-							for (int f = 0; f < sizeof(Varyings) / sizeof(f32); ++f)
+							for (int f = 0; f < static_cast< int >( sizeof(Varyings) / sizeof(f32) ); ++f)
 							{
 								printf("%.2f, ", ((f32 *)&outVaryings[ tri + i ])[f]);
 							}
@@ -465,7 +905,7 @@ void		TestGraphics_Clipping(int argc, char * argv[])
 					NativeWindowBilt(gpMain, bufColor.pData, NATIVE_BLIT_BGRA | NATIVE_BLIT_FLIP_V);
 				}
 
-				Sleep(10);
+				NativeWaitUntil(NativeGetTick() + 10000, true);
 			}
 			NativeDestroyWindow(gpMain);
 		}
@@ -522,7 +962,7 @@ void		TestGraphics_Rasterization(int argc, char * argv[])
 			{
 				NativeInputPoll();
 
-				Sleep(10);
+				NativeWaitUntil(NativeGetTick() + 10000, true);
 			}
 			NativeDestroyWindow(gpMain);
 		}
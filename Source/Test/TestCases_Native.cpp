@@ -1,14 +1,21 @@
 #include "TestCases.h"
 #include "../Core/Native.h"
 
+#include <cctype>
+#include <cinttypes>
+
 extern void		TestNative_Callbacks(int argc, char * argv[]);
 extern void		TestNative_Blit(int argc, char * argv[]);
 extern void		TestNative_MultipleWindow(int argc, char * argv[]);
+extern void		TestNative_Alloc(int argc, char * argv[]);
+extern void		TestNative_Script(int argc, char * argv[]);
 static TestCase		cases[] =
 {
 	{"callback",	TestNative_Callbacks},
 	{"blit",	TestNative_Blit},
 	{"window",	TestNative_MultipleWindow},
+	{"alloc",	TestNative_Alloc},
+	{"script",	TestNative_Script},
 };
 TestSuitEntry(Native)
 
@@ -81,7 +88,7 @@ void		TestNative_Callbacks(int argc, char * argv[])
 			while ( NativeGetWindowCount() > 0 )
 			{
 				NativeInputPoll();
-				Sleep(10);
+				NativeWaitUntil(NativeGetTick() + 10000, true);
 			}
 
 			NativeDestroyWindow(pMain);
@@ -120,7 +127,7 @@ void		TestNative_Blit(int argc, char * argv[])
 			while ( NativeGetWindowCount() > 0 )
 			{
 				NativeInputPoll();
-				Sleep(10);
+				NativeWaitUntil(NativeGetTick() + 10000, true);
 			}
 			NativeDestroyWindow(pMain);
 		}
@@ -134,19 +141,19 @@ void		TestNative_MultipleWindow(int argc, char * argv[])
 
 	if ( NativeInitialize() )
 	{
-		wsprintf(bufWindowTitle, L"Window %d", 0);
+		swprintf(bufWindowTitle, 256, L"Window %d", 0);
 		pWindowGroup[ 0 ] = NativeCreateWindow(bufWindowTitle, 300, 200, 200, 200);
-		wsprintf(bufWindowTitle, L"Window %d", 1);
+		swprintf(bufWindowTitle, 256, L"Window %d", 1);
 		pWindowGroup[ 1 ] = NativeCreateWindow(bufWindowTitle, 300, 200, 600, 200);
-		wsprintf(bufWindowTitle, L"Window %d", 2);
+		swprintf(bufWindowTitle, 256, L"Window %d", 2);
 		pWindowGroup[ 2 ] = NativeCreateWindow(bufWindowTitle, 300, 200, 200, 500);
-		wsprintf(bufWindowTitle, L"Window %d", 3);
+		swprintf(bufWindowTitle, 256, L"Window %d", 3);
 		pWindowGroup[ 3 ] = NativeCreateWindow(bufWindowTitle, 300, 200, 600, 500);
 
 		while ( NativeGetWindowCount() > 0 )
 		{
 			NativeInputPoll();
-			Sleep(10);
+			NativeWaitUntil(NativeGetTick() + 10000, true);
 		}
 
 		for (NativeWindow * p : pWindowGroup)
@@ -156,4 +163,84 @@ void		TestNative_MultipleWindow(int argc, char * argv[])
 
 		NativeTerminate();
 	}
-}
\ No newline at end of file
+}
+void		TestNative_Alloc(int argc, char * argv[])
+{
+	const int WIDTH = argc >= 1 ? atoi(argv[ 0 ]) : 3840;
+	const int HEIGHT = argc >= 2 ? atoi(argv[ 1 ]) : 2160;
+	const int ROUNDS = argc >= 3 ? atoi(argv[ 2 ]) : 10;
+	const size_t SIZE = ( size_t ) WIDTH * HEIGHT * sizeof(BGRA);
+	const char * POLICY_NAME[] = { "default", "huge page" };
+
+	NativeAllocStats stats;
+
+	for ( int policy = NATIVE_ALLOC_DEFAULT; policy <= NATIVE_ALLOC_HUGE_PAGE; ++policy )
+	{
+		Graphics::u32 * pPixels = ( Graphics::u32 * ) AlignedMallocEx(SIZE, 64, policy);
+		int64_t iChksm = 0;
+
+		memset(pPixels, 0, SIZE);
+
+		// column order, every access lands on a different page
+		int64_t iBegin = NativeGetTick();
+		for ( int iRound = 0; iRound < ROUNDS; ++iRound )
+		{
+			for ( int x = 0; x < WIDTH; ++x )
+			{
+				for ( int y = 0; y < HEIGHT; ++y )
+				{
+					pPixels[ ( size_t ) y * WIDTH + x ] += x ^ y;
+				}
+			}
+		}
+		int64_t iEnd = NativeGetTick();
+
+		for ( size_t i = 0; i < SIZE / 4; i += 4099 ) iChksm += pPixels[ i ];
+		AlignedFree(pPixels);
+
+		printf("%-9s: %8" PRId64 " ticks per round (checksum: %" PRId64 ")\n", POLICY_NAME[ policy ], ( iEnd - iBegin ) / ROUNDS, iChksm);
+	}
+
+	NativeGetAllocStats(&stats);
+	printf("huge:     %" PRId64 " allocs, %" PRId64 " bytes\n", stats.nHugeAllocs, stats.nHugeBytes);
+	printf("advised:  %" PRId64 " allocs, %" PRId64 " bytes\n", stats.nAdvisedAllocs, stats.nAdvisedBytes);
+	printf("fallback: %" PRId64 " allocs, %" PRId64 " bytes\n", stats.nFallbackAllocs, stats.nFallbackBytes);
+}
+void		TestNative_Script(int argc, char * argv[])
+{
+	// a drag with a key held, then the window closes itself
+	static const NativeInputEvent script[] =
+	{
+		{ 1,	NATIVE_INPUT_MOUSE_MOVE,	100,	100 },
+		{ 2,	NATIVE_INPUT_KEY_DOWN,		'W',	0 },
+		{ 2,	NATIVE_INPUT_LEFT_DOWN,		100,	100 },
+		{ 3,	NATIVE_INPUT_MOUSE_MOVE,	150,	120 },
+		{ 4,	NATIVE_INPUT_LEFT_UP,		150,	120 },
+		{ 5,	NATIVE_INPUT_KEY_UP,		'W',	0 },
+		{ 6,	NATIVE_INPUT_CLOSE,		0,	0 },
+	};
+
+	if ( NativeInitialize() )
+	{
+		pMain = NativeCreateWindow(L"Script Test", WINDOW_WIDTH, WINDOW_HEIGHT);
+
+		if ( pMain )
+		{
+			NativeRegisterWindowCallbacks(pMain, NativeDebugGetWindowCallbacks());
+			NativeRegisterKeyboardCallbacks(pMain, NativeDebugGetKeyboardCallbacks());
+			NativeRegisterMouseCallbacks(pMain, NativeDebugGetMouseCallbacks());
+			NativeScriptInput(pMain, script, sizeof(script) / sizeof(script[ 0 ]));
+
+			int64_t nPolls = 0;
+			while ( NativeGetWindowCount() > 0 )
+			{
+				NativeInputPoll();
+				++nPolls;
+			}
+			printf("Closed after %" PRId64 " polls.\n", nPolls);
+
+			NativeDestroyWindow(pMain);
+		}
+		NativeTerminate();
+	}
+}
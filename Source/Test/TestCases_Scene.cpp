@@ -1,37 +1,133 @@
 #include "TestCases.h"
 #include "../Core/Renderer.h"
+#include "../Core/FrameEncoder.h"
+#include "../Core/FrameRing.h"
+#include "../Core/SplitFrame.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <thread>
 
 using namespace Graphics;
 
+extern Ptr<IScene>	TestScene_Dashboard(int argc, char * argv[]);
 extern Ptr<IScene>	TestScene_Effects(int argc, char * argv[]);
 extern Ptr<IScene>	TestScene_Minecraft(int argc, char * argv[]);
 extern Ptr<IScene>	TestScene_Mirror(int argc, char * argv[]);
+extern Ptr<IScene>	TestScene_SortLast(int argc, char * argv[]);
 extern Ptr<IScene>	TestScene_Water(int argc, char * argv[]);
 
+// Everything is off unless a case's setup turns it on.
+struct SceneOptions
+{
+	double dFrameBudget	= 0.0;		// ms, dynamic resolution if nonzero
+	bool bTemporal		= false;	// half size, temporally upsampled
+	bool bDirty		= false;	// redraw and present changed tiles only
+	double dTimerMs		= 0.0;		// render on demand, waking this often, if nonzero
+	const char * pOutput	= nullptr;	// Y4M stream of the presented frames, if set
+	const char * pRing	= nullptr;	// presents into this shared memory ring instead, see graphics ring
+	const char * pStill	= nullptr;	// renders one BMP of any size instead, tile by tile, no window
+	const char * pBatch	= nullptr;	// renders views around the scene to <pBatch>NNN.bmp on all cores, no window
+	const char * pSplit	= nullptr;	// split-frame over worker processes sharing this memory
+	bool bLatch		= false;	// late camera latching on a look around sent from another thread, closes by itself
+	Integer nMaxLatency	= 0;		// frames queued ahead of the screen, 0 leaves it to the swap chain
+};
+
 struct SceneTestCase
 {
 	const char * pName;
 	Ptr<Graphics::IScene>(*pScene)(int argc, char * argv[]);
+	void(*pSetup)(SceneOptions & options);	// nullptr keeps the defaults
 };
 
+// A move sent from another thread after the view was captured still
+// turns the view the next frame draws with.
+static void	CheckLateLatching(NativeWindow * pWindow, SceneRenderer & renderer, IScene & scene)
+{
+	SceneState * pState = scene.GetState();
+	ENSURE_NOT_NULL(pState);
+
+	auto send = [ pWindow ] (int x)
+	{
+		std::thread producer([ pWindow, x ] { NativeSendInput(pWindow, NATIVE_INPUT_MOUSE_MOVE, x, 300); });
+		producer.join();
+
+		// stopping hands over what the input thread has
+		NativeWindowStopInputThread(pWindow);
+		NativeWindowStartInputThread(pWindow);
+	};
+
+	// the first move only sets where the mouse is
+	send(400);
+	renderer.Update(0.0);
+	renderer.Draw();
+	renderer.Present();
+
+	Matrix44 captured = pState->GetViewTransform();
+	send(450);
+	renderer.Update(0.0);
+	bool bLatched = memcmp(&captured, &pState->GetViewTransform(), sizeof(Matrix44)) != 0;
+	renderer.Draw();
+	renderer.Present();
+
+	printf("Late input latched: %s\n", bLatched ? "yes" : "no");
+	ENSURE_TRUE(bLatched);
+}
+
+#define SPLIT_SETTLE_FRAMES	(30)
+#define SPLIT_BAND_TOLERANCE	(0.2)	// of the mean band time, slowest to fastest
+
+// Once the bands had time to settle, the workers take about as long.
+static void	CheckBandTimes(const SplitFrameCoordinator & renderer)
+{
+	double msMin	= renderer.GetBandAverageMs(0);
+	double msMax	= msMin;
+	double msSum	= 0.0;
+
+	for ( Integer i = 0; i < renderer.WorkerCount(); ++i )
+	{
+		const double ms = renderer.GetBandAverageMs(i);
+
+		msMin	= Min(msMin, ms);
+		msMax	= Max(msMax, ms);
+		msSum	+= ms;
+	}
+
+	const double dSpread = ( msMax - msMin ) * renderer.WorkerCount() / Max(msSum, 1e-6);
+	printf("Band times within %.0f%% of their mean, after %d frames.\n", dSpread * 100.0, static_cast< int >( renderer.GetFrameCount() ));
+	if ( renderer.GetFrameCount() >= SPLIT_SETTLE_FRAMES )
+	{
+		ENSURE_TRUE(dSpread <= SPLIT_BAND_TOLERANCE);
+	}
+}
+
 static SceneTestCase	tcScene[] =
 {
-	{"effects",	TestScene_Effects},
-	{"minecraft",	TestScene_Minecraft},
-	{"mirror",	TestScene_Mirror},
-	{"water",	TestScene_Water},
+	{"dashboard",		TestScene_Dashboard,	[ ] (SceneOptions & o) { o.bDirty = true; o.dTimerMs = 100.0; }},
+	{"effects",		TestScene_Effects,	nullptr},
+	{"minecraft",		TestScene_Minecraft,	nullptr},
+	{"minecraft-budget",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.dFrameBudget = 1000.0 / 60.0; }},
+	{"minecraft-temporal",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.bTemporal = true; }},
+	{"minecraft-y4m",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.pOutput = "minecraft.y4m"; }},
+	{"minecraft-ring",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.pRing = "/renderer-ring"; }},
+	{"minecraft-latch",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.bLatch = true; o.nMaxLatency = 1; }},
+	{"minecraft-batch",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.pBatch = "minecraft-"; }},
+	{"minecraft-split",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.pSplit = "/renderer-split"; }},
+	{"minecraft-still",	TestScene_Minecraft,	[ ] (SceneOptions & o) { o.pStill = "minecraft.bmp"; }},
+	{"mirror",		TestScene_Mirror,	nullptr},
+	{"sortlast",		TestScene_SortLast,	nullptr},
+	{"water",		TestScene_Water,	nullptr},
 };
 
 const wchar_t *		GetTitle(const char * pName)
 {
 	static char	bufWndTitle[ 256 ];
 	static wchar_t	bufWndTitleW[ 256 ];
-	size_t		nSize;
 
-	sprintf_s(bufWndTitle, "Scene %s", pName);
-	mbstowcs_s(&nSize, bufWndTitleW, bufWndTitle, 256);
+	snprintf(bufWndTitle, sizeof(bufWndTitle), "Scene %s", pName);
+	mbstowcs(bufWndTitleW, bufWndTitle, 256);
 
 	return bufWndTitleW;
 }
@@ -50,18 +146,177 @@ void	TestSuit_Scene(int argc, char * argv[])
 		return;
 	}
 
+	SceneOptions options;
+	if ( pCase->pSetup )
+	{
+		pCase->pSetup(options);
+	}
+
 	NativeInitialize();
+
+	if ( options.pStill )
+	{
+		// width, height after the case name, huge by default
+		const Integer nWidth	= argc > 1 ? Max(1, atoi(argv[ 1 ])) : 16384;
+		const Integer nHeight	= argc > 2 ? Max(1, atoi(argv[ 2 ])) : 16384;
+		TiledStillRenderer renderer;
+
+		scene = pCase->pScene(argc - 1, argv + 1);
+		if ( renderer.Render(*scene, nWidth, nHeight, options.pStill) )
+		{
+			printf("Wrote %s, %dx%d.\n", options.pStill, static_cast< int >( nWidth ), static_cast< int >( nHeight ));
+		}
+		else
+		{
+			printf("Failed to write %s.\n", options.pStill);
+		}
+
+		NativeTerminate();
+		return;
+	}
+	if ( options.pBatch )
+	{
+		// views, workers, path prefix after the case name
+		const Integer nViews	= argc > 1 ? Max(1, atoi(argv[ 1 ])) : 64;
+		const Integer nWorkers	= argc > 2 ? Max(0, atoi(argv[ 2 ])) : 0;
+		const char * pPrefix	= argc > 3 ? argv[ 3 ] : options.pBatch;
+		BatchRenderer renderer(320, 240, nWorkers);
+		std::vector<BatchView> views(nViews);
+
+		// an orbit, looking down at the middle
+		for ( Integer i = 0; i < nViews; ++i )
+		{
+			const float fYaw	= 2.0f * 3.14159265f * i / nViews;
+			char path[ 256 ];
+
+			snprintf(path, sizeof(path), "%s%03d.bmp", pPrefix, static_cast< int >( i ));
+			views[ i ].camera	= Transform::Identity();
+			views[ i ].camera.tx	= -6.0f * sinf(fYaw);
+			views[ i ].camera.ty	= 2.5f;
+			views[ i ].camera.tz	= -6.0f * cosf(fYaw);
+			views[ i ].camera.rx	= ConvertToRadians(25.0f);
+			views[ i ].camera.ry	= fYaw;
+			views[ i ].path		= path;
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		const Integer nFailed = renderer.Render([ pCase ] () { return pCase->pScene(0, nullptr); }, views);
+		double ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - begin ).count();
+
+		printf("%d views on %d workers in %.0f ms, %.1f views/s, %d failed.\n",
+		       static_cast< int >( nViews ), static_cast< int >( renderer.WorkerCount() ), ms, nViews * 1000.0 / ms, static_cast< int >( nFailed ));
+
+		NativeTerminate();
+		return;
+	}
+
+	if ( options.pSplit && argc > 2 && strcmp(argv[ 1 ], "worker") == 0 )
+	{
+		SplitFrameWorker worker;
+
+		// started by the coordinator, after it made the memory
+		ENSURE_TRUE(worker.Open(options.pSplit, atoi(argv[ 2 ])));
+		scene = pCase->pScene(0, nullptr);
+		worker.Run(*scene);
+
+		NativeTerminate();
+		return;
+	}
+	if ( options.pSplit )
+	{
+		// workers after the case name
+		const Integer nWorkers		= argc > 1 ? Max(1, atoi(argv[ 1 ])) : 4;
+		const char * workerArgs[]	= { "scene", pCase->pName, "worker" };
+
+		pWindow = NativeCreateWindow(GetTitle(TestCaseName()), 800, 600);
+		if ( pWindow )
+		{
+			RenderWindow window(pWindow);
+			SplitFrameCoordinator renderer(window, options.pSplit, nWorkers, workerArgs, 3);
+
+			scene = pCase->pScene(0, nullptr);
+			renderer.SwitchScene(*scene);
+			RenderMainLoop(pWindow, &renderer);
+
+			for ( Integer i = 0; i < renderer.WorkerCount(); ++i )
+			{
+				Rect band = renderer.GetBand(i);
+				printf("Worker %d: rows %d-%d, %.2f ms, %.2f ms average\n", static_cast< int >( i ), static_cast< int >( band.top ), static_cast< int >( band.bottom ),
+				       renderer.GetBandMs(i), renderer.GetBandAverageMs(i));
+			}
+			CheckBandTimes(renderer);
+		}
+
+		NativeDestroyWindow(pWindow);
+		NativeTerminate();
+		return;
+	}
+
 	pWindow = NativeCreateWindow(GetTitle(TestCaseName()), 800, 600);
 
 	if (pWindow)
 	{
 		RenderWindow window(pWindow);
-		SceneRenderer renderer(window);
+		Ptr<FrameRing> ring(options.pRing ? new FrameRing(options.pRing, window.GetWidth(), window.GetHeight()) : nullptr);
+		SceneRenderer renderer(window, ring.get());
 		
 		scene = pCase->pScene(argc - 1, argv + 1);
 		
+		renderer.SetFrameBudget(options.dFrameBudget);
+		renderer.SetTemporalUpsampling(options.bTemporal);
+		renderer.SetDirtyRendering(options.bDirty);
+		if ( options.pOutput )
+		{
+			FrameOutputDesc output = { FrameFileFormat::Y4M, options.pOutput, 2, 4, 60 };
+			renderer.SetOutput(&output);
+		}
+		renderer.SetMaxFrameLatency(options.nMaxLatency);
+		renderer.SetLateLatching(options.bLatch);
 		renderer.SwitchScene(*scene);
-		RenderMainLoop(pWindow, &renderer);
+
+		// a mouse move every 4 ms, swinging the view left and right
+		std::atomic<bool> bProducing(options.bLatch);
+		std::thread producer;
+		if ( options.bLatch )
+		{
+			CheckLateLatching(pWindow, renderer, *scene);
+
+			// with NATIVE_HEADLESS_FRAMES the run ends when that says
+			if ( !getenv("NATIVE_HEADLESS_FRAMES") )
+			{
+				NativeInputEvent close = { 300, NATIVE_INPUT_CLOSE, 0, 0 };
+				NativeScriptInput(pWindow, &close, 1);
+			}
+			producer = std::thread([ pWindow, &bProducing ] ()
+			{
+				for ( int i = 1; bProducing; ++i )
+				{
+					NativeSendInput(pWindow, NATIVE_INPUT_MOUSE_MOVE, 400 + static_cast< int >( 50.0f * sinf(i * 0.02f) ), 300);
+					std::this_thread::sleep_for(std::chrono::milliseconds(4));
+				}
+			});
+		}
+		if ( options.dTimerMs > 0.0 )
+		{
+			RenderOnDemandLoop(pWindow, &renderer, options.dTimerMs);
+		}
+		else
+		{
+			RenderMainLoop(pWindow, &renderer);
+		}
+		if ( options.pOutput && !renderer.SetOutput(nullptr) )
+		{
+			printf("Failed to write %s.\n", options.pOutput);
+		}
+		if ( options.bLatch )
+		{
+			bProducing = false;
+			producer.join();
+
+			InputLatency latency = renderer.GetInputLatency();
+			printf("Input to present: %.2f ms average, %.2f ms max, over %llu frames, %llu input dropped.\n",
+			       latency.msAverage, latency.msMax, static_cast< unsigned long long >( latency.nFrames ), static_cast< unsigned long long >( latency.nDropped ));
+		}
 	}
 
 	NativeDestroyWindow(pWindow);
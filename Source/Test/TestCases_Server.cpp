@@ -0,0 +1,122 @@
+#include "TestCases.h"
+#include "../Core/RenderServer.h"
+
+#include <chrono>
+#include <cstdlib>
+
+using namespace Graphics;
+
+extern Ptr<IScene>	TestScene_Minecraft(int argc, char * argv[]);
+extern Ptr<IScene>	TestScene_Water(int argc, char * argv[]);
+
+#define SERVER_PATH	"/tmp/renderer.sock"
+
+// path, workers
+static void	TestServer_Run(int argc, char * argv[])
+{
+	const char * pPath	= argc > 0 ? argv[ 0 ] : SERVER_PATH;
+	const Integer nWorkers	= argc > 1 ? Max(0, atoi(argv[ 1 ])) : 0;
+	RenderServer server(nWorkers);
+
+	NativeInitialize();
+
+	server.RegisterScene("minecraft", [ ] () { return TestScene_Minecraft(0, nullptr); });
+	server.RegisterScene("water", [ ] () { return TestScene_Water(0, nullptr); });
+
+	printf("Serving %s.\n", pPath);
+	fflush(stdout);
+	ENSURE_TRUE(server.Run(pPath));
+
+	RenderServer::Stats stats = server.GetStats();
+	printf("%llu jobs in %llu batches, %llu scene loads, render %.2f ms, encode %.2f ms per job.\n",
+	       static_cast< unsigned long long >( stats.nJobs ),
+	       static_cast< unsigned long long >( stats.nBatches ),
+	       static_cast< unsigned long long >( stats.nLoads ),
+	       stats.nJobs ? stats.msRender / stats.nJobs : 0.0,
+	       stats.nJobs ? stats.msEncode / stats.nJobs : 0.0);
+
+	NativeTerminate();
+}
+
+// jobs, path, "stop"; sends an orbit of minecraft
+// views all at once, saves the first and reports requests per second
+static void	TestServer_Bench(int argc, char * argv[])
+{
+	const Integer nJobs	= argc > 0 ? Max(1, atoi(argv[ 0 ])) : 256;
+	const char * pPath	= argc > 1 ? argv[ 1 ] : SERVER_PATH;
+	const bool bStop	= argc > 2 && strcmp(argv[ 2 ], "stop") == 0;
+	RenderClient client;
+
+	if ( !client.Connect(pPath) )
+	{
+		printf("No server on %s, start one with: server run %s\n", pPath, pPath);
+		return;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+
+	// a sender thread, so neither side waits on a full socket
+	std::thread sender([ & ] ()
+	{
+		RenderJobRequest request = {};
+		request.type	= RENDER_JOB_RENDER;
+		request.format	= static_cast< u32 >( FrameFileFormat::QOI );
+		request.nWidth	= 160;
+		request.nHeight	= 120;
+		strcpy(request.scene, "minecraft");
+
+		for ( Integer i = 0; i < nJobs; ++i )
+		{
+			const float fYaw	= 2.0f * 3.14159265f * i / nJobs;
+			request.iJob		= static_cast< u32 >( i );
+			request.camera[ 0 ]	= -6.0f * sinf(fYaw);
+			request.camera[ 1 ]	= 2.5f;
+			request.camera[ 2 ]	= -6.0f * cosf(fYaw);
+			request.camera[ 3 ]	= ConvertToRadians(25.0f);
+			request.camera[ 4 ]	= fYaw;
+			request.camera[ 5 ]	= 0.0f;
+			ENSURE_TRUE(client.Send(request));
+		}
+	});
+
+	RenderJobResponse response;
+	std::vector<u8> image;
+	double msRender = 0.0;
+	double msEncode = 0.0;
+	u64 nBytes = 0;
+	for ( Integer i = 0; i < nJobs; ++i )
+	{
+		ENSURE_TRUE(client.Receive(&response, &image));
+		ENSURE_TRUE(response.status == RENDER_JOB_OK);
+
+		msRender	+= response.msRender;
+		msEncode	+= response.msEncode;
+		nBytes		+= response.nBytes;
+		if ( response.iJob == 0 )
+		{
+			FILE * pFile = fopen("server-0.qoi", "wb");
+			ENSURE_NOT_NULL(pFile);
+			ENSURE_TRUE(fwrite(image.data(), 1, image.size(), pFile) == image.size());
+			fclose(pFile);
+		}
+	}
+	sender.join();
+
+	double ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - begin ).count();
+	printf("%d jobs in %.0f ms, %.1f requests/s, %.1f KB per image, render %.2f ms, encode %.2f ms per job.\n",
+	       static_cast< int >( nJobs ), ms, nJobs * 1000.0 / ms, nBytes / 1024.0 / nJobs, msRender / nJobs, msEncode / nJobs);
+
+	if ( bStop )
+	{
+		RenderJobRequest request = {};
+		request.type = RENDER_JOB_STOP;
+		ENSURE_TRUE(client.Send(request));
+	}
+}
+
+static TestCase		cases[] =
+{
+	{"run",		TestServer_Run},
+	{"bench",	TestServer_Bench},
+};
+TestSuitEntry(Server)
@@ -15,7 +15,8 @@ const char *		LoadglTF(const char * filename)
 	char * buffer = NULL;
 	long cnt = 0;
 
-	if ( fopen_s(&file, filename, "r") )
+	file = fopen(filename, "r");
+	if ( !file )
 		return NULL;
 	
 	if ( fseek(file, 0, SEEK_END) )
@@ -26,7 +27,7 @@ const char *		LoadglTF(const char * filename)
 		return NULL;
 
 	buffer = (char *)malloc(cnt + 1);
-	if (buffer) cnt = fread_s(buffer, cnt, 1, cnt, file);
+	if (buffer) cnt = fread(buffer, 1, cnt, file);
 	else cnt = 0;
 	buffer[cnt] = '\0';
 
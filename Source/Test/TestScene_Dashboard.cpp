@@ -0,0 +1,174 @@
+#include "TestCases.h"
+
+#include <cmath>
+
+namespace Graphics
+{
+	// --------------------------------------------------------------------------
+	// Scene Objects
+	// --------------------------------------------------------------------------
+
+	namespace
+	{
+		// a cube around the entity origin, placed by its transform
+		struct TextureCube : Entity
+		{
+			Ptr<Renderable>		m_renderable;
+			float			m_size;
+
+			TextureCube(Vector3 pos, float size)
+				: m_size(size)
+			{
+				transform.translation.xyz = pos;
+			}
+			virtual void		Initialize(RenderContext & context, VertexBuffer & vertexBuffer) override
+			{
+				ENSURE_TRUE(ROCube::IsVertexFormatCompatible(vertexBuffer.GetVertexFormat()));
+
+				m_renderable.reset(new ROCube(Vector3 { 0.0f, 0.0f, 0.0f }, m_size));
+				m_renderable->Initialize(vertexBuffer);
+			}
+			virtual void		Draw(RenderContext & context) override
+			{
+				m_renderable->Draw(context);
+			}
+			virtual bool		GetBounds(Vector3 * pMin, Vector3 * pMax) override
+			{
+				// the diagonal bounds every rotation
+				float r		= m_size * 0.5f * 1.7321f;
+				*pMin		= Vector3 { -r, -r, -r };
+				*pMax		= Vector3 { r, r, r };
+				return true;
+			}
+		};
+
+		// spins for a second every few seconds, idle in between
+		struct Spinner : TextureCube
+		{
+			double			m_time = 0.0;
+
+			Spinner(Vector3 pos, float size)
+				: TextureCube(pos, size)
+			{
+			}
+			// the angle follows the time, however coarse the updates
+			virtual void		Update(double ms) override
+			{
+				m_time += ms;
+
+				double spun = floor(m_time / 3000.0) * 1000.0 + Min(fmod(m_time, 3000.0), 1000.0);
+				transform.ry = static_cast< float >( fmod(spun * 0.005, 2.0 * 3.14159265) );
+			}
+			bool			IsSpinning() const
+			{
+				return fmod(m_time, 3000.0) < 1000.0;
+			}
+		};
+	}
+
+	// --------------------------------------------------------------------------
+	// Scene
+	// --------------------------------------------------------------------------
+
+	class TestScene_Dashboard : public IScene
+	{
+	public:
+		virtual void			OnLoad(Device & device, RenderContext & context) override
+		{
+			m_device		= &device;
+			m_context		= &context;
+
+			// Setup shader
+
+			m_texEffect.reset(new TextureEffect(L"Resources/grass.bmp"));
+			m_texEffect->Initialize(device);
+
+			m_texVertices		= m_device->CreateVertexBuffer(m_texEffect->GetVSInputFormat());
+
+			// Setup display
+
+			Rect rect		= context.GetRenderTarget().GetRect();
+
+			// Setup scene
+
+			m_root			= NewObject<Root>();
+			m_texGroup		= NewObject<EntityGroup>();
+			m_camera		= NewObject<Camera>();
+
+			m_root->AddChild(m_camera);
+			m_root->AddChild(m_texGroup);
+
+			// static panels, one of them animated
+			for ( Integer row = 0; row < 3; ++row )
+			{
+				for ( Integer col = 0; col < 4; ++col )
+				{
+					Vector3 pos = { col * 1.5f - 2.25f, 1.5f - row * 1.5f, 5.0f };
+					if ( row == 1 && col == 2 )
+					{
+						m_spinner = NewObject<Spinner>(pos, 0.8f);
+						m_texGroup->AddChild(m_spinner);
+					}
+					else
+					{
+						m_texGroup->AddChild(NewObject<TextureCube>(pos, 0.8f));
+					}
+				}
+			}
+
+			m_camera->SetAspectRatio(static_cast< float >( rect.right - rect.left ) / ( rect.bottom - rect.top ));
+
+			SceneObject::InitializeAll(m_root, *m_context, m_texVertices);
+		}
+		virtual void			OnUnload() override
+		{
+		}
+		virtual void			OnUpdate(double ms) override
+		{
+			SceneObject::UpdateAll(m_root, ms);
+		}
+		virtual bool			IsAnimated() override
+		{
+			return m_spinner->IsSpinning();
+		}
+		virtual void			OnInvalidate(DirtyRegion & region) override
+		{
+			Entity::InvalidateAll(m_texGroup, m_camera->GetViewTransform() * m_camera->GetProjTransform(), region);
+		}
+		virtual void			OnDraw() override
+		{
+			m_texEffect->CBSetViewTransform(m_camera->GetViewTransform());
+			m_texEffect->CBSetProjTransform(m_camera->GetProjTransform());
+			m_texEffect->Apply(*m_context);
+			m_camera->ObserveEntity(m_texGroup);
+			m_camera->DrawObservedEntity(*m_context, *m_texEffect);
+		}
+
+	private:
+		template <typename T, typename ... TArgs>
+		T *			NewObject(TArgs ... args)
+		{
+			T * pObject = new T(args ...);
+			m_sceneObjects.emplace_back(Ptr<T>(pObject));
+			return pObject;
+		}
+
+		Device *			m_device;
+		RenderContext *			m_context;
+
+		std::vector<Ptr<SceneObject>>	m_sceneObjects;
+
+		EntityGroup *			m_texGroup;
+		VertexBuffer			m_texVertices;
+		Ptr<TextureEffect>		m_texEffect;
+
+		Root *				m_root;
+		Camera *			m_camera;
+		Spinner *			m_spinner;
+	};
+}
+
+Ptr<Graphics::IScene>	TestScene_Dashboard(int argc, char * argv[])
+{
+	return Ptr<Graphics::IScene>(new Graphics::TestScene_Dashboard());
+}
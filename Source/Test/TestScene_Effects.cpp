@@ -174,31 +174,31 @@ namespace Graphics
 		}
 		virtual void			OnDraw() override
 		{
-			RenderTarget * targets[]	= { &m_rdtgLeftRect, &m_rdtgRightRect };
-			Camera * cameras[]		= { m_cameraMain, m_cameraTopView };
 			Effect * effects[]		= { m_rgbEffect.get(), m_texEffect.get(), m_bpEffect.get() };
 			EntityGroup * groups[]		= { m_rgbGroup, m_texGroup, m_bpGroup };
 
-			for ( Integer iView = 0; iView < 2; ++iView )
+			// Both views from one geometry pass, POSITION stays in world space
+			View views[] =
 			{
-				RenderTarget * target = targets[ iView ];
-				Camera * camera = cameras[ iView ];
+				{ m_cameraMain->GetViewTransform(), m_cameraMain->GetProjTransform(), m_rdtgLeftRect, false },
+				{ m_cameraTopView->GetViewTransform(), m_cameraTopView->GetProjTransform(), m_rdtgRightRect, false },
+			};
+			m_context->RSSetViews(views, 2);
 
-				m_context->SetRenderTarget(*target);
-
-				for ( Integer i = 0; i < 3; ++i )
-				{
-					Effect * effect = effects[ i ];
-					EntityGroup * group = groups[ i ];
-
-					effect->CBSetViewTransform(camera->GetViewTransform());
-					effect->CBSetProjTransform(camera->GetProjTransform());
-					if ( i == 2 ) static_cast< BlinnPhongEffect * >( effect )->CBSetCameraPosition(m_controller->pos);
-					effect->Apply(*m_context);
-					camera->ObserveEntity(group);
-					camera->DrawObservedEntity(*m_context, *effect);
-				}
+			for ( Integer i = 0; i < 3; ++i )
+			{
+				Effect * effect = effects[ i ];
+				EntityGroup * group = groups[ i ];
+
+				effect->CBSetViewTransform(M44Identity());
+				effect->CBSetProjTransform(M44Identity());
+				if ( i == 2 ) static_cast< BlinnPhongEffect * >( effect )->CBSetCameraPosition(m_controller->pos);
+				effect->Apply(*m_context);
+				m_cameraMain->ObserveEntity(group);
+				m_cameraMain->DrawObservedEntity(*m_context, *effect);
 			}
+
+			m_context->RSSetViews(nullptr, 0);
 		}
 
 	private:
@@ -120,6 +120,9 @@ namespace Graphics
 			m_controller->ConnectTo(m_camera, ConnectType::SAME);
 
 			SceneObject::InitializeAll(m_root, *m_context, m_texVertices);
+
+			m_state.Register(m_texGroup);
+			m_state.Register(m_camera);
 		}
 		virtual void			OnUnload() override
 		{
@@ -130,11 +133,19 @@ namespace Graphics
 		}
 		virtual void			OnDraw() override
 		{
-			m_texEffect->CBSetViewTransform(m_camera->GetViewTransform());
+			m_texEffect->CBSetViewTransform(m_state.GetViewTransform());
 			m_texEffect->CBSetProjTransform(m_camera->GetProjTransform());
 			m_texEffect->Apply(*m_context);
 			m_camera->ObserveEntity(m_texGroup);
-			m_camera->DrawObservedEntity(*m_context, *m_texEffect);
+			m_camera->DrawObservedEntity(*m_context, *m_texEffect, m_state);
+		}
+		virtual Camera *		GetCamera() override
+		{
+			return m_camera;
+		}
+		virtual SceneState *		GetState() override
+		{
+			return &m_state;
 		}
 
 	private:
@@ -159,6 +170,8 @@ namespace Graphics
 		Camera *			m_camera;
 		Controller *			m_controller;
 		Terrain *			m_terrain;
+
+		SceneState			m_state;
 	};
 }
 
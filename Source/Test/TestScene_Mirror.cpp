@@ -137,6 +137,7 @@ namespace Graphics
 
 			// ASSERT(m_efObject->GetVSInputFormat() == m_efMirror->GetVSInputFormat());
 			m_vbTexture		= m_device->CreateVertexBuffer(m_efObject->GetVSInputFormat());
+			m_vbWorld		= m_device->CreateVertexBuffer(m_efObject->GetVSInputFormat());
 
 			// Setup display
 
@@ -192,6 +193,14 @@ namespace Graphics
 			DepthStencilState dssDefault = { true, true, DepthWriteMask::ALL, 0 };
 			DepthStencilState dssWriteStencil = { true, false, DepthWriteMask::ZERO, 0xff };
 
+			// 0. terrain to world space once, reused by every pass below
+			m_vbWorld.Reset();
+			m_ctxScreen->SOSetTarget(m_vbWorld);
+			m_efObject->ApplyStreamOut(*m_ctxScreen);
+			m_camera->ObserveEntity(m_terrain);
+			m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+			m_ctxScreen->SOResetTarget();
+
 			Mirror * pMirrorList[] = { m_mirror1, m_mirror2 };
 
 			for ( Mirror * pMirror : pMirrorList )
@@ -203,11 +212,7 @@ namespace Graphics
 
 				// 2. main cam - draw object
 				m_ctxScreen->RSSetFlipHorizontal(false);
-				m_efObject->CBSetViewTransform(m_camera->GetViewTransform());
-				m_efObject->CBSetProjTransform(m_camera->GetProjTransform());
-				m_efObject->Apply(*m_ctxScreen);
-				m_camera->ObserveEntity(m_terrain);
-				m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+				DrawTerrain(m_camera->GetViewTransform());
 
 				// 3. reset stencil to 0, enable stencil write, disable depth write
 				m_ctxScreen->OMSetDepthStencilState(dssWriteStencil);
@@ -230,15 +235,20 @@ namespace Graphics
 				Vector3 posMirror = pMirror->transform.translation.xyz + pMirror->m_center;
 				Vector3 normMirror = V3Transform(-V3UnitZ(), pMirror->transform.GetRotationXYZMatrix());
 				m_camera->transform.GetInvertedMirroredMatrix(posMirror, normMirror, &viewTransform);
-				m_efObject->CBSetViewTransform(viewTransform);
-				m_efObject->CBSetProjTransform(m_camera->GetProjTransform());
-				m_efObject->Apply(*m_ctxScreen);
-				m_camera->ObserveEntity(m_terrain);
-				m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+				DrawTerrain(viewTransform);
 			}
 		}
 
 	private:
+		void			DrawTerrain(const Matrix44 & viewTransform)
+		{
+			m_efObject->CBSetModelTransform(M44Identity());
+			m_efObject->CBSetViewTransform(viewTransform);
+			m_efObject->CBSetProjTransform(m_camera->GetProjTransform());
+			m_efObject->Apply(*m_ctxScreen);
+			m_ctxScreen->Draw(m_vbWorld, 0, m_vbWorld.Count());
+		}
+
 		template <typename T, typename ... TArgs>
 		T *			NewObject(TArgs ... args)
 		{
@@ -270,6 +280,7 @@ namespace Graphics
 
 		// Shared resources
 		VertexBuffer			m_vbTexture;
+		VertexBuffer			m_vbWorld;	// terrain in world space, refilled every frame
 
 		// Terrain resources
 		Ptr<TextureEffect>		m_efObject;
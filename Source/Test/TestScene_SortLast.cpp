@@ -0,0 +1,187 @@
+#include "TestCases.h"
+
+#include <cstdlib>
+#include <thread>
+
+namespace Graphics
+{
+	// --------------------------------------------------------------------------
+	// Scene Objects
+	// --------------------------------------------------------------------------
+
+	namespace
+	{
+		struct TextureCube
+		{
+			Ptr<Renderable>		m_renderable;
+			Vector3			m_center;
+			float			m_size;
+
+			TextureCube(Vector3 center, float size)
+				: m_center(center)
+				, m_size(size)
+			{
+			}
+		};
+
+		// cols [0, nWidth), rows [nDepthBegin, nDepthEnd) of the field
+		struct CubeField : Entity
+		{
+			std::vector<TextureCube>	m_cubes;
+
+			CubeField(Integer nWidth, Integer nDepthBegin, Integer nDepthEnd)
+			{
+				m_cubes.reserve(nWidth * ( nDepthEnd - nDepthBegin ));
+
+				for ( Integer d = nDepthBegin; d < nDepthEnd; ++d )
+				{
+					for ( Integer w = 0; w < nWidth; ++w )
+					{
+						// uneven heights so partitions overlap on screen
+						float h = static_cast< float >( ( w * 7 + d * 13 ) % 5 ) * 0.25f;
+						m_cubes.emplace_back(Vector3 { w + 0.5f, h, d + 0.5f }, 1.0f);
+					}
+				}
+			}
+			virtual void		Initialize(RenderContext & context, VertexBuffer & vertexBuffer) override
+			{
+				ENSURE_TRUE(ROCube::IsVertexFormatCompatible(vertexBuffer.GetVertexFormat()));
+
+				for ( TextureCube & cube : m_cubes )
+				{
+					cube.m_renderable.reset(new ROCube(cube.m_center, cube.m_size));
+					cube.m_renderable->Initialize(vertexBuffer);
+				}
+			}
+			virtual void		Draw(RenderContext & context) override
+			{
+				for ( TextureCube & cube : m_cubes )
+				{
+					cube.m_renderable->Draw(context);
+				}
+			}
+		};
+	}
+
+	// --------------------------------------------------------------------------
+	// Scene
+	// --------------------------------------------------------------------------
+
+	class TestScene_SortLast : public IScene
+	{
+	public:
+		TestScene_SortLast(Integer nPartitions, Integer nFieldSize)
+			: m_nPartitions(nPartitions)
+			, m_nFieldSize(nFieldSize)
+		{
+		}
+
+		virtual void			OnLoad(Device & device, RenderContext & context) override
+		{
+			m_device		= &device;
+			m_context		= &context;
+
+			// Setup partitions, one effect each since constant buffers
+			// are written while drawing
+
+			m_sortLast.reset(new SortLastRenderer(device, context, m_nPartitions));
+
+			for ( Integer i = 0; i < m_nPartitions; ++i )
+			{
+				m_effects.emplace_back(new TextureEffect(L"Resources/grid.bmp"));
+				m_effects.back()->Initialize(device);
+			}
+
+			// 36 vertices per cube
+			m_vbTexture		= m_device->CreateVertexBuffer(m_effects[ 0 ]->GetVSInputFormat(), m_nFieldSize * m_nFieldSize * 36);
+
+			// Setup scene
+
+			Rect rect		= context.GetRenderTarget().GetRect();
+
+			m_root			= NewObject<Root>();
+			m_camera		= NewObject<Camera>();
+			m_controller		= NewObject<Controller>();
+
+			m_camera->SetAspectRatio(static_cast< float >( rect.right - rect.left ) / ( rect.bottom - rect.top ));
+
+			m_controller->ConnectTo(m_camera, ConnectType::SAME);
+			m_controller->pos = { -4.0f, 8.0f, -4.0f };
+			m_controller->hRotDeg = 45.0f;
+			m_controller->vRotDeg = -30.0f;
+
+			m_root->AddChild(m_camera);
+			m_root->AddChild(m_controller);
+
+			// bands of rows, partition i gets rows [i * n / N, (i + 1) * n / N)
+			for ( Integer i = 0; i < m_nPartitions; ++i )
+			{
+				CubeField * pField = NewObject<CubeField>(m_nFieldSize,
+									  i * m_nFieldSize / m_nPartitions,
+									  ( i + 1 ) * m_nFieldSize / m_nPartitions);
+				m_fields.push_back(pField);
+				m_root->AddChild(pField);
+			}
+
+			SceneObject::InitializeAll(m_root, *m_context, m_vbTexture);
+		}
+		virtual void			OnUnload() override
+		{
+		}
+		virtual void			OnUpdate(double ms) override
+		{
+			SceneObject::UpdateAll(m_root, ms);
+		}
+		virtual void			OnDraw() override
+		{
+			Matrix44 viewTransform = m_camera->GetViewTransform();
+			Matrix44 projTransform = m_camera->GetProjTransform();
+
+			m_sortLast->Draw([ & ] (Integer iPartition, RenderContext & context)
+			{
+				TextureEffect & effect = *m_effects[ iPartition ];
+
+				effect.CBSetViewTransform(viewTransform);
+				effect.CBSetProjTransform(projTransform);
+				effect.Apply(context);
+				Entity::DrawAll(m_fields[ iPartition ], context, effect);
+			});
+		}
+
+	private:
+		template <typename T, typename ... TArgs>
+		T *			NewObject(TArgs ... args)
+		{
+			T * pObject = new T(args ...);
+			m_sceneObjects.emplace_back(Ptr<T>(pObject));
+			return pObject;
+		}
+
+		Device *			m_device;
+		RenderContext *			m_context;
+
+		Integer				m_nPartitions;
+		Integer				m_nFieldSize;
+		Ptr<SortLastRenderer>		m_sortLast;
+		std::vector<Ptr<TextureEffect>>	m_effects;	// per partition
+		std::vector<CubeField *>	m_fields;	// per partition
+
+		// Scene structure
+		std::vector<Ptr<SceneObject>>	m_sceneObjects;
+		Root *				m_root;
+		Camera *			m_camera;
+		Controller *			m_controller;
+
+		VertexBuffer			m_vbTexture;
+	};
+}
+
+// args: [partitions = hardware threads] [field size = 64]
+Ptr<Graphics::IScene>	TestScene_SortLast(int argc, char * argv[])
+{
+	Integer nPartitions = argc >= 1 ? atoi(argv[ 0 ]) : std::thread::hardware_concurrency();
+	Integer nFieldSize = argc >= 2 ? atoi(argv[ 1 ]) : 64;
+
+	return Ptr<Graphics::IScene>(new Graphics::TestScene_SortLast(Graphics::Max<Integer>(1, nPartitions),
+								       Graphics::Max<Integer>(1, nFieldSize)));
+}
@@ -1,5 +1,7 @@
 #include "TestCases.h"
 
+#include <cstdlib>
+
 namespace Graphics
 {
 	// --------------------------------------------------------------------------
@@ -117,6 +119,11 @@ namespace Graphics
 	class TestScene_Water : public IScene
 	{
 	public:
+		TestScene_Water(ShadingRate reflectionRate)
+			: m_reflectionRate(reflectionRate)
+		{
+		}
+
 		virtual void			OnLoad(Device & device, RenderContext & context) override
 		{
 			m_device		= &device;
@@ -137,6 +144,7 @@ namespace Graphics
 
 			// ASSERT(m_efObject->GetVSInputFormat() == m_efMirror->GetVSInputFormat());
 			m_vbTexture		= m_device->CreateVertexBuffer(m_efObject->GetVSInputFormat());
+			m_vbWorld		= m_device->CreateVertexBuffer(m_efObject->GetVSInputFormat());
 
 			// Setup display
 
@@ -236,6 +244,14 @@ namespace Graphics
 				BlendOp::ADD,	    // opAlpha
 			};
 
+			// 0. terrain to world space once, reused by every pass below
+			m_vbWorld.Reset();
+			m_ctxScreen->SOSetTarget(m_vbWorld);
+			m_efObject->ApplyStreamOut(*m_ctxScreen);
+			m_camera->ObserveEntity(m_terrain);
+			m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+			m_ctxScreen->SOResetTarget();
+
 			m_ctxScreen->OMSetDepthStencilState(dssDefault);
 			m_ctxScreen->OMSetBlendState(bsDefault);
 
@@ -244,11 +260,7 @@ namespace Graphics
 
 			// 2. main cam - draw object
 			m_ctxScreen->RSSetFlipHorizontal(false);
-			m_efObject->CBSetViewTransform(m_camera->GetViewTransform());
-			m_efObject->CBSetProjTransform(m_camera->GetProjTransform());
-			m_efObject->Apply(*m_ctxScreen);
-			m_camera->ObserveEntity(m_terrain);
-			m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+			DrawTerrain(m_camera->GetViewTransform());
 
 			m_ctxScreen->OMSetDepthStencilState(dssWriteStencil);
 
@@ -268,19 +280,26 @@ namespace Graphics
 			m_ctxScreen->OMSetBlendState(bsEnable);
 			m_ctxScreen->RSSetFlipHorizontal(true);
 
-			// 6. mirror cam - draw object
+			// 6. mirror cam - draw object, the blended reflection shades coarse
 			Matrix44 viewTransform;
 			Vector3 posMirror = m_mirror->transform.translation.xyz + m_mirror->m_center;
 			Vector3 normMirror = V3Transform(-V3UnitZ(), m_mirror->transform.GetRotationXYZMatrix());
 			m_camera->transform.GetInvertedMirroredMatrix(posMirror, normMirror, &viewTransform);
+			m_ctxScreen->RSSetShadingRate(m_reflectionRate);
+			DrawTerrain(viewTransform);
+			m_ctxScreen->RSSetShadingRate(ShadingRate::RATE_1X1);
+		}
+
+	private:
+		void			DrawTerrain(const Matrix44 & viewTransform)
+		{
+			m_efObject->CBSetModelTransform(M44Identity());
 			m_efObject->CBSetViewTransform(viewTransform);
 			m_efObject->CBSetProjTransform(m_camera->GetProjTransform());
 			m_efObject->Apply(*m_ctxScreen);
-			m_camera->ObserveEntity(m_terrain);
-			m_camera->DrawObservedEntity(*m_ctxScreen, *m_efObject);
+			m_ctxScreen->Draw(m_vbWorld, 0, m_vbWorld.Count());
 		}
 
-	private:
 		template <typename T, typename ... TArgs>
 		T *			NewObject(TArgs ... args)
 		{
@@ -311,16 +330,22 @@ namespace Graphics
 
 		// Shared resources
 		VertexBuffer			m_vbTexture;
+		VertexBuffer			m_vbWorld;	// terrain in world space, refilled every frame
 
 		// Terrain resources
 		Ptr<TextureEffect>		m_efObject;
 
 		// Mirror resources
 		Ptr<TextureEffect>		m_efMirror;
+		ShadingRate			m_reflectionRate;
 	};
 }
 
+// args: [reflection shading rate: 0 = 1x1, 1 = 2x1, 2 = 2x2, 3 = 4x4, default 2]
 Ptr<Graphics::IScene>	TestScene_Water(int argc, char * argv[])
 {
-	return Ptr<Graphics::IScene>(new Graphics::TestScene_Water());
+	Integer nRate = argc >= 1 ? atoi(argv[ 0 ]) : 2;
+
+	return Ptr<Graphics::IScene>(new Graphics::TestScene_Water(
+		static_cast< Graphics::ShadingRate >( Graphics::Bound<Integer>(0, nRate, 3) )));
 }
\ No newline at end of file